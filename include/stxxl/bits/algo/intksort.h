@@ -15,8 +15,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <vector>
 #include <stxxl/bits/common/types.h>
 #include <stxxl/bits/unused.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/parallel.h>
 
 
@@ -367,6 +370,206 @@ void classify_block(type * begin, type * end, type_key * & out, int_type * bucke
     STXXL_UNUSED(K);
 }
 
+namespace radix_sort_local
+{
+    const unsigned digit_bits = 8;
+    const int_type K = int_type(1) << digit_bits;
+    //! below this many elements a comparison sort is faster
+    const int_type min_radix_size = 256;
+    //! elements per chunk and thread in the parallel passes
+    const int_type min_chunk_size = 65536;
+
+    template <typename type_key>
+    struct key_less
+    {
+        bool operator () (const type_key & a, const type_key & b) const
+        {
+            return a.key < b.key;
+        }
+    };
+
+    template <typename type_key>
+    inline int_type digit(const type_key & x, uint64 offset, unsigned shift)
+    {
+        return int_type(((uint64(x.key) - offset) >> shift) & (K - 1));
+    }
+
+    // moves begin..end-1 to dst + pos[d] by their digits d, advancing pos.
+    // The elements go through small per-digit write-combining buffers that
+    // are flushed a few cache lines at a time, so the K output streams do
+    // not evict each other from the cache and the TLB. Ranges smaller than
+    // the buffers are moved directly, they would not fill them anyway.
+    template <typename type_key>
+    void scatter(const type_key * begin, const type_key * end, type_key * dst,
+                 int_type * pos, uint64 offset, unsigned shift)
+    {
+        const int_type W = STXXL_MAX<int_type>(4, 256 / sizeof(type_key));
+        if (end - begin < K * W)
+        {
+            for (const type_key * p = begin; p < end; p++)
+                dst[pos[digit(*p, offset, shift)]++] = *p;
+            return;
+        }
+        simple_vector<type_key> wc(K * W);     // not zero-filled
+        int_type fill[K];
+        std::fill(fill, fill + K, 0);
+        for (const type_key * p = begin; p < end; p++)
+        {
+            const int_type d = digit(*p, offset, shift);
+            wc[d * W + fill[d]] = *p;
+            if (++fill[d] == W)
+            {
+                std::copy(&wc[d * W], &wc[d * W] + W, dst + pos[d]);
+                pos[d] += W;
+                fill[d] = 0;
+            }
+        }
+        for (int_type d = 0; d < K; d++)
+        {
+            std::copy(&wc[d * W], &wc[d * W] + fill[d], dst + pos[d]);
+            pos[d] += fill[d];
+        }
+    }
+
+    // stable distribution of src[0..n-1] to dst by the digit at shift.
+    // Each of the nchunks contiguous chunks gets its own histogram; the
+    // digit-major prefix sum places the elements of chunk c after those of
+    // chunks < c. If bucket_begin is given, it receives the K+1 bucket
+    // boundaries.
+    template <typename type_key>
+    void radix_pass(const type_key * src, int_type n, type_key * dst,
+                    uint64 offset, unsigned shift, int_type nchunks,
+                    int_type * bucket_begin = NULL)
+    {
+        std::vector<int_type> bucket(nchunks * K, 0);
+#if STXXL_PARALLEL
+        #pragma omp parallel for if (nchunks > 1)
+#endif
+        for (int_type c = 0; c < nchunks; c++)
+        {
+            int_type * cbucket = &bucket[c * K];
+            for (const type_key * p = src + n * c / nchunks; p < src + n * (c + 1) / nchunks; p++)
+                cbucket[digit(*p, offset, shift)]++;
+        }
+        int_type sum = 0;
+        for (int_type i = 0; i < K; i++)
+        {
+            if (bucket_begin)
+                bucket_begin[i] = sum;
+            for (int_type c = 0; c < nchunks; c++)
+            {
+                int_type current = bucket[c * K + i];
+                bucket[c * K + i] = sum;
+                sum += current;
+            }
+        }
+        if (bucket_begin)
+            bucket_begin[K] = sum;
+#if STXXL_PARALLEL
+        #pragma omp parallel for if (nchunks > 1)
+#endif
+        for (int_type c = 0; c < nchunks; c++)
+            scatter(src + n * c / nchunks, src + n * (c + 1) / nchunks, dst,
+                    &bucket[c * K], offset, shift);
+    }
+
+    // LSD radix sort of the lowest key_bits bits of key - offset; returns
+    // a or b, whichever holds the result.
+    template <typename type_key>
+    type_key * lsd_sort(type_key * a, int_type n, type_key * b,
+                        uint64 offset, unsigned key_bits, int_type nchunks)
+    {
+        for (unsigned shift = 0; shift < key_bits; shift += digit_bits)
+        {
+            radix_pass(a, n, b, offset, shift, nchunks);
+            std::swap(a, b);
+        }
+        return a;
+    }
+
+    // sorts a..aEnd-1 with b as buffer, the result ends up in a
+    template <typename type_key>
+    void sort_range(type_key * a, type_key * aEnd, type_key * b, int_type max_threads)
+    {
+        const int_type n = aEnd - a;
+        if (n < min_radix_size)
+        {
+            std::stable_sort(a, aEnd, key_less<type_key>());
+            return;
+        }
+
+        typename type_key::key_type min_key = a->key, max_key = a->key;
+        for (type_key * p = a + 1; p < aEnd; p++)
+        {
+            if (p->key < min_key)
+                min_key = p->key;
+            else if (max_key < p->key)
+                max_key = p->key;
+        }
+        const uint64 offset = uint64(min_key);
+        const uint64 range = uint64(max_key) - offset;
+        if (range == 0)
+            return;
+        const unsigned key_bits = ilog2_floor(range) + 1;
+        const int_type nchunks = STXXL_MAX<int_type>(1, STXXL_MIN<int_type>(max_threads, n / min_chunk_size));
+
+        // narrow keys, or few enough to stay in the cache: LSD passes only
+        if (key_bits <= 2 * digit_bits || n < min_chunk_size)
+        {
+            if (lsd_sort(a, n, b, offset, key_bits, nchunks) != a)
+                std::copy(b, b + n, a);
+            return;
+        }
+
+        // one MSD pass on the most significant digit into b, then each
+        // bucket is sorted on its own; small buckets in parallel, one per
+        // thread, large ones with all threads
+        const unsigned shift = key_bits - digit_bits;
+        int_type bucket_begin[K + 1];
+        radix_pass(a, n, b, offset, shift, nchunks, bucket_begin);
+
+        std::vector<int_type> small;
+        for (int_type i = 0; i < K; i++)
+        {
+            const int_type size = bucket_begin[i + 1] - bucket_begin[i];
+            if (size > n / nchunks)
+                sort_range(b + bucket_begin[i], b + bucket_begin[i + 1], a + bucket_begin[i], max_threads);
+            else if (size > 0)
+                small.push_back(i);
+        }
+        const int_type nsmall = small.size();
+#if STXXL_PARALLEL
+        #pragma omp parallel for schedule(dynamic)
+#endif
+        for (int_type j = 0; j < nsmall; j++)
+        {
+            const int_type i = small[j];
+            sort_range(b + bucket_begin[i], b + bucket_begin[i + 1], a + bucket_begin[i], 1);
+        }
+        std::copy(b, b + n, a);
+    }
+}
+
+// stable radix sort of a..aEnd-1 by the integer member key (of up to 64
+// bits), using b as a buffer of the same size; the result ends up in a.
+// Only the digits of key - min(key) up to the highest bit of
+// max(key) - min(key) are sorted, so narrow key ranges need few passes.
+// Wide keys get one MSD pass, after which the buckets are sorted by LSD
+// passes that mostly run in the cache. All passes use per-thread
+// histograms and write-combining buffers; runs of less than a few hundred
+// elements are sorted by comparisons.
+template <typename type_key>
+void
+radix_sort(type_key * a, type_key * aEnd, type_key * b)
+{
+#if STXXL_PARALLEL && defined(STXXL_PARALLEL_MODE)
+    const int_type max_threads = omp_get_max_threads();
+#else
+    const int_type max_threads = 1;
+#endif
+    radix_sort_local::sort_range(a, aEnd, b, max_threads);
+}
+
 __STXXL_END_NAMESPACE
 
 #endif // !STXXL_INTKSORT_HEADER
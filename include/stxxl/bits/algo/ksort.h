@@ -208,15 +208,6 @@ namespace ksort_local
         run_type * run;
         run = *runs;
         int_type run_size = (*runs)->size();
-        key_type offset = 0;
-        const int log_k1 = ilog2_ceil((m2 * block_type::size * sizeof(type_key_) / STXXL_L2_SIZE) ?
-                                      (m2 * block_type::size * sizeof(type_key_) / STXXL_L2_SIZE) : 2);
-        const int log_k2 = ilog2_floor(m2 * Blocks1->size) - log_k1 - 1;
-        STXXL_VERBOSE("log_k1: " << log_k1 << " log_k2:" << log_k2);
-        const int_type k1 = 1 << log_k1;
-        const int_type k2 = 1 << log_k2;
-        int_type * bucket1 = new int_type[k1];
-        int_type * bucket2 = new int_type[k2];
         int_type i;
 
         disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
@@ -227,18 +218,11 @@ namespace ksort_local
             read_reqs[i] = Blocks1[i].read(bids[i]);
         }
 
-        unsigned_type k = 0;
-        const int shift1 = (int)(sizeof(key_type) * 8 - log_k1);
-        const int shift2 = shift1 - log_k2;
-        STXXL_VERBOSE("shift1: " << shift1 << " shift2:" << shift2);
-
-        for ( ; k < nruns; k++)
+        for (unsigned_type k = 0; k < nruns; k++)
         {
             run = runs[k];
             run_size = run->size();
 
-            std::fill(bucket1, bucket1 + k1, 0);
-
             type_key_ * ref_ptr = refs1;
             for (i = 0; i < run_size; i++)
             {
@@ -248,48 +232,33 @@ namespace ksort_local
                 read_reqs[i]->wait();
                 bm->delete_block(bids[i]);
 
-                classify_block(Blocks1[i].begin(), Blocks1[i].end(), ref_ptr, bucket1, offset, shift1, keyobj);
+                for (type * p = Blocks1[i].begin(); p < Blocks1[i].end(); p++, ref_ptr++)
+                {
+                    ref_ptr->key = keyobj(*p);
+                    ref_ptr->ptr = p;
+                }
             }
 
-            exclusive_prefix_sum(bucket1, k1);
-            classify(refs1, refs1 + run_size * Blocks1->size, refs2, bucket1,
-                     offset, shift1);
+            radix_sort(refs1, ref_ptr, refs2);
 
             int_type out_block = 0;
             int_type out_pos = 0;
             unsigned_type next_run_size = (k < nruns - 1) ? (runs[k + 1]->size()) : 0;
 
-            // recurse on each bucket
-            type_key_ * c = refs2;
-            type_key_ * d = refs1;
             block_type * cur_blk = Blocks2;
             block_type * end_blk = Blocks2 + next_run_size;
             write_completion_handler<block_type, bid_type> * next_read = next_run_reads;
 
-            for (i = 0; i < k1; i++)
-            {
-                type_key_ * cEnd = refs2 + bucket1[i];
-                type_key_ * dEnd = refs1 + bucket1[i];
-
-                l1sort(c, cEnd, d, bucket2, k2,
-                       offset + (key_type(1) << key_type(shift1)) * key_type(i), shift2);         // key_type,key_type,... paranoia
-
-                write_out(
-                    d, dEnd, cur_blk, end_blk,
-                    out_block, out_pos, *run, next_read, bids,
-                    write_reqs, read_reqs, it, keyobj);
-
-                c = cEnd;
-                d = dEnd;
-            }
+            write_out(
+                refs1, ref_ptr, cur_blk, end_blk,
+                out_block, out_pos, *run, next_read, bids,
+                write_reqs, read_reqs, it, keyobj);
 
             std::swap(Blocks1, Blocks2);
         }
 
         wait_all(write_reqs, m2);
 
-        delete[] bucket1;
-        delete[] bucket2;
         delete[] refs1;
         delete[] refs2;
         delete[] Blocks1;
@@ -21,6 +21,7 @@
 
 
 #include <stxxl/bits/stream/stream.h>
+#include <stxxl/bits/stream/shuffle.h>
 #include <stxxl/scan>
 #include <stxxl/stack>
 
@@ -372,6 +373,33 @@ void random_shuffle(stxxl::vector_iterator<Tp_, AllocStrategy_, SzTp_, DiffTp_,
     stxxl::random_shuffle(first, last, rand, M);
 }
 
+//! \brief Parallel and reproducible external random shuffle.
+//!
+//! Uses \c stream::shuffle: the elements are sent to random partitions on
+//! disk and each partition is shuffled in internal memory, with random
+//! numbers from counter-based generators. The permutation only depends on
+//! \c seed, not on the number of threads.
+//! \param first begin of the range to shuffle
+//! \param last end of the range to shuffle
+//! \param M number of bytes for internal use
+//! \param seed seed of the permutation, 0 takes one from \c get_next_seed()
+//! \param num_threads threads for drawing random numbers and in-memory shuffles, 0 keeps the default
+//! \return the seed used
+template <typename ExtIterator_>
+stxxl::uint64 parallel_random_shuffle(ExtIterator_ first, ExtIterator_ last, unsigned_type M,
+                                      stxxl::uint64 seed = 0, unsigned num_threads = 0)
+{
+    typedef typename stream::streamify_traits<ExtIterator_>::stream_type input_stream;
+    typedef stream::shuffle<input_stream> shuffle_type;
+
+    scoped_thread_budget budget(num_threads);
+    input_stream in = stream::streamify(first, last);
+    // consumes the whole input before the output overwrites it
+    shuffle_type shuffled(in, M, seed, last - first);
+    stream::materialize(shuffled, first, last);
+    return shuffled.get_seed();
+}
+
 //! \}
 
 __STXXL_END_NAMESPACE
@@ -15,13 +15,128 @@
 #ifndef STXXL_SCAN_HEADER
 #define STXXL_SCAN_HEADER
 
+#include <vector>
+
 #include <stxxl/bits/namespace.h>
+#include <stxxl/bits/parallel.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_ostream.h>
+#include <stxxl/bits/mng/buf_writer.h>
+#include <stxxl/bits/mng/block_prefetcher.h>
+#include <stxxl/bits/algo/async_schedule.h>
 
 
 __STXXL_BEGIN_NAMESPACE
 
+namespace scan_local {
+
+//! Number of blocks the parallel scans process at once.
+inline unsigned_type batch_size(int_type nbuffers)
+{
+#if STXXL_PARALLEL && defined(STXXL_PARALLEL_MODE)
+    const int_type nthreads = omp_get_max_threads();
+#else
+    const int_type nthreads = 1;
+#endif
+    // leave the other buffers for reading ahead
+    return STXXL_MAX(int_type(1), STXXL_MIN(nthreads, nbuffers / 2));
+}
+
+//! The blocks covering [begin, end) and the range of elements in each.
+template <typename ExtIterator>
+struct block_range
+{
+    typedef typename ExtIterator::bids_container_iterator bid_iterator_type;
+
+    bid_iterator_type begin_bid, end_bid;
+    unsigned_type first_offset, last_offset, nblocks;
+
+    block_range(const ExtIterator & begin, const ExtIterator & end)
+        : begin_bid(begin.bid()),
+          end_bid(end.bid() + ((end.block_offset()) ? 1 : 0)),
+          first_offset(begin.block_offset()),
+          last_offset(end.block_offset()),
+          nblocks(end_bid - begin_bid)
+    { }
+
+    //! first element of the range in block \c b
+    unsigned_type begin_of(unsigned_type b) const
+    {
+        return (b == 0) ? first_offset : 0;
+    }
+
+    //! end of the range in block \c b
+    unsigned_type end_of(unsigned_type b) const
+    {
+        return (b + 1 == nblocks && last_offset) ? last_offset : unsigned_type(ExtIterator::block_type::size);
+    }
+};
+
+//! Reads consecutive blocks with prefetching and hands them out in batches.
+template <typename BlockType, typename BIDIteratorType>
+class block_batches : private noncopyable
+{
+    typedef block_prefetcher<BlockType, BIDIteratorType> prefetcher_type;
+
+    int_type * prefetch_seq;
+    prefetcher_type * prefetcher;
+    std::vector<BlockType *> batch;
+    unsigned_type first;
+
+public:
+    //! \param begin first block to read
+    //! \param end end of the blocks to read
+    //! \param nbuffers number of prefetch buffers
+    //! \param size maximum number of blocks in a batch
+    block_batches(BIDIteratorType begin, BIDIteratorType end, int_type nbuffers, unsigned_type size)
+        : first(0)
+    {
+        const unsigned_type ndisks = config::get_instance()->disks_number();
+        const int_type seq_length = end - begin;
+        prefetch_seq = new int_type[seq_length];
+        nbuffers = STXXL_MAX(int_type(2 * ndisks), STXXL_MAX(nbuffers - 1, int_type(2 * size)));
+        compute_prefetch_schedule(begin, end, prefetch_seq, nbuffers, ndisks);
+        prefetcher = new prefetcher_type(begin, end, prefetch_seq, nbuffers);
+
+        for (unsigned_type i = 0; i < size && int_type(i) < seq_length; ++i)
+            batch.push_back(prefetcher->pull_block());
+    }
+
+    ~block_batches()
+    {
+        delete prefetcher;
+        delete[] prefetch_seq;
+    }
+
+    //! Blocks of the current batch, empty after the last batch.
+    const std::vector<BlockType *> & blocks() const
+    {
+        return batch;
+    }
+
+    //! Index of the first block of the current batch.
+    unsigned_type first_block() const
+    {
+        return first;
+    }
+
+    //! Hands back the blocks of the current batch and waits for the next.
+    void next()
+    {
+        first += batch.size();
+        std::vector<BlockType *> next_batch;
+        for (unsigned_type j = 0; j < batch.size(); ++j)
+        {
+            BlockType * block = batch[j];
+            if (prefetcher->block_consumed(block))
+                next_batch.push_back(block);
+        }
+        batch.swap(next_batch);
+    }
+};
+
+} // namespace scan_local
+
 //! \addtogroup stlalgo
 //! \{
 
@@ -291,8 +406,309 @@ ExtIterator find(ExtIterator begin, ExtIterator end, const EqualityComparable &
     return cur;
 }
 
+/*!
+ * \brief Parallel external equivalent of std::for_each.
+ *
+ * Like stxxl::for_each, but the blocks are read ahead by a prefetcher and
+ * handed out in batches, and the elements of the blocks of a batch are
+ * processed by several threads. \c functor is called concurrently and in no
+ * particular order, it must be safe to call from several threads. Without
+ * the parallel mode, the blocks are processed in order by the calling thread.
+ *
+ * \param begin object of model of \c ext_random_access_iterator concept
+ * \param end object of model of \c ext_random_access_iterator concept
+ * \param functor function object of model of \c std::UnaryFunction concept
+ * \param nbuffers number of buffers (blocks) for internal use (should be at least 2 * max(D, threads))
+ * \return function object \c functor after it has been applied to the each element of the given range
+ */
+template <typename ExtIterator, typename UnaryFunction>
+UnaryFunction parallel_for_each(ExtIterator begin, ExtIterator end, UnaryFunction functor, int_type nbuffers)
+{
+    if (begin == end)
+        return functor;
+
+    typedef typename ExtIterator::block_type block_type;
+    typedef scan_local::block_range<ExtIterator> range_type;
+    typedef scan_local::block_batches<block_type, typename range_type::bid_iterator_type> batches_type;
+
+    begin.flush();     // flush container
+
+    const range_type range(begin, end);
+    batches_type in(range.begin_bid, range.end_bid, nbuffers, scan_local::batch_size(nbuffers));
+
+    for ( ; !in.blocks().empty(); in.next())
+    {
+        const int_type n = in.blocks().size();
+#if STXXL_PARALLEL
+        #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+        for (int_type j = 0; j < n; ++j)
+        {
+            block_type * block = in.blocks()[j];
+            const unsigned_type b = in.first_block() + j;
+            for (unsigned_type i = range.begin_of(b); i < range.end_of(b); ++i)
+                functor(block->elem[i]);
+        }
+    }
+
+    return functor;
+}
+
+
+/*!
+ * \brief Parallel external equivalent of std::for_each (mutating).
+ *
+ * Like stxxl::for_each_m, but the elements of a batch of blocks are modified
+ * by several threads, see stxxl::parallel_for_each. The blocks are written
+ * back in order.
+ *
+ * \param begin object of model of \c ext_random_access_iterator concept
+ * \param end object of model of \c ext_random_access_iterator concept
+ * \param functor object of model of \c std::UnaryFunction concept
+ * \param nbuffers number of buffers (blocks) for internal use (should be at least 4 * max(D, threads))
+ * \return function object \c functor after it has been applied to the each element of the given range
+ */
+template <typename ExtIterator, typename UnaryFunction>
+UnaryFunction parallel_for_each_m(ExtIterator begin, ExtIterator end, UnaryFunction functor, int_type nbuffers)
+{
+    if (begin == end)
+        return functor;
+
+    typedef typename ExtIterator::block_type block_type;
+    typedef scan_local::block_range<ExtIterator> range_type;
+    typedef scan_local::block_batches<block_type, typename range_type::bid_iterator_type> batches_type;
+
+    begin.flush();     // flush container
+
+    const range_type range(begin, end);
+    const unsigned_type k = scan_local::batch_size(nbuffers / 2);
+    batches_type in(range.begin_bid, range.end_bid, nbuffers / 2, k);
+    buffered_writer<block_type> writer(STXXL_MAX(unsigned_type(nbuffers / 2), 2 * k), nbuffers / 4);
+
+    // the blocks of a batch are modified in copies, the copies are written
+    std::vector<block_type *> out(k);
+    for (unsigned_type j = 0; j < k; ++j)
+        out[j] = writer.get_free_block();
+
+    for ( ; !in.blocks().empty(); in.next())
+    {
+        const int_type n = in.blocks().size();
+#if STXXL_PARALLEL
+        #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+        for (int_type j = 0; j < n; ++j)
+        {
+            const block_type * block = in.blocks()[j];
+            const unsigned_type b = in.first_block() + j;
+            std::copy(block->elem, block->elem + block_type::size, out[j]->elem);
+            for (unsigned_type i = range.begin_of(b); i < range.end_of(b); ++i)
+                functor(out[j]->elem[i]);
+        }
+        for (int_type j = 0; j < n; ++j)
+            out[j] = writer.write(out[j], *(range.begin_bid + (in.first_block() + j)));
+    }
+
+    return functor;
+}
+
+
+/*!
+ * \brief Parallel external equivalent of std::generate.
+ *
+ * Assigns <tt>generator(i)</tt> to the \a i-th element of the range [first,
+ * last). Whole blocks are filled by several threads and written in order,
+ * see stxxl::parallel_for_each. Unlike for stxxl::generate, \c generator
+ * gets the position of the element, since it is called concurrently and in
+ * no particular order.
+ *
+ * \param begin object of model of \c ext_random_access_iterator concept
+ * \param end object of model of \c ext_random_access_iterator concept
+ * \param generator function object that returns the element for a position
+ * \param nbuffers number of buffers (blocks) for internal use (should be at least 2 * max(D, threads))
+ */
+template <typename ExtIterator, typename Generator>
+void parallel_generate(ExtIterator begin, ExtIterator end, Generator generator, int_type nbuffers)
+{
+    typedef typename ExtIterator::block_type block_type;
+    typedef typename ExtIterator::size_type size_type;
+
+    size_type pos = 0;
+
+    // the beginning and the end of partial blocks are set in the container
+    while (begin.block_offset())
+    {
+        if (begin == end)
+            return;
+
+        *begin = generator(pos++);
+        ++begin;
+    }
+    const ExtIterator tail = end - end.block_offset();
+
+    if (begin != tail)
+    {
+        begin.flush();     // flush container
+
+        const unsigned_type nblocks = tail.bid() - begin.bid();
+        const unsigned_type k = scan_local::batch_size(nbuffers);
+        buffered_writer<block_type> writer(STXXL_MAX(unsigned_type(nbuffers), 2 * k), nbuffers / 2);
+
+        std::vector<block_type *> out(k);
+        for (unsigned_type j = 0; j < k; ++j)
+            out[j] = writer.get_free_block();
+
+        typename ExtIterator::const_iterator block_begin = begin;
+        for (unsigned_type first = 0; first < nblocks; first += k)
+        {
+            const int_type n = STXXL_MIN(k, nblocks - first);
+#if STXXL_PARALLEL
+            #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+            for (int_type j = 0; j < n; ++j)
+            {
+                const size_type offset = pos + size_type(first + j) * block_type::size;
+                for (unsigned_type i = 0; i < block_type::size; ++i)
+                    out[j]->elem[i] = generator(offset + i);
+            }
+            for (int_type j = 0; j < n; ++j)
+            {
+                out[j] = writer.write(out[j], *(begin.bid() + (first + j)));
+                block_begin.block_externally_updated();
+                block_begin += block_type::size;
+            }
+        }
+        pos += size_type(nblocks) * block_type::size;
+        begin = tail;
+    }
+
+    for ( ; begin != end; ++begin)
+        *begin = generator(pos++);
+
+    begin.flush();
+}
+
+
+/*!
+ * \brief Parallel external equivalent of std::find.
+ *
+ * Like stxxl::find, but the blocks of a batch are searched by several
+ * threads, see stxxl::parallel_for_each. Returns the first matching
+ * position.
+ *
+ * \param begin object of model of \c ext_random_access_iterator concept
+ * \param end object of model of \c ext_random_access_iterator concept
+ * \param value value that is equality comparable to the ExtIterator's value type
+ * \param nbuffers number of buffers (blocks) for internal use (should be at least 2 * max(D, threads))
+ * \return first iterator \c i in the range [begin,end) such that *( \c i ) == \c value, if no
+ *         such exists then \c end
+ */
+template <typename ExtIterator, typename EqualityComparable>
+ExtIterator parallel_find(ExtIterator begin, ExtIterator end, const EqualityComparable & value, int_type nbuffers)
+{
+    if (begin == end)
+        return end;
+
+    typedef typename ExtIterator::block_type block_type;
+    typedef scan_local::block_range<ExtIterator> range_type;
+    typedef scan_local::block_batches<block_type, typename range_type::bid_iterator_type> batches_type;
+
+    begin.flush();     // flush container
+
+    const range_type range(begin, end);
+    batches_type in(range.begin_bid, range.end_bid, nbuffers, scan_local::batch_size(nbuffers));
+
+    for ( ; !in.blocks().empty(); in.next())
+    {
+        const int_type n = in.blocks().size();
+        // position of the first match in each block, size if none
+        std::vector<unsigned_type> found(n, block_type::size);
+#if STXXL_PARALLEL
+        #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+        for (int_type j = 0; j < n; ++j)
+        {
+            const block_type * block = in.blocks()[j];
+            const unsigned_type b = in.first_block() + j;
+            for (unsigned_type i = range.begin_of(b); i < range.end_of(b); ++i)
+            {
+                if (block->elem[i] == value)
+                {
+                    found[j] = i;
+                    break;
+                }
+            }
+        }
+        for (int_type j = 0; j < n; ++j)
+        {
+            if (found[j] != block_type::size)
+                return begin - begin.block_offset() + (in.first_block() + j) * block_type::size + found[j];
+        }
+    }
+
+    return end;
+}
+
+
+/*!
+ * \brief External equivalent of std::transform_reduce.
+ *
+ * Returns \c init combined by \c reduce with <tt>transform(x)</tt> of all
+ * elements \a x of [begin, end). The elements of a batch of blocks are
+ * processed by several threads, see stxxl::parallel_for_each, so \c reduce
+ * must be associative and commutative. The blocks are reduced one by one,
+ * their results are combined in order.
+ *
+ * \param begin object of model of \c ext_random_access_iterator concept
+ * \param end object of model of \c ext_random_access_iterator concept
+ * \param init initial value of the result
+ * \param reduce binary function object that combines two results
+ * \param transform unary function object that computes the result of an element
+ * \param nbuffers number of buffers (blocks) for internal use (should be at least 2 * max(D, threads))
+ * \return the combined result
+ */
+template <typename ExtIterator, typename Type, typename BinaryFunction, typename UnaryFunction>
+Type transform_reduce(ExtIterator begin, ExtIterator end, Type init,
+                      BinaryFunction reduce, UnaryFunction transform, int_type nbuffers)
+{
+    if (begin == end)
+        return init;
+
+    typedef typename ExtIterator::block_type block_type;
+    typedef scan_local::block_range<ExtIterator> range_type;
+    typedef scan_local::block_batches<block_type, typename range_type::bid_iterator_type> batches_type;
+
+    begin.flush();     // flush container
+
+    const range_type range(begin, end);
+    batches_type in(range.begin_bid, range.end_bid, nbuffers, scan_local::batch_size(nbuffers));
+
+    for ( ; !in.blocks().empty(); in.next())
+    {
+        const int_type n = in.blocks().size();
+        std::vector<Type> partial(n, init);
+#if STXXL_PARALLEL
+        #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+        for (int_type j = 0; j < n; ++j)
+        {
+            const block_type * block = in.blocks()[j];
+            const unsigned_type b = in.first_block() + j;
+            unsigned_type i = range.begin_of(b);
+            Type result = transform(block->elem[i]);
+            for (++i; i < range.end_of(b); ++i)
+                result = reduce(result, transform(block->elem[i]));
+            partial[j] = result;
+        }
+        for (int_type j = 0; j < n; ++j)
+            init = reduce(init, partial[j]);
+    }
+
+    return init;
+}
+
 //! \}
 
+
 __STXXL_END_NAMESPACE
 
 #endif // !STXXL_SCAN_HEADER
@@ -37,6 +37,7 @@
 #include <stxxl/bits/algo/inmemsort.h>
 #include <stxxl/bits/parallel.h>
 #include <stxxl/bits/common/is_sorted.h>
+#include <stxxl/bits/common/trace.h>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -77,6 +78,7 @@ namespace sort_local
     {
         typedef typename block_type::bid_type bid_type;
         STXXL_VERBOSE1("stxxl::create_runs nruns=" << nruns << " m=" << _m);
+        scoped_trace trace("sort", "run formation", "runs", nruns);
 
         int_type m2 = _m / 2;
         block_manager * bm = block_manager::get_instance();
@@ -133,10 +135,13 @@ namespace sort_local
                 bm->delete_block(bids1[i]);
 
             check_sort_settings();
-            potentially_parallel::
-            sort(make_element_iterator(Blocks1, 0),
-                 make_element_iterator(Blocks1, run_size * block_type::size),
-                 cmp);
+            {
+                scoped_trace sort_trace("sort", "sort run", "blocks", run_size);
+                potentially_parallel::
+                sort(make_element_iterator(Blocks1, 0),
+                     make_element_iterator(Blocks1, run_size * block_type::size),
+                     cmp);
+            }
 
             STXXL_VERBOSE1("stxxl::create_runs start waiting write_reqs");
             if (k > 0)
@@ -173,10 +178,13 @@ namespace sort_local
             bm->delete_block(bids1[i]);
 
         check_sort_settings();
-        potentially_parallel::
-        sort(make_element_iterator(Blocks1, 0),
-             make_element_iterator(Blocks1, run_size * block_type::size),
-             cmp);
+        {
+            scoped_trace sort_trace("sort", "sort run", "blocks", run_size);
+            potentially_parallel::
+            sort(make_element_iterator(Blocks1, 0),
+                 make_element_iterator(Blocks1, run_size * block_type::size),
+                 cmp);
+        }
 
         STXXL_VERBOSE1("stxxl::create_runs start waiting write_reqs");
         wait_all(write_reqs, m2);
@@ -306,6 +314,9 @@ namespace sort_local
         typedef run_cursor2<block_type, prefetcher_type> run_cursor_type;
         typedef sort_helper::run_cursor2_cmp<block_type, prefetcher_type, value_cmp> run_cursor2_cmp_type;
 
+        scoped_trace trace("sort", "merge", "runs", nruns);
+        trace.set_arg("blocks", out_run->size());
+
         run_type consume_seq(out_run->size());
 
         int_type * prefetch_seq = new int_type[out_run->size()];
@@ -14,16 +14,16 @@
 #ifndef STXXL_STABLE_KSORT_HEADER
 #define STXXL_STABLE_KSORT_HEADER
 
-// it is a first try: distribution sort without sampling
-// I rework the stable_ksort when I would have a time
-
+#include <vector>
+#include <algorithm>
 
 #include <stxxl/bits/mng/mng.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_ostream.h>
-#include <stxxl/bits/common/simple_vector.h>
+#include <stxxl/bits/mng/buf_writer.h>
 #include <stxxl/bits/algo/intksort.h>
 #include <stxxl/bits/algo/sort_base.h>
+#include <stxxl/bits/common/rand.h>
 #include <stxxl/bits/common/utils.h>
 
 
@@ -41,19 +41,6 @@ __STXXL_BEGIN_NAMESPACE
  */
 namespace stable_ksort_local
 {
-    template <class type_, class type_key>
-    void classify_block(type_ * begin, type_ * end, type_key * & out, int_type * bucket, unsigned_type offset, unsigned shift)
-    {
-        for (type_ * p = begin; p < end; p++, out++) // count & create references
-        {
-            out->ptr = p;
-            typename type_::key_type key = p->key();
-            int_type ibucket = (key - offset) >> shift;
-            out->key = key;
-            bucket[ibucket]++;
-        }
-    }
-
     template <typename type>
     struct type_key
     {
@@ -78,388 +65,388 @@ namespace stable_ksort_local
         return a.key > b.key;
     }
 
-
-    template <typename BIDType_, typename AllocStrategy_>
-    class bid_sequence
-    {
-    public:
-        typedef BIDType_ bid_type;
-        typedef bid_type & reference;
-        typedef AllocStrategy_ alloc_strategy;
-        typedef typename simple_vector<bid_type>::size_type size_type;
-        typedef typename simple_vector<bid_type>::iterator iterator;
-
-    protected:
-        simple_vector<bid_type> * bids;
-        alloc_strategy alloc_strategy_;
-
-    public:
-        bid_sequence() { }
-        bid_sequence(size_type size_)
-        {
-            bids = new simple_vector<bid_type>(size_);
-            block_manager * mng = block_manager::get_instance();
-            mng->new_blocks(alloc_strategy_, bids->begin(), bids->end());
-        }
-        void init(size_type size_)
-        {
-            bids = new simple_vector<bid_type>(size_);
-            block_manager * mng = block_manager::get_instance();
-            mng->new_blocks(alloc_strategy_, bids->begin(), bids->end());
-        }
-        reference operator [] (size_type i)
-        {
-            size_type size_ = size();             // cache size in a register
-            if (i < size_)
-                return *(bids->begin() + i);
-
-            block_manager * mng = block_manager::get_instance();
-            simple_vector<bid_type> * larger_bids = new simple_vector<bid_type>((i + 1) * 2);
-            std::copy(bids->begin(), bids->end(), larger_bids->begin());
-            mng->new_blocks(alloc_strategy_, larger_bids->begin() + size_, larger_bids->end());
-            delete bids;
-            bids = larger_bids;
-            return *(larger_bids->begin() + i);
-        }
-        size_type size() { return bids->size(); }
-        iterator begin() { return bids->begin(); }
-        ~bid_sequence()
-        {
-            block_manager::get_instance()->delete_blocks(bids->begin(), bids->end());
-            delete bids;
-        }
-    };
-
+    //! Sample sort of the records of a vector by their integer keys.
+    //!
+    //! The input is distributed into buckets by splitters chosen from a
+    //! sample of the keys, with an extra bucket for every splitter holding
+    //! only records equal to it, so skewed keys and keys with many
+    //! duplicates give balanced buckets. Buckets that fit into memory are
+    //! sorted there with a stable radix sort of (key, pointer) pairs,
+    //! while the next bucket is read; larger buckets are distributed again.
+    //! Equal-key buckets are copied unchanged. Distribution and copying
+    //! preserve the input order, so the sort is stable.
     template <typename ExtIterator_>
-    void distribute(
-        bid_sequence<typename ExtIterator_::vector_type::block_type::bid_type,
-                     typename ExtIterator_::vector_type::alloc_strategy_type> * bucket_bids,
-        int64 * bucket_sizes,
-        const int_type nbuckets,
-        const int_type lognbuckets,
-        ExtIterator_ first,
-        ExtIterator_ last,
-        const int_type nread_buffers,
-        const int_type nwrite_buffers)
+    class sorter
     {
         typedef typename ExtIterator_::vector_type::value_type value_type;
         typedef typename value_type::key_type key_type;
         typedef typename ExtIterator_::block_type block_type;
-        typedef buf_istream<typename ExtIterator_::block_type,
-                            typename ExtIterator_::bids_container_iterator> buf_istream_type;
-
-        int_type i = 0;
+        typedef typename block_type::bid_type bid_type;
+        typedef typename ExtIterator_::vector_type::alloc_strategy_type alloc_strategy;
+        typedef type_key<value_type> type_key_;
+        typedef std::vector<bid_type> bid_vector_type;
+        typedef buf_ostream<block_type, typename ExtIterator_::bids_container_iterator> buf_ostream_type;
 
-        buf_istream_type in(first.bid(), last.bid() + ((first.block_offset()) ? 1 : 0),
-                            nread_buffers);
+        struct bucket
+        {
+            bid_vector_type bids;
+            int64 size;
+            bool equal_keys;            // all records have the same key
 
-        buffered_writer<block_type> out(
-            nbuckets + nwrite_buffers,
-            nwrite_buffers);
+            bucket() : size(0), equal_keys(false) { }
+        };
 
-        unsigned_type * bucket_block_offsets = new unsigned_type[nbuckets];
-        unsigned_type * bucket_iblock = new unsigned_type[nbuckets];
-        block_type ** bucket_blocks = new block_type *[nbuckets];
+        //! The blocks of a bucket being read into memory.
+        struct loaded_bucket
+        {
+            std::vector<block_type *> blocks;
+            std::vector<request_ptr> reqs;
+        };
+
+        buf_ostream_type & out;
+        const unsigned_type m;          // blocks of memory besides the output buffers
+        const unsigned_type nbuffers;   // read and write buffers during distribution
+        const unsigned_type max_buckets;
+        int64 capacity;                 // records of a bucket sorted in memory while the next is read
+        int64 capacity_single;          // records sorted in memory if nothing else is read
+        random_number_counter rng;
+        block_manager * bm;
+        alloc_strategy alloc;
+        unsigned_type distributions;
 
-        std::fill(bucket_sizes, bucket_sizes + nbuckets, 0);
-        std::fill(bucket_iblock, bucket_iblock + nbuckets, 0);
-        std::fill(bucket_block_offsets, bucket_block_offsets + nbuckets, 0);
+    public:
+        sorter(buf_ostream_type & out_, unsigned_type m_, unsigned_type ndisks) :
+            out(out_),
+            m(m_),
+            nbuffers(2 * ndisks),
+            max_buckets(m_ - 2 * nbuffers),
+            rng(0x5a3c1e7d),
+            bm(block_manager::get_instance()),
+            distributions(0)
+        {
+            // two buckets in memory: the one being sorted with two arrays of
+            // references, and the next one being read
+            capacity = int64(m / 2 - 1) * block_type::raw_size / (sizeof(value_type) + 2 * sizeof(type_key_));
+            capacity = STXXL_MAX<int64>(capacity, 1);
+            capacity_single = int64(m - 1) * block_type::raw_size / (sizeof(value_type) + 2 * sizeof(type_key_));
+        }
 
-        for (i = 0; i < nbuckets; i++)
-            bucket_blocks[i] = out.get_free_block();
+        //! Number of distribution passes, including recursive ones.
+        unsigned_type get_distributions() const
+        {
+            return distributions;
+        }
 
+        //! Sorts the \c n records starting at index \c skip of block \c bids[0] and writes them to \c out.
+        template <typename BidIterator>
+        void sort(BidIterator bids, unsigned_type skip, int64 n)
+        {
+            if (n <= capacity_single)
+            {
+                loaded_bucket b;
+                load(bids, skip, n, b);
+                sort_loaded(b, skip, n);
+                return;
+            }
+            std::vector<bucket> buckets;
+            distribute(bids, skip, n, buckets);
+            sort_buckets(buckets);
+        }
 
-        ExtIterator_ cur = first - first.block_offset();
+    private:
+        static unsigned_type blocks_of(unsigned_type skip, int64 n)
+        {
+            return unsigned_type(div_ceil(skip + n, block_type::size));
+        }
 
-        // skip part of the block before first untouched
-        for ( ; cur != first; cur++)
-            ++in;
+        template <typename BidIterator>
+        void load(BidIterator bids, unsigned_type skip, int64 n, loaded_bucket & b)
+        {
+            const unsigned_type nblocks = blocks_of(skip, n);
+            b.blocks.resize(nblocks);
+            b.reqs.resize(nblocks);
+            for (unsigned_type i = 0; i < nblocks; ++i)
+            {
+                b.blocks[i] = new block_type;
+                b.reqs[i] = b.blocks[i]->read(bids[i]);
+            }
+        }
 
+        //! Sorts a bucket read by \c load(), writes it to the output and frees its memory.
+        void sort_loaded(loaded_bucket & b, unsigned_type skip, int64 n)
+        {
+            type_key_ * refs1 = new type_key_[n];
+            type_key_ * refs2 = new type_key_[n];
+            type_key_ * ref = refs1;
+            for (unsigned_type i = 0; i < b.blocks.size(); ++i)
+            {
+                b.reqs[i]->wait();
+                value_type * begin = b.blocks[i]->begin() + (i == 0 ? skip : 0);
+                value_type * end = b.blocks[i]->begin() + STXXL_MIN<int64>(block_type::size, skip + n - int64(i) * block_type::size);
+                for (value_type * p = begin; p < end; ++p, ++ref)
+                    *ref = type_key_(p->key(), p);
+            }
+            radix_sort(refs1, refs1 + n, refs2);
+            delete[] refs2;
+            for (type_key_ * p = refs1; p < refs1 + n; ++p)
+                out << *(p->ptr);
+            delete[] refs1;
+            for (unsigned_type i = 0; i < b.blocks.size(); ++i)
+                delete b.blocks[i];
+            b.blocks.clear();
+            b.reqs.clear();
+        }
 
-        const int_type shift = sizeof(key_type) * 8 - lognbuckets;
-        // search in the the range [_begin,_end)
-        STXXL_VERBOSE_STABLE_KSORT("Shift by: " << shift << " bits, lognbuckets: " << lognbuckets);
-        for ( ; cur != last; cur++)
+        //! Chooses up to \c nsplitters distinct splitters from a sample of random blocks.
+        template <typename BidIterator>
+        void sample(BidIterator bids, unsigned_type skip, int64 n, unsigned_type nsplitters,
+                    std::vector<key_type> & splitters)
         {
-            key_type cur_key = in.current().key();
-            int_type ibucket = cur_key >> shift;
+            const unsigned_type nblocks = blocks_of(skip, n);
+            // at most a quarter of the input, at least 8 blocks
+            const unsigned_type nsample_blocks = STXXL_MIN(nblocks,
+                                                           STXXL_MAX<unsigned_type>(8, STXXL_MIN(nsplitters, nblocks / 4)));
+            const unsigned_type keys_per_block = unsigned_type(div_ceil(32 * (nsplitters + 1), nsample_blocks));
+            const unsigned_type batch = STXXL_MAX<unsigned_type>(m / 2, 1);
+
+            std::vector<key_type> keys;
+            std::vector<block_type *> blocks(STXXL_MIN(batch, nsample_blocks));
+            std::vector<request_ptr> reqs(blocks.size());
+            std::vector<unsigned_type> index(blocks.size());
+            for (unsigned_type i = 0; i < blocks.size(); ++i)
+                blocks[i] = new block_type;
+
+            for (unsigned_type first = 0; first < nsample_blocks; first += batch)
+            {
+                const unsigned_type count = STXXL_MIN(batch, nsample_blocks - first);
+                for (unsigned_type j = 0; j < count; ++j)
+                {
+                    // one random block out of every stratum of the input
+                    const unsigned_type s = first + j;
+                    const uint64 lo = uint64(nblocks) * s / nsample_blocks, hi = uint64(nblocks) * (s + 1) / nsample_blocks;
+                    index[j] = unsigned_type(lo + rng() % (hi - lo));
+                    reqs[j] = blocks[j]->read(bids[index[j]]);
+                }
+                for (unsigned_type j = 0; j < count; ++j)
+                {
+                    reqs[j]->wait();
+                    const int64 lo = (index[j] == 0) ? skip : 0;
+                    const int64 hi = STXXL_MIN<int64>(block_type::size, skip + n - int64(index[j]) * block_type::size);
+                    for (unsigned_type k = 0; k < keys_per_block; ++k)
+                        keys.push_back(blocks[j]->elem[lo + rng() % (hi - lo)].key());
+                }
+            }
+            for (unsigned_type i = 0; i < blocks.size(); ++i)
+                delete blocks[i];
 
-            int_type block_offset = bucket_block_offsets[ibucket];
-            in >> (bucket_blocks[ibucket]->elem[block_offset++]);
-            if (block_offset == block_type::size)
+            std::sort(keys.begin(), keys.end());
+            splitters.clear();
+            for (unsigned_type i = 1; i <= nsplitters; ++i)
             {
-                block_offset = 0;
-                int_type iblock = bucket_iblock[ibucket]++;
-                bucket_blocks[ibucket] = out.write(bucket_blocks[ibucket], bucket_bids[ibucket][iblock]);
+                const key_type & k = keys[uint64(keys.size()) * i / (nsplitters + 1)];
+                if (splitters.empty() || splitters.back() < k)
+                    splitters.push_back(k);
             }
-            bucket_block_offsets[ibucket] = block_offset;
         }
-        for (i = 0; i < nbuckets; i++)
+
+        //! Distributes the records into the buckets defined by sampled splitters.
+        template <typename BidIterator>
+        void distribute(BidIterator bids, unsigned_type skip, int64 n, std::vector<bucket> & buckets)
         {
-            if (bucket_block_offsets[i])
+            typedef buf_istream<block_type, BidIterator> buf_istream_type;
+
+            // some slack for sampling errors
+            const unsigned_type nsplitters = STXXL_MIN<unsigned_type>(
+                (max_buckets - 1) / 2, unsigned_type(STXXL_MIN<int64>(2 * div_ceil(n, capacity), max_buckets)));
+            std::vector<key_type> splitters;
+            sample(bids, skip, n, nsplitters, splitters);
+
+            // bucket 2i: keys in (splitters[i - 1], splitters[i]), bucket 2i + 1: keys equal to splitters[i]
+            const unsigned_type nbuckets = 2 * splitters.size() + 1;
+            buckets.resize(nbuckets);
+            for (unsigned_type i = 1; i < nbuckets; i += 2)
+                buckets[i].equal_keys = true;
+            ++distributions;
+            STXXL_VERBOSE_STABLE_KSORT("stable_ksort: distributing " << n << " records into " << nbuckets << " buckets");
+
+            disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
             {
-                out.write(bucket_blocks[i], bucket_bids[i][bucket_iblock[i]]);
+                buf_istream_type in(bids, bids + blocks_of(skip, n), nbuffers);
+                buffered_writer<block_type> writer(nbuckets + nbuffers, nbuffers / 2);
+                std::vector<block_type *> bucket_blocks(nbuckets);
+                std::vector<unsigned_type> fill(nbuckets, 0);
+                for (unsigned_type i = 0; i < nbuckets; ++i)
+                    bucket_blocks[i] = writer.get_free_block();
+
+                for (unsigned_type i = 0; i < skip; ++i)
+                    ++in;
+                for (int64 i = 0; i < n; ++i)
+                {
+                    const key_type key = in.current().key();
+                    const unsigned_type s = std::lower_bound(splitters.begin(), splitters.end(), key) - splitters.begin();
+                    const unsigned_type b = (s < splitters.size() && !(key < splitters[s])) ? 2 * s + 1 : 2 * s;
+                    in >> bucket_blocks[b]->elem[fill[b]++];
+                    if (fill[b] == block_type::size)
+                    {
+                        bid_type bid;
+                        bm->new_block(alloc, bid);
+                        buckets[b].bids.push_back(bid);
+                        bucket_blocks[b] = writer.write(bucket_blocks[b], bid);
+                        fill[b] = 0;
+                    }
+                }
+                for (unsigned_type b = 0; b < nbuckets; ++b)
+                {
+                    if (fill[b])
+                    {
+                        bid_type bid;
+                        bm->new_block(alloc, bid);
+                        buckets[b].bids.push_back(bid);
+                        writer.write(bucket_blocks[b], bid);
+                    }
+                    buckets[b].size = int64(block_type::size) * (buckets[b].bids.size() - (fill[b] ? 1 : 0)) + fill[b];
+                    STXXL_VERBOSE_STABLE_KSORT("stable_ksort: bucket " << b << " has " << buckets[b].size << " records" <<
+                                               (buckets[b].equal_keys ? " with equal keys" : ""));
+                }
+                writer.flush();
             }
-            bucket_sizes[i] = int64(block_type::size) * bucket_iblock[i] +
-                              bucket_block_offsets[i];
-            STXXL_VERBOSE_STABLE_KSORT("Bucket " << i << " has size " << bucket_sizes[i] <<
-                                       ", estimated size: " << ((last - first) / int64(nbuckets)));
+            disk_queues::get_instance()->set_priority_op(request_queue::READ);
         }
 
-        delete[] bucket_blocks;
-        delete[] bucket_block_offsets;
-        delete[] bucket_iblock;
-    }
+        void free_bucket(bucket & b)
+        {
+            bm->delete_blocks(b.bids.begin(), b.bids.end());
+            bid_vector_type().swap(b.bids);
+        }
+
+        static bool fits(const bucket & b, int64 capacity)
+        {
+            return !b.equal_keys && b.size <= capacity;
+        }
+
+        //! Sorts the buckets one after another and frees them.
+        void sort_buckets(std::vector<bucket> & buckets)
+        {
+            loaded_bucket current, next;
+            bool next_loaded = false;
+            for (unsigned_type i = 0; i < buckets.size(); ++i)
+            {
+                bucket & b = buckets[i];
+                if (b.size == 0)
+                    continue;
+                if (b.equal_keys)
+                {
+                    typedef buf_istream<block_type, typename bid_vector_type::iterator> buf_istream_type;
+                    buf_istream_type in(b.bids.begin(), b.bids.end(), nbuffers);
+                    value_type tmp;
+                    for (int64 j = 0; j < b.size; ++j)
+                    {
+                        in >> tmp;
+                        out << tmp;
+                    }
+                }
+                else if (b.size > capacity)
+                {
+                    std::vector<bucket> sub;
+                    distribute(b.bids.begin(), 0, b.size, sub);
+                    free_bucket(b);
+                    sort_buckets(sub);
+                }
+                else
+                {
+                    if (next_loaded)
+                        std::swap(current, next);
+                    else
+                        load(b.bids.begin(), 0, b.size, current);
+                    next_loaded = false;
+                    // read the next bucket while this one is sorted
+                    unsigned_type j = i + 1;
+                    while (j < buckets.size() && buckets[j].size == 0)
+                        ++j;
+                    if (j < buckets.size() && fits(buckets[j], capacity))
+                    {
+                        load(buckets[j].bids.begin(), 0, buckets[j].size, next);
+                        next_loaded = true;
+                    }
+                    sort_loaded(current, 0, b.size);
+                }
+                free_bucket(b);
+            }
+            assert(!next_loaded);
+        }
+    };
 }
 
 //! Sort records with integer keys
+//!
+//! A stable sample sort: it makes no assumption about the key distribution
+//! and recurses on buckets that do not fit into memory, see
+//! \c stable_ksort_local::sorter. Buckets are sorted with a stable radix
+//! sort, which is parallel in parallel mode.
 //! \param first object of model of \c ext_random_access_iterator concept
 //! \param last object of model of \c ext_random_access_iterator concept
 //! \param M amount of memory for internal use (in bytes)
 //! \remark Elements must provide a method key() which returns the integer key.
-//! \remark Not yet fully implemented, it assumes that the keys are uniformly
-//! distributed between [0,(std::numeric_limits<key_type>::max)().
 template <typename ExtIterator_>
 void stable_ksort(ExtIterator_ first, ExtIterator_ last, unsigned_type M)
 {
-    STXXL_MSG("Warning: stable_ksort is not yet fully implemented, it assumes that the keys are uniformly distributed between [0,(std::numeric_limits<key_type>::max)()]");
     typedef typename ExtIterator_::vector_type::value_type value_type;
-    typedef typename value_type::key_type key_type;
     typedef typename ExtIterator_::block_type block_type;
-    typedef typename block_type::bid_type bid_type;
-    typedef typename ExtIterator_::vector_type::alloc_strategy_type alloc_strategy;
-    typedef stable_ksort_local::bid_sequence<bid_type, alloc_strategy> bucket_bids_type;
-    typedef stable_ksort_local::type_key<value_type> type_key_;
+    typedef buf_ostream<block_type, typename ExtIterator_::bids_container_iterator> buf_ostream_type;
 
     first.flush();     // flush container
 
-    double begin = timestamp();
+    const int64 n = last - first;
+    if (n == 0)
+        return;
 
-    unsigned_type i = 0;
-    config * cfg = config::get_instance();
+    double begin = timestamp();
+    const unsigned_type ndisks = config::get_instance()->disks_number();
     const unsigned_type m = M / block_type::raw_size;
-    assert(2 * block_type::raw_size <= M);
-    const unsigned_type write_buffers_multiple = 2;
-    const unsigned_type read_buffers_multiple = 2;
-    const unsigned_type ndisks = cfg->disks_number();
-    const unsigned_type min_num_read_write_buffers = (write_buffers_multiple + read_buffers_multiple) * ndisks;
-    const unsigned_type nmaxbuckets = m - min_num_read_write_buffers;
-    const unsigned int lognbuckets = ilog2_floor(nmaxbuckets);
-    const unsigned_type nbuckets = 1 << lognbuckets;
-    const uint64 est_bucket_size = div_ceil((last - first) / nbuckets, block_type::size);      //in blocks
-
-    if (m < min_num_read_write_buffers + 2 || nbuckets < 2) {
+    const unsigned_type nout_buffers = 2 * ndisks;
+    // output buffers, read and write buffers for distributing, and at least
+    // three buckets for one splitter
+    const unsigned_type min_m = nout_buffers + 4 * ndisks + 3;
+    if (m < min_m) {
         STXXL_ERRMSG("stxxl::stable_ksort: Not enough memory. Blocks available: " << m <<
-                     ", required for r/w buffers: " << min_num_read_write_buffers <<
-                     ", required for buckets: 2, nbuckets: " << nbuckets);
+                     ", required: " << min_m);
         throw bad_parameter("stxxl::stable_ksort(): INSUFFICIENT MEMORY provided, please increase parameter 'M'");
     }
-    STXXL_VERBOSE_STABLE_KSORT("Elements to sort: " << (last - first));
-    STXXL_VERBOSE_STABLE_KSORT("Number of buckets has to be reduced from " << nmaxbuckets << " to " << nbuckets);
-    const unsigned_type nread_buffers = (m - nbuckets) * read_buffers_multiple / (read_buffers_multiple + write_buffers_multiple);
-    const unsigned_type nwrite_buffers = (m - nbuckets) * write_buffers_multiple / (read_buffers_multiple + write_buffers_multiple);
-
-    STXXL_VERBOSE_STABLE_KSORT("Read buffers in distribution phase: " << nread_buffers);
-    STXXL_VERBOSE_STABLE_KSORT("Write buffers in distribution phase: " << nwrite_buffers);
-
-    bucket_bids_type * bucket_bids = new bucket_bids_type[nbuckets];
-    for (i = 0; i < nbuckets; ++i)
-        bucket_bids[i].init(est_bucket_size);
-
-    int64 * bucket_sizes = new int64[nbuckets];
-
-    disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
-
-    stable_ksort_local::distribute(
-        bucket_bids,
-        bucket_sizes,
-        nbuckets,
-        lognbuckets,
-        first,
-        last,
-        nread_buffers,
-        nwrite_buffers);
-
-    double dist_end = timestamp(), end;
-    double io_wait_after_d = stats::get_instance()->get_io_wait_time();
+    STXXL_VERBOSE_STABLE_KSORT("Elements to sort: " << n);
 
     {
-        // sort buckets
-        unsigned_type write_buffers_multiple_bs = 2;
-        unsigned_type max_bucket_size_bl = (m - write_buffers_multiple_bs * ndisks) / 2; // in number of blocks
-        int64 max_bucket_size_rec = int64(max_bucket_size_bl) * block_type::size;        // in number of records
-        int64 max_bucket_size_act = 0;                                                   // actual max bucket size
-        // establish output stream
-
-        for (i = 0; i < nbuckets; i++)
-        {
-            max_bucket_size_act = STXXL_MAX(bucket_sizes[i], max_bucket_size_act);
-            if (bucket_sizes[i] > max_bucket_size_rec)
-            {
-                STXXL_ERRMSG("Bucket " << i << " is too large: " << bucket_sizes[i] <<
-                             " records, maximum: " << max_bucket_size_rec);
-                STXXL_ERRMSG("Recursion on buckets is not yet implemented, aborting.");
-                abort();
-            }
-        }
-        // here we can increase write_buffers_multiple_b knowing max(bucket_sizes[i])
-        // ... and decrease max_bucket_size_bl
-        const int_type max_bucket_size_act_bl = div_ceil(max_bucket_size_act, block_type::size);
-        STXXL_VERBOSE_STABLE_KSORT("Reducing required number of required blocks per bucket from " <<
-                                   max_bucket_size_bl << " to " << max_bucket_size_act_bl);
-        max_bucket_size_rec = max_bucket_size_act;
-        max_bucket_size_bl = max_bucket_size_act_bl;
-        const unsigned_type nwrite_buffers_bs = m - 2 * max_bucket_size_bl;
-        STXXL_VERBOSE_STABLE_KSORT("Write buffers in bucket sorting phase: " << nwrite_buffers_bs);
+        buf_ostream_type out(first.bid(), nout_buffers);
 
-        typedef buf_ostream<block_type, typename ExtIterator_::bids_container_iterator> buf_ostream_type;
-        buf_ostream_type out(first.bid(), nwrite_buffers_bs);
-
-        disk_queues::get_instance()->set_priority_op(request_queue::READ);
-
-        if (first.block_offset())
+        // keep the part of the first block before first and of the last block after last
+        std::vector<value_type> tail;
+        if (last.block_offset())
         {
-            // has to skip part of the first block
             block_type * block = new block_type;
-            request_ptr req;
-            req = block->read(*first.bid());
-            req->wait();
-
-            for (i = 0; i < first.block_offset(); i++)
-            {
-                out << block->elem[i];
-            }
+            block->read(*last.bid())->wait();
+            tail.assign(block->begin() + last.block_offset(), block->end());
             delete block;
         }
-        block_type * blocks1 = new block_type[max_bucket_size_bl];
-        block_type * blocks2 = new block_type[max_bucket_size_bl];
-        request_ptr * reqs1 = new request_ptr[max_bucket_size_bl];
-        request_ptr * reqs2 = new request_ptr[max_bucket_size_bl];
-        type_key_ * refs1 = new type_key_[max_bucket_size_rec];
-        type_key_ * refs2 = new type_key_[max_bucket_size_rec];
-
-        // submit reading first 2 buckets (Peter's scheme)
-        unsigned_type nbucket_blocks = div_ceil(bucket_sizes[0], block_type::size);
-        for (i = 0; i < nbucket_blocks; i++)
-            reqs1[i] = blocks1[i].read(bucket_bids[0][i]);
-
-
-        nbucket_blocks = div_ceil(bucket_sizes[1], block_type::size);
-        for (i = 0; i < nbucket_blocks; i++)
-            reqs2[i] = blocks2[i].read(bucket_bids[1][i]);
-
-
-        key_type offset = 0;
-        const unsigned log_k1 = STXXL_MAX<unsigned>(ilog2_ceil(max_bucket_size_rec * sizeof(type_key_) / STXXL_L2_SIZE), 1);
-        unsigned_type k1 = 1 << log_k1;
-        int_type * bucket1 = new int_type[k1];
-
-        const unsigned int shift = (unsigned int)(sizeof(key_type) * 8 - lognbuckets);
-        const unsigned int shift1 = shift - log_k1;
-
-        STXXL_VERBOSE_STABLE_KSORT("Classifying " << nbuckets << " buckets, max size:" << max_bucket_size_rec <<
-                                   " block size:" << block_type::size << " log_k1:" << log_k1);
-
-        for (unsigned_type k = 0; k < nbuckets; k++)
-        {
-            nbucket_blocks = div_ceil(bucket_sizes[k], block_type::size);
-            const unsigned log_k1_k = STXXL_MAX<unsigned>(ilog2_ceil(bucket_sizes[k] * sizeof(type_key_) / STXXL_L2_SIZE), 1);
-            assert(log_k1_k <= log_k1);
-            k1 = (unsigned_type)(1) << log_k1_k;
-            std::fill(bucket1, bucket1 + k1, 0);
-
-            STXXL_VERBOSE_STABLE_KSORT("Classifying bucket " << k << " size:" << bucket_sizes[k] <<
-                                       " blocks:" << nbucket_blocks << " log_k1:" << log_k1_k);
-            // classify first nbucket_blocks-1 blocks, they are full
-            type_key_ * ref_ptr = refs1;
-            key_type offset1 = offset + (key_type(1) << key_type(shift)) * key_type(k);
-            for (i = 0; i < nbucket_blocks - 1; i++)
-            {
-                reqs1[i]->wait();
-                stable_ksort_local::classify_block(blocks1[i].begin(), blocks1[i].end(), ref_ptr, bucket1, offset1, shift1 /*,k1*/);
-            }
-            // last block might be non-full
-            const unsigned_type last_block_size = bucket_sizes[k] - int64(nbucket_blocks - 1) * block_type::size;
-            reqs1[i]->wait();
-
-            //STXXL_MSG("block_type::size: "<<block_type::size<<" last_block_size:"<<last_block_size);
-
-            classify_block(blocks1[i].begin(), blocks1[i].begin() + last_block_size, ref_ptr, bucket1, offset1, shift1);
-
-            exclusive_prefix_sum(bucket1, k1);
-            classify(refs1, refs1 + bucket_sizes[k], refs2, bucket1, offset1, shift1);
-
-            type_key_ * c = refs2;
-            type_key_ * d = refs1;
-            for (i = 0; i < k1; i++)
-            {
-                type_key_ * cEnd = refs2 + bucket1[i];
-                type_key_ * dEnd = refs1 + bucket1[i];
-
-                const unsigned log_k2 = ilog2_floor(bucket1[i]) - 1;        // adaptive bucket size
-                const unsigned_type k2 = 1 << log_k2;
-                int_type * bucket2 = new int_type[k2];
-                const unsigned shift2 = shift1 - log_k2;
-
-                // STXXL_MSG("Sorting bucket "<<k<<":"<<i);
-                l1sort(c, cEnd, d, bucket2, k2,
-                       offset1 + (key_type(1) << key_type(shift1)) * key_type(i),
-                       shift2);
-
-                // write out all
-                for (type_key_ * p = d; p < dEnd; p++)
-                    out << (*(p->ptr));
-
-
-                delete[] bucket2;
-                c = cEnd;
-                d = dEnd;
-            }
-            // submit next read
-            const unsigned_type bucket2submit = k + 2;
-            if (bucket2submit < nbuckets)
-            {
-                nbucket_blocks = div_ceil(bucket_sizes[bucket2submit], block_type::size);
-                for (i = 0; i < nbucket_blocks; i++)
-                    reqs1[i] = blocks1[i].read(bucket_bids[bucket2submit][i]);
-            }
-
-            std::swap(blocks1, blocks2);
-            std::swap(reqs1, reqs2);
-        }
-
-        delete[] bucket1;
-        delete[] refs1;
-        delete[] refs2;
-        delete[] blocks1;
-        delete[] blocks2;
-        delete[] reqs1;
-        delete[] reqs2;
-        delete[] bucket_bids;
-        delete[] bucket_sizes;
-
-        if (last.block_offset())
+        if (first.block_offset())
         {
-            // has to skip part of the first block
             block_type * block = new block_type;
-            request_ptr req = block->read(*last.bid());
-            req->wait();
-
-            for (i = last.block_offset(); i < block_type::size; i++)
-            {
+            block->read(*first.bid())->wait();
+            for (unsigned_type i = 0; i < first.block_offset(); i++)
                 out << block->elem[i];
-            }
             delete block;
         }
 
-        end = timestamp();
+        stable_ksort_local::sorter<ExtIterator_> sorter(out, m - nout_buffers, ndisks);
+        sorter.sort(first.bid(), first.block_offset(), n);
+
+        for (unsigned_type i = 0; i < tail.size(); i++)
+            out << tail[i];
+
+        STXXL_VERBOSE_STABLE_KSORT("Distribution passes: " << sorter.get_distributions());
     }
 
-    STXXL_VERBOSE("Elapsed time        : " << end - begin << " s. Distribution time: " <<
-                  dist_end - begin << " s");
-    STXXL_VERBOSE("Time in I/O wait(ds): " << io_wait_after_d << " s");
+    STXXL_VERBOSE("Elapsed time        : " << timestamp() - begin << " s.");
     STXXL_VERBOSE(*stats::get_instance());
-    STXXL_UNUSED(begin + dist_end + end + io_wait_after_d);
+    STXXL_UNUSED(begin);
 }
 
 //! \}
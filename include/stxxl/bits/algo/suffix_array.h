@@ -0,0 +1,1523 @@
+/***************************************************************************
+ *  include/stxxl/bits/algo/suffix_array.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Copyright (C) 2004 Jens Mehnert <jmehnert@mpi-sb.mpg.de>
+ *  Copyright (C) 2012-2013 Timo Bingmann <bingmann@kit.edu>
+ *  Copyright (C) 2012-2013 Daniel Feist <daniel.feist@student.kit.edu>
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_SUFFIX_ARRAY_HEADER
+#define STXXL_SUFFIX_ARRAY_HEADER
+
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/parallel.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/tuple.h>
+#include <stxxl/bits/containers/vector.h>
+#include <stxxl/bits/containers/sorter.h>
+#include <stxxl/bits/stream/stream.h>
+#include <stxxl/bits/stream/sort_stream.h>
+#include <stxxl/bits/stream/choose.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+namespace suffix_array_local
+{
+    //! Compares the suffixes of a short internal text starting at two positions.
+    template <typename alphabet_type, typename offset_type>
+    struct naive_suffix_less
+    {
+        const std::vector<alphabet_type> & text;
+
+        naive_suffix_less(const std::vector<alphabet_type> & text_) : text(text_) { }
+
+        bool operator () (offset_type a, offset_type b) const
+        {
+            return std::lexicographical_compare(text.begin() + a, text.end(), text.begin() + b, text.end());
+        }
+    };
+
+    /**
+     * Algorithm to check whether the suffix array is correct. Loosely based on the
+     * ideas of Kaerkkaeinen und Burghardt, originally implemented in STXXL by Jens
+     * Mehnert (2004), reimplemented using triples by Timo Bingmann (2012).
+     *
+     * @param InputT is the original text, from which the suffix array was build
+     * @param InputSA is the suffix array from InputT
+     *
+     * Note: ISA := The inverse of SA
+     */
+    template <typename InputT, typename InputSA>
+    bool sacheck(InputT& inputT, InputSA& inputSA, uint64 memory)
+    {
+        typedef typename InputSA::value_type offset_type;
+        typedef tuple<offset_type, offset_type> pair_type;
+        typedef tuple<offset_type, offset_type, offset_type> triple_type;
+
+        // *** Pipeline Declaration ***
+
+        // Build tuples with index: (SA[i]) -> (i, SA[i])
+        typedef counter<offset_type> index_counter_type;
+        index_counter_type index_counter;
+
+        typedef stream::make_tuple<index_counter_type, InputSA> tuple_index_sa_type;
+        tuple_index_sa_type tuple_index_sa(index_counter, inputSA);
+
+        // take (i, SA[i]) and sort to (ISA[i], i)
+        typedef tuple_less2nd<pair_type> pair_less_type;
+        typedef typename stream::sort<tuple_index_sa_type, pair_less_type> build_isa_type;
+
+        build_isa_type build_isa(tuple_index_sa, pair_less_type(), memory / 3);
+
+        // build (ISA[i], T[i], ISA[i+1]) and sort to (i, T[SA[i]], ISA[SA[i]+1])
+        typedef tuple_less1st<triple_type> triple_less_type;  // comparison relation
+
+        typedef typename stream::use_push<triple_type> triple_push_type;  // indicator use push()
+        typedef typename stream::runs_creator<triple_push_type, triple_less_type> triple_rc_type;
+        typedef typename stream::runs_merger<typename triple_rc_type::sorted_runs_type, triple_less_type> triple_rm_type;
+
+        triple_rc_type triple_rc(triple_less_type(), memory / 3);
+
+        // ************************* Process ******************************
+        // loop 1: read ISA and check for a permutation. Simultaneously create runs
+        // of triples by iterating ISA and T.
+
+        external_size_type totalSize;
+        {
+            offset_type prev_isa = (*build_isa).first;
+            offset_type counter = 0;
+            while (!build_isa.empty())
+            {
+                if ((*build_isa).second != counter) {
+                    STXXL_VERBOSE1("suffix_array_check: suffix array is not a permutation of 0..n-1.");
+                    return false;
+                }
+
+                ++counter;
+                ++build_isa; // ISA is one in front of T
+
+                if (!build_isa.empty()) {
+                    triple_rc.push( triple_type(prev_isa, *inputT, (*build_isa).first) );
+                    prev_isa = (*build_isa).first;
+                }
+                ++inputT;
+            }
+
+            totalSize = counter;
+        }
+
+        if (totalSize == 1) return true;
+
+        // ************************************************************************
+        // loop 2: read triples (i,T[SA[i]],ISA[SA[i]+1]) and check for correct
+        // ordering.
+
+        triple_rm_type triple_rm(triple_rc.result(), triple_less_type(), memory / 3);
+
+        {
+            triple_type prev_triple = *triple_rm;
+            external_size_type counter = 0;
+
+            ++triple_rm;
+
+            while (!triple_rm.empty())
+            {
+                const triple_type& this_triple = *triple_rm;
+
+                if (prev_triple.second > this_triple.second)
+                {
+                    // simple check of first character of suffix
+                    STXXL_VERBOSE1("suffix_array_check: suffix array position " << counter  << " ordered incorrectly.");
+                    return false;
+                }
+                else if (prev_triple.second == this_triple.second)
+                {
+                    if ( this_triple.third == (offset_type)totalSize ) {
+                        // last suffix of string must be first among those with same
+                        // first character
+                        STXXL_VERBOSE1("suffix_array_check: suffix array position " << counter << " ordered incorrectly.");
+                        return false;
+                    }
+                    if ( prev_triple.third != (offset_type)totalSize && prev_triple.third > this_triple.third ) {
+                        // positions SA[i] and SA[i-1] has same first character but
+                        // their suffixes are ordered incorrectly: the suffix
+                        // position of SA[i] is given by ISA[SA[i]]
+                        STXXL_VERBOSE1("suffix_array_check: suffix array position " << counter << " ordered incorrectly.");
+                        return false;
+                    }
+                }
+
+                prev_triple = this_triple;
+
+                ++triple_rm;
+                ++counter;
+            }
+        }
+        return true;
+    }
+
+    //! Owns the name vectors of the prefix doubling levels.
+    template <typename VectorType>
+    struct doubling_levels : public std::vector<VectorType*>
+    {
+        ~doubling_levels()
+        {
+            for (unsigned_type h = 0; h < this->size(); ++h)
+                delete (*this)[h];
+        }
+    };
+
+    //! Writes the names of a level, sorted by position, into a new vector.
+    template <typename VectorType, typename NameSorter>
+    void store_names(doubling_levels<VectorType> & levels, NameSorter & names, uint64 n)
+    {
+        levels.push_back(NULL);
+        levels.back() = new VectorType(n);
+        names.sort();
+        typename VectorType::bufwriter_type writer(*levels.back());
+        for ( ; !names.empty(); ++names)
+            writer << (*names).second;
+        writer.finish();
+        names.clear();
+    }
+
+    /**
+     * Computes the LCP array fully externally by prefix doubling.
+     *
+     * Level h stores for every text position i a name of T[i, i + 2^h), such
+     * that equal names mean equal substrings. Level 0 ranks the characters,
+     * level h + 1 ranks the pairs of level h names at i and i + 2^h, where
+     * positions past the end get the name 0. The doubling stops when all names
+     * of a level are distinct, so every LCP is shorter than 2^h.
+     *
+     * Then every pair of neighbours (SA[i-1], SA[i]) is extended greedily from
+     * the highest level down: if the level h names at SA[i-1] + l and
+     * SA[i] + l are equal, l grows by 2^h. Each level joins the queries with
+     * the names by two sorts and two scans.
+     *
+     * No part of the text is kept in internal memory. The levels take up to
+     * n log(max LCP) offsets of disk space.
+     */
+    template <class TextVector, class SAVector, class LCPVector>
+    void lcp_doubling(const TextVector & text, const SAVector & sa, LCPVector & lcp, uint64 memory_to_use)
+    {
+        typedef typename SAVector::value_type offset_type;
+        typedef typename TextVector::value_type alphabet_type;
+        typedef typename LCPVector::value_type lcp_type;
+        typedef typename VECTOR_GENERATOR<offset_type, 1, 1>::result name_vector_type;
+        typedef typename name_vector_type::bufreader_type name_reader_type;
+        typedef tuple<alphabet_type, offset_type> char_type;                          // (T[i], i)
+        typedef tuple<offset_type, offset_type> pair_type;                            // (i, name)
+        typedef tuple<offset_type, offset_type, offset_type> name_pair_type;          // (name[i], name[i + 2^h], i)
+        typedef tuple<offset_type, offset_type, offset_type, offset_type> query_type; // (SA[i-1] + l, SA[i] + l, i, name)
+        typedef tuple_less1st<char_type> char_less_type;
+        typedef tuple_less1st<pair_type> pair_less_type;
+        typedef tuple_less1st_less2nd<name_pair_type> name_pair_less_type;
+        typedef tuple_less1st<query_type> query_less1st_type;
+        typedef tuple_less2nd<query_type> query_less2nd_type;
+
+        assert(text.size() == sa.size());
+        const offset_type n = offset_type(sa.size());
+        lcp.resize(sa.size());
+        if (n == 0)
+            return;
+
+        doubling_levels<name_vector_type> levels;
+        offset_type distinct = 0;
+        {
+            sorter<pair_type, pair_less_type> name_sorter(pair_less_type(), unsigned_type(memory_to_use / 2));
+
+            // level 0: rank the characters
+            {
+                sorter<char_type, char_less_type> char_sorter(char_less_type(), unsigned_type(memory_to_use / 2));
+                typename stream::streamify_traits<typename TextVector::const_iterator>::stream_type
+                text_stream = stream::streamify(text.begin(), text.end());
+                for (offset_type i = 0; !text_stream.empty(); ++text_stream, ++i)
+                    char_sorter.push(char_type(*text_stream, i));
+
+                char_sorter.sort();
+                alphabet_type prev = alphabet_type();
+                for ( ; !char_sorter.empty(); ++char_sorter)
+                {
+                    if (distinct == 0 || prev < (*char_sorter).first)
+                        ++distinct;
+                    prev = (*char_sorter).first;
+                    name_sorter.push(pair_type((*char_sorter).second, distinct));
+                }
+            }
+            store_names(levels, name_sorter, n);
+
+            // level h + 1: rank the pairs of level h names
+            sorter<name_pair_type, name_pair_less_type> pair_sorter(name_pair_less_type(), unsigned_type(memory_to_use / 2));
+            for (offset_type step = 1; distinct < n; step *= 2)
+            {
+                {
+                    const name_vector_type & names = *levels.back();
+                    name_reader_type first(names);
+                    name_reader_type second(step < n ? names.cbegin() + step : names.cend(), names.cend());
+                    for (offset_type i = 0; i < n; ++i, ++first)
+                    {
+                        if (second.empty())
+                            pair_sorter.push(name_pair_type(*first, 0, i));
+                        else
+                        {
+                            pair_sorter.push(name_pair_type(*first, *second, i));
+                            ++second;
+                        }
+                    }
+                }
+
+                pair_sorter.sort();
+                distinct = 0;
+                name_pair_type prev(0, 0, 0);
+                for ( ; !pair_sorter.empty(); ++pair_sorter)
+                {
+                    const name_pair_type & p = *pair_sorter;
+                    if (distinct == 0 || prev.first != p.first || prev.second != p.second)
+                        ++distinct;
+                    prev = p;
+                    name_sorter.push(pair_type(p.third, distinct));
+                }
+                pair_sorter.clear();
+                store_names(levels, name_sorter, n);
+            }
+        }
+
+        // the top level has only distinct names and answers no query
+        delete levels.back();
+        levels.back() = NULL;
+
+        const unsigned_type query_memory = unsigned_type(memory_to_use / 3);
+        sorter<query_type, query_less1st_type> by_first(query_less1st_type(), query_memory);
+        sorter<query_type, query_less2nd_type> by_second(query_less2nd_type(), query_memory);
+        sorter<pair_type, pair_less_type> result(pair_less_type(), query_memory);
+        {
+            typename stream::streamify_traits<typename SAVector::const_iterator>::stream_type
+            sa_stream = stream::streamify(sa.begin(), sa.end());
+            offset_type prev = *sa_stream;
+            ++sa_stream;
+            for (offset_type i = 1; !sa_stream.empty(); ++sa_stream, ++i)
+            {
+                by_first.push(query_type(prev, *sa_stream, i, 0));
+                prev = *sa_stream;
+            }
+        }
+
+        for (int h = int(levels.size()) - 2; h >= 0; --h)
+        {
+            const offset_type step = offset_type(1) << h;
+
+            // fetch the name at SA[i-1] + l
+            by_first.sort();
+            {
+                name_reader_type names(*levels[h]);
+                offset_type pos = 0;
+                for ( ; !by_first.empty(); ++by_first)
+                {
+                    query_type q = *by_first;
+                    for ( ; pos < q.first && pos < n; ++pos)
+                        ++names;
+                    q.fourth = (q.first < n) ? *names : 0;
+                    by_second.push(q);
+                }
+            }
+            by_first.clear();
+
+            // compare it with the name at SA[i] + l
+            by_second.sort();
+            {
+                name_reader_type names(*levels[h]);
+                offset_type pos = 0;
+                for ( ; !by_second.empty(); ++by_second)
+                {
+                    query_type q = *by_second;
+                    for ( ; pos < q.second && pos < n; ++pos)
+                        ++names;
+                    if (q.fourth != 0 && q.second < n && *names == q.fourth)
+                    {
+                        q.first += step;
+                        q.second += step;
+                    }
+                    by_first.push(q);
+                }
+            }
+            by_second.clear();
+
+            delete levels[h];
+            levels[h] = NULL;
+        }
+
+        // LCP[i] = l = (SA[i] + l) - SA[i]
+        by_first.sort();
+        for ( ; !by_first.empty(); ++by_first)
+            result.push(pair_type((*by_first).third, (*by_first).second));
+        by_first.finish_clear();
+        result.sort();
+
+        typename stream::streamify_traits<typename SAVector::const_iterator>::stream_type
+        sa_stream = stream::streamify(sa.begin(), sa.end());
+        typename LCPVector::iterator out = lcp.begin();
+        *out = 0;
+        for (++out, ++sa_stream; !result.empty(); ++result, ++sa_stream, ++out)
+            *out = lcp_type((*result).second - *sa_stream);
+    }
+
+    /// DC3 aka skew algorithm
+
+    /*
+     * DC3 aka skew algorithm a short description. T := input string
+     * The recursion works as follows:
+     * Step 1: a) pick all mod1/mod2 triples (i.e. triples T[i,i+2] at position i mod 3 != 0) (-> extract_mod12 class)
+     *         b) sort mod1/mod2 triples lexicographically (-> build_sa class)
+     *         c) give mod1/mod2 triples lexicographical ascending names n (-> naming class)
+     *         d) check lexicographical names for uniqueness (-> naming class)
+     *            If yes: proceed to next Step, If no: set T := lexicographical names and run Step 1 again
+     * Step 2: a) by sorting the lexicographical names n we receive ranks r
+     *         b) construct mod0-quints, mod1-quads and mod2-quints  (-> build_sa class)
+     *         c) prepare for merging by:
+     *            sort mod0-quints by 2 components, sort mod1-quads / mod2-quints by one component (-> build_sa class)
+     *         c) merge mod0-quints, mod1-quads and mod2-quints (-> merge_sa class)
+     * Step 3: a) return Suffix Array of T
+     *
+     * @param offset_type later suffix array data type
+     */
+    template <typename offset_type>
+    class skew
+    {
+    public:
+
+        // 2-tuple, 3-tuple, 4-tuple (=quads), 5-tuple(=quints) definition
+        typedef tuple<offset_type, offset_type> skew_pair_type;
+        typedef tuple<offset_type, offset_type, offset_type> skew_triple_type;
+        typedef tuple<offset_type, offset_type, offset_type, offset_type> skew_quad_type;
+        typedef tuple<offset_type, offset_type, offset_type, offset_type, offset_type> skew_quint_type;
+
+        typedef typename VECTOR_GENERATOR<offset_type, 1, 2>::result offset_array_type;
+        typedef stream::vector_iterator2stream<typename offset_array_type::iterator> offset_array_it_rg;
+
+        /** Comparison function for the mod0 tuples. */
+        struct less_mod0
+        {
+            typedef skew_quint_type value_type;
+
+            bool operator() (const value_type& a, const value_type& b) const
+            {
+                if (a.second == b.second)
+                    return a.fourth < b.fourth;
+                else
+                    return a.second < b.second;
+            }
+
+            static value_type min_value() { return value_type::min_value(); }
+            static value_type max_value() { return value_type::max_value(); }
+        };
+
+        typedef tuple_less2nd<skew_quad_type> less_mod1;
+        typedef tuple_less2nd<skew_quint_type> less_mod2;
+
+        /** Put the (0 mod 2) [which are the 1,2 mod 3 tuples] tuples at the begin. */
+        struct less_skew
+        {
+            typedef skew_pair_type value_type;
+
+            bool operator() (const value_type& a, const value_type& b) const
+            {
+                if ((a.first & 1) == (b.first & 1))
+                    return a.first < b.first;
+                else
+                    return (a.first & 1) < (b.first & 1);
+            }
+
+            static value_type min_value() { return value_type::min_value(); }
+            static value_type max_value() { return value_type::max_value(); }
+        };
+
+        /** Sort skew_quad datatype. */
+        template <typename alphabet_type>
+        struct less_quad
+        {
+            typedef tuple<offset_type, alphabet_type, alphabet_type, alphabet_type> value_type;
+
+            bool operator() (const value_type& a, const value_type& b) const
+            {
+                if (a.second == b.second) {
+                    if (a.third == b.third)
+                        return a.fourth < b.fourth;
+                    else
+                        return a.third < b.third;
+                }
+                else
+                    return a.second < b.second;
+            }
+
+            static value_type min_value() { return value_type::min_value(); }
+            static value_type max_value() { return value_type::max_value(); }
+        };
+
+
+        /** Check, if last two components of tree quads are equal. */
+        template <class quad_type>
+        static inline bool quad_eq(const quad_type& a, const quad_type& b)
+        {
+            return (a.second == b.second) && (a.third == b.third) && (a.fourth == b.fourth);
+        }
+
+        /** Naming pipe for the conventional skew algorithm without discarding. */
+        template<class Input>
+        class naming {
+        public:
+            typedef typename Input::value_type quad_type;
+
+            typedef skew_pair_type value_type;
+
+        private:
+            Input& A;
+
+            bool & unique;
+            offset_type lexname;
+            quad_type prev;
+            skew_pair_type result;
+
+        public:
+
+            naming(Input& A_, bool & unique_) :
+                A(A_), unique(unique_), lexname(0) {
+                assert(!A.empty());
+                unique = true;
+
+                prev = *A;
+                result.first = prev.first;
+                result.second = lexname;
+            }
+
+            const value_type& operator*() const {
+                return result;
+            }
+
+            naming& operator++() {
+                assert(!A.empty());
+
+                ++A;
+                if (A.empty())
+                    return *this;
+
+                quad_type curr = *A;
+                if (!quad_eq(prev, curr)) {
+                    ++lexname;
+                } else {
+                    if (!A.empty() && curr.second != offset_type(0)) {
+                        unique = false;
+                    }
+                }
+
+                result.first = curr.first;
+                result.second = lexname;
+
+                prev = curr;
+                return *this;
+            }
+
+            bool empty() const {
+                return A.empty();
+            }
+        };
+
+        /** Create tuples of 2 components until one of the input streams are empty. */
+        template<class InputA, class InputB, const int add_alphabet = 0>
+        class make_pairs
+        {
+        public:
+            typedef tuple<typename InputA::value_type, offset_type> value_type;
+
+        private:
+            InputA& A;
+            InputB& B;
+            value_type result;
+
+        public:
+
+            make_pairs(InputA& a, InputB& b)
+                : A(a), B(b)
+            {
+                assert(!A.empty()); assert(!B.empty());
+                if (!empty()) {
+                    result = value_type(*A, *B + add_alphabet);
+                }
+            }
+
+            const value_type & operator*() const
+            { return result; }
+
+            make_pairs & operator++()
+            {
+                assert(!A.empty()); assert(!B.empty());
+
+                ++A; ++B;
+
+                if (!A.empty() && !B.empty()) {
+                    result = value_type(*A, *B + add_alphabet);
+                }
+
+                return *this;
+            }
+
+            bool empty() const
+            { return (A.empty() || B.empty()); }
+        };
+
+
+        /**
+         * Collect three characters t_i, t_{i+1}, t_{i+2} beginning at the index
+         * i. Since we need at least one unique endcaracter, we free the first
+         * characters i.e. we map (t_i) -> (i,t_i,t_{i+1},t_{i+2})
+         *
+         * @param Input holds all characters t_i from input string t
+         * @param alphabet_type
+         * @param add_alphabet
+         */
+        template <class Input, typename alphabet_type, const int add_alphabet = 0>
+        class make_quads
+        {
+        public:
+            typedef tuple<offset_type, alphabet_type, alphabet_type, alphabet_type> value_type;
+
+        private:
+            Input & A;
+            value_type current;
+            offset_type counter;
+            unsigned int z3z;  // = counter mod 3, ("+",Z/3Z) is cheaper than %
+            bool finished;
+
+            offset_array_type & text;
+
+        public:
+            make_quads(Input & data_in_, offset_array_type & text_)
+                : A(data_in_),
+                  current(0,0,0,0),
+                  counter(0),
+                  z3z(0),
+                  finished(false),
+                  text(text_)
+            {
+                assert(!A.empty());
+
+                current.first = counter;
+                current.second = (*A).second + add_alphabet;
+                ++A;
+
+                if (!A.empty()) {
+                    current.third = (*A).second + add_alphabet;
+                    ++A;
+                }
+                else {
+                    current.third = 0;
+                    current.fourth = 0;
+                }
+
+                if (!A.empty()) {
+                    current.fourth = (*A).second + add_alphabet;
+                }
+                else {
+                    current.fourth = 0;
+                }
+            }
+
+            const value_type & operator*() const
+            { return current; }
+
+            make_quads & operator++()
+            {
+                assert(!A.empty() || !finished);
+
+                if (current.second != offset_type(0)) {
+                    text.push_back(current.second);
+                }
+
+                // Calculate module
+                if (++z3z == 3) z3z = 0;
+
+                current.first = ++counter;
+                current.second = current.third;
+                current.third = current.fourth;
+
+                if (!A.empty())
+                    ++A;
+
+                if (!A.empty()) {
+                    current.fourth = (*A).second + add_alphabet;
+                }
+                else {
+                    current.fourth = 0;
+                }
+
+                // Inserts a dummy tuple for input sizes of n%3==1
+                if ((current.second == offset_type(0)) && (z3z != 1)) {
+                    finished = true;
+                }
+
+                return *this;
+            }
+
+            bool empty() const
+            { return (A.empty() && finished); }
+        };
+
+        /** Drop 1/3 of the input. More exactly the offsets at positions (0 mod
+         * 3). Index begins with 0. */
+        template <class Input>
+        class extract_mod12
+        {
+        public:
+            typedef typename Input::value_type value_type;
+
+        private:
+            Input & A;
+            offset_type counter;
+            offset_type output_counter;
+            value_type result;
+
+        public:
+
+            extract_mod12(Input & A_)
+                : A(A_),
+                  counter(0),
+                  output_counter(0)
+            {
+                assert(!A.empty());
+                ++A, ++counter;  // skip 0 = mod0 offset
+                if (!A.empty()) {
+                    result = *A;
+                    result.first = output_counter;
+                }
+            }
+
+            const value_type & operator*() const
+            { return result; }
+
+            extract_mod12 & operator++()
+            {
+                assert(!A.empty());
+
+                ++A, ++counter, ++output_counter;
+
+                if (!A.empty() && (counter % 3) == 0) {
+                    // skip mod0 offsets
+                    ++A, ++counter;
+                }
+                if (!A.empty()) {
+                    result = *A;
+                    result.first = output_counter;
+                }
+
+                return *this;
+            }
+
+            bool empty() const
+            { return A.empty(); }
+        };
+
+
+        /** Create the suffix array from the current sub problem by simple
+         *  comparison-based merging.  More precisely: compare characters(out of
+         *  text t) and ranks(out of ISA12) of the following constellation:
+         *  Input constellation:
+         *  @param Mod0 5-tuple (quint): <i, t_i, t_{i+1}, ISA12[i+1], ISA12[i+2]>
+         *  @param Mod1 4-tuple (quad): <i, ISA12[i], t_i, ISA12[i+1]>
+         *  @param Mod2 5-tuple (quint): <i, ISA[i], t_i, t_{i+1}, ISA12[i+1]>
+         */
+        template <class Mod0, class Mod1, class Mod2>
+        class merge_sa
+        {
+        public:
+            typedef offset_type value_type;
+
+        private:
+            Mod0 & A;
+            Mod1 & B;
+            Mod2 & C;
+
+            skew_quint_type s0;
+            skew_quad_type s1;
+            skew_quint_type s2;
+
+            int selected;
+            bool done[3];
+
+            offset_type index;
+            offset_type merge_result;
+
+            bool cmp_mod1_less_mod2()
+            {
+                assert(!done[1] && !done[2]);
+
+                return s1.second < s2.second;
+            }
+
+            bool cmp_mod0_less_mod2()
+            {
+                assert(!done[0] && !done[2]);
+
+                if (s0.second == s2.third) {
+                    if (s0.third == s2.fourth)
+                        return s0.fifth < s2.fifth;
+                    else
+                        return s0.third < s2.fourth;
+                }
+                else
+                    return s0.second < s2.third;
+            }
+
+            bool cmp_mod0_less_mod1()
+            {
+                assert(!done[0] && !done[1]);
+
+                if (s0.second == s1.third)
+                    return s0.fourth < s1.fourth;
+                else
+                    return s0.second < s1.third;
+            }
+
+            void merge()
+            {
+                assert( !done[0] || !done[1] || !done[2] );
+
+                if (done[0])
+                {
+                    if (done[2] || (!done[1] && cmp_mod1_less_mod2()))
+                    {
+                        selected = 1;
+                        merge_result = s1.first;
+                    }
+                    else
+                    {
+                        selected = 2;
+                        merge_result = s2.first;
+                    }
+                }
+                else if (done[1] || cmp_mod0_less_mod1())
+                {
+                    if (done[2] || cmp_mod0_less_mod2())
+                    {
+                        selected = 0;
+                        merge_result = s0.first;
+                    }
+                    else
+                    {
+                        selected = 2;
+                        merge_result = s2.first;
+                    }
+                }
+                else
+                {
+                    if (done[2] || cmp_mod1_less_mod2())
+                    {
+                        selected = 1;
+                        merge_result = s1.first;
+                    }
+                    else
+                    {
+                        selected = 2;
+                        merge_result = s2.first;
+                    }
+                }
+
+                assert( !done[selected] );
+            }
+
+        public:
+
+            bool empty() const
+            {
+                return (A.empty() && B.empty() && C.empty());
+            }
+
+            merge_sa(Mod0 & x1, Mod1 & x2, Mod2 & x3)
+                : A(x1), B(x2), C(x3), selected(-1), index(0)
+            {
+                assert(!A.empty());
+                assert(!B.empty());
+                assert(!C.empty());
+                done[0] = false;
+                done[1] = false;
+                done[2] = false;
+                s0 = *A;
+                s1 = *B;
+                s2 = *C;
+
+                merge();
+            }
+
+            const value_type & operator* () const
+            {
+                return merge_result;
+            }
+
+            merge_sa & operator++ ()
+            {
+                if (selected == 0) {
+                    assert(!A.empty());
+                    ++A;
+                    if (!A.empty())
+                        s0 = *A;
+                    else
+                        done[0] = true;
+                }
+                else if (selected == 1) {
+                    assert(!B.empty());
+                    ++B;
+                    if (!B.empty())
+                        s1 = *B;
+                    else
+                        done[1] = true;
+                }
+                else {
+                    assert(!C.empty());
+                    assert(selected == 2);
+                    ++C;
+                    if (!C.empty())
+                        s2 = *C;
+                    else
+                        done[2] = true;
+                }
+
+                ++index;
+                if (!empty())
+                    merge();
+
+                return *this;
+            }
+        };
+
+
+        /** Helper function for computing the size of the 2/3 subproblem. */
+        static inline size_t subp_size(size_t n)
+        {
+            return (n / 3) * 2 + ((n % 3) == 2);
+        }
+
+        /**
+         * Sort mod0-quints / mod1-quads / mod2-quints and run merge_sa class to
+         * merge them together.
+         * @param S input string pipe type.
+         * @param Mod1 mod1 tuples input pipe type.
+         * @param Mod2 mod2 tuples input pipe type.
+         */
+        template <class S, class Mod1, class Mod2>
+        class build_sa
+        {
+        public:
+            typedef offset_type value_type;
+
+            static const unsigned int add_rank = 1;  // free first rank to mark ranks beyond end of input
+
+        private:
+
+            // mod1 types
+            typedef typename stream::use_push < skew_quad_type > mod1_push_type;
+            typedef typename stream::runs_creator < mod1_push_type, less_mod1> mod1_runs_type;
+            typedef typename mod1_runs_type::sorted_runs_type sorted_mod1_runs_type;
+            typedef typename stream::runs_merger < sorted_mod1_runs_type, less_mod1 > mod1_rm_type;
+
+            // mod2 types
+            typedef typename stream::use_push < skew_quint_type > mod2_push_type;
+            typedef typename stream::runs_creator < mod2_push_type, less_mod2> mod2_runs_type;
+            typedef typename mod2_runs_type::sorted_runs_type sorted_mod2_runs_type;
+            typedef typename stream::runs_merger < sorted_mod2_runs_type, less_mod2 > mod2_rm_type;
+
+            // mod0 types
+            typedef typename stream::use_push < skew_quint_type > mod0_push_type;
+            typedef typename stream::runs_creator < mod0_push_type, less_mod0> mod0_runs_type;
+            typedef typename mod0_runs_type::sorted_runs_type sorted_mod0_runs_type;
+            typedef typename stream::runs_merger < sorted_mod0_runs_type, less_mod0 > mod0_rm_type;
+
+            // Merge type
+            typedef merge_sa < mod0_rm_type, mod1_rm_type, mod2_rm_type > merge_sa_type;
+
+            // Functions
+            less_mod0 c0;
+            less_mod1 c1;
+            less_mod2 c2;
+
+            // Runs merger
+            mod1_rm_type *mod1_result;
+            mod2_rm_type *mod2_result;
+            mod0_rm_type *mod0_result;
+
+            // Merger
+            merge_sa_type *vmerge_sa;
+
+            // Input
+            S & source;
+            Mod1 & mod_1;
+            Mod2 & mod_2;
+
+            // Tmp variables
+            offset_type t[3];
+            offset_type old_t2;
+            offset_type old_mod2;
+            bool exists[3];
+            offset_type mod_one;
+            offset_type mod_two;
+
+            offset_type index;
+
+            // Empty_flag
+            bool ready;
+
+            // Result
+            value_type result;
+
+        public:
+
+            build_sa(S & source_, Mod1 & mod_1_, Mod2 & mod_2_, size_t a_size, size_t memsize)
+                : source(source_), mod_1(mod_1_), mod_2(mod_2_), index(0), ready(false)
+            {
+                assert(!source_.empty());
+
+                // Runs storage
+
+                // input: ISA_1,2 from previous level
+                mod0_runs_type mod0_runs(c0, memsize / 4);
+                mod1_runs_type mod1_runs(c1, memsize / 4);
+                mod2_runs_type mod2_runs(c2, memsize / 4);
+
+                while (!source.empty())
+                {
+                    exists[0] = false;
+                    exists[1] = false;
+                    exists[2] = false;
+
+                    if (!source.empty()) {
+                        t[0] = *source;
+                        ++source;
+                        exists[0] = true;
+                    }
+
+                    if (!source.empty()) {
+                        assert(!mod_1.empty());
+                        t[1] = *source;
+                        ++source;
+                        mod_one = *mod_1 + add_rank;
+                        ++mod_1;
+                        exists[1] = true;
+                    }
+
+                    if (!source.empty()) {
+                        assert(!mod_2.empty());
+                        t[2] = *source;
+                        ++source;
+                        mod_two = *mod_2 + add_rank;
+                        ++mod_2;
+                        exists[2] = true;
+                    }
+
+                    // Check special cases in the middle of "source"
+                    // Cases are cx|xc cxx|cxx and cxxc|xxc
+
+                    assert(t[0] != offset_type(0));
+                    assert(!exists[1] || t[1] != offset_type(0));
+                    assert(!exists[2] || t[2] != offset_type(0));
+
+                    // Mod 0 : (index0,char0,char1,mod1,mod2)
+                    // Mod 1 : (index1,mod1,char1,mod2)
+                    // Mod 2 : (index2,mod2)
+
+                    if (exists[2]) { // Nothing is missed
+                        mod0_runs.push(skew_quint_type(index, t[0], t[1], mod_one, mod_two));
+                        mod1_runs.push(skew_quad_type(index + 1, mod_one, t[1], mod_two));
+
+                        if (index != offset_type(0)) {
+                            mod2_runs.push(skew_quint_type((index - 1), old_mod2, old_t2, t[0], mod_one));
+                        }
+                    }
+                    else if (exists[1]) { // Last element missed
+                        mod0_runs.push(skew_quint_type(index, t[0], t[1], mod_one, 0));
+                        mod1_runs.push(skew_quad_type(index + 1, mod_one, t[1], 0));
+
+                        if (index != offset_type(0)) {
+                            mod2_runs.push(skew_quint_type((index - 1), old_mod2, old_t2, t[0], mod_one));
+                        }
+                    }
+                    else { // Only one element left
+                        assert(exists[0]);
+                        mod0_runs.push(skew_quint_type(index, t[0], 0, 0, 0));
+
+                        if (index != offset_type(0)) {
+                            mod2_runs.push(skew_quint_type((index - 1), old_mod2, old_t2, t[0], 0));
+                        }
+                    }
+
+                    old_mod2 = mod_two;
+                    old_t2 = t[2];
+                    index += 3;
+                }
+
+                if ((a_size % 3) == 0) { // changed
+                    if (index != offset_type(0)) {
+                        mod2_runs.push(skew_quint_type((index - 1), old_mod2, old_t2, 0, 0));
+                    }
+                }
+
+                mod0_runs.deallocate();
+                mod1_runs.deallocate();
+                mod2_runs.deallocate();
+
+                STXXL_VERBOSE1("suffix_array: merging S0 = " << mod0_runs.size() << ", S1 = " << mod1_runs.size()
+                               << ", S2 = " << mod2_runs.size() << " tuples");
+
+                // Prepare for merging
+
+                mod0_result = new mod0_rm_type(mod0_runs.result(), less_mod0(), memsize / 5);
+                mod1_result = new mod1_rm_type(mod1_runs.result(), less_mod1(), memsize / 5);
+                mod2_result = new mod2_rm_type(mod2_runs.result(), less_mod2(), memsize / 5);
+
+                // output: ISA_1,2 for next level
+                vmerge_sa = new merge_sa_type(*mod0_result, *mod1_result, *mod2_result);
+
+                result = *(*vmerge_sa);
+            }
+
+            const value_type & operator*() const
+            {
+                return result;
+            }
+
+            build_sa & operator++()
+            {
+                assert(vmerge_sa != 0 && !vmerge_sa->empty());
+
+                ++(*vmerge_sa);
+                if (!vmerge_sa->empty()) {
+                    result = *(*vmerge_sa);
+                }
+                else {  // cleaning up
+                    assert(vmerge_sa->empty());
+                    ready = true;
+
+                    assert(vmerge_sa != NULL);
+                    delete vmerge_sa;
+
+                    assert(mod0_result != NULL && mod1_result != NULL && mod2_result != NULL);
+                    delete mod0_result;
+                    delete mod1_result;
+                    delete mod2_result;
+                }
+
+                return *this;
+            }
+
+            bool empty() const {
+                return ready;
+            }
+        };
+
+        /** The skew algorithm.
+         *  @param Input type of the input pipe. */
+        template <class Input>
+        class algorithm
+        {
+        public:
+            typedef offset_type value_type;
+            typedef typename Input::value_type alphabet_type;
+
+        protected:
+
+            // finished reading final suffix array
+            bool finished;
+
+            // current recursion depth
+            unsigned int rec_depth;
+
+            // memory budget in bytes
+            uint64 m_memory;
+
+        protected:
+
+            // generate (i) sequence
+            typedef counter<offset_type> counter_stream_type;
+
+            // Sorter
+            typedef tuple_less1st<skew_pair_type> mod12cmp;
+            typedef sorter<skew_pair_type, mod12cmp> mod12_sorter_type;
+
+            // Additional streaming items
+            typedef stream::choose<mod12_sorter_type, 2> isa_second_type;
+            typedef build_sa<offset_array_it_rg, isa_second_type, isa_second_type> buildSA_type;
+            typedef make_pairs< buildSA_type , counter_stream_type> precompute_isa_type;
+
+            // Real recursive skew3 implementation
+            // This part is the core of the skew algorithm and runs all class objects in their respective order
+            template <typename RecInputType>
+            buildSA_type* skew3(RecInputType& p_Input)
+            {
+                // (t_i) -> (i,t_i,t_{i+1},t_{i+2})
+                typedef make_quads <RecInputType, offset_type, 1> make_quads_input_type;
+
+                // (t_i) -> (i,t_i,t_{i+1},t_{i+2}) with i = 1,2 mod 3
+                typedef extract_mod12 <make_quads_input_type> mod12_quads_input_type;
+
+                // sort (i,t_i,t_{i+1},t_{i+2}) by (t_i,t_{i+1},t_{i+2})
+                typedef typename stream::sort<mod12_quads_input_type, less_quad<offset_type> > sort_mod12_input_type;
+
+                // name (i,t_i,t_{i+1},t_{i+2}) -> (i,n_i)
+                typedef naming <sort_mod12_input_type> naming_input_type;
+
+                mod12_sorter_type m1_sorter(mod12cmp(), m_memory / 5);
+                mod12_sorter_type m2_sorter(mod12cmp(), m_memory / 5);
+
+                // sorted mod1 runs -concatenate- sorted mod2 runs
+                typedef concatenate <mod12_sorter_type, mod12_sorter_type> concatenation;
+
+                // (t_i) -> (i,t_i,t_{i+1},t_{i+2})
+                offset_array_type text;
+                make_quads_input_type quads_input(p_Input, text);
+
+                // (t_i) -> (i,t_i,t_{i+1},t_{i+2}) with i = 1,2 mod 3
+                mod12_quads_input_type mod12_quads_input(quads_input);
+
+                // sort (i,t_i,t_{i+1},t_{i+2}) by (t_i,t_i+1},t_{i+2})
+                sort_mod12_input_type sort_mod12_input(mod12_quads_input, less_quad<offset_type>(), m_memory / 5);
+
+                // name (i,t_i,t_{i+1},t_{i+2}) -> (i,"n_i")
+                bool unique = false; // is the current quad array unique?
+                naming_input_type names_input(sort_mod12_input, unique);
+
+                // create (i, s^12[i])
+                external_size_type concat_length = 0; // holds length of current S_12
+                while (!names_input.empty()) {
+                    const skew_pair_type& tmp = *names_input;
+                    if (tmp.first & 1) {
+                        m2_sorter.push(tmp); // sorter #2
+                    }
+                    else {
+                        m1_sorter.push(tmp); // sorter #1
+                    }
+                    ++names_input;
+                    concat_length++;
+                }
+
+                STXXL_VERBOSE1("suffix_array: recursion string length = " << concat_length);
+
+                m1_sorter.sort();
+                m2_sorter.sort();
+
+                if (!unique)
+                {
+                    ++rec_depth;
+                    STXXL_VERBOSE1("suffix_array: names not unique, next recursion level = " << rec_depth);
+
+                    // compute s^12 := lexname[S[1 mod 3]] . lexname[S[2 mod 3]], (also known as reduced recursion string 'R')
+                    concatenation concat_mod1mod2(m1_sorter, m2_sorter);
+
+                    buildSA_type* recType = skew3(concat_mod1mod2); // recursion with recursion string T' = concat_mod1mod2 lexnames
+
+                    --rec_depth;
+                    STXXL_VERBOSE1("suffix_array: exit to recursion level = " << rec_depth);
+
+                    counter_stream_type isa_loop_index;
+                    precompute_isa_type isa_pairs(*recType, isa_loop_index); // add index as component => (SA12, i)
+
+                    // store beginning of mod2-tuples of s^12 in mod2_pos
+                    offset_type special = (concat_length != subp_size(text.size()));
+                    offset_type mod2_pos = (subp_size(text.size()) >> 1) + (subp_size(text.size()) & 1) + special;
+
+                    mod12_sorter_type isa1_pair(mod12cmp(), m_memory / 5);
+                    mod12_sorter_type isa2_pair(mod12cmp(), m_memory / 5);
+
+                    while (!isa_pairs.empty()) {
+                        const skew_pair_type& tmp = *isa_pairs;
+                        if (tmp.first < mod2_pos) {
+                            if (tmp.first + special < mod2_pos) // else: special sentinel tuple is dropped
+                                isa1_pair.push(tmp); // sorter #1
+                        } else {
+                            isa2_pair.push(tmp); // sorter #2
+                        }
+                        ++isa_pairs;
+                    }
+
+                    delete recType;
+
+                    isa1_pair.finish();
+                    isa2_pair.finish();
+
+                    offset_array_it_rg input(text.begin(), text.end());
+
+                    // => (i, ISA)
+                    isa1_pair.sort(m_memory / 8);
+                    isa2_pair.sort(m_memory / 8);
+
+                    // pick ISA of (i, ISA)
+                    isa_second_type isa1(isa1_pair);
+                    isa_second_type isa2(isa2_pair);
+
+                    // prepare and run merger
+                    return new buildSA_type(input, isa1, isa2, text.size(), m_memory);
+                }
+                else // unique
+                {
+                    STXXL_VERBOSE1("suffix_array: names are unique");
+
+                    isa_second_type isa1(m1_sorter);
+                    isa_second_type isa2(m2_sorter);
+
+                    offset_array_it_rg source(text.begin(), text.end());
+
+                    // prepare and run merger
+                    return new buildSA_type(source, isa1, isa2, text.size(), m_memory);
+                }
+            } // end of skew3()
+
+        protected:
+
+            // Adapt (t_i) -> (i,t_i) for input to fit to recursive call
+            typedef make_pairs<counter_stream_type, Input> make_pairs_input_type;
+
+            // points to final constructed suffix array generator
+            buildSA_type *out_sa;
+
+        public:
+
+            algorithm(Input & data_in, uint64 memory)
+                : finished(false), rec_depth(0), m_memory(memory)
+            {
+                // (t_i) -> (i,t_i)
+                counter_stream_type dummy;
+                make_pairs_input_type pairs_input(dummy, data_in);
+
+                out_sa = skew3(pairs_input);
+            }
+
+            const value_type & operator*() const
+            {
+                return *(*out_sa);
+            }
+
+            algorithm & operator++()
+            {
+                assert(!out_sa->empty());
+
+                ++(*out_sa);
+
+                if ((out_sa != NULL) && (out_sa->empty())) {
+                    finished = true;
+                    delete out_sa; out_sa = NULL;
+                }
+                return *this;
+            }
+
+            bool empty() const
+            {
+                return finished;
+            }
+        }; // algorithm class
+    }; // skew class
+}
+
+//! Stream package subnamespace.
+namespace stream
+{
+    ////////////////////////////////////////////////////////////////////////
+    //     SUFFIX_ARRAY_DC3                                               //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Suffix array of a text stream computed with the DC3 (skew) algorithm.
+    //!
+    //! Reads the whole text in the constructor and yields the suffix array,
+    //! i.e. the starting positions of the suffixes in lexicographic order.
+    //! All sorting is done with \c runs_creator / \c runs_merger, so run
+    //! formation and merging are parallel if STXXL is built in parallel mode.
+    //! \tparam Input_ stream of characters, of an unsigned type smaller than \c OffsetType_
+    //! \tparam OffsetType_ integer type of the suffix array entries, must hold n + 3
+    template <class Input_, class OffsetType_>
+    class suffix_array_dc3 : public suffix_array_local::skew<OffsetType_>::template algorithm<Input_>
+    {
+        typedef typename suffix_array_local::skew<OffsetType_>::template algorithm<Input_> base;
+
+    public:
+        //! \param input text, at least three characters long
+        //! \param memory_to_use memory for sorting in bytes
+        suffix_array_dc3(Input_ & input, uint64 memory_to_use)
+            : base(input, memory_to_use)
+        { }
+    };
+}
+
+//! \addtogroup stlalgo
+//! \{
+
+//! \brief Computes the suffix array of a text with the DC3 algorithm.
+//!
+//! \param text the text
+//! \param sa resized to text.size() and filled with the suffix array
+//! \param memory_to_use memory for sorting in bytes
+//! \param num_threads threads for parallel sorting and merging, 0 keeps the default
+//! \remark the value type of \c sa must be able to hold text.size() + 3
+template <class TextVector, class SAVector>
+void suffix_array(const TextVector & text, SAVector & sa, uint64 memory_to_use,
+                  unsigned num_threads = 0)
+{
+    typedef typename SAVector::value_type offset_type;
+    typedef typename stream::streamify_traits<typename TextVector::const_iterator>::stream_type text_stream_type;
+
+    const external_size_type n = text.size();
+    if (n + 3 >= external_size_type(std::numeric_limits<offset_type>::max()))
+        STXXL_THROW_INVALID_ARGUMENT("text is too long for the offset type of the suffix array");
+
+    sa.resize(n);
+    if (n < 3)
+    {
+        // DC3 needs all three residue classes to be non-empty
+        std::vector<typename TextVector::value_type> t(text.begin(), text.end());
+        std::vector<offset_type> s;
+        for (offset_type i = 0; i < offset_type(n); ++i)
+            s.push_back(i);
+        std::sort(s.begin(), s.end(), suffix_array_local::naive_suffix_less<typename TextVector::value_type, offset_type>(t));
+        std::copy(s.begin(), s.end(), sa.begin());
+        return;
+    }
+
+    scoped_thread_budget budget(num_threads);
+    text_stream_type input = stream::streamify(text.begin(), text.end());
+    stream::suffix_array_dc3<text_stream_type, offset_type> dc3(input, memory_to_use);
+    stream::materialize(dc3, sa.begin(), sa.end());
+}
+
+//! \brief Checks that \c sa is the suffix array of \c text.
+//!
+//! Uses two external sorts; see Kaerkkaeinen and Burkhardt.
+//! \param memory_to_use memory for sorting in bytes
+template <class TextVector, class SAVector>
+bool suffix_array_check(const TextVector & text, const SAVector & sa, uint64 memory_to_use)
+{
+    if (text.size() != sa.size())
+        return false;
+    if (sa.size() == 0)
+        return true;
+
+    typename stream::streamify_traits<typename TextVector::const_iterator>::stream_type
+    text_stream = stream::streamify(text.begin(), text.end());
+    typename stream::streamify_traits<typename SAVector::const_iterator>::stream_type
+    sa_stream = stream::streamify(sa.begin(), sa.end());
+
+    return suffix_array_local::sacheck(text_stream, sa_stream, memory_to_use);
+}
+
+//! \brief Computes the longest common prefix array from a text and its suffix array.
+//!
+//! lcp[0] = 0 and lcp[i] is the length of the longest common prefix of the
+//! suffixes sa[i - 1] and sa[i]. Uses the permuted LCP array (PLCP) and two
+//! external sorts: one brings the predecessor of every suffix into text
+//! order, the other brings the PLCP values into suffix array order.
+//!
+//! If the text takes at most half of \c memory_to_use, a copy of it is kept in
+//! internal memory and the rest is used for sorting. Larger texts are handled
+//! fully externally by prefix doubling, which needs O(log(max LCP)) rounds
+//! of sorting instead of two.
+//! \param text the text
+//! \param sa the suffix array of \c text
+//! \param lcp resized to sa.size() and filled with the LCP array
+//! \param memory_to_use memory for sorting in bytes
+//! \param num_threads threads for parallel sorting and merging, 0 keeps the default
+template <class TextVector, class SAVector, class LCPVector>
+void lcp_array(const TextVector & text, const SAVector & sa, LCPVector & lcp,
+               uint64 memory_to_use, unsigned num_threads = 0)
+{
+    typedef typename SAVector::value_type offset_type;
+    typedef typename TextVector::value_type alphabet_type;
+    typedef typename LCPVector::value_type lcp_type;
+    typedef tuple<offset_type, offset_type, offset_type> triple_type;   // (SA[i], SA[i-1], i)
+    typedef tuple<offset_type, lcp_type> pair_type;                     // (i, LCP[i])
+    typedef tuple_less1st<triple_type> triple_less_type;
+    typedef tuple_less1st<pair_type> pair_less_type;
+    typedef stream::runs_creator<stream::use_push<triple_type>, triple_less_type> triple_rc_type;
+    typedef stream::runs_merger<typename triple_rc_type::sorted_runs_type, triple_less_type> triple_rm_type;
+    typedef stream::runs_creator<stream::use_push<pair_type>, pair_less_type> pair_rc_type;
+    typedef stream::runs_merger<typename pair_rc_type::sorted_runs_type, pair_less_type> pair_rm_type;
+
+    assert(text.size() == sa.size());
+    const offset_type n = offset_type(sa.size());
+    lcp.resize(sa.size());
+    if (sa.size() == 0)
+        return;
+
+    scoped_thread_budget budget(num_threads);
+
+    const uint64 text_bytes = uint64(text.size()) * sizeof(alphabet_type);
+    if (text_bytes > memory_to_use / 2)
+    {
+        suffix_array_local::lcp_doubling(text, sa, lcp, memory_to_use);
+        return;
+    }
+    memory_to_use -= text_bytes;
+
+    // sort the predecessors in the suffix array by their successor: phi
+    triple_rc_type phi_rc(triple_less_type(), memory_to_use / 2);
+    {
+        typename stream::streamify_traits<typename SAVector::const_iterator>::stream_type
+        sa_stream = stream::streamify(sa.begin(), sa.end());
+        offset_type prev = n;
+        for (offset_type i = 0; !sa_stream.empty(); ++sa_stream, ++i)
+        {
+            phi_rc.push(triple_type(*sa_stream, prev, i));
+            prev = *sa_stream;
+        }
+    }
+    typename triple_rc_type::sorted_runs_type phi_runs = phi_rc.result();
+    phi_rc.deallocate();
+
+    std::vector<alphabet_type> itext(text.size());
+    {
+        typename stream::streamify_traits<typename TextVector::const_iterator>::stream_type
+        text_stream = stream::streamify(text.begin(), text.end());
+        stream::materialize(text_stream, itext.begin(), itext.end());
+    }
+
+    // PLCP[j] >= PLCP[j - 1] - 1, so scanning in text order takes O(n) comparisons
+    pair_rc_type lcp_rc(pair_less_type(), memory_to_use / 2);
+    {
+        triple_rm_type phi(phi_runs, triple_less_type(), memory_to_use / 2);
+        offset_type l = 0;
+        for (offset_type j = 0; !phi.empty(); ++phi, ++j)
+        {
+            const triple_type & t = *phi;
+            assert(t.first == j);
+            if (t.second == n)
+                l = 0;
+            else
+            {
+                const offset_type k = t.second;
+                while (j + l < n && k + l < n && itext[j + l] == itext[k + l])
+                    ++l;
+            }
+            lcp_rc.push(pair_type(t.third, lcp_type(l)));
+            if (l > 0)
+                --l;
+        }
+    }
+    std::vector<alphabet_type>().swap(itext);
+    typename pair_rc_type::sorted_runs_type lcp_runs = lcp_rc.result();
+    lcp_rc.deallocate();
+
+    pair_rm_type lcp_sorted(lcp_runs, pair_less_type(), memory_to_use);
+    stream::choose<pair_rm_type, 2> lcp_values(lcp_sorted);
+    stream::materialize(lcp_values, lcp.begin(), lcp.end());
+}
+
+//! \}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_SUFFIX_ARRAY_HEADER
+// vim: et:ts=4:sw=4
@@ -0,0 +1,131 @@
+/***************************************************************************
+ *  include/stxxl/bits/common/hyperloglog.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_HYPERLOGLOG_HEADER
+#define STXXL_HYPERLOGLOG_HEADER
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/common/types.h>
+#include <stxxl/bits/common/utils.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! \brief HyperLogLog sketch estimating the number of distinct elements.
+//!
+//! Uses 2^precision one-byte registers; the standard error of the estimate
+//! is about 1.04 / sqrt(2^precision), e.g. 1.6% for the default precision
+//! of 12 (4 KiB). Elements are added by their hash values, which are mixed
+//! internally, so weak hash functions (like the identity for integers) are
+//! fine.
+class hyperloglog
+{
+    unsigned precision;
+    std::vector<unsigned char> registers;
+
+public:
+    //! 64-bit finalizer spreading the bits of a hash value.
+    static stxxl::uint64 mix(stxxl::uint64 h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    //! \param precision_ number of index bits, between 4 and 18
+    explicit hyperloglog(unsigned precision_ = 12) :
+        precision(STXXL_MIN<unsigned>(STXXL_MAX<unsigned>(precision_, 4), 18)),
+        registers(size_t(1) << precision, 0)
+    { }
+
+    //! Adds an element given by its hash value.
+    void insert(stxxl::uint64 hash)
+    {
+        const stxxl::uint64 h = mix(hash);
+        const size_t index = size_t(h >> (64 - precision));
+        stxxl::uint64 rest = h << precision;
+        // position of the leftmost one bit in the remaining bits
+        unsigned char rank = 1;
+        const unsigned char max_rank = (unsigned char)(64 - precision + 1);
+        while (rank < max_rank && !(rest & 0x8000000000000000ull))
+        {
+            rest <<= 1;
+            ++rank;
+        }
+        if (registers[index] < rank)
+            registers[index] = rank;
+    }
+
+    //! Merges the sketch of another set with the same precision into this one.
+    void merge(const hyperloglog & other)
+    {
+        assert(precision == other.precision);
+        for (size_t i = 0; i < registers.size(); ++i)
+            registers[i] = std::max(registers[i], other.registers[i]);
+    }
+
+    //! Forgets all elements.
+    void clear()
+    {
+        std::fill(registers.begin(), registers.end(), 0);
+    }
+
+    //! Estimated number of distinct elements added so far.
+    double estimate() const
+    {
+        const double m = double(registers.size());
+        double alpha;
+        switch (registers.size())
+        {
+        case 16:
+            alpha = 0.673;
+            break;
+        case 32:
+            alpha = 0.697;
+            break;
+        case 64:
+            alpha = 0.709;
+            break;
+        default:
+            alpha = 0.7213 / (1.0 + 1.079 / m);
+        }
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (size_t i = 0; i < registers.size(); ++i)
+        {
+            sum += std::ldexp(1.0, -int(registers[i]));
+            if (registers[i] == 0)
+                ++zeros;
+        }
+        const double e = alpha * m * m / sum;
+        // small range correction: linear counting
+        if (e <= 2.5 * m && zeros > 0)
+            return m * std::log(m / double(zeros));
+        return e;
+    }
+
+    unsigned get_precision() const
+    {
+        return precision;
+    }
+};
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_HYPERLOGLOG_HEADER
+// vim: et:ts=4:sw=4
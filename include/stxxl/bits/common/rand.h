@@ -212,6 +212,54 @@ struct random_number64
 #pragma warning(pop) // assignment operator could not be generated
 #endif
 
+//! Counter-based uniform [0, 2^64) pseudo-random generator (SplitMix64).
+//! The n-th number is a pure function of (seed, stream, n) and can be
+//! computed directly with \c at(n), so threads can draw numbers for disjoint
+//! index ranges without sharing state and the results do not depend on the
+//! number of threads. Different stream ids give independent sequences.
+struct random_number_counter
+{
+    typedef stxxl::uint64 value_type;
+    value_type key;
+    mutable value_type counter;
+
+    //! \param seed seed, 0 takes one from \c get_next_seed()
+    //! \param stream id of the sequence
+    random_number_counter(value_type seed = 0, value_type stream = 0)
+        : counter(0)
+    {
+        if (!seed)
+            seed = get_next_seed();
+        key = mix(mix(seed) ^ (stream * 0xD1B54A32D192ED03ull + 1));
+    }
+
+    //! SplitMix64 finalizer.
+    static value_type mix(value_type z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    //! Returns the n-th random number of the sequence from [0, 2^64)
+    inline value_type at(value_type n) const
+    {
+        return mix(key + (n + 1) * 0x9E3779B97F4A7C15ull);
+    }
+
+    //! Returns the next random number from [0, 2^64)
+    inline value_type operator () () const
+    {
+        return at(counter++);
+    }
+
+    //! Returns the next random number from [0, N)
+    inline value_type operator () (value_type N) const
+    {
+        return operator()() % N;
+    }
+};
+
 __STXXL_END_NAMESPACE
 
 #endif // !STXXL_RAND_HEADER
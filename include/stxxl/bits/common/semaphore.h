@@ -19,11 +19,15 @@
 #if STXXL_STD_THREADS
  #include <mutex>
  #include <condition_variable>
+ #include <chrono>
 #elif STXXL_BOOST_THREADS
  #include <boost/thread/mutex.hpp>
  #include <boost/thread/condition.hpp>
+ #include <boost/thread/thread_time.hpp>
 #elif STXXL_POSIX_THREADS
  #include <pthread.h>
+ #include <cerrno>
+ #include <ctime>
 #else
  #error "Thread implementation not detected."
 #endif
@@ -125,6 +129,69 @@ public:
         return res;
 #endif
     }
+    // function decrements the semaphore only if it is positive and never
+    // blocks, returns whether it was decremented
+    bool try_decrement()
+    {
+#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+        scoped_lock Lock(mutex);
+        if (v <= 0)
+            return false;
+        --v;
+        return true;
+#else
+        check_pthread_call(pthread_mutex_lock(&mutex));
+        bool res = (v > 0);
+        if (res)
+            --v;
+        check_pthread_call(pthread_mutex_unlock(&mutex));
+        return res;
+#endif
+    }
+    // function decrements the semaphore like operator --, but blocks at
+    // most for the given number of seconds, returns whether it was
+    // decremented
+    bool timed_decrement(double seconds)
+    {
+        if (seconds < 0.0)
+            seconds = 0.0;
+#if STXXL_STD_THREADS
+        const std::chrono::steady_clock::time_point until =
+            std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(seconds * 1e6));
+        scoped_lock Lock(mutex);
+        while (v <= 0)
+            if (cond.wait_until(Lock, until) == std::cv_status::timeout)
+                break;
+#elif STXXL_BOOST_THREADS
+        const boost::system_time until =
+            boost::get_system_time() + boost::posix_time::microseconds((long long)(seconds * 1e6));
+        scoped_lock Lock(mutex);
+        while (v <= 0)
+            if (!cond.timed_wait(Lock, until))
+                break;
+#else
+        timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        const long long nsec = until.tv_nsec + (long long)(seconds * 1e9);
+        until.tv_sec += time_t(nsec / 1000000000);
+        until.tv_nsec = long(nsec % 1000000000);
+        check_pthread_call(pthread_mutex_lock(&mutex));
+        while (v <= 0)
+        {
+            int res = pthread_cond_timedwait(&cond, &mutex, &until);
+            if (res == ETIMEDOUT)
+                break;
+            check_pthread_call(res);
+        }
+#endif
+        const bool res = (v > 0);
+        if (res)
+            --v;
+#if !(STXXL_STD_THREADS || STXXL_BOOST_THREADS)
+        check_pthread_call(pthread_mutex_unlock(&mutex));
+#endif
+        return res;
+    }
     // function returns the value of the semaphore at the time the
     // critical section is accessed.  obviously the value is not guaranteed
     // after the function unlocks the critical section.
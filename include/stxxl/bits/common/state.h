@@ -17,7 +17,13 @@
 
 #include <stxxl/bits/config.h>
 
-#if STXXL_STD_THREADS
+#if STXXL_HAVE_FUTEX
+ #include <atomic>
+ #include <climits>
+ #include <unistd.h>
+ #include <sys/syscall.h>
+ #include <linux/futex.h>
+#elif STXXL_STD_THREADS
  #include <mutex>
  #include <condition_variable>
 #elif STXXL_BOOST_THREADS
@@ -35,12 +41,27 @@
 
 __STXXL_BEGIN_NAMESPACE
 
+//! A value that threads can wait for to reach a certain state.
+//!
+//! With futexes, reading and setting the state needs no lock and setting it
+//! enters the kernel only if threads are waiting, which keeps per-request
+//! completion cheap. Otherwise a mutex and condition variable are used.
 template <typename Tp = int>
 class state : private noncopyable
 {
     typedef Tp value_type;
 
-#if STXXL_STD_THREADS
+#if STXXL_HAVE_FUTEX
+    //! the state, waited for by futex, therefore a plain int
+    std::atomic<int> _state;
+    //! number of threads that may be sleeping on _state
+    std::atomic<int> _waiters;
+
+    int * futex_word()
+    {
+        return reinterpret_cast<int *>(&_state);
+    }
+#elif STXXL_STD_THREADS
     std::mutex mutex;
     std::condition_variable cond;
     typedef std::unique_lock<std::mutex> scoped_lock;
@@ -52,9 +73,16 @@ class state : private noncopyable
     pthread_mutex_t mutex;
     pthread_cond_t cond;
 #endif
+
+#if !STXXL_HAVE_FUTEX
     value_type _state;
+#endif
 
 public:
+#if STXXL_HAVE_FUTEX
+    state(value_type s) : _state(s), _waiters(0)
+    { }
+#else
     state(value_type s) : _state(s)
     {
 #if STXXL_POSIX_THREADS
@@ -76,10 +104,17 @@ public:
         check_pthread_call(pthread_cond_destroy(&cond));
 #endif
     }
+#endif
 
     void set_to(value_type new_state)
     {
-#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+#if STXXL_HAVE_FUTEX
+        // sequentially consistent: either a waiter sees the new state or we
+        // see the waiter
+        _state.store(new_state);
+        if (_waiters.load() != 0)
+            syscall(SYS_futex, futex_word(), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#elif STXXL_STD_THREADS || STXXL_BOOST_THREADS
         scoped_lock Lock(mutex);
         _state = new_state;
         Lock.unlock();
@@ -94,7 +129,16 @@ public:
 
     void wait_for(value_type needed_state)
     {
-#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+#if STXXL_HAVE_FUTEX
+        for (int current = _state.load(); current != needed_state; current = _state.load())
+        {
+            ++_waiters;
+            // returns at once if the state changed after it was read
+            if (_state.load() == current)
+                syscall(SYS_futex, futex_word(), FUTEX_WAIT_PRIVATE, current, NULL, NULL, 0);
+            --_waiters;
+        }
+#elif STXXL_STD_THREADS || STXXL_BOOST_THREADS
         scoped_lock Lock(mutex);
         while (needed_state != _state)
             cond.wait(Lock);
@@ -110,7 +154,9 @@ public:
 
     value_type operator () ()
     {
-#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+#if STXXL_HAVE_FUTEX
+        return static_cast<value_type>(_state.load());
+#elif STXXL_STD_THREADS || STXXL_BOOST_THREADS
         scoped_lock Lock(mutex);
         return _state;
 #else
@@ -0,0 +1,209 @@
+/***************************************************************************
+ *  include/stxxl/bits/common/trace.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_COMMON_TRACE_HEADER
+#define STXXL_COMMON_TRACE_HEADER
+
+#ifndef STXXL_TRACE
+ #define STXXL_TRACE 1
+#endif
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_ATOMIC
+ #include <atomic>
+#endif
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/singleton.h>
+#include <stxxl/bits/unused.h>
+#include <stxxl/bits/common/types.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/timer.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! One completed operation: a name, a category, the time span and up to two
+//! integer arguments. Names, categories and argument names must be string
+//! literals, they are not copied.
+struct trace_event
+{
+    const char * category;
+    const char * name;
+    double begin;
+    double duration;
+    const char * arg_names[2];
+    int64 args[2];
+};
+
+//! \brief Collects trace events of the major phases and writes them in
+//! Chrome trace format.
+//!
+//! Every thread records into a ring buffer of its own that keeps the most
+//! recent events, so tracing long runs needs bounded memory. The result can
+//! be loaded into \c chrome://tracing or the Perfetto UI, showing per thread
+//! when run formation, merging, priority queue refills, B-tree node cache
+//! misses and the requests served by the disk queues took place.
+//!
+//! Tracing is off by default and costs one flag test per traced scope then.
+//! It is switched on by enable() or by setting the environment variable
+//! \c STXXLTRACEFILE to a file name, which the trace is written to at exit.
+//! Compiling with \c STXXL_TRACE=0 removes all trace points.
+class tracer : public singleton<tracer, false>
+{
+    friend class singleton<tracer, false>;
+
+    class thread_buffer;
+
+#if STXXL_STD_ATOMIC
+    static std::atomic<bool> enabled_flag;
+#else
+    static volatile bool enabled_flag;
+#endif
+
+    mutex buffers_mutex;
+    std::vector<thread_buffer *> buffers;
+    unsigned_type events_per_thread;
+    std::string filename;
+    double origin;
+
+    tracer();
+
+    thread_buffer * get_buffer();
+    static void dump_at_exit();
+
+public:
+    //! Tests cheaply whether events are recorded.
+    static bool enabled()
+    {
+#if STXXL_TRACE
+        return enabled_flag;
+#else
+        return false;
+#endif
+    }
+
+    //! \brief Starts recording.
+    //! \param filename_ file the trace is written to at exit, empty for none
+    //! \param events_per_thread_ capacity of each thread's ring buffer,
+    //! changing it drops the events recorded so far
+    void enable(const std::string & filename_ = std::string(),
+                unsigned_type events_per_thread_ = 64 * 1024);
+
+    //! Stops recording, the recorded events are kept.
+    void disable();
+
+    //! Drops all recorded events.
+    void clear();
+
+    //! Records a completed event in the calling thread's buffer.
+    void record(const trace_event & event);
+
+    //! Number of events currently held in all buffers.
+    unsigned_type size();
+
+    //! Number of events overwritten because a ring buffer was full.
+    uint64 get_dropped();
+
+    //! Writes the recorded events as Chrome trace JSON.
+    void dump(std::ostream & o);
+
+    //! Writes the recorded events as Chrome trace JSON to a file.
+    void dump(const std::string & filename_);
+};
+
+//! \brief Records the lifetime of a scope as a trace event.
+//!
+//! Nothing is recorded if tracing was disabled when the scope was entered.
+class scoped_trace : private noncopyable
+{
+#if STXXL_TRACE
+    trace_event event;
+    bool active;
+#endif
+
+public:
+    //! Begins the event; \c category and \c name must be string literals.
+    scoped_trace(const char * category, const char * name)
+    {
+#if STXXL_TRACE
+        active = tracer::enabled();
+        if (active)
+        {
+            event.category = category;
+            event.name = name;
+            event.arg_names[0] = event.arg_names[1] = NULL;
+            event.args[0] = event.args[1] = 0;
+            event.begin = timestamp();
+        }
+#else
+        STXXL_UNUSED(category);
+        STXXL_UNUSED(name);
+#endif
+    }
+
+    //! Begins the event with an argument.
+    scoped_trace(const char * category, const char * name, const char * arg_name, int64 arg)
+    {
+#if STXXL_TRACE
+        active = tracer::enabled();
+        if (active)
+        {
+            event.category = category;
+            event.name = name;
+            event.arg_names[0] = arg_name;
+            event.arg_names[1] = NULL;
+            event.args[0] = arg;
+            event.args[1] = 0;
+            event.begin = timestamp();
+        }
+#else
+        STXXL_UNUSED(category);
+        STXXL_UNUSED(name);
+        STXXL_UNUSED(arg_name);
+        STXXL_UNUSED(arg);
+#endif
+    }
+
+    //! Sets the second argument, e.g. a result known at the end of the scope.
+    void set_arg(const char * arg_name, int64 arg)
+    {
+#if STXXL_TRACE
+        event.arg_names[1] = arg_name;
+        event.args[1] = arg;
+#else
+        STXXL_UNUSED(arg_name);
+        STXXL_UNUSED(arg);
+#endif
+    }
+
+    //! Ends and records the event.
+    ~scoped_trace()
+    {
+#if STXXL_TRACE
+        if (active && tracer::enabled())
+        {
+            event.duration = timestamp() - event.begin;
+            tracer::get_instance()->record(event);
+        }
+#endif
+    }
+};
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_COMMON_TRACE_HEADER
+// vim: et:ts=4:sw=4
@@ -40,6 +40,16 @@ __STXXL_BEGIN_NAMESPACE
 
 ////////////////////////////////////////////////////////////////////////////
 
+#if STXXL_HAVE_CXX11
+ #define STXXL_THREAD_LOCAL thread_local
+#elif STXXL_MSVC
+ #define STXXL_THREAD_LOCAL __declspec(thread)
+#else
+ #define STXXL_THREAD_LOCAL __thread
+#endif
+
+////////////////////////////////////////////////////////////////////////////
+
 #if defined(__GXX_EXPERIMENTAL_CXX0X__)
 #define STXXL_STATIC_ASSERT(x) static_assert(x, #x)
 #else
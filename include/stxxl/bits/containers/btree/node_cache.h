@@ -20,6 +20,7 @@
 #include <stxxl/bits/mng/typed_block.h>
 #include <stxxl/bits/containers/pager.h>
 #include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/trace.h>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -289,6 +290,7 @@ namespace btree
             }
 
             ++n_not_found;
+            scoped_trace trace("btree", "node cache miss");
 
             // the node is not in cache
             if (free_nodes_.empty())
@@ -385,6 +387,7 @@ namespace btree
             }
 
             ++n_not_found;
+            scoped_trace trace("btree", "node cache miss");
 
             // the node is not in cache
             if (free_nodes_.empty())
@@ -19,6 +19,7 @@
 #ifndef STXXL_PRIORITY_QUEUE_HEADER
 #define STXXL_PRIORITY_QUEUE_HEADER
 
+#include <stxxl/bits/common/trace.h>
 #include <stxxl/bits/containers/pq_helpers.h>
 #include <stxxl/bits/containers/pq_mergers.h>
 #include <stxxl/bits/containers/pq_ext_merger.h>
@@ -499,6 +500,7 @@ template <class ConfigType>
 void priority_queue<ConfigType>::refill_delete_buffer()
 {
     STXXL_VERBOSE_PQ("refill_delete_buffer()");
+    scoped_trace trace("priority_queue", "refill delete buffer");
 
     size_type total_group_size = 0;
     //num_active_groups is <= 4
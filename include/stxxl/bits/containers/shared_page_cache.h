@@ -0,0 +1,345 @@
+/***************************************************************************
+ *  include/stxxl/bits/containers/shared_page_cache.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_SHARED_PAGE_CACHE_HEADER
+#define STXXL_SHARED_PAGE_CACHE_HEADER
+
+#include <map>
+#include <vector>
+#include <cassert>
+
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/aligned_alloc.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/simple_vector.h>
+#include <stxxl/bits/io/request.h>
+#include <stxxl/bits/verbose.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup stlcontinternals
+//! \{
+
+//! \brief Page cache shared by several containers with global CLOCK replacement.
+//!
+//! Every container owning a private page cache keeps its memory even when it
+//! is idle. A shared_page_cache instead hands out fixed-size slots to all
+//! registered clients, so memory flows to whichever container is accessed
+//! most. Victims are chosen by a CLOCK sweep over all slots; a client that has
+//! reached its quota (if any) only evicts its own pages.
+//!
+//! The cache does not perform I/O itself: a client is asked to write back and
+//! forget a page via client::evict_page() before its slot is reused, and keeps
+//! track of its dirty pages on its own. Not thread-safe, all clients have to be
+//! accessed from the same thread.
+class shared_page_cache : private noncopyable
+{
+public:
+    typedef unsigned_type size_type;
+
+    //! Interface to be implemented by containers using a shared_page_cache.
+    class client
+    {
+    public:
+        //! Write page \c page_no held in \c slot back (if dirty) and forget
+        //! its mapping. The slot is reused immediately after this call.
+        virtual void evict_page(unsigned_type page_no, size_type slot) const = 0;
+
+        virtual ~client() { }
+    };
+
+private:
+    struct slot_info
+    {
+        const client * owner;
+        unsigned_type page_no;
+        bool referenced;
+
+        slot_info() : owner(NULL), page_no(0), referenced(false) { }
+    };
+
+    struct client_info
+    {
+        size_type quota;        // 0 = unlimited
+        size_type used;
+
+        client_info(size_type quota = 0) : quota(quota), used(0) { }
+    };
+
+    typedef std::map<const client *, client_info> client_map_type;
+
+    size_type slot_bytes;
+    char * data;
+    simple_vector<slot_info> slots;
+    std::vector<size_type> free_slots;
+    client_map_type clients;
+    size_type hand;
+    //! most recently touched slot, never chosen as victim so that two
+    //! references obtained in one expression stay valid
+    size_type last;
+
+    stxxl::uint64 hits, misses, evictions;
+
+    static size_type round_up(size_type bytes)
+    {
+        return (bytes + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+    }
+
+    client_info & info(const client * c)
+    {
+        client_map_type::iterator it = clients.find(c);
+        assert(it != clients.end());
+        return it->second;
+    }
+
+    //! Advance the clock hand until an unreferenced slot (owned by \c only,
+    //! unless NULL) is found.
+    size_type find_victim(const client * only)
+    {
+        assert(slots.size() > 0);
+        for (size_type steps = 0; steps < 3 * slots.size(); ++steps)
+        {
+            size_type s = hand;
+            hand = (hand + 1) % slots.size();
+            slot_info & si = slots[s];
+            if (si.owner == NULL || (only != NULL && si.owner != only))
+                continue;
+            if (s == last && slots.size() > 1)
+                continue;
+            if (si.referenced)
+                si.referenced = false;
+            else
+                return s;
+        }
+        // only the most recently used slot qualifies
+        assert(last < slots.size() && slots[last].owner != NULL);
+        return last;
+    }
+
+    void evict(size_type s)
+    {
+        slot_info & si = slots[s];
+        assert(si.owner != NULL);
+        const client * owner = si.owner;
+        unsigned_type page_no = si.page_no;
+        STXXL_VERBOSE2("shared_page_cache: evicting page " << page_no << " of " << (const void *)owner << " from slot " << s);
+        // release first: the client may not touch the slot any more
+        --info(owner).used;
+        si.owner = NULL;
+        si.referenced = false;
+        ++evictions;
+        owner->evict_page(page_no, s);
+    }
+
+public:
+    //! \brief Construct a cache.
+    //! \param num_slots number of slots
+    //! \param slot_bytes size of a slot in bytes, rounded up to a multiple
+    //! of \c BLOCK_ALIGN; must hold one page of every client
+    shared_page_cache(size_type num_slots, size_type slot_bytes) :
+        slot_bytes(round_up(slot_bytes)),
+        data(NULL),
+        slots(num_slots),
+        hand(0),
+        last(num_slots),
+        hits(0), misses(0), evictions(0)
+    {
+        if (num_slots == 0 || slot_bytes == 0)
+            STXXL_THROW_INVALID_ARGUMENT("shared_page_cache needs at least one slot of nonzero size");
+        data = static_cast<char *>(aligned_alloc<BLOCK_ALIGN>(num_slots * this->slot_bytes));
+        free_slots.reserve(num_slots);
+        for (size_type i = num_slots; i > 0; --i)
+            free_slots.push_back(i - 1);
+    }
+
+    //! All clients must have been unregistered before.
+    ~shared_page_cache()
+    {
+        assert(clients.empty());
+        aligned_dealloc<BLOCK_ALIGN>(data);
+    }
+
+    //! Number of slots.
+    size_type size() const
+    {
+        return slots.size();
+    }
+
+    //! Size of a slot in bytes.
+    size_type get_slot_bytes() const
+    {
+        return slot_bytes;
+    }
+
+    //! Number of unused slots.
+    size_type size_free() const
+    {
+        return free_slots.size();
+    }
+
+    //! Number of slots currently held by \c c.
+    size_type size_used(const client * c) const
+    {
+        client_map_type::const_iterator it = clients.find(c);
+        return (it == clients.end()) ? 0 : it->second.used;
+    }
+
+    //! Memory of \c slot.
+    void * get_slot(size_type slot) const
+    {
+        assert(slot < slots.size());
+        return data + slot * slot_bytes;
+    }
+
+    //! \brief Register \c c as user of this cache.
+    //! \param quota maximum number of slots \c c may hold, 0 for no limit
+    void register_client(const client * c, size_type quota = 0)
+    {
+        assert(clients.find(c) == clients.end());
+        clients.insert(std::make_pair(c, client_info(quota)));
+    }
+
+    //! Unregister \c c, which must have released all its slots.
+    void unregister_client(const client * c)
+    {
+        assert(size_used(c) == 0);
+        clients.erase(c);
+    }
+
+    //! Change the quota of \c c, evicting its pages in excess immediately.
+    void set_quota(const client * c, size_type quota)
+    {
+        client_info & ci = info(c);
+        ci.quota = quota;
+        while (quota > 0 && ci.used > quota)
+        {
+            size_type victim = find_victim(c);
+            if (victim == last)
+                last = slots.size();
+            evict(victim);
+            free_slots.push_back(victim);
+        }
+    }
+
+    //! \brief Obtain a slot for page \c page_no of client \c c.
+    //!
+    //! Evicts some page if no slot is free or \c c has reached its quota. The
+    //! caller has to fill the slot.
+    size_type acquire(const client * c, unsigned_type page_no)
+    {
+        client_info & ci = info(c);
+        ++misses;
+        size_type s;
+        if (ci.quota > 0 && ci.used >= ci.quota)
+        {
+            s = find_victim(c);
+            evict(s);
+        }
+        else if (!free_slots.empty())
+        {
+            s = free_slots.back();
+            free_slots.pop_back();
+        }
+        else
+        {
+            s = find_victim(NULL);
+            evict(s);
+        }
+        slot_info & si = slots[s];
+        si.owner = c;
+        si.page_no = page_no;
+        si.referenced = true;
+        ++ci.used;
+        last = s;
+        return s;
+    }
+
+    //! Record an access to an acquired slot.
+    void hit(size_type slot)
+    {
+        assert(slot < slots.size() && slots[slot].owner != NULL);
+        ++hits;
+        slots[slot].referenced = true;
+        last = slot;
+    }
+
+    //! Return a slot without calling back its owner.
+    void release(size_type slot)
+    {
+        assert(slot < slots.size() && slots[slot].owner != NULL);
+        slot_info & si = slots[slot];
+        --info(si.owner).used;
+        si.owner = NULL;
+        si.referenced = false;
+        if (slot == last)
+            last = slots.size();
+        free_slots.push_back(slot);
+    }
+
+    //! Exchange all slots and settings of two clients, used when the
+    //! clients swap their content. Clients not registered are ignored.
+    void swap_clients(const client * a, const client * b)
+    {
+        for (size_type i = 0; i < slots.size(); ++i)
+        {
+            if (slots[i].owner == a)
+                slots[i].owner = b;
+            else if (slots[i].owner == b)
+                slots[i].owner = a;
+        }
+        client_map_type::iterator ia = clients.find(a), ib = clients.find(b);
+        if (ia != clients.end() && ib != clients.end())
+            std::swap(ia->second, ib->second);
+        else if (ia != clients.end())
+        {
+            clients.insert(std::make_pair(b, ia->second));
+            clients.erase(ia);
+        }
+        else if (ib != clients.end())
+        {
+            clients.insert(std::make_pair(a, ib->second));
+            clients.erase(ib);
+        }
+    }
+
+    /** @name Statistics */
+    ///@{
+    //! Number of accesses to cached pages.
+    stxxl::uint64 get_hits() const
+    {
+        return hits;
+    }
+
+    //! Number of slot acquisitions, i.e. page faults.
+    stxxl::uint64 get_misses() const
+    {
+        return misses;
+    }
+
+    //! Number of pages evicted to make room for others.
+    stxxl::uint64 get_evictions() const
+    {
+        return evictions;
+    }
+
+    void reset_stats()
+    {
+        hits = misses = evictions = 0;
+    }
+    ///@}
+};
+
+//! \}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_SHARED_PAGE_CACHE_HEADER
+// vim: et:ts=4:sw=4
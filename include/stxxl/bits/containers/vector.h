@@ -25,7 +25,9 @@
 #include <stxxl/bits/mng/mng.h>
 #include <stxxl/bits/mng/typed_block.h>
 #include <stxxl/bits/common/tmeta.h>
+#include <stxxl/bits/common/mutex.h>
 #include <stxxl/bits/containers/pager.h>
+#include <stxxl/bits/containers/shared_page_cache.h>
 #include <stxxl/bits/common/is_sorted.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_istream_reverse.h>
@@ -266,6 +268,12 @@ class vector_bufreader_reverse;
 template <typename VectorIteratorType>
 class vector_bufwriter;
 
+template <typename VectorType>
+class vector_reader;
+
+template <typename VectorType>
+class vector_parallel_writer;
+
 ////////////////////////////////////////////////////////////////////////////
 
 //! External vector iterator, model of \c ext_random_access_iterator concept.
@@ -749,7 +757,7 @@ template <
     typename AllocStr = STXXL_DEFAULT_ALLOC_STRATEGY,
     typename SizeType = stxxl::uint64       // will be deprecated soon
     >
-class vector
+class vector : private shared_page_cache::client
 {
 public:
     //! The type of elements stored in the vector.
@@ -796,6 +804,13 @@ public:
     //! vector_bufreader compatible with this vector
     typedef vector_bufreader_reverse<const_iterator> bufreader_reverse_type;
 
+    //! vector_reader compatible with this vector
+    typedef vector_reader<vector> reader_type;
+    friend class vector_reader<vector>;
+
+    //! vector_parallel_writer compatible with this vector
+    typedef vector_parallel_writer<vector> parallel_writer_type;
+
     //! \internal
     class bid_vector : public std::vector< BID<block_size> >
     {
@@ -828,6 +843,9 @@ private:
     mutable simple_vector<int_type> _slot_to_page;
     mutable std::queue<int_type> _free_slots;
     mutable simple_vector<block_type> * _cache;
+    shared_page_cache * _shared_cache;
+    //! serializes flush(), which readers of other threads call concurrently
+    mutable mutex _flush_mutex;
     file * _from;
     block_manager * bm;
     config * cfg;
@@ -869,6 +887,7 @@ public:
         _page_to_slot(div_ceil(_bids.size(), page_size)),
         _slot_to_page(npages),
         _cache(NULL),
+        _shared_cache(NULL),
         _from(NULL),
         exported(false)
     {
@@ -904,6 +923,11 @@ public:
         std::swap(_slot_to_page, obj._slot_to_page);
         std::swap(_free_slots, obj._free_slots);
         std::swap(_cache, obj._cache);
+        if (_shared_cache)
+            _shared_cache->swap_clients(this, &obj);
+        if (obj._shared_cache && obj._shared_cache != _shared_cache)
+            obj._shared_cache->swap_clients(this, &obj);
+        std::swap(_shared_cache, obj._shared_cache);
         std::swap(_from, obj._from);
         std::swap(exported, obj.exported);
     }
@@ -914,7 +938,7 @@ public:
     void allocate_page_cache() const
     {
         //  numpages() might be zero
-        if (!_cache && numpages() > 0)
+        if (!_cache && !_shared_cache && numpages() > 0)
             _cache = new simple_vector<block_type> (numpages() * page_size);
     }
 
@@ -925,6 +949,55 @@ public:
         delete _cache;
         _cache = NULL;
     }
+
+    //! \brief Use pages of a shared_page_cache instead of the private page cache.
+    //!
+    //! The private cache is flushed and freed. While attached, accessing any
+    //! other container using the same cache may invalidate references to
+    //! elements of this vector. The vector has to be detached (or destroyed)
+    //! before the cache is destroyed.
+    //! \param cache cache whose slots can hold a page of this vector
+    //! \param quota maximum number of pages held in the cache, 0 for no limit
+    void attach_cache(shared_page_cache & cache, unsigned_type quota = 0)
+    {
+        if (cache.get_slot_bytes() < page_size * block_type::raw_size)
+            STXXL_THROW_INVALID_ARGUMENT("slots of the shared_page_cache are smaller than a page of the vector (" <<
+                                         page_size * block_type::raw_size << " bytes)");
+        detach_cache();
+        deallocate_page_cache();
+        _shared_cache = &cache;
+        _shared_cache->register_client(this, quota);
+    }
+
+    //! Flush the pages held in the shared_page_cache and return to a private page cache.
+    void detach_cache()
+    {
+        if (!_shared_cache)
+            return;
+        flush();
+        _shared_cache->unregister_client(this);
+        _shared_cache = NULL;
+        allocate_page_cache();
+    }
+
+    //! Change the maximum number of pages held in the attached shared_page_cache.
+    void set_cache_quota(unsigned_type quota)
+    {
+        assert(_shared_cache);
+        _shared_cache->set_quota(this, quota);
+    }
+
+    //! Returns the attached shared_page_cache or NULL.
+    shared_page_cache * get_shared_cache() const
+    {
+        return _shared_cache;
+    }
+
+    //! Number of pages currently held in the attached shared_page_cache.
+    unsigned_type shared_cache_pages() const
+    {
+        return _shared_cache ? _shared_cache->size_used(this) : 0;
+    }
     ///@}
     
     /** @name Capacity */
@@ -1001,7 +1074,7 @@ private:
             unsigned_type first_page_to_evict = (unsigned_type)div_ceil(n, block_type::size * page_size);
             for (unsigned_type i = first_page_to_evict; i < _page_status.size(); ++i) {
                 if (_page_to_slot[i] != on_disk) {
-                    _free_slots.push(_page_to_slot[i]);
+                    release_slot(_page_to_slot[i]);
                     _page_to_slot[i] = on_disk;
                 }
                 _page_status[i] = uninitialized;
@@ -1028,12 +1101,13 @@ private:
 
             _bids.resize(new_bids_size);
             unsigned_type new_pages = div_ceil(new_bids_size, page_size);
-            _page_status.resize(new_pages);
 
-            unsigned_type first_page_to_evict = div_ceil(new_bids_size, page_size);
-            // clear dirty flag, so these pages will be never written
-            std::fill(_page_status.begin() + first_page_to_evict,
-                      _page_status.end(), (unsigned char)valid_on_disk);
+            // drop cached pages beyond the end, they will never be written
+            for (unsigned_type i = new_pages; i < _page_to_slot.size(); ++i)
+                if (_page_to_slot[i] != on_disk)
+                    release_slot(_page_to_slot[i]);
+            _page_status.resize(new_pages);
+            _page_to_slot.resize(new_pages);
         }
 
         _size = n;
@@ -1050,6 +1124,12 @@ public:
             bm->delete_blocks(_bids.begin(), _bids.end());
 
         _bids.clear();
+        if (_shared_cache)
+        {
+            for (unsigned_type i = 0; i < _page_to_slot.size(); ++i)
+                if (_page_to_slot[i] != on_disk)
+                    _shared_cache->release(_page_to_slot[i]);
+        }
         _page_status.clear();
         _page_to_slot.clear();
         while (!_free_slots.empty())
@@ -1114,6 +1194,7 @@ public:
         _page_to_slot(div_ceil(_bids.size(), page_size)),
         _slot_to_page(npages),
         _cache(NULL),
+        _shared_cache(NULL),
         _from(from),
         exported(false)
     {
@@ -1161,6 +1242,7 @@ public:
         _page_to_slot(div_ceil(_bids.size(), page_size)),
         _slot_to_page(obj.numpages ()),
         _cache(NULL),
+        _shared_cache(NULL),
         _from(NULL),
         exported(false)
     {
@@ -1291,9 +1373,28 @@ public:
 
     /** @name Modifiers */
     ///@{
-    //! Flushes the cache pages to the external memory.
+    //! \brief Flushes the cache pages to the external memory.
+    //!
+    //! May be called by several threads at the same time as long as none of
+    //! them accesses the elements otherwise, which is what vector_bufreader
+    //! and vector_reader do.
     void flush() const
     {
+        scoped_mutex_lock lock(_flush_mutex);
+        if (_shared_cache)
+        {
+            for (unsigned_type page_no = 0; page_no < _page_to_slot.size(); ++page_no)
+            {
+                int_type slot = _page_to_slot[page_no];
+                if (slot == on_disk)
+                    continue;
+                write_page(page_no, slot);
+                _shared_cache->release(slot);
+                _page_to_slot[page_no] = on_disk;
+            }
+            return;
+        }
+
         simple_vector<bool> non_free_slots(numpages());
 
         for (unsigned_type i = 0; i < numpages(); i++)
@@ -1339,6 +1440,14 @@ public:
         {
             STXXL_ERRMSG("Exception thrown in ~vector()");
         }
+        if (_shared_cache)
+        {
+            // pages not written back due to an error above are dropped
+            for (unsigned_type i = 0; i < _page_to_slot.size(); ++i)
+                if (_page_to_slot[i] != on_disk)
+                    _shared_cache->release(_page_to_slot[i]);
+            _shared_cache->unregister_client(this);
+        }
 
         if (!exported)
         {
@@ -1439,6 +1548,48 @@ private:
                 (offset.get_block2() * PageSize + offset.get_block1()));
     }
 
+    //! Block \c i of the page cache, i.e. block i % page_size of slot i / page_size.
+    block_type & cache_block(int_type i) const
+    {
+        if (_shared_cache)
+            return static_cast<block_type *>(_shared_cache->get_slot(i / page_size))[i % page_size];
+        return (*_cache)[i];
+    }
+
+    void release_slot(int_type cache_slot) const
+    {
+        if (_shared_cache)
+            _shared_cache->release(cache_slot);
+        else
+            _free_slots.push(cache_slot);
+    }
+
+    //! shared_page_cache::client callback
+    void evict_page(unsigned_type page_no, shared_page_cache::size_type slot) const
+    {
+        assert(_page_to_slot[page_no] == int_type(slot));
+        _page_to_slot[page_no] = on_disk;
+        write_page(page_no, slot);
+    }
+
+    //! Looks up (or loads) \c page_no in the shared_page_cache and returns its slot.
+    int_type shared_page(unsigned_type page_no) const
+    {
+        int_type cache_slot = _page_to_slot[page_no];
+        if (cache_slot >= 0)
+        {
+            _shared_cache->hit(cache_slot);
+            return cache_slot;
+        }
+        cache_slot = _shared_cache->acquire(this, page_no);
+        block_type * blocks = static_cast<block_type *>(_shared_cache->get_slot(cache_slot));
+        for (unsigned_type j = 0; j < page_size; ++j)
+            new (blocks + j) block_type;
+        _page_to_slot[page_no] = cache_slot;
+        read_page(page_no, cache_slot);
+        return cache_slot;
+    }
+
     void read_page(int_type page_no, int_type cache_slot) const
     {
         if (_page_status[page_no] == uninitialized)
@@ -1450,7 +1601,7 @@ private:
         int_type i = cache_slot * page_size, j = 0;
         for ( ; block_no < last_block; ++block_no, ++i, ++j)
         {
-            reqs[j] = (*_cache)[i].read(_bids[block_no]);
+            reqs[j] = cache_block(i).read(_bids[block_no]);
         }
         assert(last_block - page_no * page_size > 0);
         wait_all(reqs, last_block - page_no * page_size);
@@ -1468,7 +1619,7 @@ private:
         int_type i = cache_slot * page_size, j = 0;
         for ( ; block_no < last_block; ++block_no, ++i, ++j)
         {
-            reqs[j] = (*_cache)[i].write(_bids[block_no]);
+            reqs[j] = cache_block(i).write(_bids[block_no]);
         }
         _page_status[page_no] = valid_on_disk;
         assert(last_block - page_no * page_size > 0);
@@ -1491,6 +1642,12 @@ private:
         #endif
         unsigned_type page_no = offset.get_block2();
         assert(page_no < _page_to_slot.size());   // fails if offset is too large, out of bound access
+        if (_shared_cache)
+        {
+            int_type cache_slot = shared_page(page_no);
+            _page_status[page_no] = dirty;
+            return cache_block(cache_slot * page_size + offset.get_block1())[offset.get_offset()];
+        }
         int_type cache_slot = _page_to_slot[page_no];
         if (cache_slot < 0)                                 // == on_disk
         {
@@ -1542,7 +1699,7 @@ private:
         assert(!(_page_status[page_no] & dirty));
         if (_page_to_slot[page_no] != on_disk) {
             // remove page from cache
-            _free_slots.push(_page_to_slot[page_no]);
+            release_slot(_page_to_slot[page_no]);
             _page_to_slot[page_no] = on_disk;
             STXXL_VERBOSE_VECTOR("page_externally_updated(): page_no=" << page_no << " flushed from cache.");
         }
@@ -1581,6 +1738,11 @@ private:
     {
         unsigned_type page_no = offset.get_block2();
         assert(page_no < _page_to_slot.size());   // fails if offset is too large, out of bound access
+        if (_shared_cache)
+        {
+            int_type cache_slot = shared_page(page_no);
+            return cache_block(cache_slot * page_size + offset.get_block1())[offset.get_offset()];
+        }
         int_type cache_slot = _page_to_slot[page_no];
         if (cache_slot < 0)                                 // == on_disk
         {
@@ -1765,6 +1927,10 @@ class vector_bufreader_iterator;
  * Note that this buffered reader is inefficient for reading small ranges. This
  * is intentional, as one can just use operator[] on the vector for that.
  *
+ * Several threads may read the same vector at the same time, each with its
+ * own buffered reader, as long as nobody modifies the vector meanwhile. For
+ * random lookups from several threads use vector_reader.
+ *
  * See \ref tutorial_vector_buf
  */
 template <typename VectorIteratorType>
@@ -1858,8 +2024,9 @@ public:
         // find last bid to read
         bids_container_iterator end_bid = m_end.bid() + (m_end.block_offset() ? 1 : 0);
 
-        // construct buffered istream for range
-        m_bufin = new buf_istream_type(m_begin.bid(), end_bid, m_nbuffers);
+        // construct buffered istream for range, reading read-only mappings
+        // directly if the vector's files support it
+        m_bufin = new buf_istream_type(m_begin.bid(), end_bid, m_nbuffers, true);
 
         // skip the beginning of the block, up to real beginning
         vector_iterator curr = m_begin - m_begin.block_offset();
@@ -2033,6 +2200,10 @@ public:
  * Note that this buffered reader is inefficient for reading small ranges. This
  * is intentional, as one can just use operator[] on the vector for that.
  *
+ * Several threads may read the same vector at the same time, each with its
+ * own buffered reader, as long as nobody modifies the vector meanwhile. For
+ * random lookups from several threads use vector_reader.
+ *
  * See \ref tutorial_vector_buf
  */
 template <typename VectorIteratorType>
@@ -2193,6 +2364,139 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * Random access reader from a vector with a private page cache.
+ *
+ * The vector's own page cache may only be used by one thread at a time. A
+ * vector_reader instead reads the pages it needs into a cache of its own,
+ * straight from the vector's blocks, so several threads can look up elements
+ * of one large vector at the same time, each with its own reader. The vector
+ * is flushed when a reader is created and must not be modified while readers
+ * exist.
+ *
+ * \code
+ * #pragma omp parallel
+ * {
+ *     vector_type::reader_type reader(table);   // one per thread
+ *     #pragma omp for
+ *     for (int i = 0; i < n; ++i)
+ *         out[i] = reader[keys[i]];
+ * }
+ * \endcode
+ */
+template <typename VectorType>
+class vector_reader : public noncopyable
+{
+public:
+    //! template parameter: the vector type
+    typedef VectorType vector_type;
+
+    //! value type of the vector
+    typedef typename vector_type::value_type value_type;
+
+    //! constant reference to value_type
+    typedef typename vector_type::const_reference const_reference;
+
+    //! size type of the vector
+    typedef typename vector_type::size_type size_type;
+
+    //! block type used in the vector
+    typedef typename vector_type::block_type block_type;
+
+    //! index of an element split into page, block and offset
+    typedef typename vector_type::blocked_index_type blocked_index_type;
+
+    enum constants {
+        page_size = vector_type::page_size,
+        on_disk = vector_type::on_disk
+    };
+
+protected:
+    //! the vector read from
+    const vector_type & m_vector;
+
+    //! replacement strategy of the private page cache
+    lru_pager<> m_pager;
+
+    //! pages of the private cache, page_size blocks per slot
+    simple_vector<block_type> m_cache;
+
+    //! cache slot of each page of the vector or on_disk
+    std::vector<int_type> m_page_to_slot;
+
+    //! page held by each cache slot or on_disk
+    simple_vector<int_type> m_slot_to_page;
+
+    //! number of cache slots in use, these are filled first
+    unsigned_type m_used_slots;
+
+    //! Reads a page of the vector into a slot of the private cache.
+    void read_page(unsigned_type page_no, int_type slot)
+    {
+        // uninitialized pages have no contents on disk
+        if (m_vector._page_status[page_no] == vector_type::uninitialized)
+            return;
+
+        request_ptr reqs[page_size];
+        const unsigned_type first_block = page_no * page_size;
+        const unsigned_type last_block = STXXL_MIN(first_block + page_size, unsigned_type(m_vector._bids.size()));
+        for (unsigned_type i = first_block; i < last_block; ++i)
+            reqs[i - first_block] = m_cache[slot * page_size + i - first_block].read(m_vector._bids[i]);
+        wait_all(reqs, last_block - first_block);
+    }
+
+public:
+    //! Create a reader for the given vector.
+    //! \param vec vector to read
+    //! \param npages number of pages cached by the reader, 0 for as many as
+    //!        the vector caches
+    vector_reader(const vector_type & vec, unsigned_type npages = 0)
+        : m_vector(vec),
+          m_pager(npages ? npages : STXXL_MAX(vec.numpages(), unsigned_type(1))),
+          m_cache(m_pager.size() * page_size),
+          m_page_to_slot(div_ceil(vec._bids.size(), page_size), on_disk),
+          m_slot_to_page(m_pager.size()),
+          m_used_slots(0)
+    {
+        vec.flush(); // flush container
+    }
+
+    //! Return constant reference to the element at the given position. The
+    //! reference is valid until the reader loads another page.
+    const_reference operator [] (size_type offset)
+    {
+        assert(offset < size());
+        const blocked_index_type index(offset);
+        const unsigned_type page_no = index.get_block2();
+        int_type slot = m_page_to_slot[page_no];
+        if (slot == on_disk)
+        {
+            if (m_used_slots < m_pager.size())
+            {
+                slot = m_used_slots++;
+            }
+            else
+            {
+                slot = m_pager.kick();
+                m_page_to_slot[m_slot_to_page[slot]] = on_disk;
+            }
+            read_page(page_no, slot);
+            m_page_to_slot[page_no] = slot;
+            m_slot_to_page[slot] = page_no;
+        }
+        m_pager.hit(slot);
+        return m_cache[slot * page_size + index.get_block1()][index.get_offset()];
+    }
+
+    //! Return the number of elements of the vector.
+    size_type size() const
+    {
+        return m_vector.size();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////
+
 /*!
  * Buffered sequential writer to a vector using overlapped I/O.
  *
@@ -2420,6 +2724,233 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////
 
+/*!
+ * Parallel writers to disjoint ranges of a vector using overlapped I/O.
+ *
+ * vector_bufwriter writes from a single thread. A vector_parallel_writer
+ * resizes the vector and splits it into a number of block-aligned ranges,
+ * each written by its own range_writer with its own write buffers, so
+ * several threads, e.g. parsers, can fill one vector without funneling the
+ * data through one thread. The range writers do not touch the vector itself;
+ * nobody may access the vector until finish() has been called, after which
+ * it holds the written elements. Elements not written have unspecified
+ * values, as after vector::resize().
+ *
+ * \code
+ * vector_type::parallel_writer_type writers(v, n, num_threads);
+ * #pragma omp parallel for
+ * for (int t = 0; t < num_threads; ++t)
+ * {
+ *     vector_type::parallel_writer_type::range_writer & w = writers[t];
+ *     for (size_type i = w.range_begin(); i < w.range_end(); ++i)
+ *         w << parse(i);
+ *     w.finish();
+ * }
+ * writers.finish();
+ * \endcode
+ */
+template <typename VectorType>
+class vector_parallel_writer : public noncopyable
+{
+public:
+    //! template parameter: the vector type
+    typedef VectorType vector_type;
+
+    //! value type of the output vector
+    typedef typename vector_type::value_type value_type;
+
+    //! size type of the output vector
+    typedef typename vector_type::size_type size_type;
+
+    //! block type used in the vector
+    typedef typename vector_type::block_type block_type;
+
+    //! block identifier iterator of the vector
+    typedef typename vector_type::bids_container_iterator bids_container_iterator;
+
+    //! construct output buffered stream used for overlapped writing
+    typedef buf_ostream<block_type, bids_container_iterator> buf_ostream_type;
+
+    //! Writes one range of the vector from one thread.
+    class range_writer : public noncopyable
+    {
+    protected:
+        //! buffered output stream, NULL for an empty or finished range
+        buf_ostream_type* m_bufout;
+
+        //! range of elements of the vector written
+        size_type m_begin, m_end;
+
+        //! position of the next element written
+        size_type m_pos;
+
+    public:
+        //! \param bid first block of the range
+        //! \param begin first element of the range, at the beginning of a
+        //!        block unless the range is empty
+        //! \param end end of the range
+        //! \param nbuffers number of buffers used for overlapped I/O
+        range_writer(bids_container_iterator bid, size_type begin, size_type end, unsigned_type nbuffers)
+            : m_bufout((begin < end) ? new buf_ostream_type(bid, nbuffers) : NULL),
+              m_begin(begin), m_end(end), m_pos(begin)
+        {
+            assert(begin == end || begin % block_type::size == 0);
+        }
+
+        ~range_writer()
+        {
+            finish();
+        }
+
+        //! Return mutable reference to the element at the current position.
+        value_type & operator * ()
+        {
+            assert(m_pos < m_end);
+            return m_bufout->operator*();
+        }
+
+        //! Advance to the next element.
+        range_writer& operator ++ ()
+        {
+            assert(m_pos < m_end);
+            ++m_pos;
+            m_bufout->operator++();
+            return *this;
+        }
+
+        //! Write value to the current position and advance to the next one.
+        range_writer& operator << (const value_type& v)
+        {
+            operator*() = v;
+            operator++();
+
+            return *this;
+        }
+
+        //! Index of the first element of the range in the vector.
+        size_type range_begin() const
+        {
+            return m_begin;
+        }
+
+        //! Index of the end of the range in the vector.
+        size_type range_end() const
+        {
+            return m_end;
+        }
+
+        //! Index of the element written next.
+        size_type position() const
+        {
+            return m_pos;
+        }
+
+        //! Return remaining size of the range.
+        size_type size() const
+        {
+            return m_end - m_pos;
+        }
+
+        //! Finish writing and wait for the writes of this range. May be
+        //! called by the writing thread, before
+        //! vector_parallel_writer::finish().
+        void finish()
+        {
+            if (!m_bufout)
+                return;
+
+            // pad the block started last
+            if (m_pos % block_type::size != 0)
+                m_bufout->fill(value_type());
+
+            delete m_bufout;
+            m_bufout = NULL;
+        }
+    };
+
+protected:
+    //! the vector written
+    vector_type& m_vector;
+
+    //! writers of the ranges
+    std::vector<range_writer*> m_writers;
+
+    //! whether finish() has been called
+    bool m_finished;
+
+public:
+    //! Resize the vector and split it into ranges for the writers.
+    //! \param vec vector to write
+    //! \param n new size of the vector
+    //! \param nwriters number of ranges
+    //! \param nbuffers number of buffers used for overlapped I/O by each
+    //!        range writer (>= 2D recommended)
+    vector_parallel_writer(vector_type& vec, size_type n, unsigned_type nwriters,
+                           unsigned_type nbuffers = 0)
+        : m_vector(vec), m_finished(false)
+    {
+        assert(nwriters > 0);
+
+        if (nbuffers == 0)
+            nbuffers = 2 * config::get_instance()->disks_number();
+
+        m_vector.resize(n);
+        m_vector.flush(); // flush container, the writers bypass it
+
+        const size_type nblocks = div_ceil(n, block_type::size);
+        const size_type blocks_per_writer = div_ceil(nblocks, nwriters);
+        for (unsigned_type i = 0; i < nwriters; ++i)
+        {
+            const size_type first = STXXL_MIN(i * blocks_per_writer, nblocks);
+            const size_type last = STXXL_MIN(first + blocks_per_writer, nblocks);
+            m_writers.push_back(new range_writer(m_vector.begin().bid() + first,
+                                                 STXXL_MIN(first * block_type::size, n),
+                                                 STXXL_MIN(last * block_type::size, n),
+                                                 nbuffers));
+        }
+    }
+
+    //! Finish writing.
+    ~vector_parallel_writer()
+    {
+        finish();
+        for (unsigned_type i = 0; i < m_writers.size(); ++i)
+            delete m_writers[i];
+    }
+
+    //! Return the number of range writers.
+    unsigned_type num_writers() const
+    {
+        return m_writers.size();
+    }
+
+    //! Return the writer of range \c i, ranges are in the order of the vector.
+    range_writer & operator [] (unsigned_type i)
+    {
+        assert(i < m_writers.size());
+        return *m_writers[i];
+    }
+
+    //! Finish all range writers and inform the vector of the written blocks.
+    //! Must be called after all threads are done with their writers.
+    void finish()
+    {
+        if (m_finished)
+            return;
+
+        for (unsigned_type i = 0; i < m_writers.size(); ++i)
+            m_writers[i]->finish();
+
+        const size_type page_elements = size_type(vector_type::page_size) * block_type::size;
+        for (size_type pos = 0; pos < m_vector.size(); pos += page_elements)
+            (m_vector.cbegin() + pos).block_externally_updated();
+
+        m_finished = true;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////
+
 //! \addtogroup stlcont
 //! \{
 
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/completion_queue.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO__COMPLETION_QUEUE_H_
+#define STXXL_IO__COMPLETION_QUEUE_H_
+
+#include <deque>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/semaphore.h>
+#include <stxxl/bits/common/types.h>
+#include <stxxl/bits/io/request.h>
+#include <stxxl/bits/io/completion_handler.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup iolayer
+//! \{
+
+//! \brief Collects completed requests in the order they complete.
+//!
+//! Requests are tagged by passing tag() as the completion handler to
+//! \c file::aread or \c file::awrite. The thread that consumes them learns
+//! about each completion in O(1) with wait_next() or try_next() instead of
+//! scanning all outstanding requests with \c wait_any() or \c poll_any().
+//!
+//! \code
+//! stxxl::completion_queue cq;
+//! for (i = 0; i < n; ++i)
+//!     f->aread(buffer[i], offset[i], size, cq.tag());
+//! while (stxxl::request_ptr req = cq.wait_next())
+//!     consume(req->get_buffer());
+//! \endcode
+//!
+//! Several threads may take requests from the same queue.
+class completion_queue : private noncopyable
+{
+    class tagged_handler
+    {
+        completion_queue * queue;
+        completion_handler on_cmpl;
+
+    public:
+        tagged_handler(completion_queue * queue_, const completion_handler & on_cmpl_)
+            : queue(queue_), on_cmpl(on_cmpl_)
+        { }
+
+        void operator () (request * req)
+        {
+            on_cmpl(req);
+            queue->push(req);
+        }
+    };
+
+    mutex queue_mutex;
+    //! completed requests not yet taken, invalid entries stand for
+    //! canceled requests that a thread in wait_next() was waiting for
+    std::deque<request_ptr> completed;
+    //! number of completed requests that are not claimed by a taker
+    semaphore available;
+    //! number of tagged requests that no taker has claimed yet
+    unsigned_type outstanding;
+
+    void push(request * req);
+    request_ptr pop();
+
+public:
+    completion_queue() : available(0), outstanding(0)
+    { }
+
+    //! \brief Returns a completion handler that puts the request into this
+    //! queue when it completes.
+    //!
+    //! Each handler returned must be passed to exactly one request.
+    //! \param on_cmpl handler to call before, on the disk thread
+    completion_handler tag(const completion_handler & on_cmpl = default_completion_handler());
+
+    //! \brief Waits for the next tagged request to complete.
+    //!
+    //! Requests are returned in the order they completed and are finished,
+    //! like after \c request::wait(), which also throws io_error for failed
+    //! requests. Returns an invalid \c request_ptr if no tagged request is
+    //! left.
+    request_ptr wait_next();
+
+    //! Returns the next completed request like wait_next(), or an invalid
+    //! \c request_ptr at once if none has completed yet.
+    request_ptr try_next();
+
+    //! \brief Cancels a tagged request like \c request::cancel().
+    //!
+    //! Canceled requests do not complete and are therefore never returned,
+    //! tagged requests must be canceled here so the queue stops waiting for
+    //! them.
+    //! \return whether the request was canceled
+    bool cancel(const request_ptr & req);
+
+    //! Number of tagged requests that were neither returned nor are awaited
+    //! by a thread in wait_next().
+    unsigned_type size();
+
+    //! Whether all tagged requests were returned.
+    bool empty()
+    {
+        return size() == 0;
+    }
+};
+
+//! \}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_IO__COMPLETION_QUEUE_H_
+// vim: et:ts=4:sw=4
@@ -34,12 +34,14 @@ public:
         void * buffer,
         offset_type pos,
         size_type bytes,
-        const completion_handler & on_cmpl);
+        const completion_handler & on_cmpl,
+        request::request_priority prio = request::DEMAND);
     request_ptr awrite(
         void * buffer,
         offset_type pos,
         size_type bytes,
-        const completion_handler & on_cmpl);
+        const completion_handler & on_cmpl,
+        request::request_priority prio = request::WRITEBACK);
 
     virtual int get_queue_id() const
     {
@@ -35,7 +35,7 @@ class disk_queues : public singleton<disk_queues>
 {
     friend class singleton<disk_queues>;
 
-    // 2 queues: write queue and read queue
+    // one queue per priority class, served by earliest deadline
     typedef request_queue_impl_qwqr request_queue_type;
 
     typedef stxxl::int64 DISKID;
@@ -81,6 +81,19 @@ public:
             return false;
     }
 
+    //! Raises the priority of a queued request and moves it to its new class.
+    //! \param req request to promote
+    //! \param disk disk number for disk that \c req was scheduled on
+    //! \param prio new priority class
+    void promote_request(request_ptr & req, DISKID disk, request::request_priority prio)
+    {
+#ifdef STXXL_HACK_SINGLE_IO_THREAD
+        disk = 42;
+#endif
+        if (queues.find(disk) != queues.end())
+            queues[disk]->promote_request(req, prio);
+    }
+
     ~disk_queues()
     {
         // deallocate all queues
@@ -116,6 +116,14 @@ public:
         NO_LOCK = 128                       //!< do not aquire an exclusive lock by default
     };
 
+    //! Access pattern hints for map_readonly().
+    enum access_hint
+    {
+        NORMAL_ACCESS,                      //!< no special treatment
+        SEQUENTIAL_ACCESS,                  //!< region is read once in ascending order
+        WILLNEED_ACCESS                     //!< region will be read soon, start read-ahead
+    };
+
     static const int DEFAULT_QUEUE = -1;
     static const int NO_QUEUE = -2;
     static const int NO_ALLOCATOR = -1;
@@ -125,18 +133,22 @@ public:
     //! \param pos file position to start read from
     //! \param bytes number of bytes to transfer
     //! \param on_cmpl I/O completion handler
+    //! \param prio priority class of the request in the disk queue
     //! \return \c request_ptr request object, which can be used to track the status of the operation
     virtual request_ptr aread(void * buffer, offset_type pos, size_type bytes,
-                              const completion_handler & on_cmpl) = 0;
+                              const completion_handler & on_cmpl,
+                              request::request_priority prio = request::DEMAND) = 0;
 
     //! Schedules an asynchronous write request to the file.
     //! \param buffer pointer to memory buffer to write from
     //! \param pos starting file position to write
     //! \param bytes number of bytes to transfer
     //! \param on_cmpl I/O completion handler
+    //! \param prio priority class of the request in the disk queue
     //! \return \c request_ptr request object, which can be used to track the status of the operation
     virtual request_ptr awrite(void * buffer, offset_type pos, size_type bytes,
-                               const completion_handler & on_cmpl) = 0;
+                               const completion_handler & on_cmpl,
+                               request::request_priority prio = request::WRITEBACK) = 0;
 
     virtual void serve(const request * req) throw (io_error) = 0;
 
@@ -185,13 +197,46 @@ public:
     virtual void lock() = 0;
 
     //! Discard a region of the file (mark it unused).
-    //! Some specialized file types may need to know freed regions
+    //! Some specialized file types may need to know freed regions,
+    //! others can release the underlying storage (hole punching, TRIM)
     virtual void discard(offset_type offset, offset_type size)
     {
         STXXL_UNUSED(offset);
         STXXL_UNUSED(size);
     }
 
+    //! Borrows a read-only pointer to the file content in [offset, offset + bytes).
+    //! The pointer remains valid until it is returned with release_readonly(),
+    //! but the data it points to changes if the region is written. No I/O
+    //! requests or statistics are involved. If a region is available, so are
+    //! all regions before it.
+    //! \param offset file position of the region
+    //! \param bytes size of the region
+    //! \param hint expected access pattern, passed to the operating system
+    //! \return pointer to the region, or NULL if the file type does not support
+    //!         zero-copy access or the region is not available
+    virtual const void * map_readonly(offset_type offset, size_type bytes,
+                                      access_hint hint = NORMAL_ACCESS)
+    {
+        STXXL_UNUSED(offset);
+        STXXL_UNUSED(bytes);
+        STXXL_UNUSED(hint);
+        return NULL;
+    }
+
+    //! Returns a pointer borrowed by map_readonly(), which must not be used
+    //! afterwards. Every non-NULL result of map_readonly() is returned once.
+    virtual void release_readonly(const void * region)
+    {
+        STXXL_UNUSED(region);
+    }
+
+    //! Returns whether set_size() may also be used to shrink the file.
+    virtual bool can_shrink() const
+    {
+        return false;
+    }
+
     virtual void export_files(offset_type offset, offset_type length, std::string prefix)
     {
         STXXL_UNUSED(offset);
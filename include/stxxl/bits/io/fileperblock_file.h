@@ -60,6 +60,9 @@ public:
     //! \return file size in length
     virtual offset_type size() { return current_size; }
 
+    //! Blocks live in separate files, so the size is only bookkeeping.
+    virtual bool can_shrink() const { return true; }
+
     virtual void lock();
 
     //! Frees the specified region.
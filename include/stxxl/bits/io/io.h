@@ -26,6 +26,7 @@
 #include <stxxl/bits/io/create_file.h>
 #include <stxxl/bits/io/disk_queues.h>
 #include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/io/io_throttle.h>
 
 
 //! \c STXXL library namespace
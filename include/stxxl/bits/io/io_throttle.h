@@ -0,0 +1,101 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/io_throttle.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO__IO_THROTTLE_H_
+#define STXXL_IO__IO_THROTTLE_H_
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/types.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup iolayer
+//! \{
+
+//! \brief Limits the bandwidth and the number of I/Os of a group of requests
+//! with token buckets.
+//!
+//! Requests that a thread submits within a scoped_io_throttle are charged to
+//! its throttle. A disk queue defers a request while its throttle is out of
+//! tokens and serves other requests meanwhile, so a rate limited background
+//! job leaves the rest of the disk time to other jobs.
+//!
+//! \code
+//! stxxl::io_throttle limit(20 * 1024 * 1024);     // 20 MiB/s
+//! {
+//!     stxxl::scoped_io_throttle context(limit);
+//!     build_map();                                 // all its I/Os are limited
+//! }
+//! \endcode
+//!
+//! A throttle may be shared by several threads and disks and must outlive
+//! the requests charged to it.
+class io_throttle : private noncopyable
+{
+    mutex throttle_mutex;
+    double bytes_per_second, ops_per_second, burst_seconds;
+    //! tokens left, negative after a request larger than the rest
+    double byte_tokens, op_tokens;
+    double last_refill;
+    uint64 deferred;
+
+    void refill(double now);
+
+public:
+    //! \param bytes_per_second_ bandwidth limit in bytes per second, 0 for none
+    //! \param ops_per_second_ limit of requests per second, 0 for none
+    //! \param burst_seconds_ the rates may be exceeded by what accumulates
+    //!        in this time while no request is charged
+    io_throttle(double bytes_per_second_ = 0.0, double ops_per_second_ = 0.0,
+                double burst_seconds_ = 0.1);
+
+    //! Changes the limits, 0 for none.
+    void set_limits(double bytes_per_second_, double ops_per_second_);
+
+    //! \brief Charges a request, called by the disk queues.
+    //!
+    //! A request is granted while no tokens are owed and then takes its
+    //! tokens, possibly more than there are left.
+    //! \param bytes size of the request
+    //! \param now current \c timestamp()
+    //! \return 0 if the request may be served now, otherwise the time from
+    //!         which on it will be granted if no other request is charged
+    double acquire(unsigned_type bytes, double now);
+
+    //! Number of times a request was deferred.
+    uint64 get_deferred();
+
+    //! Throttle of the requests submitted by the calling thread, \c NULL if
+    //! none.
+    static io_throttle * get_current();
+};
+
+//! Charges the requests submitted by the calling thread to a throttle until
+//! the object is destroyed. Scopes nest.
+class scoped_io_throttle : private noncopyable
+{
+    io_throttle * previous;
+
+public:
+    //! \param throttle throttle to charge, \c NULL lifts the limits
+    scoped_io_throttle(io_throttle * throttle);
+    scoped_io_throttle(io_throttle & throttle);
+    ~scoped_io_throttle();
+};
+
+//! \}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_IO__IO_THROTTLE_H_
+// vim: et:ts=4:sw=4
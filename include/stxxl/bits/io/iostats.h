@@ -20,9 +20,14 @@
 #endif
 
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include <utility>
 
+#include <stxxl/bits/config.h>
 #include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
 #include <stxxl/bits/deprecated.h>
 #include <stxxl/bits/common/mutex.h>
 #include <stxxl/bits/common/timer.h>
@@ -31,6 +36,9 @@
 #include <stxxl/bits/unused.h>
 #include <stxxl/bits/singleton.h>
 
+#if STXXL_STD_ATOMIC
+#include <atomic>
+#endif
 
 __STXXL_BEGIN_NAMESPACE
 
@@ -38,35 +46,246 @@ __STXXL_BEGIN_NAMESPACE
 //!
 //! \{
 
+//! A statistics counter that is updated without locks (with a mutex if
+//! std::atomic is not available).
+class stats_counter : private noncopyable
+{
+#if STXXL_STD_ATOMIC
+    std::atomic<int64> value;
+
+public:
+    stats_counter() : value(0) { }
+
+    void add(int64 diff)
+    {
+        value.fetch_add(diff, std::memory_order_relaxed);
+    }
+
+    int64 get() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void set(int64 v)
+    {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    //! Sets the counter to \c desired if it still holds \c expected.
+    bool compare_and_set(int64 expected, int64 desired)
+    {
+        return value.compare_exchange_strong(expected, desired, std::memory_order_relaxed);
+    }
+#else
+    mutable mutex value_mutex;
+    int64 value;
+
+public:
+    stats_counter() : value(0) { }
+
+    void add(int64 diff)
+    {
+        scoped_mutex_lock Lock(value_mutex);
+        value += diff;
+    }
+
+    int64 get() const
+    {
+        scoped_mutex_lock Lock(value_mutex);
+        return value;
+    }
+
+    void set(int64 v)
+    {
+        scoped_mutex_lock Lock(value_mutex);
+        value = v;
+    }
+
+    bool compare_and_set(int64 expected, int64 desired)
+    {
+        scoped_mutex_lock Lock(value_mutex);
+        if (value != expected)
+            return false;
+        value = desired;
+        return true;
+    }
+#endif
+
+    //! Raises the counter to \c v if it is smaller.
+    void set_max(int64 v)
+    {
+        int64 current = get();
+        while (current < v && !compare_and_set(current, v))
+            current = get();
+    }
+};
+
+//! Integrates the number of concurrently active operations (the level) over
+//! time: the time during which the level was positive, and the integral of
+//! the level, which is the sum of the durations of all operations.
+//!
+//! A level change is a single compare-and-swap of one word holding the level
+//! (20 bits) and the time of the last change in microseconds since program
+//! start (44 bits, about 200 days).
+class stats_activity : private noncopyable
+{
+    static const unsigned level_bits = 20;
+
+#if STXXL_STD_ATOMIC
+    std::atomic<uint64> state;
+#else
+    mutex state_mutex;
+    uint64 state;
+#endif
+    stats_counter busy, weighted;               // microseconds
+    stats_counter max_level;
+
+public:
+    stats_activity() : state(0) { }
+
+    //! Changes the level by \c diff at time \c now (a \c timestamp()).
+    void change(int diff, double now);
+
+    //! Current number of active operations.
+    unsigned get_level() const;
+
+    //! Maximum level since the last reset.
+    unsigned get_max_level() const
+    {
+        return unsigned(max_level.get());
+    }
+
+    //! Seconds during which at least one operation was active.
+    double get_busy_time() const
+    {
+        return double(busy.get()) * 1e-6;
+    }
+
+    //! Integral of the level over time in seconds.
+    double get_weighted_time() const
+    {
+        return double(weighted.get()) * 1e-6;
+    }
+
+    //! Clears the accumulated times, active operations stay active.
+    void reset()
+    {
+        busy.set(0);
+        weighted.set(0);
+        max_level.set(get_level());
+    }
+};
+
+//! Histogram of latencies with four buckets per power of two nanoseconds,
+//! up to about 18 minutes; percentiles are accurate to 25%.
+class latency_histogram
+{
+public:
+    static const unsigned num_buckets = 4 * 40;
+
+private:
+    uint64 counts[num_buckets];
+
+public:
+    latency_histogram()
+    {
+        std::fill(counts, counts + num_buckets, uint64(0));
+    }
+
+    //! Bucket of a latency in seconds.
+    static unsigned bucket(double seconds);
+
+    //! Upper bound of the latencies in bucket \c b in seconds.
+    static double bucket_upper(unsigned b);
+
+    void add(unsigned b, uint64 n = 1)
+    {
+        counts[b] += n;
+    }
+
+    uint64 get(unsigned b) const
+    {
+        return counts[b];
+    }
+
+    //! Number of recorded latencies.
+    uint64 count() const;
+
+    //! Latency (upper bucket bound) below which the fraction \c q of the
+    //! recorded latencies lie, e.g. 0.99 for the 99th percentile.
+    double percentile(double q) const;
+
+    latency_histogram & operator += (const latency_histogram & a)
+    {
+        for (unsigned b = 0; b < num_buckets; ++b)
+            counts[b] += a.counts[b];
+        return *this;
+    }
+
+    latency_histogram operator - (const latency_histogram & a) const
+    {
+        latency_histogram h;
+        for (unsigned b = 0; b < num_buckets; ++b)
+            h.counts[b] = counts[b] - a.counts[b];
+        return h;
+    }
+};
+
+class disk_stats_data;
+
 //! Collects various I/O statistics.
+//!
+//! All counters are updated without locks. Besides the process-wide totals,
+//! statistics are kept per disk queue (\c file::get_queue_id()) for the
+//! requests submitted through the disk queues: operation counts and volumes,
+//! service times, latency histograms from submission to completion, and the
+//! queue depth (requests queued or being served) over time, see
+//! \c get_disk_stats().
 //! \remarks is a singleton
 class stats : public singleton<stats>
 {
     friend class singleton<stats>;
 
-    unsigned reads, writes;                     // number of operations
-    int64 volume_read, volume_written;          // number of bytes read/written
-    unsigned c_reads, c_writes;                 // number of cached operations
-    int64 c_volume_read, c_volume_written;      // number of bytes read/written from/to cache
-    double t_reads, t_writes;                   // seconds spent in operations
-    double p_reads, p_writes;                   // seconds spent in parallel operations
-    double p_begin_read, p_begin_write;         // start time of parallel operation
-    double p_ios;                               // seconds spent in all parallel I/O operations (read and write)
-    double p_begin_io;
-    double t_waits, p_waits;                    // seconds spent waiting for completion of I/O operations
-    double p_begin_wait;
-    double t_wait_read, p_wait_read;
-    double p_begin_wait_read;
-    double t_wait_write, p_wait_write;
-    double p_begin_wait_write;
-    int acc_reads, acc_writes;                  // number of requests, participating in parallel operation
-    int acc_ios;
-    int acc_waits;
-    int acc_wait_read, acc_wait_write;
+    stats_counter reads, writes;                // number of operations
+    stats_counter volume_read, volume_written;  // number of bytes read/written
+    stats_counter c_reads, c_writes;            // number of cached operations
+    stats_counter c_volume_read, c_volume_written; // number of bytes read/written from/to cache
+    //! operations being served: the integral of their number is the
+    //! serialized time, the time with at least one of them the parallel time
+    stats_activity read_activity, write_activity, io_activity;
+    //! threads waiting for completion of I/O operations
+    stats_activity wait_activity, wait_read_activity, wait_write_activity;
     double last_reset;
-    mutex read_mutex, write_mutex, io_mutex, wait_mutex;
+    mutex log_mutex;
+
+public:
+    //! Number of disk queues with separate statistics, queue ids from
+    //! \c file::NO_QUEUE up to max_disks - 4 are kept apart, larger ids
+    //! share the last slot.
+    static const int max_disks = 256;
+
+private:
+    class disk_stats;
+#if STXXL_STD_ATOMIC
+    std::atomic<disk_stats *> disks[max_disks];
+#else
+    disk_stats * disks[max_disks];
+#endif
+    mutex disks_mutex;
+    stats_counter sampling_interval;            // microseconds, 0 = off
+    stats_counter sampling_max_samples;
+
+    static int disk_slot(int queue_id)
+    {
+        return STXXL_MIN(STXXL_MAX(queue_id + 2, 0), max_disks - 1);
+    }
+
+    //! The statistics of a queue, created on first use.
+    disk_stats * get_disk(int queue_id);
+    void sample_queue_depth(disk_stats * d, double now);
 
     stats();
+    ~stats();
 
 public:
     enum wait_op_type {
@@ -266,91 +485,91 @@ public:
     //! \return total number of reads
     unsigned get_reads() const
     {
-        return reads;
+        return unsigned(reads.get());
     }
 
     //! Returns total number of writes.
     //! \return total number of writes
     unsigned get_writes() const
     {
-        return writes;
+        return unsigned(writes.get());
     }
 
     //! Returns number of bytes read from disks.
     //! \return number of bytes read
     int64 get_read_volume() const
     {
-        return volume_read;
+        return volume_read.get();
     }
 
     //! Returns number of bytes written to the disks.
     //! \return number of bytes written
     int64 get_written_volume() const
     {
-        return volume_written;
+        return volume_written.get();
     }
 
     //! Returns total number of reads served from cache.
     //! \return total number of cached reads
     unsigned get_cached_reads() const
     {
-        return c_reads;
+        return unsigned(c_reads.get());
     }
 
     //! Returns total number of cached writes.
     //! \return total number of cached writes
     unsigned get_cached_writes() const
     {
-        return c_writes;
+        return unsigned(c_writes.get());
     }
 
     //! Returns number of bytes read from cache.
     //! \return number of bytes read from cache
     int64 get_cached_read_volume() const
     {
-        return c_volume_read;
+        return c_volume_read.get();
     }
 
     //! Returns number of bytes written to the cache.
     //! \return number of bytes written to cache
     int64 get_cached_written_volume() const
     {
-        return c_volume_written;
+        return c_volume_written.get();
     }
 
     //! Time that would be spent in read syscalls if all parallel reads were serialized.
     //! \return seconds spent in reading
     double get_read_time() const
     {
-        return t_reads;
+        return read_activity.get_weighted_time();
     }
 
     //! Time that would be spent in write syscalls if all parallel writes were serialized.
     //! \return seconds spent in writing
     double get_write_time() const
     {
-        return t_writes;
+        return write_activity.get_weighted_time();
     }
 
     //! Period of time when at least one I/O thread was executing a read.
     //! \return seconds spent in reading
     double get_pread_time() const
     {
-        return p_reads;
+        return read_activity.get_busy_time();
     }
 
     //! Period of time when at least one I/O thread was executing a write.
     //! \return seconds spent in writing
     double get_pwrite_time() const
     {
-        return p_writes;
+        return write_activity.get_busy_time();
     }
 
     //! Period of time when at least one I/O thread was executing a read or a write.
     //! \return seconds spent in I/O
     double get_pio_time() const
     {
-        return p_ios;
+        return io_activity.get_busy_time();
     }
 
     //! I/O wait time counter.
@@ -358,17 +577,17 @@ public:
     //! request::wait request::wait \endlink, \c wait_any and \c wait_all
     double get_io_wait_time() const
     {
-        return t_waits;
+        return wait_activity.get_weighted_time();
     }
 
     double get_wait_read_time() const
     {
-        return t_wait_read;
+        return wait_read_activity.get_weighted_time();
     }
 
     double get_wait_write_time() const
     {
-        return t_wait_write;
+        return wait_write_activity.get_weighted_time();
     }
 
     //! Return time of the last reset.
@@ -386,6 +605,18 @@ public:
     //! Resets I/O wait time counter.
     _STXXL_DEPRECATED(void _reset_io_wait_time());
 
+    //! Statistics of the requests submitted to the disk queue \c queue_id.
+    disk_stats_data get_disk_stats(int queue_id);
+
+    //! Ids of the disk queues that have statistics.
+    std::vector<int> get_disk_ids() const;
+
+    //! Records the depth of each disk queue at most once per \c interval
+    //! seconds when it changes, 0 disables sampling. If a queue has
+    //! \c max_samples samples, every other one is dropped and the interval
+    //! of that queue is doubled, so the samples always cover the whole run.
+    void set_queue_depth_sampling(double interval, unsigned_type max_samples = 4096);
+
     // for library use
     void write_started(unsigned_type size_, double now = 0.0);
     void write_canceled(unsigned_type size_);
@@ -397,6 +628,10 @@ public:
     void read_cached(unsigned_type size_);
     void wait_started(wait_op_type wait_op);
     void wait_finished(wait_op_type wait_op);
+    void request_queued(int queue_id);
+    void request_canceled(int queue_id);
+    void request_served(int queue_id, bool is_write, unsigned_type size_,
+                        double submitted, double begin, double end);
 };
 
 #if !STXXL_IO_STATS
@@ -420,6 +655,9 @@ inline void stats::read_cached(unsigned_type size_)
     STXXL_UNUSED(size_);
 }
 inline void stats::read_finished() { }
+inline void stats::request_queued(int) { }
+inline void stats::request_canceled(int) { }
+inline void stats::request_served(int, bool, unsigned_type, double, double, double) { }
 #endif
 #ifdef STXXL_DO_NOT_COUNT_WAIT_TIME
 inline void stats::wait_started(wait_op_type) { }
@@ -615,6 +853,129 @@ public:
 
 std::ostream & operator << (std::ostream & o, const stats_data & s);
 
+//! Snapshot of the statistics of one disk queue, see \c stats::get_disk_stats().
+class disk_stats_data
+{
+    friend class stats;
+
+    int queue_id;
+    uint64 reads, writes;                       // number of operations
+    int64 volume_read, volume_written;          // number of bytes read/written
+    double t_reads, t_writes;                   // seconds spent serving requests
+    double t_busy;                              // seconds with requests queued or in service
+    double t_queue;                             // integral of the queue depth over time
+    unsigned max_depth, depth;
+    latency_histogram read_latency, write_latency;
+    std::vector<std::pair<double, unsigned> > samples;
+    double time, elapsed;
+
+public:
+    disk_stats_data() :
+        queue_id(0),
+        reads(0),
+        writes(0),
+        volume_read(0),
+        volume_written(0),
+        t_reads(0.0),
+        t_writes(0.0),
+        t_busy(0.0),
+        t_queue(0.0),
+        max_depth(0),
+        depth(0),
+        time(timestamp()),
+        elapsed(0.0)
+    { }
+
+    //! Differences of the counters since the snapshot \c a; the maximum
+    //! and current queue depth and the samples after \c a are kept.
+    disk_stats_data operator - (const disk_stats_data & a) const;
+
+    int get_queue_id() const
+    {
+        return queue_id;
+    }
+
+    uint64 get_reads() const
+    {
+        return reads;
+    }
+
+    uint64 get_writes() const
+    {
+        return writes;
+    }
+
+    int64 get_read_volume() const
+    {
+        return volume_read;
+    }
+
+    int64 get_written_volume() const
+    {
+        return volume_written;
+    }
+
+    //! Seconds spent in the file's serve() for reads.
+    double get_read_time() const
+    {
+        return t_reads;
+    }
+
+    //! Seconds spent in the file's serve() for writes.
+    double get_write_time() const
+    {
+        return t_writes;
+    }
+
+    //! Fraction of the elapsed time with requests queued or in service.
+    double get_utilization() const
+    {
+        return elapsed > 0.0 ? t_busy / elapsed : 0.0;
+    }
+
+    //! Average number of requests queued or in service.
+    double get_mean_queue_depth() const
+    {
+        return elapsed > 0.0 ? t_queue / elapsed : 0.0;
+    }
+
+    unsigned get_max_queue_depth() const
+    {
+        return max_depth;
+    }
+
+    unsigned get_queue_depth() const
+    {
+        return depth;
+    }
+
+    //! Latencies of reads from submission to completion.
+    const latency_histogram & get_read_latency() const
+    {
+        return read_latency;
+    }
+
+    //! Latencies of writes from submission to completion.
+    const latency_histogram & get_write_latency() const
+    {
+        return write_latency;
+    }
+
+    //! Queue depth samples as (\c timestamp(), depth), see
+    //! \c stats::set_queue_depth_sampling().
+    const std::vector<std::pair<double, unsigned> > & get_queue_depth_samples() const
+    {
+        return samples;
+    }
+
+    double get_elapsed_time() const
+    {
+        return elapsed;
+    }
+};
+
+std::ostream & operator << (std::ostream & o, const disk_stats_data & s);
+
 inline std::ostream & operator << (std::ostream & o, const stats & s)
 {
     o << stxxl::stats_data(s);
@@ -40,6 +40,7 @@ public:
     ~mem_file();
     offset_type size();
     void set_size(offset_type newsize);
+    bool can_shrink() const { return true; }
     void lock();
     void discard(offset_type offset, offset_type size);
     const char * io_type() const;
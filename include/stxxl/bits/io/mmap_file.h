@@ -29,6 +29,7 @@
 #if STXXL_HAVE_MMAP_FILE
 
 #include <sys/mman.h>
+#include <vector>
 
 #include <stxxl/bits/io/ufs_file_base.h>
 #include <stxxl/bits/io/disk_queued_file.h>
@@ -43,17 +44,49 @@ __STXXL_BEGIN_NAMESPACE
 //! \{
 
 //! Implementation of memory mapped access file.
+//!
+//! map_readonly() lends out regions of a persistent read-only mapping of the
+//! file for zero-copy access. Reads are served from that mapping if it
+//! covers them, otherwise from a mapping of the request alone.
 class mmap_file : public ufs_file_base, public disk_queued_file
 {
+    struct mapping_type
+    {
+        char * base;
+        offset_type length;
+        unsigned_type borrowers;        // regions lent out and not yet released
+
+        mapping_type(char * base_, offset_type length_)
+            : base(base_), length(length_), borrowers(0)
+        { }
+
+        bool contains(const char * p) const
+        {
+            return base <= p && p < base + length;
+        }
+    };
+
+    mutex map_mutex;                    // protects the mapping variables
+    mapping_type mapping;               // read-only mapping from the file start
+    std::vector<mapping_type> retired_mappings; // outgrown, but still borrowed from
+
+    //! Returns the persistent mapping, enlarged to cover at least end bytes.
+    //! \remark expects map_mutex to be locked
+    char * _get_mapping(offset_type end, offset_type file_size);
+
 public:
     //! Constructs file object.
     //! param filename path of file
     //! param mode open mode, see \c stxxl::file::open_modes
     //! param disk disk(file) identifier
     inline mmap_file(const std::string & filename, int mode, int queue_id = DEFAULT_QUEUE, int allocator_id = NO_ALLOCATOR) :
-        ufs_file_base(filename, mode), disk_queued_file(queue_id, allocator_id)
+        ufs_file_base(filename, mode), disk_queued_file(queue_id, allocator_id),
+        mapping(NULL, 0)
     { }
+    ~mmap_file();
     void serve(const request * req) throw (io_error);
+    const void * map_readonly(offset_type offset, size_type bytes, access_hint hint = NORMAL_ACCESS);
+    void release_readonly(const void * region);
     const char * io_type() const;
 };
 
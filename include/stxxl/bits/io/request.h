@@ -34,6 +34,7 @@ __STXXL_BEGIN_NAMESPACE
 #define BLOCK_ALIGN 4096
 
 class file;
+class io_throttle;
 
 //! Request with basic properties like file and offset.
 class request : virtual public request_interface, public atomic_counted_object
@@ -48,6 +49,9 @@ protected:
     offset_type offset;
     size_type bytes;
     request_type type;
+    request_priority priority;
+    //! throttle the request is charged to, \c NULL if none
+    io_throttle * throttle;
 
     void completed();
 
@@ -58,7 +62,8 @@ public:
             void * buffer_,
             offset_type offset_,
             size_type bytes_,
-            request_type type_);
+            request_type type_,
+            request_priority priority_ = DEMAND);
 
     virtual ~request();
 
@@ -67,6 +72,18 @@ public:
     offset_type get_offset() const { return offset; }
     size_type get_size() const { return bytes; }
     request_type get_type() const { return type; }
+    request_priority get_priority() const { return priority; }
+    io_throttle * get_throttle() const { return throttle; }
+
+    //! Raises the priority class, called by the disk queue under its lock.
+    //! \return \c true if the priority was raised
+    bool raise_priority(request_priority prio)
+    {
+        if (prio >= priority)
+            return false;
+        priority = prio;
+        return true;
+    }
 
     void check_alignment() const;
 
@@ -40,6 +40,19 @@ public:
     typedef stxxl::external_size_type offset_type;
     typedef stxxl::internal_size_type size_type;
     enum request_type { READ, WRITE };
+    //! Priority classes of requests, most urgent first.
+    //!
+    //! A disk queue serves the request with the earliest deadline. The
+    //! deadline of a request is its submission time plus a slack that grows
+    //! with the class, so less urgent requests are delayed, but not starved.
+    enum request_priority
+    {
+        DEMAND,                             //!< a thread needs the data right now
+        PREFETCH,                           //!< data needed soon, read ahead of consumption
+        WRITEBACK,                          //!< write-behind of buffered blocks
+        BACKGROUND                          //!< nobody waits for it
+    };
+    static const int NUM_PRIORITIES = BACKGROUND + 1;
 
 public:
     virtual bool add_waiter(onoff_switch * sw) = 0;
@@ -68,6 +81,13 @@ public:
     //! \return \c true iff the request was canceled successfully
     virtual bool cancel() = 0;
 
+    //! Raises the priority of a request that is still queued.
+    //!
+    //! Lowering the priority is not possible and ignored. Waiting for a read
+    //! request raises its priority to \c DEMAND; waiting for a write does
+    //! not, so waited-on write-behind does not overtake prefetches.
+    virtual void promote(request_priority prio) = 0;
+
     //! Polls the status of the request.
     //! \return \c true if request is completed, otherwise \c false
     virtual bool poll() = 0;
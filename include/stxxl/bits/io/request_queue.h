@@ -31,6 +31,12 @@ public:
 public:
     virtual void add_request(request_ptr & req) = 0;
     virtual bool cancel_request(request_ptr & req) = 0;
+    //! Raises the priority of a queued request and reorders it. Queues that
+    //! read the priority while dispatching must raise it under their lock.
+    virtual void promote_request(request_ptr & req, request::request_priority prio)
+    {
+        req->raise_priority(prio);
+    }
     virtual ~request_queue() { }
     virtual void set_priority_op(priority_op p) { STXXL_UNUSED(p); }
 };
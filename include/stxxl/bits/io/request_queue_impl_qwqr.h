@@ -15,10 +15,12 @@
 #ifndef STXXL_IO_REQUEST_QUEUE_IMPL_QWQR_HEADER
 #define STXXL_IO_REQUEST_QUEUE_IMPL_QWQR_HEADER
 
-#include <list>
+#include <map>
+#include <utility>
 
 #include <stxxl/bits/io/request_queue_impl_worker.h>
 #include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/compat_hash_map.h>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -26,29 +28,94 @@ __STXXL_BEGIN_NAMESPACE
 //! \addtogroup iolayer
 //! \{
 
+//! Request queue served by one thread, ordered by priority and deadline.
+//!
+//! Requests wait in one FIFO queue per \c request::request_priority class.
+//! The worker serves the request with the earliest deadline, which is its
+//! submission time plus the slack of its class, see deadline_slack(). So a
+//! demand read overtakes prefetches and write-behind that were submitted less
+//! than their slack ago, while requests of low priority classes still make
+//! progress. A read is never served before a queued write of the same block.
+//!
+//! A request charged to an \c io_throttle that is out of tokens is put aside
+//! until the throttle grants it, and other requests are served meanwhile.
+//!
+//! Every queued request is indexed by its address and by its block, so
+//! cancelation, promotion and the check for a pending write of a block take
+//! constant or logarithmic time.
 class request_queue_impl_qwqr : public request_queue_impl_worker
 {
 private:
     typedef request_queue_impl_qwqr self;
-    typedef std::list<request_ptr> queue_type;
 
-    mutex write_mutex;
-    mutex read_mutex;
-    queue_type write_queue;
-    queue_type read_queue;
+    struct queued_request
+    {
+        request_ptr req;
+        double submitted;
+    };
+    //! requests by deadline, or by the time their throttle grants them
+    typedef std::multimap<double, queued_request> queue_type;
+
+    //! where a queued request is
+    struct location
+    {
+        queue_type * queue;
+        queue_type::iterator pos;
+    };
+    typedef compat_hash_map<request *, location>::result location_map;
+    typedef std::pair<file *, request::offset_type> block_type;
+    typedef std::multimap<block_type, request *> block_index;
+
+    mutex queue_mutex;
+    queue_type queues[request::NUM_PRIORITIES];
+    //! requests deferred by their throttle
+    queue_type throttled;
+    //! location of every request in queues or throttled
+    location_map locations;
+    //! queued requests by block, one index per request::request_type
+    block_index pending_blocks[2];
 
     state<thread_state> _thread_state;
     thread_type thread;
     semaphore sem;
 
-    static const priority_op _priority_op = WRITE;
-
     static void * worker(void * arg);
 
+    //! Finds the oldest queued request of the given type for the file and
+    //! offset of \c req, NULL if there is none. queue_mutex must be held.
+    location * find_conflict(const request_ptr & req, request::request_type type);
+    //! Puts an entry into \c queue under \c key and records its location,
+    //! queue_mutex must be held.
+    void insert(queue_type & queue, double key, const queued_request & entry);
+    //! Inserts into the queue of the request's class by deadline,
+    //! queue_mutex must be held.
+    void insert_by_deadline(const queued_request & entry);
+    //! Removes a queued request from its queue and the indexes,
+    //! queue_mutex must be held.
+    void remove(location_map::iterator loc);
+    //! Removes the next request to serve, queue_mutex must be held.
+    //!
+    //! sem counts the requests in the queues of the classes, deferred ones
+    //! are not counted.
+    //! \param now current \c timestamp()
+    //! \param token whether the caller took a count from sem, cleared if
+    //!        it was used up for a request that left the queues
+    //! \param wakeup is set to when the next deferred request becomes ready,
+    //!        0 if there is none
+    request_ptr next_request(double now, bool & token, double & wakeup);
+
 public:
     // \param n max number of requests simultaneously submitted to disk
     request_queue_impl_qwqr(int n = 1);
 
+    //! Slack between submission and deadline of a priority class in seconds.
+    static double deadline_slack(request::request_priority prio);
+
+    //! Changes the slack of a priority class for all disk queues. Only
+    //! requests submitted afterwards are affected; call it while no
+    //! requests are queued.
+    static void set_deadline_slack(request::request_priority prio, double seconds);
+
     // in a multi-threaded setup this does not work as intended
     // also there were race conditions possible
     // and actually an old value was never restored once a new one was set ...
@@ -60,6 +127,7 @@ public:
     }
     void add_request(request_ptr & req);
     bool cancel_request(request_ptr & req);
+    void promote_request(request_ptr & req, request::request_priority prio);
     ~request_queue_impl_qwqr();
 };
 
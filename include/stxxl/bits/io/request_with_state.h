@@ -41,8 +41,9 @@ protected:
         void * buf,
         offset_type off,
         size_type b,
-        request_type t) :
-        request(on_cmpl, f, buf, off, b, t),
+        request_type t,
+        request_priority p = DEMAND) :
+        request(on_cmpl, f, buf, off, b, t, p),
         _state(OP)
     { }
 
@@ -51,6 +52,7 @@ public:
     void wait(bool measure_time = true);
     bool poll();
     bool cancel();
+    void promote(request_priority prio);
 };
 
 //! \}
@@ -14,7 +14,13 @@
 #ifndef STXXL_IO__REQUEST_WITH_WAITERS_H_
 #define STXXL_IO__REQUEST_WITH_WAITERS_H_
 
-#include <set>
+#include <vector>
+
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_ATOMIC
+ #include <atomic>
+#endif
 
 #include <stxxl/bits/common/mutex.h>
 #include <stxxl/bits/common/switch.h>
@@ -30,15 +36,26 @@ __STXXL_BEGIN_NAMESPACE
 class request_with_waiters : virtual public request_interface
 {
     mutex waiters_mutex;
-    std::set<onoff_switch *> waiters;
+    //! the first waiter is kept inline, so waiting for a request nobody
+    //! else waits for allocates nothing
+    onoff_switch * first_waiter;
+    std::vector<onoff_switch *> more_waiters;
+#if STXXL_STD_ATOMIC
+    //! number of waiters, lets notify_waiters() skip the lock if there are none
+    std::atomic<int> num_waiters;
+#endif
 
 protected:
+    request_with_waiters()
+        : first_waiter(NULL)
+#if STXXL_STD_ATOMIC
+          , num_waiters(0)
+#endif
+    { }
+
     bool add_waiter(onoff_switch * sw);
     void delete_waiter(onoff_switch * sw);
     void notify_waiters();
-    /*
-    int nwaiters();             // returns number of waiters
-    */
 };
 
 //! \}
@@ -28,14 +28,21 @@ class serving_request : public request_with_state
     template <class base_file_type>
     friend class fileperblock_file;
 
+    //! submission time of a request for a disk queue, 0 otherwise
+    double time_submitted;
+
 public:
+    //! \param queued whether the request is submitted to the disk queue of
+    //! the file, which keeps per-queue statistics of it
     serving_request(
         const completion_handler & on_cmpl,
         file * f,
         void * buf,
         offset_type off,
         size_type b,
-        request_type t);
+        request_type t,
+        bool queued = false,
+        request_priority p = DEMAND);
 
 protected:
     void serve();
@@ -133,6 +133,7 @@ public:
     }
     void serve(const request * req) throw (io_error);
     void set_size(offset_type newsize);
+    bool can_shrink() const { return false; }
     const char * io_type() const;
 };
 
@@ -33,6 +33,7 @@ protected:
     mutex fd_mutex;        // sequentialize function calls involving file_des
     int file_des;          // file descriptor
     int mode_;             // open mode
+    bool punch_holes;      // discard() releases storage via fallocate(), guarded by fd_mutex
     const std::string filename;
     ufs_file_base(const std::string & filename, int mode);
     offset_type _size();
@@ -43,6 +44,9 @@ public:
     ~ufs_file_base();
     offset_type size();
     void set_size(offset_type newsize);
+    bool can_shrink() const;
+    //! release the storage of a freed region back to the file system
+    void discard(offset_type offset, offset_type size);
     void lock();
     const char * io_type() const;
     void close_remove();
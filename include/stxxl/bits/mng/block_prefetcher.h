@@ -81,6 +81,13 @@ protected:
     block_type * wait(int_type iblock)
     {
         STXXL_VERBOSE1("block_prefetcher: waiting block " << iblock);
+        if (!completed[iblock].is_on())
+        {
+            // the consumer blocks on this prefetch now
+            const int_type ibuffer = pref_buffer[iblock];
+            if (ibuffer >= 0 && read_reqs[ibuffer].valid())
+                read_reqs[ibuffer]->promote(request::DEMAND);
+        }
         {
             stats::scoped_wait_timer wait_timer(stats::WAIT_OP_READ);
 
@@ -142,7 +149,8 @@ public:
                            " @ " << read_bids[i]);
             read_reqs[i] = read_buffers[i].read(
                 read_bids[i],
-                set_switch_handler(*(completed + prefetch_seq[i]), do_after_fetch));
+                set_switch_handler(*(completed + prefetch_seq[i]), do_after_fetch),
+                request::PREFETCH);
             pref_buffer[prefetch_seq[i]] = i;
         }
     }
@@ -180,8 +188,8 @@ public:
             read_bids[ibuffer] = *(consume_seq_begin + next_2_prefetch);
             read_reqs[ibuffer] = read_buffers[ibuffer].read(
                 read_bids[ibuffer],
-                set_switch_handler(*(completed + next_2_prefetch), do_after_fetch)
-                );
+                set_switch_handler(*(completed + next_2_prefetch), do_after_fetch),
+                request::PREFETCH);
         }
 
         if (nextconsume >= seq_length)
@@ -13,6 +13,10 @@
 #ifndef STXXL_BUF_ISTREAM_HEADER
 #define STXXL_BUF_ISTREAM_HEADER
 
+#include <utility>
+#include <vector>
+
+#include <stxxl/bits/io/file.h>
 #include <stxxl/bits/mng/config.h>
 #include <stxxl/bits/mng/block_prefetcher.h>
 #include <stxxl/bits/noncopyable.h>
@@ -33,6 +37,11 @@ __STXXL_BEGIN_NAMESPACE
 //!
 //! Reads data records from the stream of blocks.
 //! \remark Reading performed in the background, i.e. with overlapping of I/O and computation
+//!
+//! If constructed with \c allow_mapping and all blocks reside in files that
+//! support \c file::map_readonly(), the blocks are not copied into
+//! prefetch buffers but borrowed directly from the file mappings. The
+//! records must not be modified through the stream in this case.
 template <typename BlockType, typename BIDIteratorType>
 class buf_istream : private noncopyable
 {
@@ -50,6 +59,10 @@ protected:
     int_type current_elem;
     block_type * current_blk;
     int_type * prefetch_seq;
+    //! next block to borrow from a mapping, prefetcher is NULL in this mode
+    bid_iterator_type mapped_bid;
+    //! number of blocks to advise read-ahead for in mapped mode
+    int_type mapped_ahead;
 #ifdef BUF_ISTREAM_CHECK_END
     bool not_finished;
 #endif
@@ -62,12 +75,30 @@ public:
     //! \param _begin \c bid_iterator pointing to the first block of the stream
     //! \param _end \c bid_iterator pointing to the ( \b last + 1 ) block of the stream
     //! \param nbuffers number of buffers for internal use
-    buf_istream(bid_iterator_type _begin, bid_iterator_type _end, int_type nbuffers) :
-        current_elem(0)
+    //! \param allow_mapping borrow blocks from file mappings if possible,
+    //!        the stream is then used strictly read-only
+    buf_istream(bid_iterator_type _begin, bid_iterator_type _end, int_type nbuffers,
+                bool allow_mapping = false) :
+        prefetcher(NULL),
+        begin_bid(_begin), end_bid(_end),
+        current_elem(0),
+        current_blk(NULL),
+        prefetch_seq(NULL),
+        mapped_bid(_begin),
+        mapped_ahead(nbuffers)
 #ifdef BUF_ISTREAM_CHECK_END
         , not_finished(true)
 #endif
     {
+        if (allow_mapping && all_mappable())
+        {
+            // advise read-ahead for the first blocks, then borrow the first
+            for (bid_iterator_type it = _begin + 1; it < _end && it < _begin + mapped_ahead; ++it)
+                advise_block(it);
+            current_blk = next_mapped_block();
+            return;
+        }
+
         //int_type i;
         const unsigned_type ndisks = config::get_instance()->disks_number();
         const int_type seq_length = _end - _begin;
@@ -88,6 +119,85 @@ public:
         current_blk = prefetcher->pull_block();
     }
 
+protected:
+    //! Returns the block at bid from its file's mapping, or NULL.
+    static block_type * map_block(bid_iterator_type bid, file::access_hint hint)
+    {
+        // the stream is read-only, so casting away const is safe
+        return static_cast<block_type *>(const_cast<void *>(
+            bid->storage->map_readonly(bid->offset, block_type::raw_size, hint)));
+    }
+
+    //! Starts read-ahead of the block at bid without keeping it borrowed.
+    static void advise_block(bid_iterator_type bid)
+    {
+        const void * blk = bid->storage->map_readonly(bid->offset, block_type::raw_size, file::WILLNEED_ACCESS);
+        if (blk)
+            bid->storage->release_readonly(blk);
+    }
+
+    //! Returns the current block to its file's mapping.
+    void release_current_block()
+    {
+        if (current_blk)
+            (mapped_bid - 1)->storage->release_readonly(current_blk);
+        current_blk = NULL;
+    }
+
+    //! Checks whether all blocks of the stream can be borrowed from mappings.
+    //! A file maps everything up to the end of a mappable region, so it is
+    //! asked only once, for the farthest block of the stream it holds.
+    bool all_mappable() const
+    {
+        typedef std::pair<file *, file::offset_type> extent_type;
+        std::vector<extent_type> extents;   // streams span few files
+        for (bid_iterator_type it = begin_bid; it != end_bid; ++it)
+        {
+            if (!it->storage)
+                return false;
+            unsigned_type i = 0;
+            while (i < extents.size() && extents[i].first != it->storage)
+                ++i;
+            if (i == extents.size())
+                extents.push_back(extent_type(it->storage, file::offset_type(it->offset)));
+            else if (extents[i].second < file::offset_type(it->offset))
+                extents[i].second = file::offset_type(it->offset);
+        }
+        for (unsigned_type i = 0; i < extents.size(); ++i)
+        {
+            const void * blk = extents[i].first->map_readonly(extents[i].second, block_type::raw_size);
+            if (!blk)
+                return false;
+            extents[i].first->release_readonly(blk);
+        }
+        return begin_bid != end_bid;
+    }
+
+    //! Borrows the next block in place of the current one and advises
+    //! read-ahead further on.
+    block_type * next_mapped_block()
+    {
+        release_current_block();
+        if (mapped_bid + mapped_ahead < end_bid)
+            advise_block(mapped_bid + mapped_ahead);
+        return map_block(mapped_bid++, file::SEQUENTIAL_ACCESS);
+    }
+
+    //! Advances to the next block when the current one has been consumed.
+    bool block_consumed()
+    {
+        if (prefetcher)
+            return prefetcher->block_consumed(current_blk);
+
+        if (mapped_bid == end_bid)
+            return false;
+
+        current_blk = next_mapped_block();
+        return true;
+    }
+
+public:
+
     //! Input stream operator, reads in \c record.
     //! \param record reference to the block record type,
     //!        contains value of the next record in the stream after the call of the operator
@@ -104,9 +214,9 @@ public:
         {
             current_elem = 0;
 #ifdef BUF_ISTREAM_CHECK_END
-            not_finished = prefetcher->block_consumed(current_blk);
+            not_finished = block_consumed();
 #else
-            prefetcher->block_consumed(current_blk);
+            block_consumed();
 #endif
         }
 
@@ -139,9 +249,44 @@ public:
         {
             current_elem = 0;
 #ifdef BUF_ISTREAM_CHECK_END
-            not_finished = prefetcher->block_consumed(current_blk);
+            not_finished = block_consumed();
+#else
+            block_consumed();
+#endif
+        }
+        return *this;
+    }
+
+    //! Number of records left in the current block, contiguous in memory.
+    unsigned_type batch_length() const
+    {
+        return block_type::size - current_elem;
+    }
+
+    //! Returns pointer to the current record, followed by batch_length() - 1 records.
+    const typename block_type::value_type * batch_begin() const
+    {
+        return current_blk->elem + current_elem;
+    }
+
+    //! Skips \c n <= batch_length() records.
+    //! \return reference to itself after the advance
+    _Self & operator += (unsigned_type n)
+    {
+#ifdef BUF_ISTREAM_CHECK_END
+        assert(not_finished);
+#endif
+        assert(n <= batch_length());
+
+        current_elem += n;
+
+        if (UNLIKELY(current_elem >= block_type::size))
+        {
+            current_elem = 0;
+#ifdef BUF_ISTREAM_CHECK_END
+            not_finished = block_consumed();
 #else
-            prefetcher->block_consumed(current_blk);
+            block_consumed();
 #endif
         }
         return *this;
@@ -150,6 +295,8 @@ public:
     //! Frees used internal objects.
     ~buf_istream()
     {
+        if (!prefetcher)
+            release_current_block();
         delete prefetcher;
         delete[] prefetch_seq;
     }
@@ -96,6 +96,32 @@ public:
         return *this;
     }
 
+    //! Number of records that fit into the rest of the current block.
+    unsigned_type batch_length() const
+    {
+        return block_type::size - current_elem;
+    }
+
+    //! Returns pointer to the current record, followed by batch_length() - 1 writable records.
+    typename block_type::value_type * batch_begin()
+    {
+        return current_blk->elem + current_elem;
+    }
+
+    //! Moves \c n <= batch_length() records ahead, the skipped records must have been written.
+    //! \return reference to itself after the advance
+    _Self & operator += (unsigned_type n)
+    {
+        assert(n <= batch_length());
+        current_elem += n;
+        if (UNLIKELY(current_elem >= block_type::size))
+        {
+            current_elem = 0;
+            current_blk = writer.write(current_blk, *(current_bid++));
+        }
+        return *this;
+    }
+
     //! Fill current block with padding and flush
     _Self & fill(const_reference record)
     {
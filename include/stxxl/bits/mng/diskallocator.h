@@ -28,6 +28,12 @@
 
 __STXXL_BEGIN_NAMESPACE
 
+#ifndef STXXL_DISKALLOCATOR_SHRINK_MIN
+//! minimum size of a free region at the end of a grown file that is given
+//! back to the file system while the program is running
+#define STXXL_DISKALLOCATOR_SHRINK_MIN (64 * 1024 * 1024)
+#endif // STXXL_DISKALLOCATOR_SHRINK_MIN
+
 //! \ingroup mnglayer
 //! \{
 
@@ -51,6 +57,7 @@ class DiskAllocator : private noncopyable
     sortseq free_space;
     stxxl::int64 free_bytes;
     stxxl::int64 disk_bytes;
+    stxxl::int64 configured_bytes;
     stxxl::file * storage;
     bool autogrow;
 
@@ -74,16 +81,25 @@ class DiskAllocator : private noncopyable
         disk_bytes += extend_bytes;
     }
 
+    // expects the mutex to be locked to prevent concurrent access
+    //! Cuts a free region at the end of the file, but never below the
+    //! configured size, if at least min_bytes can be released.
+    void shrink_file(stxxl::int64 min_bytes);
+
 public:
     DiskAllocator(stxxl::file * storage, stxxl::int64 disk_size) :
         free_bytes(0),
         disk_bytes(0),
+        configured_bytes(disk_size),
         storage(storage),
         autogrow(disk_size == 0)
     {
         grow_file(disk_size);
     }
 
+    //! Shrinks the file back to its configured size if the end is unused.
+    ~DiskAllocator();
+
     inline stxxl::int64 get_free_bytes() const
     {
         return free_bytes;
@@ -127,6 +143,11 @@ public:
                        "), free:" << free_bytes << " total:" << disk_bytes);
 
         add_free_region(bid.offset, bid.size);
+
+        // give space beyond the configured size back to the file system,
+        // but only in large steps to avoid growing and shrinking repeatedly
+        shrink_file(std::max<stxxl::int64>(STXXL_DISKALLOCATOR_SHRINK_MIN,
+                                           disk_bytes / 2));
     }
 };
 
@@ -50,6 +50,8 @@ __STXXL_BEGIN_NAMESPACE
 #define STXXL_MNG_COUNT_ALLOCATION 1
 #endif // STXXL_MNG_COUNT_ALLOCATION
 
+class stats_sampler;
+
 //! \defgroup mnglayer Block management layer
 //! Group of classes which help controlling external memory space,
 //! managing disks, and allocating and deallocating blocks of external storage
@@ -69,6 +71,9 @@ class block_manager : public singleton<block_manager>
     size_t ndisks;
     block_manager();
 
+    //! writes statistics in the background if requested by STXXLSTATSFILE
+    stats_sampler * sampler;
+
 #if STXXL_MNG_COUNT_ALLOCATION
     //! total requested allocation in bytes
     uint64      m_total_allocation;
@@ -243,8 +248,10 @@ void block_manager::delete_block(const BID<BLK_SIZE> & bid)
         return;  // self managed disk
     STXXL_VERBOSE_BLOCK_LIFE_CYCLE("BLC:delete " << FMT_BID(bid));
     assert(bid.storage->get_allocator_id() >= 0);
-    disk_allocators[bid.storage->get_allocator_id()]->delete_block(bid);
+    // discard before releasing the region: afterwards it may be reallocated
+    // and written by another thread
     disk_files[bid.storage->get_allocator_id()]->discard(bid.offset, bid.size);
+    disk_allocators[bid.storage->get_allocator_id()]->delete_block(bid);
 
 #if STXXL_MNG_COUNT_ALLOCATION
     m_current_allocation -= BLK_SIZE;
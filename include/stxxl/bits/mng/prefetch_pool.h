@@ -15,8 +15,14 @@
 #define STXXL_PREFETCH_POOL_HEADER
 
 #include <list>
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <ostream>
 #include <stxxl/bits/config.h>
 #include <stxxl/bits/mng/write_pool.h>
+#include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/common/timer.h>
 #include <stxxl/bits/compat_hash_map.h>
 
 
@@ -25,7 +31,43 @@ __STXXL_BEGIN_NAMESPACE
 //! \addtogroup schedlayer
 //! \{
 
+//! Counters of a prefetch_pool, see prefetch_pool::get_stats().
+struct prefetch_pool_stats
+{
+    //! read() found a prefetched block that had already arrived
+    unsigned_type hits;
+    //! read() found a prefetched block that was still being read
+    unsigned_type late_hits;
+    //! read() found no prefetched block and issued the read itself
+    unsigned_type misses;
+    //! blocks prefetched by the automatic read-ahead
+    unsigned_type readahead;
+    //! read-ahead blocks invalidated or reclaimed without being read
+    unsigned_type wasted;
+
+    prefetch_pool_stats() :
+        hits(0), late_hits(0), misses(0), readahead(0), wasted(0)
+    { }
+};
+
+inline std::ostream & operator << (std::ostream & o, const prefetch_pool_stats & s)
+{
+    o << "prefetch_pool: hits " << s.hits << " late " << s.late_hits <<
+        " misses " << s.misses << " read-ahead " << s.readahead <<
+        " wasted " << s.wasted;
+    return o;
+}
+
 //! Implements dynamically resizable prefetching pool.
+//!
+//! Besides prefetching blocks that are explicitly hinted, the pool can
+//! detect sequential or strided sequences of read() calls and read ahead
+//! automatically, see set_readahead(). The read-ahead window of each
+//! detected stream is sized from the average read latency and the rate at
+//! which the stream consumes blocks, and is enlarged when blocks arrive late.
+//! As with hint(), blocks written behind the pool's back are not detected,
+//! so automatic read-ahead must only be enabled if all writes to the
+//! blocks read go through the pool (e.g. read_write_pool::write()).
 template <class BlockType>
 class prefetch_pool : private noncopyable
 {
@@ -66,10 +108,47 @@ protected:
 
     unsigned_type free_blocks_size;
 
+    //! state of a detected sequence of reads with constant stride
+    struct stream_type
+    {
+        file * storage;
+        int64 last_offset;      // offset of the last block read
+        int64 stride;           // 0 while untrained
+        int64 ahead_offset;     // next offset to read ahead
+        int64 file_size;        // size of storage when last looked up
+        unsigned_type confirmed; // number of reads matching the stride
+        unsigned_type late;     // late arrivals, enlarge the window
+        double last_time;       // timestamp of the last read
+        double interval;        // average time between reads
+        unsigned_type last_use;
+    };
+
+    typedef typename compat_hash_map<bid_type, bool, bid_hash>::result speculative_map_type;
+
+    //! maximum number of blocks read ahead per stream, 0 = no read-ahead
+    unsigned_type max_readahead;
+    //! maximum number of streams tracked at the same time
+    unsigned_type max_streams;
+    //! maximum stride (in bytes) still considered a stream
+    int64 max_stride;
+
+    std::vector<stream_type> streams;
+    unsigned_type use_counter;
+
+    //! blocks in busy_blocks that were not hinted by the user
+    speculative_map_type speculative;
+    //! speculative blocks in order of issue, for reclaiming (lazily cleaned)
+    std::deque<bid_type> speculative_order;
+
+    prefetch_pool_stats m_stats;
+
 public:
     //! Constructs pool.
     //! \param init_size initial number of blocks in the pool
-    explicit prefetch_pool(unsigned_type init_size = 1) : free_blocks_size(init_size)
+    explicit prefetch_pool(unsigned_type init_size = 1) :
+        free_blocks_size(init_size),
+        max_readahead(0), max_streams(8), max_stride(0),
+        use_counter(0)
     {
         unsigned_type i = 0;
         for ( ; i < init_size; ++i)
@@ -81,6 +160,14 @@ public:
         std::swap(free_blocks, obj.free_blocks);
         std::swap(busy_blocks, obj.busy_blocks);
         std::swap(free_blocks_size, obj.free_blocks_size);
+        std::swap(max_readahead, obj.max_readahead);
+        std::swap(max_streams, obj.max_streams);
+        std::swap(max_stride, obj.max_stride);
+        std::swap(streams, obj.streams);
+        std::swap(use_counter, obj.use_counter);
+        std::swap(speculative, obj.speculative);
+        std::swap(speculative_order, obj.speculative_order);
+        std::swap(m_stats, obj.m_stats);
     }
 
     //! Waits for completion of all ongoing read requests and frees memory.
@@ -124,13 +211,13 @@ public:
             return true;
         }
 
-        if (free_blocks_size) //  only if we have a free block
+        if (free_blocks_size || reclaim_speculative()) //  only if we have a free block
         {
             --free_blocks_size;
             block_type * block = free_blocks.back();
             free_blocks.pop_back();
             STXXL_VERBOSE2("prefetch_pool::hint bid=" << bid << " => prefetching");
-            request_ptr req = block->read(bid);
+            request_ptr req = block->read(bid, default_completion_handler(), request::PREFETCH);
             busy_blocks[bid] = busy_entry(block, req);
             return true;
         }
@@ -146,7 +233,7 @@ public:
             return true;
         }
 
-        if (free_blocks_size) //  only if we have a free block
+        if (free_blocks_size || reclaim_speculative()) //  only if we have a free block
         {
             --free_blocks_size;
             block_type * block = free_blocks.back();
@@ -161,7 +248,7 @@ public:
                 return true;
             }
             STXXL_VERBOSE2("prefetch_pool::hint2 bid=" << bid << " => prefetching");
-            request_ptr req = block->read(bid);
+            request_ptr req = block->read(bid, default_completion_handler(), request::PREFETCH);
             busy_blocks[bid] = busy_entry(block, req);
             return true;
         }
@@ -184,6 +271,8 @@ public:
         ++free_blocks_size;
         free_blocks.push_back(cache_el->second.first);
         busy_blocks.erase(cache_el);
+        if (speculative.erase(bid))
+            ++m_stats.wasted;
         return true;
     }
 
@@ -200,26 +289,39 @@ public:
     //! \return request pointer object of read operation
     request_ptr read(block_type * & block, bid_type bid)
     {
+        request_ptr result;
+        bool late = false;
         busy_blocks_iterator cache_el = busy_blocks.find(bid);
         if (cache_el == busy_blocks.end())
         {
             // not cached
             STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " => no copy in cache, retrieving to " << block);
-            return block->read(bid);
+            ++m_stats.misses;
+            result = block->read(bid);
+        }
+        else
+        {
+            // cached
+            STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " => copy in cache exists");
+            ++free_blocks_size;
+            free_blocks.push_back(block);
+            block = cache_el->second.first;
+            result = cache_el->second.second;
+            busy_blocks.erase(cache_el);
+            late = count_hit(bid, result);
         }
 
-        // cached
-        STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " => copy in cache exists");
-        ++free_blocks_size;
-        free_blocks.push_back(block);
-        block = cache_el->second.first;
-        request_ptr result = cache_el->second.second;
-        busy_blocks.erase(cache_el);
+        if (max_readahead)
+            detect_stream(bid, NULL, late);
+
         return result;
     }
 
     request_ptr read(block_type * & block, bid_type bid, write_pool<block_type> & w_pool)
     {
+        request_ptr result;
+        bool late = false;
+
         // try cache
         busy_blocks_iterator cache_el = busy_blocks.find(bid);
         if (cache_el != busy_blocks.end())
@@ -229,25 +331,33 @@ public:
             ++free_blocks_size;
             free_blocks.push_back(block);
             block = cache_el->second.first;
-            request_ptr result = cache_el->second.second;
+            result = cache_el->second.second;
             busy_blocks.erase(cache_el);
-            return result;
+            late = count_hit(bid, result);
         }
-
         // try w_pool cache
-        if (w_pool.has_request(bid))
+        else if (w_pool.has_request(bid))
         {
             busy_entry wp_request = w_pool.steal_request(bid);
             STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " was in write cache at " << wp_request.first);
             assert(wp_request.first != 0);
             w_pool.add(block);  //in exchange
             block = wp_request.first;
-            return wp_request.second;
+            result = wp_request.second;
+            ++m_stats.hits;
+        }
+        else
+        {
+            // not cached
+            STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " => no copy in cache, retrieving to " << block);
+            ++m_stats.misses;
+            result = block->read(bid);
         }
 
-        // not cached
-        STXXL_VERBOSE1("prefetch_pool::read bid=" << bid << " => no copy in cache, retrieving to " << block);
-        return block->read(bid);
+        if (max_readahead)
+            detect_stream(bid, &w_pool, late);
+
+        return result;
     }
 
     //! Resizes size of the pool.
@@ -269,7 +379,7 @@ public:
             return size();
         }
 
-        while (diff < 0 && free_blocks_size > 0)
+        while (diff < 0 && (free_blocks_size > 0 || reclaim_speculative()))
         {
             ++diff;
             --free_blocks_size;
@@ -278,6 +388,208 @@ public:
         }
         return size();
     }
+
+    //! Enables or disables automatic read-ahead for sequential and strided
+    //! sequences of read() calls.
+    //! \param max_window maximum number of blocks read ahead per stream,
+    //!        0 disables read-ahead
+    //! \param streams maximum number of interleaved streams detected
+    //! \param stride_limit maximum distance in blocks between consecutive
+    //!        reads of a stream
+    void set_readahead(unsigned_type max_window, unsigned_type streams = 8,
+                       unsigned_type stride_limit = 64)
+    {
+        max_readahead = max_window;
+        max_streams = STXXL_MAX<unsigned_type>(streams, 1);
+        max_stride = int64(stride_limit) * int64(block_type::raw_size);
+        this->streams.clear();
+        if (!max_readahead)
+        {
+            while (reclaim_speculative()) { }
+        }
+    }
+
+    //! Returns the hit, miss and read-ahead counters.
+    const prefetch_pool_stats & get_stats() const
+    {
+        return m_stats;
+    }
+
+    //! Resets the hit, miss and read-ahead counters.
+    void reset_stats()
+    {
+        m_stats = prefetch_pool_stats();
+    }
+
+protected:
+    //! Counts a read() served from busy_blocks.
+    //! \return whether the block was read ahead but had not arrived yet
+    bool count_hit(const bid_type & bid, request_ptr & req)
+    {
+        bool late = !req->poll();
+        if (late)
+            ++m_stats.late_hits;
+        else
+            ++m_stats.hits;
+        return speculative.erase(bid) && late;
+    }
+
+    //! Frees the oldest speculatively read block, if there is one.
+    bool reclaim_speculative()
+    {
+        while (!speculative_order.empty())
+        {
+            bid_type bid = speculative_order.front();
+            speculative_order.pop_front();
+            if (speculative.find(bid) != speculative.end())
+            {
+                STXXL_VERBOSE2("prefetch_pool::reclaim_speculative bid=" << bid);
+                invalidate(bid);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! Issues a read-ahead, only using free blocks.
+    void hint_speculative(const bid_type & bid, write_pool<block_type> * w_pool)
+    {
+        if (!free_blocks_size || in_prefetching(bid))
+            return;
+
+        if (w_pool)
+            hint(bid, *w_pool);
+        else
+            hint(bid);
+
+        speculative[bid] = true;
+        speculative_order.push_back(bid);
+        ++m_stats.readahead;
+    }
+
+    //! Invalidates the outstanding read-ahead blocks of a stream.
+    void drop_readahead(const stream_type & s)
+    {
+        if (s.stride == 0)
+            return;
+        for (int64 offset = s.last_offset + s.stride; offset != s.ahead_offset; offset += s.stride)
+        {
+            bid_type bid(s.storage, offset);
+            if (speculative.find(bid) != speculative.end())
+                invalidate(bid);
+        }
+    }
+
+    //! Matches a read() to a stream and reads ahead along it.
+    //! \param late whether the block was read ahead but had not arrived yet
+    void detect_stream(const bid_type & bid, write_pool<block_type> * w_pool, bool late)
+    {
+        double now = timestamp();
+        stream_type * s = NULL;
+
+        // continuation of a trained stream?
+        for (unsigned_type i = 0; i < streams.size(); ++i)
+        {
+            stream_type & t = streams[i];
+            if (t.storage == bid.storage && t.stride != 0 && t.last_offset + t.stride == bid.offset)
+            {
+                s = &t;
+                ++s->confirmed;
+                break;
+            }
+        }
+
+        if (!s)
+        {
+            // train the nearest untrained stream on the same file
+            int64 best = max_stride + 1;
+            for (unsigned_type i = 0; i < streams.size(); ++i)
+            {
+                stream_type & t = streams[i];
+                int64 dist = bid.offset - t.last_offset;
+                if (t.storage != bid.storage || t.confirmed != 0 || dist == 0)
+                    continue;
+                dist = (dist < 0) ? -dist : dist;
+                if (dist < best) {
+                    best = dist;
+                    s = &t;
+                }
+            }
+
+            if (s)
+            {
+                s->stride = bid.offset - s->last_offset;
+                s->ahead_offset = bid.offset + s->stride;
+                s->confirmed = 1;
+                s->late = 0;
+            }
+            else
+            {
+                // start a new stream, replacing the least recently used
+                if (streams.size() < max_streams) {
+                    streams.push_back(stream_type());
+                    s = &streams.back();
+                }
+                else {
+                    s = &streams[0];
+                    for (unsigned_type i = 1; i < streams.size(); ++i)
+                        if (streams[i].last_use < s->last_use)
+                            s = &streams[i];
+                    drop_readahead(*s);
+                }
+                s->storage = bid.storage;
+                s->stride = 0;
+                s->ahead_offset = 0;
+                s->file_size = 0;
+                s->confirmed = 0;
+                s->late = 0;
+                s->interval = 0;
+                s->last_time = now;
+            }
+        }
+
+        // a late arrival of a read-ahead block means the window is too small
+        if (late && s->late < max_readahead)
+            ++s->late;
+
+        s->interval = (s->interval == 0) ? (now - s->last_time)
+                      : 0.75 * s->interval + 0.25 * (now - s->last_time);
+        s->last_time = now;
+        s->last_offset = bid.offset;
+        s->last_use = ++use_counter;
+
+        if (s->stride == 0)
+            return;
+
+        // window from Little's law: blocks in flight = latency / interval
+        unsigned_type window = max_readahead;
+        stats * st = stats::get_instance();
+        if (st->get_reads() > 0 && s->interval > 0)
+        {
+            double latency = st->get_read_time() / double(st->get_reads());
+            window = unsigned_type(std::ceil(latency / s->interval)) + 1 + s->late;
+        }
+        window = STXXL_MIN(STXXL_MAX<unsigned_type>(window, 1), max_readahead);
+
+        if (s->stride > 0 ? (s->ahead_offset < bid.offset + s->stride)
+                          : (s->ahead_offset > bid.offset + s->stride))
+            s->ahead_offset = bid.offset + s->stride;
+        int64 window_end = bid.offset + int64(window + 1) * s->stride;
+
+        // never read ahead beyond the end of the file; the size is looked up
+        // again only when the stream reaches the cached bound
+        if (s->stride > 0 && s->ahead_offset + int64(block_type::raw_size) > s->file_size)
+            s->file_size = bid.storage->size();
+
+        while ((s->stride > 0 ? s->ahead_offset < window_end : s->ahead_offset > window_end) &&
+               s->ahead_offset >= 0 &&
+               (s->stride < 0 || s->ahead_offset + int64(block_type::raw_size) <= s->file_size) &&
+               free_blocks_size > 0)
+        {
+            hint_speculative(bid_type(bid.storage, s->ahead_offset), w_pool);
+            s->ahead_offset += s->stride;
+        }
+    }
 };
 
 //! \}
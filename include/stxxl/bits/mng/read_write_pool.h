@@ -110,6 +110,19 @@ public:
         return result;
     }
 
+    //! Enables deferred, combined writing in the write pool,
+    //! see write_pool::set_write_combining().
+    void set_write_combining(size_type high_water)
+    {
+        w_pool->set_write_combining(high_water);
+    }
+
+    //! Submits all deferred writes of the write pool.
+    void flush()
+    {
+        w_pool->flush();
+    }
+
     //! Take out a block from the pool.
     //! \return pointer to the block. Ownership of the block goes to the caller.
     block_type * steal()
@@ -151,6 +164,20 @@ public:
     {
         return p_pool->read(block, bid, *w_pool);
     }
+
+    //! Enables automatic read-ahead in the prefetch pool,
+    //! see prefetch_pool::set_readahead().
+    void set_readahead(unsigned_type max_window, unsigned_type streams = 8,
+                       unsigned_type stride_limit = 64)
+    {
+        p_pool->set_readahead(max_window, streams, stride_limit);
+    }
+
+    //! Returns the hit, miss and read-ahead counters of the prefetch pool.
+    const prefetch_pool_stats & get_prefetch_stats() const
+    {
+        return p_pool->get_stats();
+    }
 };
 
 //! \}
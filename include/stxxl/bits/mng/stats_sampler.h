@@ -0,0 +1,137 @@
+/***************************************************************************
+ *  include/stxxl/bits/mng/stats_sampler.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_MNG_STATS_SAMPLER_HEADER
+#define STXXL_MNG_STATS_SAMPLER_HEADER
+
+#include <map>
+#include <string>
+#include <ostream>
+
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread/thread.hpp>
+#elif STXXL_POSIX_THREADS
+ #include <pthread.h>
+#else
+ #error "Thread implementation not detected."
+#endif
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/io/iostats.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+class block_manager;
+
+//! \addtogroup mnglayer
+//! \{
+
+//! \brief Writes machine-readable snapshots of the I/O statistics in the background.
+//!
+//! A thread takes a snapshot of \c stats, of the per-queue statistics and of
+//! the block manager's allocation counters every \c interval seconds and
+//! writes it to a file or to a local socket, and a final one when the
+//! sampler is destroyed. Besides the totals, each snapshot contains the
+//! bandwidth, IOPS, utilization and latency percentiles of the last
+//! interval.
+//!
+//! The target is a file name or \c unix:<path> for a Unix domain stream
+//! socket that some monitoring process listens on. In \c JSON_LINES format
+//! every snapshot is one JSON object on a line of its own, appended to the
+//! file. In \c PROMETHEUS text exposition format a file is replaced
+//! atomically by the latest snapshot (for the textfile collector of the
+//! node exporter), while snapshots sent to a socket are separated by empty
+//! lines.
+//!
+//! The block manager starts a sampler by itself if the environment variable
+//! \c STXXLSTATSFILE names a target; \c STXXLSTATSINTERVAL sets the
+//! interval (default 1 s) and \c STXXLSTATSFORMAT the format (\c json or
+//! \c prometheus, the default is \c prometheus for file names ending in
+//! \c .prom and \c json otherwise).
+class stats_sampler : private noncopyable
+{
+public:
+    enum format_type { JSON_LINES, PROMETHEUS };
+
+private:
+#if STXXL_STD_THREADS
+    typedef std::thread * thread_type;
+#elif STXXL_BOOST_THREADS
+    typedef boost::thread * thread_type;
+#else
+    typedef pthread_t thread_type;
+#endif
+
+    std::string target;
+    double interval;
+    format_type format;
+    const block_manager * bm;
+
+    thread_type worker;
+    mutex stop_mutex;
+    bool stop_requested;
+
+    //! serializes sample()
+    mutable mutex sample_mutex;
+    stats_data last;
+    std::map<int, disk_stats_data> last_disks;
+    unsigned_type samples_written;
+
+    int socket_fd;
+    //! an error is reported once until the target works again
+    bool socket_error_reported, file_error_reported;
+
+    static void * worker_main(void * arg);
+    void run();
+    bool stopping();
+
+    void write_json(std::ostream & o, const stats_data & total, const stats_data & diff,
+                    const std::map<int, disk_stats_data> & disks);
+    void write_prometheus(std::ostream & o, const stats_data & total, const stats_data & diff,
+                          const std::map<int, disk_stats_data> & disks);
+    void output(const std::string & text);
+
+public:
+    //! \brief Starts sampling.
+    //! \param target_ file name, or \c unix:<path> for a Unix domain socket
+    //! \param interval_ seconds between two snapshots
+    //! \param format_ output format
+    //! \param bm_ block manager whose allocation is reported, NULL for the global one
+    stats_sampler(const std::string & target_, double interval_ = 1.0,
+                  format_type format_ = JSON_LINES, const block_manager * bm_ = NULL);
+
+    //! Stops the thread and writes a final snapshot.
+    ~stats_sampler();
+
+    //! Writes a snapshot now.
+    void sample();
+
+    //! Number of snapshots written so far.
+    unsigned_type get_samples_written() const;
+
+    //! Creates a sampler as configured by the \c STXXLSTATSFILE,
+    //! \c STXXLSTATSINTERVAL and \c STXXLSTATSFORMAT environment variables,
+    //! or returns NULL if \c STXXLSTATSFILE is not set.
+    static stats_sampler * from_environment(const block_manager * bm_ = NULL);
+};
+
+//! \}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_MNG_STATS_SAMPLER_HEADER
+// vim: et:ts=4:sw=4
@@ -264,25 +264,29 @@ public:
     /*! Writes block to the disk(s).
      *! \param bid block identifier, points the file(disk) and position
      *! \param on_cmpl completion handler
+     *! \param prio priority class of the request in the disk queue
      *! \return \c pointer_ptr object to track status I/O operation after the call
      */
     request_ptr write(const bid_type & bid,
-                      completion_handler on_cmpl = default_completion_handler())
+                      completion_handler on_cmpl = default_completion_handler(),
+                      request::request_priority prio = request::WRITEBACK)
     {
         STXXL_VERBOSE_BLOCK_LIFE_CYCLE("BLC:write  " << FMT_BID(bid));
-        return bid.storage->awrite(this, bid.offset, raw_size, on_cmpl);
+        return bid.storage->awrite(this, bid.offset, raw_size, on_cmpl, prio);
     }
 
     /*! Reads block from the disk(s).
      *! \param bid block identifier, points the file(disk) and position
      *! \param on_cmpl completion handler
+     *! \param prio priority class of the request in the disk queue
      *! \return \c pointer_ptr object to track status I/O operation after the call
      */
     request_ptr read(const bid_type & bid,
-                     completion_handler on_cmpl = default_completion_handler())
+                     completion_handler on_cmpl = default_completion_handler(),
+                     request::request_priority prio = request::DEMAND)
     {
         STXXL_VERBOSE_BLOCK_LIFE_CYCLE("BLC:read   " << FMT_BID(bid));
-        return bid.storage->aread(this, bid.offset, raw_size, on_cmpl);
+        return bid.storage->aread(this, bid.offset, raw_size, on_cmpl, prio);
     }
 
     static void * operator new (size_t bytes)
@@ -15,6 +15,8 @@
 #define STXXL_WRITE_POOL_HEADER
 
 #include <list>
+#include <vector>
+#include <algorithm>
 #include <stxxl/bits/config.h>
 #include <stxxl/bits/noncopyable.h>
 #include <stxxl/bits/deprecated.h>
@@ -30,6 +32,15 @@ __STXXL_BEGIN_NAMESPACE
 
 
 //! Implements dynamically resizable buffered writing pool.
+//!
+//! By default every block handed to write() is written immediately. With
+//! set_write_combining() the writes are deferred instead: pending blocks are
+//! collected until a high-water mark is reached, a free block is needed or
+//! flush() is called, and are then submitted as one batch sorted by file and
+//! offset, so that scattered writes become mostly sequential. Pending blocks
+//! are still found by has_request() and steal_request(), and a block that is
+//! overwritten while pending is not written at all. The blocks of pending
+//! writes must not be deallocated before the pool has been flushed.
 template <class BlockType>
 class write_pool : private noncopyable
 {
@@ -59,11 +70,25 @@ protected:
     std::list<block_type *> free_blocks;
     // blocks that are in writing
     std::list<busy_entry> busy_blocks;
+    // blocks whose write is deferred, their req is not yet valid
+    std::list<busy_entry> pending_blocks;
+    // number of pending blocks that triggers a flush, 0 = no deferral
+    unsigned_type combine_high_water;
+
+    //! orders pending writes by file and offset
+    struct pending_order
+    {
+        bool operator () (const busy_entry * a, const busy_entry * b) const
+        {
+            return (a->bid.storage < b->bid.storage) ||
+                   (a->bid.storage == b->bid.storage && a->bid.offset < b->bid.offset);
+        }
+    };
 
 public:
     //! Constructs pool.
     //! \param init_size initial number of blocks in the pool
-    explicit write_pool(unsigned_type init_size = 1)
+    explicit write_pool(unsigned_type init_size = 1) : combine_high_water(0)
     {
         for (unsigned_type i = 0; i < init_size; ++i)
         {
@@ -76,13 +101,23 @@ public:
     {
         std::swap(free_blocks, obj.free_blocks);
         std::swap(busy_blocks, obj.busy_blocks);
+        std::swap(pending_blocks, obj.pending_blocks);
+        std::swap(combine_high_water, obj.combine_high_water);
     }
 
     //! Waits for completion of all ongoing write requests and frees memory.
     virtual ~write_pool()
     {
         STXXL_VERBOSE_WPOOL("::~write_pool free_blocks.size()=" << free_blocks.size() <<
-                            " busy_blocks.size()=" << busy_blocks.size());
+                            " busy_blocks.size()=" << busy_blocks.size() <<
+                            " pending_blocks.size()=" << pending_blocks.size());
+        try
+        {
+            flush();
+        }
+        catch (...)
+        { }
+
         while (!free_blocks.empty())
         {
             STXXL_VERBOSE_WPOOL("  delete free block=" << free_blocks.back());
@@ -107,17 +142,62 @@ public:
     }
 
     //! Returns number of owned blocks.
-    unsigned_type size() const { return free_blocks.size() + busy_blocks.size(); }
+    unsigned_type size() const
+    { return free_blocks.size() + busy_blocks.size() + pending_blocks.size(); }
+
+    //! Returns number of blocks whose write is deferred.
+    unsigned_type size_pending() const { return pending_blocks.size(); }
+
+    //! Enables deferred, combined writing.
+    //! \param high_water number of pending blocks that are submitted together,
+    //!        0 switches back to immediate writing
+    void set_write_combining(unsigned_type high_water)
+    {
+        combine_high_water = high_water;
+        if (pending_blocks.size() >= combine_high_water)
+            flush();
+    }
+
+    //! Submits all pending writes, sorted by file and offset.
+    void flush()
+    {
+        if (pending_blocks.empty())
+            return;
+
+        STXXL_VERBOSE_WPOOL("::flush : submitting " << pending_blocks.size() << " pending blocks");
+
+        std::vector<busy_entry *> order;
+        order.reserve(pending_blocks.size());
+        for (busy_blocks_iterator i2 = pending_blocks.begin(); i2 != pending_blocks.end(); ++i2)
+            order.push_back(&*i2);
+        std::sort(order.begin(), order.end(), pending_order());
+
+        for (typename std::vector<busy_entry *>::iterator it = order.begin(); it != order.end(); ++it)
+            (*it)->req = (*it)->block->write((*it)->bid);
+
+        busy_blocks.splice(busy_blocks.end(), pending_blocks);
+    }
 
     //! Passes a block to the pool for writing.
     //! \param block block to write. Ownership of the block goes to the pool.
     //! \c block must be allocated dynamically with using \c new .
     //! \param bid location, where to write
     //! \warning \c block must be allocated dynamically with using \c new .
-    //! \return request object of the write operation
+    //! \return request object of the write operation, which is invalid if
+    //! the write was deferred by write combining
     request_ptr write(block_type * & block, bid_type bid)
     {
         STXXL_VERBOSE_WPOOL("::write: " << block << " @ " << bid);
+        for (busy_blocks_iterator i2 = pending_blocks.begin(); i2 != pending_blocks.end(); ++i2)
+        {
+            if (i2->bid == bid) {
+                assert(i2->block != block);
+                STXXL_VERBOSE_WPOOL("WAW dependency on pending block, dropping it");
+                free_blocks.push_back(i2->block);
+                pending_blocks.erase(i2);
+                break;
+            }
+        }
         for (busy_blocks_iterator i2 = busy_blocks.begin(); i2 != busy_blocks.end(); ++i2)
         {
             if (i2->bid == bid) {
@@ -130,8 +210,18 @@ public:
                 i2->bid.storage = 0;
             }
         }
-        request_ptr result = block->write(bid);
-        busy_blocks.push_back(busy_entry(block, result, bid));
+        request_ptr result;
+        if (combine_high_water)
+        {
+            pending_blocks.push_back(busy_entry(block, result, bid));
+            if (pending_blocks.size() >= combine_high_water)
+                flush();
+        }
+        else
+        {
+            result = block->write(bid);
+            busy_blocks.push_back(busy_entry(block, result, bid));
+        }
         block = NULL; // prevent caller from using the block any further
         return result;
     }
@@ -149,6 +239,7 @@ public:
             return p;
         }
         STXXL_VERBOSE_WPOOL("::steal : all " << busy_blocks.size() << " are busy");
+        flush();
         busy_blocks_iterator completed = wait_any(busy_blocks.begin(), busy_blocks.end());
         assert(completed != busy_blocks.end()); // we got something reasonable from wait_any
         assert(completed->req->poll());         // and it is *really* completed
@@ -187,6 +278,7 @@ public:
 
     _STXXL_DEPRECATED(request_ptr get_request(bid_type bid))
     {
+        submit_pending(bid);
         busy_blocks_iterator i2 = busy_blocks.begin();
         for ( ; i2 != busy_blocks.end(); ++i2)
         {
@@ -203,11 +295,17 @@ public:
             if (i2->bid == bid)
                 return true;
         }
+        for (busy_blocks_iterator i2 = pending_blocks.begin(); i2 != pending_blocks.end(); ++i2)
+        {
+            if (i2->bid == bid)
+                return true;
+        }
         return false;
     }
 
     _STXXL_DEPRECATED(block_type * steal(bid_type bid))
     {
+        submit_pending(bid);
         busy_blocks_iterator i2 = busy_blocks.begin();
         for ( ; i2 != busy_blocks.end(); ++i2)
         {
@@ -225,6 +323,8 @@ public:
     // returns a block and a (potentially unfinished) I/O request associated with it
     std::pair<block_type *, request_ptr> steal_request(bid_type bid)
     {
+        // a pending block is written now, it is handed over like a busy one
+        submit_pending(bid);
         for (busy_blocks_iterator i2 = busy_blocks.begin(); i2 != busy_blocks.end(); ++i2)
         {
             if (i2->bid == bid)
@@ -252,6 +352,20 @@ public:
     }
 
 protected:
+    //! Submits the pending write of bid ahead of the others, if any.
+    void submit_pending(const bid_type & bid)
+    {
+        for (busy_blocks_iterator i2 = pending_blocks.begin(); i2 != pending_blocks.end(); ++i2)
+        {
+            if (i2->bid == bid)
+            {
+                i2->req = i2->block->write(i2->bid);
+                busy_blocks.splice(busy_blocks.end(), pending_blocks, i2);
+                return;
+            }
+        }
+    }
+
     void check_all_busy()
     {
         busy_blocks_iterator cur = busy_blocks.begin();
@@ -140,6 +140,34 @@ inline bool do_parallel_merge()
 #endif
 }
 
+//! Limits the number of threads used by parallel sorting and merging
+//! within a scope; 0 keeps the current setting. A no-op without parallel mode.
+class scoped_thread_budget
+{
+#if STXXL_PARALLEL && defined(STXXL_PARALLEL_MODE)
+    int saved;
+#endif
+
+public:
+    explicit scoped_thread_budget(unsigned num_threads)
+    {
+#if STXXL_PARALLEL && defined(STXXL_PARALLEL_MODE)
+        saved = omp_get_max_threads();
+        if (num_threads > 0)
+            omp_set_num_threads(int(num_threads));
+#else
+        (void)num_threads;
+#endif
+    }
+
+    ~scoped_thread_budget()
+    {
+#if STXXL_PARALLEL && defined(STXXL_PARALLEL_MODE)
+        omp_set_num_threads(saved);
+#endif
+    }
+};
+
 
 namespace potentially_parallel
 {
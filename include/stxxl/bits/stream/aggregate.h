@@ -0,0 +1,237 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/aggregate.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__AGGREGATE_H
+#define STXXL_STREAM__AGGREGATE_H
+
+#include <vector>
+#include <algorithm>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/compat_hash_map.h>
+#include <stxxl/bits/compat_unique_ptr.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/stream/sort_stream.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    ////////////////////////////////////////////////////////////////////////
+    //     AGGREGATE                                                      //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Group-by with early aggregation: combines all elements with equal keys.
+    //!
+    //! Elements are reduced in an in-memory hash table. Whenever the table
+    //! exceeds half of the memory budget, its partial aggregates are pushed
+    //! into a \c runs_creator and the table is emptied; at the end the runs
+    //! are merged and partial aggregates with equal keys are combined in the
+    //! merge. Only the partially aggregated volume is written to disk, which
+    //! is much smaller than the input if there are few distinct keys.
+    //!
+    //! The output contains one element per distinct key and is sorted by
+    //! \c Compare_ in both cases.
+    //!
+    //! \tparam Input_ type of the input stream
+    //! \tparam KeyExtract_ functor with typedef \c key_type, extracting keys from the input
+    //! \tparam Reducer_ functor combining two elements with equal keys into one,
+    //! must be associative and commutative
+    //! \tparam Compare_ comparison object of the elements ordering them by key,
+    //! with \c min_value() and \c max_value() as required by \c runs_creator;
+    //! elements are equivalent if neither compares less than the other
+    //! \tparam BlockSize_ size of blocks used to store the runs
+    //! \tparam AllocStr_ allocation strategy for the runs
+    //! \tparam Hash_ hash function of the keys
+    template <class Input_,
+              class KeyExtract_,
+              class Reducer_,
+              class Compare_,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY,
+              class Hash_ = typename compat_hash<typename KeyExtract_::key_type>::result>
+    class aggregate : private noncopyable
+    {
+    public:
+        //! Standard stream typedef.
+        typedef typename Input_::value_type value_type;
+        typedef typename KeyExtract_::key_type key_type;
+
+    private:
+        typedef runs_creator<use_push<value_type>, Compare_, BlockSize_, AllocStr_> runs_creator_type;
+        typedef typename runs_creator_type::sorted_runs_type sorted_runs_type;
+        typedef runs_merger<sorted_runs_type, Compare_, AllocStr_> runs_merger_type;
+        typedef typename compat_hash_map<key_type, value_type, Hash_>::result table_type;
+
+        Input_ & input;
+        KeyExtract_ key;
+        Reducer_ reduce;
+        Compare_ cmp;
+        unsigned_type memory_to_use;
+
+        unsigned_type max_entries;      // distinct keys held in the table
+        table_type table;
+        typename compat_unique_ptr<runs_creator_type>::result creator;
+        typename compat_unique_ptr<runs_merger_type>::result merger;
+
+        std::vector<value_type> result; // sorted table contents if nothing was spilled
+        unsigned_type result_pos;
+
+        value_type current;
+        bool m_empty;
+        stxxl::uint64 elements_read, elements_spilled, spills;
+
+        void spill()
+        {
+            if (!creator.get())
+                creator.reset(new runs_creator_type(cmp, memory_to_use / 2));
+            for (typename table_type::const_iterator it = table.begin(); it != table.end(); ++it)
+                creator->push(it->second);
+            elements_spilled += table.size();
+            ++spills;
+            table.clear();
+        }
+
+        void consume_input()
+        {
+            for ( ; !input.empty(); ++input)
+            {
+                const value_type & v = *input;
+                ++elements_read;
+                std::pair<typename table_type::iterator, bool> res =
+                    table.insert(std::make_pair(key(v), v));
+                if (!res.second)
+                    res.first->second = reduce(res.first->second, v);
+                else if (UNLIKELY(table.size() >= max_entries))
+                    spill();
+            }
+        }
+
+        void fetch_next()
+        {
+            if (merger.get())
+            {
+                m_empty = merger->empty();
+                if (m_empty)
+                    return;
+                current = **merger;
+                ++(*merger);
+                // equivalent under the comparator, as the runs were ordered by it
+                while (!merger->empty() && !cmp(current, **merger) && !cmp(**merger, current))
+                {
+                    current = reduce(current, **merger);
+                    ++(*merger);
+                }
+            }
+            else
+            {
+                m_empty = (result_pos == result.size());
+                if (!m_empty)
+                    current = result[result_pos++];
+            }
+        }
+
+    public:
+        //! \brief Consumes the whole input and prepares the first result element.
+        //! \param input_ input stream
+        //! \param key_ key extractor
+        //! \param reduce_ reducer of elements with equal keys
+        //! \param cmp_ comparison object ordering the elements by key
+        //! \param memory_to_use_ memory budget in bytes, half of it for the hash table
+        aggregate(Input_ & input_, KeyExtract_ key_, Reducer_ reduce_, Compare_ cmp_,
+                  unsigned_type memory_to_use_) :
+            input(input_),
+            key(key_),
+            reduce(reduce_),
+            cmp(cmp_),
+            memory_to_use(memory_to_use_),
+            result_pos(0),
+            m_empty(true),
+            elements_read(0),
+            elements_spilled(0),
+            spills(0)
+        {
+            // rough per-entry cost of a node based hash table
+            const unsigned_type entry_bytes = sizeof(key_type) + sizeof(value_type) + 4 * sizeof(void *);
+            max_entries = STXXL_MAX<unsigned_type>(memory_to_use / 2 / entry_bytes, 1);
+
+            consume_input();
+            if (creator.get())
+            {
+                spill();
+                table_type().swap(table);
+                sorted_runs_type runs = creator->result();
+                creator.reset();
+                merger.reset(new runs_merger_type(runs, cmp, memory_to_use));
+            }
+            else
+            {
+                result.reserve(table.size());
+                for (typename table_type::const_iterator it = table.begin(); it != table.end(); ++it)
+                    result.push_back(it->second);
+                table_type().swap(table);
+                std::sort(result.begin(), result.end(), cmp);
+            }
+            fetch_next();
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            assert(!m_empty);
+            return current;
+        }
+
+        const value_type * operator -> () const
+        {
+            return &(operator * ());
+        }
+
+        //! Standard stream method.
+        aggregate & operator ++ ()
+        {
+            assert(!m_empty);
+            fetch_next();
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return m_empty;
+        }
+
+        //! Number of input elements consumed.
+        stxxl::uint64 get_elements_read() const
+        {
+            return elements_read;
+        }
+
+        //! Number of partial aggregates written to sorted runs, 0 if the table fit into memory.
+        stxxl::uint64 get_elements_spilled() const
+        {
+            return elements_spilled;
+        }
+
+        //! Number of times the hash table was spilled.
+        stxxl::uint64 get_spills() const
+        {
+            return spills;
+        }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__AGGREGATE_H
+// vim: et:ts=4:sw=4
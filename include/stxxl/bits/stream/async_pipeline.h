@@ -0,0 +1,301 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/async_pipeline.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__ASYNC_PIPELINE_H
+#define STXXL_STREAM__ASYNC_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread/thread.hpp>
+ #include <boost/bind.hpp>
+#elif STXXL_POSIX_THREADS
+ #include <pthread.h>
+#else
+ #error "Thread implementation not detected."
+#endif
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/semaphore.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/simple_vector.h>
+#include <stxxl/bits/common/types.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/mng/mng.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    ////////////////////////////////////////////////////////////////////////
+    //     ASYNC_PIPELINE                                                 //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Decouples a stream from its consumer by pulling it in a separate thread.
+    //!
+    //! The upstream \c Input is evaluated by a worker thread, which copies
+    //! batches of elements into a bounded ring of buffers; the consumer reads
+    //! from the buffers. A CPU-bound upstream (e.g. \c transform) and a
+    //! downstream doing I/O (e.g. \c runs_creator) thereby overlap. The worker
+    //! blocks when all buffers are full, so at most \c num_batches batches are
+    //! ahead of the consumer.
+    //!
+    //! \c Input must not be accessed by anyone else while the async_pipeline
+    //! exists. An exception thrown by \c Input is rethrown by the consumer as
+    //! \c std::runtime_error once it reaches the failed batch.
+    //! \tparam Input type of the input stream
+    template <class Input>
+    class async_pipeline : private noncopyable
+    {
+    public:
+        //! Standard stream typedef.
+        typedef typename Input::value_type value_type;
+
+    private:
+#if STXXL_STD_THREADS
+        typedef std::thread * thread_type;
+#elif STXXL_BOOST_THREADS
+        typedef boost::thread * thread_type;
+#else
+        typedef pthread_t thread_type;
+#endif
+
+        Input & input;
+        unsigned_type num_batches, batch_size;
+        simple_vector<value_type> buffer;
+        //! number of elements in each batch, written by the worker
+        simple_vector<unsigned_type> batch_fill;
+        //! whether the batch is the last one, written by the worker
+        simple_vector<bool> batch_last;
+
+        semaphore free_batches, full_batches;
+        thread_type worker;
+
+        mutex flags_mutex;
+        bool stop_requested;    // protected by flags_mutex
+        std::string error;      // written before the failed batch is published
+
+        // consumer state
+        unsigned_type current_batch;
+        const value_type * current, * current_end;
+        bool finished;
+
+        bool stop_requested_locked()
+        {
+            scoped_mutex_lock lock(flags_mutex);
+            return stop_requested;
+        }
+
+        void produce()
+        {
+            bool last = false;
+            for (unsigned_type b = 0; !last; b = (b + 1) % num_batches)
+            {
+                free_batches--;
+                if (stop_requested_locked())
+                    break;
+
+                value_type * out = buffer.begin() + b * batch_size;
+                unsigned_type n = 0;
+                try
+                {
+                    while (n < batch_size && !input.empty())
+                    {
+                        out[n++] = *input;
+                        ++input;
+                    }
+                    last = input.empty();
+                }
+                catch (std::exception & e)
+                {
+                    error = e.what();
+                    last = true;
+                }
+                catch (...)
+                {
+                    error = "unknown exception in async_pipeline input";
+                    last = true;
+                }
+                batch_fill[b] = n;
+                batch_last[b] = last;
+                full_batches++;
+            }
+        }
+
+        static void * worker_main(void * arg)
+        {
+            static_cast<async_pipeline *>(arg)->produce();
+            return NULL;
+        }
+
+        void start_worker()
+        {
+#if STXXL_STD_THREADS
+            worker = new std::thread(worker_main, this);
+#elif STXXL_BOOST_THREADS
+            worker = new boost::thread(boost::bind(worker_main, this));
+#else
+            check_pthread_call(pthread_create(&worker, NULL, worker_main, this));
+#endif
+        }
+
+        void join_worker()
+        {
+#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+            worker->join();
+            delete worker;
+            worker = NULL;
+#else
+            check_pthread_call(pthread_join(worker, NULL));
+#endif
+        }
+
+        void stop_worker()
+        {
+            {
+                scoped_mutex_lock lock(flags_mutex);
+                stop_requested = true;
+            }
+            // wake the worker if it waits for a free batch
+            free_batches++;
+            join_worker();
+        }
+
+        //! Take the next batch from the worker, skipping empty ones.
+        void next_batch()
+        {
+            while (current == current_end && !finished)
+            {
+                full_batches--;
+                const unsigned_type b = current_batch;
+                current = buffer.begin() + b * batch_size;
+                current_end = current + batch_fill[b];
+                finished = batch_last[b];
+                current_batch = (b + 1) % num_batches;
+                if (finished && !error.empty())
+                    throw std::runtime_error(error);
+                if (current == current_end)
+                    free_batches++;
+            }
+        }
+
+    public:
+        //! \brief Start pulling \c input in a separate thread.
+        //! \param input_ input stream, evaluated by the worker thread only
+        //! \param num_batches_ number of batches the worker may run ahead
+        //! \param batch_size_ elements per batch, default fills one block
+        async_pipeline(Input & input_,
+                       unsigned_type num_batches_ = 4,
+                       unsigned_type batch_size_ = STXXL_DEFAULT_BLOCK_SIZE(value_type) / sizeof(value_type)) :
+            input(input_),
+            num_batches(STXXL_MAX<unsigned_type>(num_batches_, 2)),
+            batch_size(STXXL_MAX<unsigned_type>(batch_size_, 1)),
+            buffer(num_batches * batch_size),
+            batch_fill(num_batches),
+            batch_last(num_batches),
+            free_batches(int(num_batches)),
+            full_batches(0),
+            stop_requested(false),
+            current_batch(0),
+            current(NULL),
+            current_end(NULL),
+            finished(false)
+        {
+            start_worker();
+            try
+            {
+                next_batch();
+            }
+            catch (...)
+            {
+                stop_worker();
+                throw;
+            }
+        }
+
+        //! Stops the worker if the stream has not been consumed completely.
+        ~async_pipeline()
+        {
+            stop_worker();
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            return *current;
+        }
+
+        const value_type * operator -> () const
+        {
+            return current;
+        }
+
+        //! Standard stream method.
+        async_pipeline & operator ++ ()
+        {
+            assert(!empty());
+            if (++current == current_end && !finished)
+            {
+                free_batches++;
+                next_batch();
+            }
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return current == current_end;
+        }
+
+        //! Batch interface marker.
+        typedef void batch_capable;
+
+        //! Batch interface: number of elements left in the current batch.
+        unsigned_type batch_length() const
+        {
+            return current_end - current;
+        }
+
+        //! Batch interface: the current element, followed by batch_length() - 1 others.
+        const value_type * batch_begin() const
+        {
+            return current;
+        }
+
+        //! Batch interface: skip \c n <= batch_length() elements.
+        async_pipeline & operator += (unsigned_type n)
+        {
+            assert(n <= batch_length());
+            current += n;
+            if (current == current_end && !finished)
+            {
+                free_batches++;
+                next_batch();
+            }
+            return *this;
+        }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__ASYNC_PIPELINE_H
+// vim: et:ts=4:sw=4
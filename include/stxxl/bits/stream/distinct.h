@@ -0,0 +1,426 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/distinct.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__DISTINCT_H
+#define STXXL_STREAM__DISTINCT_H
+
+#include <vector>
+#include <utility>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/compat_hash_map.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/common/hyperloglog.h>
+#include <stxxl/bits/stream/spill_partitions.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    //! \brief Estimates the number of distinct elements of a stream with a HyperLogLog sketch.
+    //!
+    //! Consumes \c in. Intended as a pre-pass over a re-readable input (e.g.
+    //! a vector) whose result is passed to \c hash_distinct or \c hash_count.
+    template <class Input_, class Hash_>
+    stxxl::uint64 estimate_distinct(Input_ & in, Hash_ hash, unsigned precision = 12)
+    {
+        hyperloglog sketch(precision);
+        for ( ; !in.empty(); ++in)
+            sketch.insert(stxxl::uint64(hash(*in)));
+        return stxxl::uint64(sketch.estimate());
+    }
+
+    //! \brief Estimates the number of distinct elements of a stream using the default hash.
+    template <class Input_>
+    stxxl::uint64 estimate_distinct(Input_ & in)
+    {
+        return estimate_distinct(in, typename compat_hash<typename Input_::value_type>::result());
+    }
+
+    namespace distinct_local
+    {
+        //! Element type of the output and of spilled partitions.
+        template <class ValueType, bool Counting>
+        struct record
+        {
+            typedef ValueType type;
+
+            static type make(const ValueType & v, stxxl::uint64)
+            {
+                return v;
+            }
+
+            static const ValueType & value(const type & r)
+            {
+                return r;
+            }
+
+            static stxxl::uint64 count(const type &)
+            {
+                return 1;
+            }
+        };
+
+        template <class ValueType>
+        struct record<ValueType, true>
+        {
+            typedef std::pair<ValueType, stxxl::uint64> type;
+
+            static type make(const ValueType & v, stxxl::uint64 c)
+            {
+                return type(v, c);
+            }
+
+            static const ValueType & value(const type & r)
+            {
+                return r.first;
+            }
+
+            static stxxl::uint64 count(const type & r)
+            {
+                return r.second;
+            }
+        };
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    //     BASIC_HASH_DISTINCT                                            //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Removes duplicates from an unsorted stream by hashing.
+    //!
+    //! Elements are collected in an in-memory hash table. If the table
+    //! exceeds the memory budget, its contents and the rest of the input are
+    //! hash partitioned to disk (\c spill_partitions) and the partitions are
+    //! deduplicated one after another. A partition that still has too many
+    //! distinct elements is partitioned again with a different hash, so the
+    //! operator needs one partition pass for inputs with up to about
+    //! (memory / block size) times more distinct elements than fit into
+    //! memory. If the number of distinct elements is known or estimated in
+    //! advance (see \c estimate_distinct), the input is partitioned right away
+    //! into enough partitions instead of filling the table first.
+    //!
+    //! Re-partitioning only remixes the hash values, so it cannot separate
+    //! elements with equal hashes. If a re-partitioning leaves all elements of
+    //! a partition in one part, or after \c max_spill_level levels, the part
+    //! is deduplicated in filter passes instead: each pass keeps a table full
+    //! of distinct elements, emits it and spills only the elements not in the
+    //! table for the next pass.
+    //!
+    //! The output order is unspecified. Use \c hash_distinct or \c hash_count.
+    //!
+    //! \tparam Input_ type of the input stream
+    //! \tparam Counting_ emit pairs (value, multiplicity) instead of values
+    //! \tparam Hash_ hash function of the elements
+    //! \tparam BlockSize_ size of the blocks used for spilling partitions
+    //! \tparam AllocStr_ allocation strategy for spilled blocks
+    template <class Input_,
+              bool Counting_,
+              class Hash_,
+              unsigned BlockSize_,
+              class AllocStr_>
+    class basic_hash_distinct : private noncopyable
+    {
+        typedef typename Input_::value_type input_value_type;
+        typedef distinct_local::record<input_value_type, Counting_> record_traits;
+
+    public:
+        //! Standard stream typedef.
+        typedef typename record_traits::type value_type;
+
+    private:
+        typedef spill_partitions<value_type, BlockSize_, AllocStr_> spill_type;
+        typedef typename spill_type::reader reader_type;
+        typedef typename compat_hash_map<input_value_type, stxxl::uint64, Hash_>::result table_type;
+
+        //! re-partitionings of a partition before switching to filter passes
+        static const unsigned_type max_spill_level = 16;
+
+        Input_ & input;
+        Hash_ hash;
+        unsigned_type max_entries;              // distinct elements held in the table
+        unsigned_type max_partitions;           // partitions whose buffers fit into memory
+
+        table_type table;
+        typename table_type::const_iterator pos;
+
+        std::vector<spill_type *> spills;       // partition sets, owned
+        std::vector<unsigned_type> spill_level; // hash seed of each set
+        std::vector<bool> spill_filtered;       // set is deduplicated by filter passes
+        //! partitions still to be deduplicated: (partition set, partition)
+        std::vector<std::pair<unsigned_type, unsigned_type> > pending;
+
+        value_type current;
+        bool m_empty;
+        stxxl::uint64 elements_read, blocks_written;
+
+        unsigned_type partition_of(const input_value_type & v, unsigned_type s) const
+        {
+            const stxxl::uint64 h = hyperloglog::mix(stxxl::uint64(hash(v)) ^
+                                                     (stxxl::uint64(spill_level[s] + 1) * 0x9E3779B97F4A7C15ull));
+            return unsigned_type(h % spills[s]->size());
+        }
+
+        void add(const input_value_type & v, stxxl::uint64 count)
+        {
+            std::pair<typename table_type::iterator, bool> res = table.insert(std::make_pair(v, count));
+            if (!res.second)
+                res.first->second += count;
+        }
+
+        //! Creates a partition set for about \c distinct distinct elements and moves the table into it.
+        unsigned_type start_partitioning(stxxl::uint64 distinct, unsigned_type level)
+        {
+            // some slack for estimation errors and uneven partitions
+            const stxxl::uint64 wanted = div_ceil(distinct + distinct / 4, max_entries);
+            const unsigned_type num_parts = unsigned_type(STXXL_MAX<stxxl::uint64>(
+                                                              STXXL_MIN<stxxl::uint64>(wanted, max_partitions), 2));
+            STXXL_VERBOSE1("hash_distinct: partitioning about " << distinct << " distinct elements into "
+                                                                << num_parts << " partitions at level " << level);
+            const unsigned_type s = spills.size();
+            spills.push_back(new spill_type(num_parts));
+            spill_level.push_back(level);
+            spill_filtered.push_back(level >= max_spill_level);
+            for (typename table_type::const_iterator it = table.begin(); it != table.end(); ++it)
+                spills[s]->push(partition_of(it->first, s), record_traits::make(it->first, it->second));
+            table.clear();
+            return s;
+        }
+
+        void finish_partitioning(unsigned_type s)
+        {
+            spills[s]->finish();
+            blocks_written += spills[s]->get_blocks_written();
+            for (unsigned_type p = spills[s]->size(); p > 0; --p)
+                if (spills[s]->elements(p - 1) > 0)
+                    pending.push_back(std::make_pair(s, p - 1));
+        }
+
+        //! Reads pending partitions until one fits into the table.
+        void load_partition()
+        {
+            while (!pending.empty())
+            {
+                const unsigned_type s = pending.back().first, p = pending.back().second;
+                pending.pop_back();
+                table.clear();
+                {
+                    reader_type reader(*spills[s], p);
+                    while (!reader.empty() && table.size() <= max_entries)
+                    {
+                        add(record_traits::value(*reader), record_traits::count(*reader));
+                        ++reader;
+                    }
+                    if (!reader.empty() && spill_filtered[s])
+                    {
+                        // the table is full: count what it holds, spill the rest
+                        const unsigned_type t = spills.size();
+                        spills.push_back(new spill_type(1));
+                        spill_level.push_back(spill_level[s]);
+                        spill_filtered.push_back(true);
+                        for ( ; !reader.empty(); ++reader)
+                        {
+                            typename table_type::iterator it = table.find(record_traits::value(*reader));
+                            if (it != table.end())
+                                it->second += record_traits::count(*reader);
+                            else
+                                spills[t]->push(0, *reader);
+                        }
+                        finish_partitioning(t);
+                    }
+                    else if (!reader.empty())
+                    {
+                        const unsigned_type t = start_partitioning(spills[s]->elements(p), spill_level[s] + 1);
+                        for ( ; !reader.empty(); ++reader)
+                            spills[t]->push(partition_of(record_traits::value(*reader), t), *reader);
+                        spills[s]->clear(p);
+                        finish_partitioning(t);
+                        // equal hashes stay together however they are remixed
+                        stxxl::uint64 total = 0, largest = 0;
+                        for (unsigned_type q = 0; q < spills[t]->size(); ++q)
+                        {
+                            total += spills[t]->elements(q);
+                            largest = STXXL_MAX(largest, spills[t]->elements(q));
+                        }
+                        spill_filtered[t] = spill_filtered[t] || largest == total;
+                        continue;
+                    }
+                }
+                spills[s]->clear(p);
+                pos = table.begin();
+                return;
+            }
+            table.clear();
+            pos = table.end();
+        }
+
+        void fetch_next()
+        {
+            if (pos == table.end())
+                load_partition();
+            m_empty = (pos == table.end());
+            if (m_empty)
+                return;
+            current = record_traits::make(pos->first, pos->second);
+            ++pos;
+        }
+
+    public:
+        //! \brief Consumes the whole input and prepares the first result element.
+        //! \param input_ input stream
+        //! \param memory_to_use memory for the hash table and the partition buffers in bytes
+        //! \param distinct_estimate expected number of distinct elements, 0 if unknown
+        //! \param hash_ hash function
+        basic_hash_distinct(Input_ & input_, unsigned_type memory_to_use,
+                            stxxl::uint64 distinct_estimate = 0, Hash_ hash_ = Hash_()) :
+            input(input_),
+            hash(hash_),
+            m_empty(true),
+            elements_read(0),
+            blocks_written(0)
+        {
+            // element, counter and roughly a hash node per entry
+            const unsigned_type entry_bytes = sizeof(input_value_type) + sizeof(stxxl::uint64) + 3 * sizeof(void *);
+            max_entries = STXXL_MAX<unsigned_type>(memory_to_use / 2 / entry_bytes, 1);
+            max_partitions = STXXL_MAX<unsigned_type>(memory_to_use / 2 / sizeof(typename spill_type::block_type), 2);
+
+            if (distinct_estimate > max_entries)
+            {
+                const unsigned_type s = start_partitioning(distinct_estimate, 0);
+                for ( ; !input.empty(); ++input, ++elements_read)
+                    spills[s]->push(partition_of(*input, s), record_traits::make(*input, 1));
+                finish_partitioning(s);
+                pos = table.end();
+            }
+            else
+            {
+                for ( ; !input.empty() && table.size() <= max_entries; ++input, ++elements_read)
+                    add(*input, 1);
+                if (!input.empty())
+                {
+                    // nothing known about the rest, use as many partitions as possible
+                    const unsigned_type s = start_partitioning(stxxl::uint64(max_entries) * max_partitions, 0);
+                    for ( ; !input.empty(); ++input, ++elements_read)
+                        spills[s]->push(partition_of(*input, s), record_traits::make(*input, 1));
+                    finish_partitioning(s);
+                    pos = table.end();
+                }
+                else
+                    pos = table.begin();
+            }
+            fetch_next();
+        }
+
+        //! Deletes all partitions still held.
+        ~basic_hash_distinct()
+        {
+            for (unsigned_type s = 0; s < spills.size(); ++s)
+                delete spills[s];
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            assert(!m_empty);
+            return current;
+        }
+
+        const value_type * operator -> () const
+        {
+            return &(operator * ());
+        }
+
+        //! Standard stream method.
+        basic_hash_distinct & operator ++ ()
+        {
+            assert(!m_empty);
+            fetch_next();
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return m_empty;
+        }
+
+        //! Number of input elements consumed.
+        stxxl::uint64 get_elements_read() const
+        {
+            return elements_read;
+        }
+
+        //! Number of partition sets created, 0 if the input fit into memory.
+        unsigned_type get_partitionings() const
+        {
+            return spills.size();
+        }
+
+        //! Number of blocks written while partitioning.
+        stxxl::uint64 get_blocks_written() const
+        {
+            return blocks_written;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////
+    //     HASH_DISTINCT                                                  //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Emits every distinct element of an unsorted stream once, in unspecified order.
+    //!
+    //! Unlike \c unique the input need not be sorted. See \c basic_hash_distinct.
+    template <class Input_,
+              class Hash_ = typename compat_hash<typename Input_::value_type>::result,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY>
+    class hash_distinct : public basic_hash_distinct<Input_, false, Hash_, BlockSize_, AllocStr_>
+    {
+        typedef basic_hash_distinct<Input_, false, Hash_, BlockSize_, AllocStr_> base;
+
+    public:
+        //! \copydoc basic_hash_distinct::basic_hash_distinct
+        hash_distinct(Input_ & input_, unsigned_type memory_to_use,
+                      stxxl::uint64 distinct_estimate = 0, Hash_ hash_ = Hash_()) :
+            base(input_, memory_to_use, distinct_estimate, hash_)
+        { }
+    };
+
+    ////////////////////////////////////////////////////////////////////////
+    //     HASH_COUNT                                                     //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Emits a pair (value, multiplicity) for every distinct element of an unsorted stream.
+    //!
+    //! The order is unspecified. See \c basic_hash_distinct.
+    template <class Input_,
+              class Hash_ = typename compat_hash<typename Input_::value_type>::result,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY>
+    class hash_count : public basic_hash_distinct<Input_, true, Hash_, BlockSize_, AllocStr_>
+    {
+        typedef basic_hash_distinct<Input_, true, Hash_, BlockSize_, AllocStr_> base;
+
+    public:
+        //! \copydoc basic_hash_distinct::basic_hash_distinct
+        hash_count(Input_ & input_, unsigned_type memory_to_use,
+                   stxxl::uint64 distinct_estimate = 0, Hash_ hash_ = Hash_()) :
+            base(input_, memory_to_use, distinct_estimate, hash_)
+        { }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__DISTINCT_H
+// vim: et:ts=4:sw=4
@@ -0,0 +1,516 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/join.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__JOIN_H
+#define STXXL_STREAM__JOIN_H
+
+#include <ostream>
+#include <vector>
+#include <functional>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/compat_hash_map.h>
+#include <stxxl/bits/compat_unique_ptr.h>
+#include <stxxl/bits/common/tuple.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/stream/spill_partitions.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    //! Counters of a join operator.
+    struct join_stats
+    {
+        stxxl::uint64 left;             //!< elements read from the first input
+        stxxl::uint64 right;            //!< elements read from the second input
+        stxxl::uint64 matches;          //!< result tuples produced
+        unsigned_type partitions;       //!< number of partitions spilled to disk, 0 if none
+        stxxl::uint64 blocks_written;   //!< blocks written while spilling
+        stxxl::uint64 blocks_read;      //!< blocks read back from spilled partitions
+
+        join_stats() :
+            left(0), right(0), matches(0), partitions(0),
+            blocks_written(0), blocks_read(0)
+        { }
+    };
+
+    inline std::ostream & operator << (std::ostream & o, const join_stats & s)
+    {
+        o << "join: " << s.left << " x " << s.right << " elements, "
+          << s.matches << " matches, " << s.partitions << " partitions, "
+          << s.blocks_written << " blocks written, " << s.blocks_read << " blocks read";
+        return o;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    //     MERGE_JOIN                                                     //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Equi-join of two streams sorted by their keys.
+    //!
+    //! Produces a tuple (left, right) for every pair of elements with equal
+    //! keys, ordered by key and then by the position in the left input. All
+    //! elements of the right input with the current key are buffered; if such
+    //! a group exceeds the memory budget, its remainder is spilled to disk and
+    //! read once for every matching left element.
+    //!
+    //! \tparam Input1_ type of the left input, sorted by \c KeyExtract1_
+    //! \tparam Input2_ type of the right input, sorted by \c KeyExtract2_
+    //! \tparam KeyExtract1_ functor with typedef \c key_type, extracting keys from the left input
+    //! \tparam KeyExtract2_ functor returning the same key type for the right input
+    //! \tparam Compare_ strict weak ordering of the keys, both inputs are sorted by it
+    template <class Input1_,
+              class Input2_,
+              class KeyExtract1_,
+              class KeyExtract2_,
+              class Compare_ = std::less<typename KeyExtract1_::key_type> >
+    class merge_join : private noncopyable
+    {
+    public:
+        typedef typename Input1_::value_type left_type;
+        typedef typename Input2_::value_type right_type;
+        typedef typename KeyExtract1_::key_type key_type;
+        //! Standard stream typedef.
+        typedef tuple<left_type, right_type> value_type;
+
+    private:
+        typedef spill_partitions<right_type> spill_type;
+        typedef typename spill_type::reader spill_reader_type;
+
+        Input1_ & in1;
+        Input2_ & in2;
+        KeyExtract1_ key1;
+        KeyExtract2_ key2;
+        Compare_ cmp;
+
+        unsigned_type group_limit;              // elements of a group kept in memory
+        std::vector<right_type> group;          // right elements with group_key
+        typename compat_unique_ptr<spill_type>::result group_spill;
+        typename compat_unique_ptr<spill_reader_type>::result spill_reader;
+        key_type group_key;
+        unsigned_type group_pos;                // next in-memory element to pair
+        bool have_left;                         // *in1 is being paired with the group
+
+        value_type current;
+        bool m_empty;
+        join_stats stats;
+
+        bool equal(const key_type & a, const key_type & b) const
+        {
+            return !cmp(a, b) && !cmp(b, a);
+        }
+
+        void clear_group()
+        {
+            group.clear();
+            spill_reader.reset();
+            if (group_spill.get())
+                stats.blocks_written += group_spill->get_blocks_written();
+            group_spill.reset();
+        }
+
+        //! Reads all right elements equal to key k.
+        void load_group(const key_type & k)
+        {
+            clear_group();
+            while (!in2.empty() && !cmp(k, key2(*in2)))
+            {
+                if (group.size() < group_limit)
+                    group.push_back(*in2);
+                else
+                {
+                    if (!group_spill.get())
+                        group_spill.reset(new spill_type(1));
+                    group_spill->push(0, *in2);
+                }
+                ++in2;
+                ++stats.right;
+            }
+            if (group_spill.get())
+                group_spill->finish();
+            group_key = k;
+        }
+
+        //! Starts pairing the current left element with the group.
+        void start_left()
+        {
+            group_pos = 0;
+            have_left = true;
+            if (group_spill.get())
+            {
+                spill_reader.reset(new spill_reader_type(*group_spill, 0));
+                stats.blocks_read += div_ceil(group_spill->elements(0), spill_type::block_type::size);
+            }
+        }
+
+        void find_next()
+        {
+            while (true)
+            {
+                if (have_left)
+                {
+                    if (group_pos < group.size())
+                    {
+                        current = value_type(*in1, group[group_pos++]);
+                        ++stats.matches;
+                        return;
+                    }
+                    if (spill_reader.get() && !spill_reader->empty())
+                    {
+                        current = value_type(*in1, **spill_reader);
+                        ++(*spill_reader);
+                        ++stats.matches;
+                        return;
+                    }
+                    ++in1;
+                    have_left = false;
+                }
+                if (in1.empty())
+                    break;
+                ++stats.left;
+                const key_type k = key1(*in1);
+                if (!group.empty() && equal(k, group_key))
+                {
+                    start_left();
+                    continue;
+                }
+                // skip smaller keys of the right input
+                while (!in2.empty() && cmp(key2(*in2), k))
+                {
+                    ++in2;
+                    ++stats.right;
+                }
+                if (in2.empty())
+                    break;
+                if (cmp(k, key2(*in2)))
+                {
+                    ++in1;      // no partner
+                    continue;
+                }
+                load_group(k);
+                start_left();
+            }
+            m_empty = true;
+            clear_group();
+        }
+
+    public:
+        //! \brief Construction.
+        //! \param in1_ left input
+        //! \param in2_ right input
+        //! \param key1_ key extractor of the left input
+        //! \param key2_ key extractor of the right input
+        //! \param memory_to_use memory for buffering a group of equal right keys in bytes
+        //! \param cmp_ comparator of the keys
+        merge_join(Input1_ & in1_, Input2_ & in2_, KeyExtract1_ key1_, KeyExtract2_ key2_,
+                   unsigned_type memory_to_use = 16 * 1024 * 1024, Compare_ cmp_ = Compare_()) :
+            in1(in1_), in2(in2_), key1(key1_), key2(key2_), cmp(cmp_),
+            group_limit(STXXL_MAX<unsigned_type>(memory_to_use / sizeof(right_type), 1)),
+            group_spill(static_cast<spill_type *>(NULL)),
+            spill_reader(static_cast<spill_reader_type *>(NULL)),
+            group_pos(0),
+            have_left(false),
+            m_empty(false)
+        {
+            find_next();
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            return current;
+        }
+
+        const value_type * operator -> () const
+        {
+            return &current;
+        }
+
+        //! Standard stream method.
+        merge_join & operator ++ ()
+        {
+            assert(!empty());
+            find_next();
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return m_empty;
+        }
+
+        //! Counters, elements are counted when consumed from the inputs.
+        const join_stats & get_stats() const
+        {
+            return stats;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////
+    //     HASH_JOIN                                                      //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Equi-join of two unsorted streams by hashing (grace hash join).
+    //!
+    //! The first (build) input is read into an in-memory hash table; the
+    //! second (probe) input is then streamed and produces a tuple (build,
+    //! probe) for every build element with the same key. If the build input
+    //! exceeds the memory budget, both inputs are hash-partitioned to disk
+    //! through the block manager and the partitions are joined one by one.
+    //! A single partition is assumed to fit into memory; a heavily skewed key
+    //! distribution may exceed the budget.
+    //!
+    //! The build input is consumed by the constructor, in partitioned mode
+    //! also the probe input.
+    //!
+    //! \tparam Input1_ type of the build input (the smaller one)
+    //! \tparam Input2_ type of the probe input
+    //! \tparam KeyExtract1_ functor with typedef \c key_type, extracting keys from the build input
+    //! \tparam KeyExtract2_ functor returning the same key type for the probe input
+    //! \tparam BlockSize_ size of the blocks used for spilling partitions
+    //! \tparam AllocStr_ allocation strategy for spilled blocks
+    //! \tparam Hash_ hash function of the keys
+    template <class Input1_,
+              class Input2_,
+              class KeyExtract1_,
+              class KeyExtract2_,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input1_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY,
+              class Hash_ = typename compat_hash<typename KeyExtract1_::key_type>::result>
+    class hash_join : private noncopyable
+    {
+    public:
+        typedef typename Input1_::value_type build_type;
+        typedef typename Input2_::value_type probe_type;
+        typedef typename KeyExtract1_::key_type key_type;
+        //! Standard stream typedef.
+        typedef tuple<build_type, probe_type> value_type;
+
+    private:
+        typedef spill_partitions<build_type, BlockSize_, AllocStr_> build_spill_type;
+        typedef spill_partitions<probe_type, BlockSize_, AllocStr_> probe_spill_type;
+        typedef typename build_spill_type::reader build_reader_type;
+        typedef typename probe_spill_type::reader probe_reader_type;
+        typedef typename compat_hash_map<key_type, int_type, Hash_>::result table_type;
+
+        Input1_ & in1;
+        Input2_ & in2;
+        KeyExtract1_ key1;
+        KeyExtract2_ key2;
+        Hash_ hash;
+
+        unsigned_type max_build;                // build elements held in memory
+        std::vector<build_type> build;
+        std::vector<int_type> chain;            // next build element with the same key, or -1
+        table_type table;                       // key -> last build element with the key
+
+        typename compat_unique_ptr<build_spill_type>::result build_parts;
+        typename compat_unique_ptr<probe_spill_type>::result probe_parts;
+        typename compat_unique_ptr<probe_reader_type>::result probe_reader;
+        unsigned_type partition;                // partition being joined
+
+        probe_type probe;                       // element being matched
+        int_type match;                         // next build element for probe, or -1
+        value_type current;
+        bool m_empty;
+        join_stats stats;
+
+        unsigned_type partition_of(const key_type & k) const
+        {
+            // decorrelate from the bucket selection of the hash table
+            stxxl::uint64 h = stxxl::uint64(hash(k)) * 0x9E3779B97F4A7C15ull;
+            return unsigned_type((h >> 32) % build_parts->size());
+        }
+
+        void build_table()
+        {
+            table.clear();
+            chain.resize(build.size());
+            for (unsigned_type i = 0; i < build.size(); ++i)
+            {
+                std::pair<typename table_type::iterator, bool> res =
+                    table.insert(std::make_pair(key1(build[i]), int_type(i)));
+                if (res.second)
+                    chain[i] = -1;
+                else
+                {
+                    chain[i] = res.first->second;
+                    res.first->second = int_type(i);
+                }
+            }
+        }
+
+        void partition_inputs()
+        {
+            const unsigned_type block_bytes = sizeof(typename build_spill_type::block_type);
+            // enough partitions so that each fits into memory, within the
+            // memory available for the write buffers
+            unsigned_type num_parts = STXXL_MAX<unsigned_type>(
+                STXXL_MIN<unsigned_type>(max_build * sizeof(build_type) / block_bytes / 2, 1024), 2);
+            build_parts.reset(new build_spill_type(num_parts));
+            for (unsigned_type i = 0; i < build.size(); ++i)
+                build_parts->push(partition_of(key1(build[i])), build[i]);
+            std::vector<build_type>().swap(build);
+            for ( ; !in1.empty(); ++in1, ++stats.left)
+                build_parts->push(partition_of(key1(*in1)), *in1);
+            build_parts->finish();
+
+            probe_parts.reset(new probe_spill_type(num_parts));
+            for ( ; !in2.empty(); ++in2, ++stats.right)
+                probe_parts->push(partition_of(key2(*in2)), *in2);
+            probe_parts->finish();
+
+            stats.partitions = num_parts;
+            stats.blocks_written = build_parts->get_blocks_written() + probe_parts->get_blocks_written();
+        }
+
+        //! Loads the build side of \c partition and opens its probe side.
+        void load_partition()
+        {
+            typedef typename build_spill_type::block_type build_block_type;
+            typedef typename probe_spill_type::block_type probe_block_type;
+
+            build.clear();
+            {
+                build_reader_type reader(*build_parts, partition);
+                for ( ; !reader.empty(); ++reader)
+                    build.push_back(*reader);
+            }
+            build_parts->clear(partition);
+            build_table();
+            probe_reader.reset(new probe_reader_type(*probe_parts, partition));
+            stats.blocks_read += div_ceil(build.size(), build_block_type::size)
+                                 + div_ceil(probe_parts->elements(partition), probe_block_type::size);
+        }
+
+        bool probe_empty() const
+        {
+            return build_parts.get() ? probe_reader->empty() : in2.empty();
+        }
+
+        const probe_type & probe_current() const
+        {
+            return build_parts.get() ? **probe_reader : *in2;
+        }
+
+        void probe_next()
+        {
+            if (build_parts.get())
+                ++(*probe_reader);
+            else
+            {
+                ++in2;
+                ++stats.right;
+            }
+        }
+
+        void find_next()
+        {
+            while (match < 0)
+            {
+                while (probe_empty())
+                {
+                    if (!build_parts.get() || partition + 1 >= build_parts->size())
+                    {
+                        m_empty = true;
+                        return;
+                    }
+                    probe_reader.reset();
+                    probe_parts->clear(partition);
+                    ++partition;
+                    load_partition();
+                }
+                probe = probe_current();
+                probe_next();
+                typename table_type::const_iterator it = table.find(key2(probe));
+                if (it != table.end())
+                    match = it->second;
+            }
+            current = value_type(build[match], probe);
+            match = chain[match];
+            ++stats.matches;
+        }
+
+    public:
+        //! \brief Construction, reads the build input.
+        //! \param in1_ build input
+        //! \param in2_ probe input
+        //! \param key1_ key extractor of the build input
+        //! \param key2_ key extractor of the probe input
+        //! \param memory_to_use memory for the hash table or the partition buffers in bytes
+        hash_join(Input1_ & in1_, Input2_ & in2_, KeyExtract1_ key1_, KeyExtract2_ key2_,
+                  unsigned_type memory_to_use) :
+            in1(in1_), in2(in2_), key1(key1_), key2(key2_),
+            // value, chain entry and roughly a hash node per element
+            max_build(STXXL_MAX<unsigned_type>(memory_to_use / (sizeof(build_type) + sizeof(int_type) +
+                                                                sizeof(key_type) + 3 * sizeof(void *)), 1)),
+            build_parts(static_cast<build_spill_type *>(NULL)),
+            probe_parts(static_cast<probe_spill_type *>(NULL)),
+            probe_reader(static_cast<probe_reader_type *>(NULL)),
+            partition(0),
+            match(-1),
+            m_empty(false)
+        {
+            for ( ; !in1.empty() && build.size() < max_build; ++in1, ++stats.left)
+                build.push_back(*in1);
+
+            if (in1.empty())
+                build_table();
+            else
+            {
+                STXXL_VERBOSE1("hash_join: build input exceeds " << max_build << " elements, partitioning");
+                partition_inputs();
+                load_partition();
+            }
+            find_next();
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            return current;
+        }
+
+        const value_type * operator -> () const
+        {
+            return &current;
+        }
+
+        //! Standard stream method.
+        hash_join & operator ++ ()
+        {
+            assert(!empty());
+            find_next();
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return m_empty;
+        }
+
+        //! Counters of elements, matches and spilled blocks.
+        const join_stats & get_stats() const
+        {
+            return stats;
+        }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__JOIN_H
+// vim: et:ts=4:sw=4
@@ -0,0 +1,294 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/shuffle.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__SHUFFLE_H
+#define STXXL_STREAM__SHUFFLE_H
+
+#include <vector>
+#include <utility>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/parallel.h>
+#include <stxxl/bits/verbose.h>
+#include <stxxl/bits/common/rand.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/stream/spill_partitions.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    namespace shuffle_local
+    {
+        template <class KeyedType>
+        struct key_less
+        {
+            bool operator () (const KeyedType & a, const KeyedType & b) const
+            {
+                return a.first < b.first;
+            }
+        };
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    //     SHUFFLE                                                        //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Random permutation of a stream.
+    //!
+    //! If the input fits into memory, it is shuffled there. Otherwise every
+    //! element is sent to a random partition on disk (\c spill_partitions)
+    //! and the partitions are shuffled one after another in memory; a
+    //! partition that is still too large is partitioned again. With a
+    //! partition fan-out of (memory / 2 / block size), one pass suffices for
+    //! inputs of up to about (memory / 2)^2 / block size bytes.
+    //!
+    //! All random numbers come from counter-based generators
+    //! (\c random_number_counter): the partition of the i-th element and the
+    //! order within a partition only depend on the seed, so the result is
+    //! reproducible and does not depend on the number of threads. In
+    //! parallel mode the random numbers are drawn by all threads and the
+    //! in-memory shuffles are parallel sorts by random keys; the partition
+    //! buffers are written asynchronously by the write pool of
+    //! \c spill_partitions.
+    //!
+    //! \tparam Input_ type of the input stream
+    //! \tparam BlockSize_ size of the blocks used for the partitions
+    //! \tparam AllocStr_ allocation strategy for the partitions
+    template <class Input_,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY>
+    class shuffle : private noncopyable
+    {
+    public:
+        //! Standard stream typedef.
+        typedef typename Input_::value_type value_type;
+
+    private:
+        typedef spill_partitions<value_type, BlockSize_, AllocStr_> spill_type;
+        typedef typename spill_type::reader reader_type;
+        //! random key or partition number, and the element
+        typedef std::pair<stxxl::uint64, value_type> keyed_type;
+
+        Input_ & input;
+        stxxl::uint64 seed;
+        unsigned_type capacity;                 // elements held in memory
+        unsigned_type max_partitions;           // partitions whose buffers fit into memory
+
+        std::vector<keyed_type> buffer;
+        unsigned_type pos;
+
+        std::vector<spill_type *> spills;       // partition sets, owned
+        std::vector<unsigned_type> spill_level;
+        std::vector<stxxl::uint64> spill_pushed; // elements distributed into each set
+        //! partitions still to be shuffled: (partition set, partition)
+        std::vector<std::pair<unsigned_type, unsigned_type> > pending;
+
+        stxxl::uint64 elements_read, blocks_written;
+
+        //! Random number generator of partition set \c s, or of partition \c p of it.
+        random_number_counter rng(unsigned_type s, unsigned_type p) const
+        {
+            return random_number_counter(seed, (stxxl::uint64(s) << 32) + p);
+        }
+
+        //! Sends the buffered elements to random partitions of set \c s.
+        void distribute(unsigned_type s)
+        {
+            const random_number_counter r = rng(s + 1, 0);
+            const stxxl::uint64 first = spill_pushed[s];
+            const stxxl::uint64 parts = spills[s]->size();
+            const stxxl::int64 n = buffer.size();
+#if STXXL_PARALLEL
+            #pragma omp parallel for
+#endif
+            for (stxxl::int64 j = 0; j < n; ++j)
+                buffer[j].first = r.at(first + j) % parts;
+            for (stxxl::int64 j = 0; j < n; ++j)
+                spills[s]->push(unsigned_type(buffer[j].first), buffer[j].second);
+            spill_pushed[s] += n;
+            buffer.clear();
+        }
+
+        //! Orders the buffer randomly, the order only depends on the generator.
+        void shuffle_buffer(const random_number_counter & r)
+        {
+            const stxxl::int64 n = buffer.size();
+#if STXXL_PARALLEL
+            #pragma omp parallel for
+#endif
+            for (stxxl::int64 j = 0; j < n; ++j)
+                buffer[j].first = r.at(j);
+            potentially_parallel::sort(buffer.begin(), buffer.end(), shuffle_local::key_less<keyed_type>());
+            pos = 0;
+        }
+
+        //! Creates a partition set for about \c elements elements.
+        unsigned_type start_partitioning(stxxl::uint64 elements, unsigned_type level)
+        {
+            // some slack for uneven partitions
+            const stxxl::uint64 wanted = div_ceil(elements + elements / 4, capacity);
+            const unsigned_type num_parts = unsigned_type(STXXL_MAX<stxxl::uint64>(
+                                                              STXXL_MIN<stxxl::uint64>(wanted, max_partitions), 2));
+            STXXL_VERBOSE1("shuffle: distributing about " << elements << " elements into "
+                                                          << num_parts << " partitions at level " << level);
+            spills.push_back(new spill_type(num_parts));
+            spill_level.push_back(level);
+            spill_pushed.push_back(0);
+            return spills.size() - 1;
+        }
+
+        void finish_partitioning(unsigned_type s)
+        {
+            spills[s]->finish();
+            blocks_written += spills[s]->get_blocks_written();
+            for (unsigned_type p = spills[s]->size(); p > 0; --p)
+                if (spills[s]->elements(p - 1) > 0)
+                    pending.push_back(std::make_pair(s, p - 1));
+        }
+
+        //! Reads pending partitions until one fits into memory.
+        void load_partition()
+        {
+            buffer.clear();
+            pos = 0;
+            while (!pending.empty())
+            {
+                const unsigned_type s = pending.back().first, p = pending.back().second;
+                pending.pop_back();
+                {
+                    reader_type reader(*spills[s], p);
+                    if (spills[s]->elements(p) > capacity)
+                    {
+                        const unsigned_type t = start_partitioning(spills[s]->elements(p), spill_level[s] + 1);
+                        while (!reader.empty())
+                        {
+                            for ( ; !reader.empty() && buffer.size() < capacity; ++reader)
+                                buffer.push_back(keyed_type(0, *reader));
+                            distribute(t);
+                        }
+                        spills[s]->clear(p);
+                        finish_partitioning(t);
+                        continue;
+                    }
+                    for ( ; !reader.empty(); ++reader)
+                        buffer.push_back(keyed_type(0, *reader));
+                }
+                spills[s]->clear(p);
+                shuffle_buffer(rng(s + 1, p + 1));
+                return;
+            }
+        }
+
+    public:
+        //! \brief Consumes the whole input and prepares the first result element.
+        //! \param input_ input stream
+        //! \param memory_to_use memory for the in-memory shuffles and the partition buffers in bytes
+        //! \param seed_ seed of the random permutation, 0 takes one from \c get_next_seed()
+        //! \param size_estimate expected number of elements, 0 if unknown
+        shuffle(Input_ & input_, unsigned_type memory_to_use,
+                stxxl::uint64 seed_ = 0, stxxl::uint64 size_estimate = 0) :
+            input(input_),
+            seed(seed_ ? seed_ : get_next_seed()),
+            pos(0),
+            elements_read(0),
+            blocks_written(0)
+        {
+            capacity = STXXL_MAX<unsigned_type>(memory_to_use / 2 / sizeof(keyed_type), 1);
+            max_partitions = STXXL_MAX<unsigned_type>(memory_to_use / 2 / sizeof(typename spill_type::block_type), 2);
+
+            for ( ; !input.empty() && buffer.size() < capacity; ++input, ++elements_read)
+                buffer.push_back(keyed_type(0, *input));
+            if (input.empty())
+            {
+                shuffle_buffer(rng(0, 0));
+                return;
+            }
+
+            // nothing known about the rest without an estimate, use as many partitions as possible
+            const unsigned_type s = start_partitioning(
+                STXXL_MAX<stxxl::uint64>(size_estimate, stxxl::uint64(capacity) * max_partitions), 0);
+            while (!buffer.empty())
+            {
+                distribute(s);
+                for ( ; !input.empty() && buffer.size() < capacity; ++input, ++elements_read)
+                    buffer.push_back(keyed_type(0, *input));
+            }
+            finish_partitioning(s);
+            load_partition();
+        }
+
+        //! Deletes all partitions still held.
+        ~shuffle()
+        {
+            for (unsigned_type s = 0; s < spills.size(); ++s)
+                delete spills[s];
+        }
+
+        //! Standard stream method.
+        const value_type & operator * () const
+        {
+            assert(!empty());
+            return buffer[pos].second;
+        }
+
+        const value_type * operator -> () const
+        {
+            return &(operator * ());
+        }
+
+        //! Standard stream method.
+        shuffle & operator ++ ()
+        {
+            assert(!empty());
+            if (++pos == buffer.size())
+                load_partition();
+            return *this;
+        }
+
+        //! Standard stream method.
+        bool empty() const
+        {
+            return pos == buffer.size();
+        }
+
+        //! The seed of the permutation, shuffling the same input with it again gives the same result.
+        stxxl::uint64 get_seed() const
+        {
+            return seed;
+        }
+
+        //! Number of input elements consumed.
+        stxxl::uint64 get_elements_read() const
+        {
+            return elements_read;
+        }
+
+        //! Number of partition sets created, 0 if the input fit into memory.
+        unsigned_type get_partitionings() const
+        {
+            return spills.size();
+        }
+
+        //! Number of blocks written to the partitions.
+        stxxl::uint64 get_blocks_written() const
+        {
+            return blocks_written;
+        }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__SHUFFLE_H
+// vim: et:ts=4:sw=4
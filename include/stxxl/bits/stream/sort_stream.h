@@ -25,6 +25,7 @@
 #include <stxxl/bits/algo/run_cursor.h>
 #include <stxxl/bits/algo/losertree.h>
 #include <stxxl/bits/stream/sorted_runs.h>
+#include <stxxl/bits/common/trace.h>
 
 __STXXL_BEGIN_NAMESPACE
 
@@ -77,14 +78,15 @@ namespace stream
         //! Fetch data from input into blocks[first_idx,last_idx).
         unsigned_type fetch(block_type * blocks, unsigned_type first_idx, unsigned_type last_idx)
         {
-            typename element_iterator_traits<block_type>::element_iterator output =
-                make_element_iterator(blocks, first_idx);
             unsigned_type curr_idx = first_idx;
-            while (!m_input.empty() && curr_idx != last_idx) {
-                *output = *m_input;
-                ++m_input;
-                ++output;
-                ++curr_idx;
+            while (curr_idx != last_idx) {
+                // copy block by block, whole batches if the input supports it
+                const unsigned_type offset = curr_idx % block_type::size;
+                unsigned_type n = STXXL_MIN(last_idx - curr_idx, unsigned_type(block_type::size) - offset);
+                pull_batch(m_input, blocks[curr_idx / block_type::size].elem + offset, n);
+                if (n == 0)
+                    break;
+                curr_idx += n;
             }
             return curr_idx;
         }
@@ -107,6 +109,7 @@ namespace stream
         //! Sort a specific run, contained in a sequences of blocks.
         void sort_run(block_type * run, unsigned_type elements)
         {
+            scoped_trace trace("sort", "sort run", "elements", elements);
             check_sort_settings();
             potentially_parallel::sort(make_element_iterator(run, 0),
                                        make_element_iterator(run, elements),
@@ -161,6 +164,7 @@ namespace stream
         unsigned_type m2 = m_memsize / 2;
         const unsigned_type el_in_run = m2 * block_type::size; // # el in a run
         STXXL_VERBOSE1("basic_runs_creator::compute_result m2=" << m2);
+        scoped_trace trace("sort", "run formation");
         unsigned_type blocks1_length = 0, blocks2_length = 0;
         block_type * Blocks1 = NULL;
 
@@ -472,6 +476,7 @@ namespace stream
         //! Sort a specific run, contained in a sequences of blocks.
         void sort_run(block_type * run, unsigned_type elements)
         {
+            scoped_trace trace("sort", "sort run", "elements", elements);
             check_sort_settings();
             potentially_parallel::sort(make_element_iterator(run, 0),
                                        make_element_iterator(run, elements),
@@ -999,6 +1004,7 @@ namespace stream
         void fill_buffer_block()
         {
             STXXL_VERBOSE1("fill_buffer_block");
+            scoped_trace trace("sort", "merge block");
             if (do_parallel_merge())
             {
 #if STXXL_PARALLEL_MULTIWAY_MERGE
@@ -1353,6 +1359,8 @@ namespace stream
 
                 if (runs2merge > 1) // non-trivial merge
                 {
+                    scoped_trace trace("sort", "merge", "runs", runs2merge);
+
                     // count the number of elements in the run
                     size_type elements_in_new_run = 0;
                     for (unsigned_type i = nruns - runs_left; i < (nruns - runs_left + runs2merge); ++i)
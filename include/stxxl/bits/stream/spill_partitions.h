@@ -0,0 +1,227 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/spill_partitions.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__SPILL_PARTITIONS_H
+#define STXXL_STREAM__SPILL_PARTITIONS_H
+
+#include <vector>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/mng/mng.h>
+#include <stxxl/bits/mng/typed_block.h>
+#include <stxxl/bits/mng/buf_writer.h>
+#include <stxxl/bits/mng/buf_istream.h>
+#include <stxxl/bits/compat_unique_ptr.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    ////////////////////////////////////////////////////////////////////////
+    //     SPILL_PARTITIONS                                               //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief A set of external buckets written block-wise through the block manager.
+    //!
+    //! Used by operators that partition their input when it exceeds the
+    //! memory budget (e.g. \c hash_join). Each partition buffers one block;
+    //! full blocks are written by a shared \c buffered_writer. After finish()
+    //! every partition can be read (repeatedly) with a \c reader stream.
+    //! Memory usage: (num_partitions + write_buffers) blocks while writing.
+    //! \tparam ValueType type of the elements
+    //! \tparam BlockSize size of the blocks in bytes
+    //! \tparam AllocStr allocation strategy for the blocks
+    template <class ValueType,
+              unsigned BlockSize = STXXL_DEFAULT_BLOCK_SIZE(ValueType),
+              class AllocStr = STXXL_DEFAULT_ALLOC_STRATEGY>
+    class spill_partitions : private noncopyable
+    {
+    public:
+        typedef ValueType value_type;
+        typedef typed_block<BlockSize, value_type> block_type;
+        typedef typename block_type::bid_type bid_type;
+        typedef std::vector<bid_type> bid_vector_type;
+        typedef buffered_writer<block_type> writer_type;
+
+    private:
+        struct partition
+        {
+            bid_vector_type bids;
+            block_type * block;         // buffer in writer, NULL after finish()
+            unsigned_type fill;         // elements in block
+            stxxl::uint64 size;         // elements in total
+
+            partition() : block(NULL), fill(0), size(0) { }
+        };
+
+        std::vector<partition> parts;
+        writer_type * writer;
+        block_manager * bm;
+        AllocStr alloc;
+        stxxl::uint64 blocks_written;
+
+        void write_block(partition & pt)
+        {
+            bid_type bid;
+            bm->new_block(alloc, bid);
+            pt.bids.push_back(bid);
+            pt.block = writer->write(pt.block, bid);
+            pt.fill = 0;
+            ++blocks_written;
+        }
+
+    public:
+        //! \brief Create empty partitions.
+        //! \param num_partitions number of partitions
+        //! \param write_buffers additional blocks for overlapping writes,
+        //! 0 selects 2 * number of disks
+        spill_partitions(unsigned_type num_partitions, unsigned_type write_buffers = 0) :
+            parts(num_partitions),
+            bm(block_manager::get_instance()),
+            blocks_written(0)
+        {
+            if (write_buffers == 0)
+                write_buffers = 2 * config::get_instance()->disks_number();
+            write_buffers = STXXL_MAX<unsigned_type>(write_buffers, 2);
+            writer = new writer_type(num_partitions + write_buffers, write_buffers / 2);
+            for (unsigned_type i = 0; i < num_partitions; ++i)
+                parts[i].block = writer->get_free_block();
+        }
+
+        //! Deletes all blocks still held.
+        ~spill_partitions()
+        {
+            delete writer;
+            for (unsigned_type i = 0; i < parts.size(); ++i)
+                clear(i);
+        }
+
+        //! Number of partitions.
+        unsigned_type size() const
+        {
+            return parts.size();
+        }
+
+        //! Appends \c value to partition \c p.
+        void push(unsigned_type p, const value_type & value)
+        {
+            assert(p < parts.size() && writer);
+            partition & pt = parts[p];
+            pt.block->elem[pt.fill++] = value;
+            ++pt.size;
+            if (UNLIKELY(pt.fill == block_type::size))
+                write_block(pt);
+        }
+
+        //! Writes out all partially filled blocks and frees the write buffers.
+        void finish()
+        {
+            if (!writer)
+                return;
+            for (unsigned_type i = 0; i < parts.size(); ++i)
+            {
+                if (parts[i].fill > 0)
+                    write_block(parts[i]);
+                parts[i].block = NULL;
+            }
+            writer->flush();
+            delete writer;
+            writer = NULL;
+        }
+
+        //! Number of elements in partition \c p.
+        stxxl::uint64 elements(unsigned_type p) const
+        {
+            return parts[p].size;
+        }
+
+        //! Number of blocks written so far.
+        stxxl::uint64 get_blocks_written() const
+        {
+            return blocks_written;
+        }
+
+        //! Deletes the blocks of partition \c p, which must not be read any more.
+        void clear(unsigned_type p)
+        {
+            partition & pt = parts[p];
+            bm->delete_blocks(pt.bids.begin(), pt.bids.end());
+            pt.bids.clear();
+            pt.size = 0;
+        }
+
+        //! \brief Stream reading back one partition after finish().
+        class reader : private noncopyable
+        {
+            typedef buf_istream<block_type, typename bid_vector_type::const_iterator> buf_istream_type;
+            typedef typename stxxl::compat_unique_ptr<buf_istream_type>::result buf_istream_unique_ptr_type;
+
+            buf_istream_unique_ptr_type in;
+            stxxl::uint64 remaining;
+
+        public:
+            //! Standard stream typedef.
+            typedef ValueType value_type;
+
+            //! \param parts finished partitions
+            //! \param p partition to read
+            //! \param nbuffers number of prefetch buffers, 0 selects 2 * number of disks
+            reader(const spill_partitions & parts, unsigned_type p, unsigned_type nbuffers = 0) :
+                in(static_cast<buf_istream_type *>(NULL)),
+                remaining(parts.elements(p))
+            {
+                assert(!parts.writer);
+                if (remaining == 0)
+                    return;
+                const bid_vector_type & bids = parts.parts[p].bids;
+                in.reset(new buf_istream_type(bids.begin(), bids.end(),
+                                              nbuffers ? nbuffers : 2 * config::get_instance()->disks_number()));
+            }
+
+            //! Standard stream method.
+            const value_type & operator * () const
+            {
+                return **in;
+            }
+
+            const value_type * operator -> () const
+            {
+                return &(**in);
+            }
+
+            //! Standard stream method.
+            reader & operator ++ ()
+            {
+                assert(!empty());
+                if (--remaining == 0)
+                    in.reset();
+                else
+                    ++(*in);
+                return *this;
+            }
+
+            //! Standard stream method.
+            bool empty() const
+            {
+                return remaining == 0;
+            }
+        };
+
+        friend class reader;
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__SPILL_PARTITIONS_H
+// vim: et:ts=4:sw=4
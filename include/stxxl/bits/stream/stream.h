@@ -15,6 +15,9 @@
 #ifndef STXXL_STREAM_HEADER
 #define STXXL_STREAM_HEADER
 
+#include <limits>
+#include <algorithm>
+
 #include <stxxl/bits/namespace.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_ostream.h>
@@ -56,8 +59,95 @@ namespace stream
     //!    };
     //! \endverbatim
     //!
+    //! A stream may additionally offer the BATCH INTERFACE, which gives access
+    //! to elements that are contiguous in memory, e.g. the rest of a block.
+    //! Sinks like \c materialize and \c runs_creator then copy whole arrays
+    //! instead of pulling single elements:
+    //!
+    //! \verbatim
+    //!
+    //!      typedef void batch_capable;                  // marks the interface as available
+    //!      unsigned_type batch_length() const;          // number of contiguous elements, 0 iff empty()
+    //!      const value_type * batch_begin() const;      // the current element and those following it
+    //!      stream_algorithm & operator += (unsigned_type n); // skip n <= batch_length() elements
+    //!
+    //! \endverbatim
+    //!
     //! \{
 
+    ////////////////////////////////////////////////////////////////////////
+    //     BATCH INTERFACE                                                //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Determines whether \c Stream_ implements the batch interface.
+    template <class Stream_>
+    class is_batch_stream
+    {
+        typedef char yes_type;
+        typedef char (&no_type)[2];
+
+        template <class S>
+        static yes_type test(typename S::batch_capable *);
+        template <class S>
+        static no_type test(...);
+
+    public:
+        enum { value = (sizeof(test<Stream_>(0)) == sizeof(yes_type)) };
+    };
+
+    //! \internal element-wise copying for streams without batch interface
+    template <bool Batch_>
+    struct batch_puller
+    {
+        template <class Stream_, class OutputIterator_>
+        static OutputIterator_ pull(Stream_ & in, OutputIterator_ out, unsigned_type & n)
+        {
+            unsigned_type i = 0;
+            for ( ; i < n && !in.empty(); ++i)
+            {
+                *out = *in;
+                ++out;
+                ++in;
+            }
+            n = i;
+            return out;
+        }
+    };
+
+    //! \internal copying of whole batches
+    template <>
+    struct batch_puller<true>
+    {
+        template <class Stream_, class OutputIterator_>
+        static OutputIterator_ pull(Stream_ & in, OutputIterator_ out, unsigned_type & n)
+        {
+            unsigned_type i = 0;
+            while (i < n)
+            {
+                const unsigned_type length = STXXL_MIN(in.batch_length(), n - i);
+                if (length == 0)
+                    break;
+                const typename Stream_::value_type * begin = in.batch_begin();
+                out = std::copy(begin, begin + length, out);
+                in += length;
+                i += length;
+            }
+            n = i;
+            return out;
+        }
+    };
+
+    //! Copies up to \c n elements from a stream, using its batch interface if available.
+    //! \param in stream to read from
+    //! \param out output iterator used as destination
+    //! \param n maximum number of elements to copy, set to the number copied
+    //! \return value of the output iterator after all increments
+    template <class Stream_, class OutputIterator_>
+    OutputIterator_ pull_batch(Stream_ & in, OutputIterator_ out, unsigned_type & n)
+    {
+        return batch_puller<is_batch_stream<Stream_>::value>::pull(in, out, n);
+    }
+
 
     ////////////////////////////////////////////////////////////////////////
     //     STREAMIFY                                                      //
@@ -162,7 +252,8 @@ namespace stream
             if (end_iter - begin.bid() > 0)
             {
                 in.reset(new buf_istream_type(begin.bid(), end_iter, nbuffers ? nbuffers :
-                                              (2 * config::get_instance()->disks_number())));
+                                              (2 * config::get_instance()->disks_number()),
+                                              true));
 
                 InputIterator_ cur = begin - begin.block_offset();
 
@@ -203,6 +294,37 @@ namespace stream
         {
             return (current_ == end_);
         }
+
+        //! Batch interface marker.
+        typedef void batch_capable;
+
+        //! Batch interface: number of elements left in the current block.
+        unsigned_type batch_length() const
+        {
+            if (empty())
+                return 0;
+            return (unsigned_type)STXXL_MIN<typename InputIterator_::difference_type>(
+                in->batch_length(), end_ - current_);
+        }
+
+        //! Batch interface: the current element, followed by batch_length() - 1 others.
+        const value_type * batch_begin() const
+        {
+            return in->batch_begin();
+        }
+
+        //! Batch interface: skip \c n <= batch_length() elements.
+        Self_ & operator += (unsigned_type n)
+        {
+            assert(n <= batch_length());
+            current_ += n;
+            (*in) += n;
+            if (UNLIKELY(empty()))
+                delete_stream();
+
+            return *this;
+        }
+
         virtual ~vector_iterator2stream()
         {
             delete_stream();      // not needed actually
@@ -397,9 +519,8 @@ namespace stream
         STXXL_VERBOSE_MATERIALIZE(STXXL_PRETTY_FUNCTION_NAME);
         while (!in.empty())
         {
-            *out = *in;
-            ++out;
-            ++in;
+            unsigned_type n = std::numeric_limits<unsigned_type>::max();
+            out = pull_batch(in, out, n);
         }
         return out;
     }
@@ -487,10 +608,10 @@ namespace stream
                 }
             }
 
-            *outstream = *in;
-            ++outbegin;
-            ++outstream;
-            ++in;
+            unsigned_type n = STXXL_MIN<DiffTp_>(outstream.batch_length(), outend - outbegin);
+            pull_batch(in, outstream.batch_begin(), n);
+            outbegin += n;
+            outstream += n;
         }
 
         ConstExtIterator const_out = outbegin;
@@ -571,11 +692,10 @@ namespace stream
                 }
             }
 
-            // tells the vector that the block was modified
-            *outstream = *in;
-            ++out;
-            ++outstream;
-            ++in;
+            unsigned_type n = outstream.batch_length();
+            pull_batch(in, outstream.batch_begin(), n);
+            out += n;
+            outstream += n;
         }
 
         ConstExtIterator const_out = out;
@@ -0,0 +1,371 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/tee.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM__TEE_H
+#define STXXL_STREAM__TEE_H
+
+#include <deque>
+#include <vector>
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/mng/mng.h>
+#include <stxxl/bits/mng/typed_block.h>
+#include <stxxl/bits/stream/stream.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream
+{
+    ////////////////////////////////////////////////////////////////////////
+    //     TEE_INTO / PARTITION_INTO                                      //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Pushes every element of a stream into two push-style sinks.
+    //!
+    //! A sink is anything with a \c push(value) method, e.g. a
+    //! \c runs_creator with the \c use_push strategy. The input is consumed.
+    //! \return number of elements pushed into each sink
+    template <class Input_, class Sink1_, class Sink2_>
+    stxxl::uint64 tee_into(Input_ & in, Sink1_ & sink1, Sink2_ & sink2)
+    {
+        stxxl::uint64 count = 0;
+        for ( ; !in.empty(); ++in, ++count)
+        {
+            const typename Input_::value_type & v = *in;
+            sink1.push(v);
+            sink2.push(v);
+        }
+        return count;
+    }
+
+    //! \brief Pushes every element of a stream into three push-style sinks.
+    template <class Input_, class Sink1_, class Sink2_, class Sink3_>
+    stxxl::uint64 tee_into(Input_ & in, Sink1_ & sink1, Sink2_ & sink2, Sink3_ & sink3)
+    {
+        stxxl::uint64 count = 0;
+        for ( ; !in.empty(); ++in, ++count)
+        {
+            const typename Input_::value_type & v = *in;
+            sink1.push(v);
+            sink2.push(v);
+            sink3.push(v);
+        }
+        return count;
+    }
+
+    //! \brief Pushes every element of a stream into the sink chosen by \c selector.
+    //!
+    //! \param in input stream, consumed
+    //! \param selector functor returning the index of the sink for an element
+    //! \param sinks random access iterator over pointers to the sinks
+    //! \return number of elements pushed
+    template <class Input_, class Selector_, class SinkPtrIterator_>
+    stxxl::uint64 partition_into(Input_ & in, Selector_ selector, SinkPtrIterator_ sinks)
+    {
+        stxxl::uint64 count = 0;
+        for ( ; !in.empty(); ++in, ++count)
+        {
+            const typename Input_::value_type & v = *in;
+            sinks[selector(v)]->push(v);
+        }
+        return count;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    //     TEE                                                            //
+    ////////////////////////////////////////////////////////////////////////
+
+    //! \brief Splits a stream into several independent pull-style outputs.
+    //!
+    //! Every output yields the complete input. The outputs can be consumed
+    //! at different speeds; elements that have been read by the leading
+    //! output but not yet by all others are spooled in blocks, and only if
+    //! this lag exceeds the memory budget are blocks written to disk (the
+    //! newest first, as they are needed last) and read back when the lagging
+    //! outputs reach them. Blocks that
+    //! all outputs have passed are released.
+    //!
+    //! Memory usage: the budget, but at least (number of outputs + 2) blocks.
+    //! \tparam Input_ type of the input stream
+    //! \tparam BlockSize_ size of the spool blocks
+    //! \tparam AllocStr_ allocation strategy for spooled blocks
+    template <class Input_,
+              unsigned BlockSize_ = STXXL_DEFAULT_BLOCK_SIZE(typename Input_::value_type),
+              class AllocStr_ = STXXL_DEFAULT_ALLOC_STRATEGY>
+    class tee : private noncopyable
+    {
+    public:
+        typedef typename Input_::value_type value_type;
+        typedef typed_block<BlockSize_, value_type> block_type;
+        typedef typename block_type::bid_type bid_type;
+
+        //! \brief One output of a \c tee, a stream yielding the complete input.
+        class output : private noncopyable
+        {
+            friend class tee;
+
+        public:
+            //! Standard stream typedef.
+            typedef typename Input_::value_type value_type;
+
+        private:
+            tee * parent;
+            unsigned_type index;
+            stxxl::uint64 pos;          // elements consumed
+            const value_type * cur, * end;
+
+            output(tee * parent_, unsigned_type index_) :
+                parent(parent_), index(index_), pos(0), cur(NULL), end(NULL)
+            { }
+
+        public:
+            //! Standard stream method.
+            const value_type & operator * () const
+            {
+                return *cur;
+            }
+
+            const value_type * operator -> () const
+            {
+                return cur;
+            }
+
+            //! Standard stream method.
+            output & operator ++ ()
+            {
+                assert(!empty());
+                ++pos;
+                if (++cur == end)
+                    parent->refill(*this);
+                return *this;
+            }
+
+            //! Standard stream method.
+            bool empty() const
+            {
+                return cur == end;
+            }
+        };
+
+    private:
+        struct spool_block
+        {
+            block_type * mem;           // NULL while only on disk
+            bid_type bid;
+            bool written;
+
+            spool_block() : mem(NULL), written(false) { }
+        };
+
+        Input_ & input;
+        std::vector<output *> outputs;
+        std::deque<spool_block> blocks;
+        stxxl::uint64 first_block;      // number of the block in blocks.front()
+        stxxl::uint64 produced;         // elements pulled from the input
+
+        std::vector<block_type *> free_mem;
+        unsigned_type allocated, max_allocated;
+        block_manager * bm;
+        stxxl::uint64 blocks_written, blocks_read;
+
+        static stxxl::uint64 block_of(stxxl::uint64 pos)
+        {
+            return pos / block_type::size;
+        }
+
+        bool pinned(stxxl::uint64 b) const
+        {
+            for (unsigned_type i = 0; i < outputs.size(); ++i)
+                if (block_of(outputs[i]->pos) == b)
+                    return true;
+            return false;
+        }
+
+        //! Writes the newest block in memory that no output is reading to disk.
+        block_type * evict()
+        {
+            // outputs only move forward, so the newest block is needed last;
+            // the last block is the one being filled
+            for (unsigned_type k = blocks.size(); k-- > 1; )
+            {
+                spool_block & sb = blocks[k - 1];
+                if (!sb.mem || pinned(first_block + k - 1))
+                    continue;
+                if (!sb.written)
+                {
+                    bm->new_block(AllocStr_(), sb.bid);
+                    sb.mem->write(sb.bid)->wait();
+                    sb.written = true;
+                    ++blocks_written;
+                }
+                block_type * mem = sb.mem;
+                sb.mem = NULL;
+                return mem;
+            }
+            return NULL;
+        }
+
+        block_type * get_memory()
+        {
+            if (!free_mem.empty())
+            {
+                block_type * mem = free_mem.back();
+                free_mem.pop_back();
+                return mem;
+            }
+            if (allocated >= max_allocated)
+            {
+                block_type * mem = evict();
+                if (mem)
+                    return mem;
+            }
+            ++allocated;
+            return new block_type;
+        }
+
+        //! Pulls elements into the last block, starting a new one if it is full.
+        void fill_tail()
+        {
+            if (produced % block_type::size == 0)
+            {
+                if (blocks.empty())
+                    first_block = block_of(produced);
+                spool_block sb;
+                sb.mem = get_memory();
+                blocks.push_back(sb);
+            }
+            const unsigned_type offset = unsigned_type(produced % block_type::size);
+            unsigned_type n = block_type::size - offset;
+            pull_batch(input, blocks.back().mem->begin() + offset, n);
+            produced += n;
+        }
+
+        //! Releases the blocks that all outputs have passed.
+        void release()
+        {
+            stxxl::uint64 min_block = block_of(outputs[0]->pos);
+            for (unsigned_type i = 1; i < outputs.size(); ++i)
+                min_block = STXXL_MIN(min_block, block_of(outputs[i]->pos));
+            while (!blocks.empty() && first_block < min_block)
+            {
+                spool_block & sb = blocks.front();
+                if (sb.mem)
+                    free_mem.push_back(sb.mem);
+                if (sb.written)
+                    bm->delete_block(sb.bid);
+                blocks.pop_front();
+                ++first_block;
+            }
+        }
+
+        //! Makes the next elements of \c out available.
+        void refill(output & out)
+        {
+            if (out.pos % block_type::size == 0)
+                release();
+            if (out.pos == produced)
+            {
+                if (input.empty())
+                {
+                    out.cur = out.end = NULL;
+                    return;
+                }
+                fill_tail();
+            }
+            const stxxl::uint64 b = block_of(out.pos);
+            spool_block & sb = blocks[unsigned_type(b - first_block)];
+            if (!sb.mem)
+            {
+                block_type * mem = get_memory();
+                mem->read(sb.bid)->wait();
+                sb.mem = mem;
+                ++blocks_read;
+            }
+            const stxxl::uint64 block_end = STXXL_MIN(produced, (b + 1) * block_type::size);
+            out.cur = sb.mem->begin() + unsigned_type(out.pos - b * block_type::size);
+            out.end = sb.mem->begin() + unsigned_type(block_end - b * block_type::size);
+        }
+
+    public:
+        //! \brief Creates the outputs, reads the first block of the input.
+        //! \param input_ input stream, must not be accessed by anyone else while the tee exists
+        //! \param num_outputs number of outputs
+        //! \param memory_to_use memory for spooled blocks in bytes
+        tee(Input_ & input_, unsigned_type num_outputs, unsigned_type memory_to_use) :
+            input(input_),
+            first_block(0),
+            produced(0),
+            allocated(0),
+            max_allocated(STXXL_MAX<unsigned_type>(memory_to_use / sizeof(block_type), num_outputs + 2)),
+            bm(block_manager::get_instance()),
+            blocks_written(0),
+            blocks_read(0)
+        {
+            for (unsigned_type i = 0; i < num_outputs; ++i)
+                outputs.push_back(new output(this, i));
+            for (unsigned_type i = 0; i < num_outputs; ++i)
+                refill(*outputs[i]);
+        }
+
+        //! Frees all spooled blocks.
+        ~tee()
+        {
+            for (unsigned_type i = 0; i < outputs.size(); ++i)
+                delete outputs[i];
+            for (unsigned_type k = 0; k < blocks.size(); ++k)
+            {
+                delete blocks[k].mem;
+                if (blocks[k].written)
+                    bm->delete_block(blocks[k].bid);
+            }
+            for (unsigned_type k = 0; k < free_mem.size(); ++k)
+                delete free_mem[k];
+        }
+
+        //! Number of outputs.
+        unsigned_type size() const
+        {
+            return outputs.size();
+        }
+
+        //! Output \c i, a stream yielding the complete input.
+        output & get_output(unsigned_type i)
+        {
+            return *outputs[i];
+        }
+
+        //! Output \c i.
+        output & operator [] (unsigned_type i)
+        {
+            return *outputs[i];
+        }
+
+        //! Number of blocks spooled to disk because of the lag between outputs.
+        stxxl::uint64 get_blocks_written() const
+        {
+            return blocks_written;
+        }
+
+        //! Number of spooled blocks read back from disk.
+        stxxl::uint64 get_blocks_read() const
+        {
+            return blocks_read;
+        }
+    };
+}
+
+__STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM__TEE_H
+// vim: et:ts=4:sw=4
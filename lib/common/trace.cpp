@@ -0,0 +1,221 @@
+/***************************************************************************
+ *  lib/common/trace.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#include <stxxl/bits/common/trace.h>
+#include <stxxl/bits/common/exithandler.h>
+#include <stxxl/bits/verbose.h>
+#include <stxxl/bits/common/utils.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+//! Ring buffer of the events of one thread. Only the owning thread writes,
+//! the lock is taken by readers and therefore hardly ever contended.
+class tracer::thread_buffer
+{
+public:
+    mutex events_mutex;
+    std::vector<trace_event> events;
+    unsigned_type next;
+    uint64 total;
+    unsigned_type tid;
+
+    thread_buffer(unsigned_type capacity, unsigned_type tid_)
+        : events(capacity), next(0), total(0), tid(tid_)
+    { }
+
+    unsigned_type size() const
+    {
+        return (total < events.size()) ? unsigned_type(total) : events.size();
+    }
+};
+
+#if STXXL_STD_ATOMIC
+std::atomic<bool> tracer::enabled_flag(false);
+#else
+volatile bool tracer::enabled_flag = false;
+#endif
+
+namespace
+{
+    //! the calling thread's buffer, a tracer::thread_buffer
+    STXXL_THREAD_LOCAL void * local_buffer = NULL;
+}
+
+tracer::tracer()
+    : events_per_thread(64 * 1024), origin(timestamp())
+{
+    register_exit_handler(dump_at_exit);
+
+    const char * env = getenv("STXXLTRACEFILE");
+    if (env && *env)
+    {
+        STXXL_MSG("Writing a trace of the I/O and algorithm phases to " << env);
+        enable(env);
+    }
+}
+
+void tracer::enable(const std::string & filename_, unsigned_type events_per_thread_)
+{
+    {
+        scoped_mutex_lock Lock(buffers_mutex);
+        filename = filename_;
+        events_per_thread = STXXL_MAX(events_per_thread_, unsigned_type(1));
+        for (unsigned_type i = 0; i < buffers.size(); ++i)
+        {
+            thread_buffer & b = *buffers[i];
+            scoped_mutex_lock BufferLock(b.events_mutex);
+            if (b.events.size() != events_per_thread)
+            {
+                std::vector<trace_event>(events_per_thread).swap(b.events);
+                b.next = 0;
+                b.total = 0;
+            }
+        }
+    }
+    enabled_flag = true;
+}
+
+void tracer::disable()
+{
+    enabled_flag = false;
+}
+
+void tracer::clear()
+{
+    scoped_mutex_lock Lock(buffers_mutex);
+    for (unsigned_type i = 0; i < buffers.size(); ++i)
+    {
+        scoped_mutex_lock BufferLock(buffers[i]->events_mutex);
+        buffers[i]->next = 0;
+        buffers[i]->total = 0;
+    }
+}
+
+tracer::thread_buffer * tracer::get_buffer()
+{
+    if (!local_buffer)
+    {
+        scoped_mutex_lock Lock(buffers_mutex);
+        buffers.push_back(new thread_buffer(events_per_thread, buffers.size() + 1));
+        local_buffer = buffers.back();
+    }
+    return static_cast<thread_buffer *>(local_buffer);
+}
+
+void tracer::record(const trace_event & event)
+{
+    thread_buffer * b = get_buffer();
+    scoped_mutex_lock Lock(b->events_mutex);
+    b->events[b->next] = event;
+    if (++b->next == b->events.size())
+        b->next = 0;
+    ++b->total;
+}
+
+unsigned_type tracer::size()
+{
+    scoped_mutex_lock Lock(buffers_mutex);
+    unsigned_type result = 0;
+    for (unsigned_type i = 0; i < buffers.size(); ++i)
+    {
+        scoped_mutex_lock BufferLock(buffers[i]->events_mutex);
+        result += buffers[i]->size();
+    }
+    return result;
+}
+
+uint64 tracer::get_dropped()
+{
+    scoped_mutex_lock Lock(buffers_mutex);
+    uint64 result = 0;
+    for (unsigned_type i = 0; i < buffers.size(); ++i)
+    {
+        scoped_mutex_lock BufferLock(buffers[i]->events_mutex);
+        result += buffers[i]->total - buffers[i]->size();
+    }
+    return result;
+}
+
+void tracer::dump(std::ostream & o)
+{
+    scoped_mutex_lock Lock(buffers_mutex);
+    const std::ios::fmtflags flags = o.flags();
+    const std::streamsize precision = o.precision();
+    o << std::fixed << std::setprecision(3);
+
+    o << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (unsigned_type i = 0; i < buffers.size(); ++i)
+    {
+        thread_buffer & b = *buffers[i];
+        scoped_mutex_lock BufferLock(b.events_mutex);
+        const unsigned_type n = b.size();
+        // oldest event first
+        unsigned_type pos = (b.total > b.events.size()) ? b.next : 0;
+        for (unsigned_type j = 0; j < n; ++j)
+        {
+            const trace_event & e = b.events[pos];
+            if (++pos == b.events.size())
+                pos = 0;
+
+            o << (first ? "" : ",\n")
+              << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+              << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b.tid
+              << ",\"ts\":" << (e.begin - origin) * 1e6
+              << ",\"dur\":" << e.duration * 1e6;
+            if (e.arg_names[0] || e.arg_names[1])
+            {
+                o << ",\"args\":{";
+                if (e.arg_names[0])
+                    o << "\"" << e.arg_names[0] << "\":" << e.args[0];
+                if (e.arg_names[1])
+                    o << (e.arg_names[0] ? "," : "") << "\"" << e.arg_names[1] << "\":" << e.args[1];
+                o << "}";
+            }
+            o << "}";
+            first = false;
+        }
+        if (b.total > n)
+        {
+            o << (first ? "" : ",\n")
+              << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b.tid
+              << ",\"args\":{\"name\":\"thread " << b.tid << " (" << (b.total - n) << " older events dropped)\"}}";
+            first = false;
+        }
+    }
+    o << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    o.flags(flags);
+    o.precision(precision);
+}
+
+void tracer::dump(const std::string & filename_)
+{
+    std::ofstream f(filename_.c_str());
+    dump(f);
+    if (!f)
+        STXXL_ERRMSG("Cannot write the trace to " << filename_);
+}
+
+void tracer::dump_at_exit()
+{
+    tracer * t = get_instance();
+    t->disable();
+    if (!t->filename.empty())
+        t->dump(t->filename);
+}
+
+__STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
@@ -0,0 +1,105 @@
+/***************************************************************************
+ *  io/completion_queue.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <cassert>
+#include <stxxl/bits/io/completion_queue.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+completion_handler completion_queue::tag(const completion_handler & on_cmpl)
+{
+    scoped_mutex_lock Lock(queue_mutex);
+    ++outstanding;
+    return tagged_handler(this, on_cmpl);
+}
+
+void completion_queue::push(request * req)
+{
+    {
+        scoped_mutex_lock Lock(queue_mutex);
+        completed.push_back(request_ptr(req));
+    }
+    available++;
+}
+
+request_ptr completion_queue::pop()
+{
+    request_ptr req;
+    {
+        scoped_mutex_lock Lock(queue_mutex);
+        assert(!completed.empty());
+        req = completed.front();
+        completed.pop_front();
+    }
+    // the completion handler runs before the request is entirely finished
+    if (req.valid())
+        req->wait(false);
+    return req;
+}
+
+request_ptr completion_queue::wait_next()
+{
+    for ( ; ; )
+    {
+        {
+            // claim one of the outstanding requests, so that a concurrent
+            // try_next() can not take the one we are waiting for
+            scoped_mutex_lock Lock(queue_mutex);
+            if (outstanding == 0)
+                return request_ptr();
+            --outstanding;
+        }
+        available--;
+        request_ptr req = pop();
+        if (req.valid())
+            return req;
+        // the request we waited for was canceled
+    }
+}
+
+request_ptr completion_queue::try_next()
+{
+    {
+        scoped_mutex_lock Lock(queue_mutex);
+        // completed requests are reserved for blocked wait_next() calls first
+        if (outstanding == 0 || !available.try_decrement())
+            return request_ptr();
+        --outstanding;
+    }
+    return pop();
+}
+
+bool completion_queue::cancel(const request_ptr & req)
+{
+    if (!req->cancel())
+        return false;
+    {
+        scoped_mutex_lock Lock(queue_mutex);
+        if (outstanding > 0)
+        {
+            --outstanding;
+            return true;
+        }
+        // all remaining requests are awaited, wake up one of the waiters
+        completed.push_back(request_ptr());
+    }
+    available++;
+    return true;
+}
+
+unsigned_type completion_queue::size()
+{
+    scoped_mutex_lock Lock(queue_mutex);
+    return outstanding;
+}
+
+__STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
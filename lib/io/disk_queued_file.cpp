@@ -22,10 +22,11 @@ request_ptr disk_queued_file::aread(
     void * buffer,
     offset_type pos,
     size_type bytes,
-    const completion_handler & on_cmpl)
+    const completion_handler & on_cmpl,
+    request::request_priority prio)
 {
     request_ptr req(new serving_request(on_cmpl, this, buffer, pos, bytes,
-                                        request::READ));
+                                        request::READ, true, prio));
 
     disk_queues::get_instance()->add_request(req, get_queue_id());
 
@@ -36,10 +37,11 @@ request_ptr disk_queued_file::awrite(
     void * buffer,
     offset_type pos,
     size_type bytes,
-    const completion_handler & on_cmpl)
+    const completion_handler & on_cmpl,
+    request::request_priority prio)
 {
     request_ptr req(new serving_request(on_cmpl, this, buffer, pos, bytes,
-                                        request::WRITE));
+                                        request::WRITE, true, prio));
 
     disk_queues::get_instance()->add_request(req, get_queue_id());
 
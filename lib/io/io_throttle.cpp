@@ -0,0 +1,103 @@
+/***************************************************************************
+ *  io/io_throttle.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <algorithm>
+#include <stxxl/bits/io/io_throttle.h>
+#include <stxxl/bits/common/timer.h>
+#include <stxxl/bits/common/utils.h>
+
+
+__STXXL_BEGIN_NAMESPACE
+
+namespace
+{
+    //! the throttle of the calling thread's requests
+    STXXL_THREAD_LOCAL io_throttle * current_throttle = NULL;
+}
+
+io_throttle::io_throttle(double bytes_per_second_, double ops_per_second_, double burst_seconds_)
+    : bytes_per_second(bytes_per_second_), ops_per_second(ops_per_second_),
+      burst_seconds(burst_seconds_),
+      byte_tokens(bytes_per_second_ * burst_seconds_),
+      op_tokens(ops_per_second_ * burst_seconds_),
+      last_refill(timestamp()), deferred(0)
+{ }
+
+void io_throttle::refill(double now)
+{
+    const double elapsed = std::max(now - last_refill, 0.0);
+    byte_tokens = std::min(byte_tokens + elapsed * bytes_per_second, bytes_per_second * burst_seconds);
+    op_tokens = std::min(op_tokens + elapsed * ops_per_second, ops_per_second * burst_seconds);
+    last_refill = std::max(now, last_refill);
+}
+
+void io_throttle::set_limits(double bytes_per_second_, double ops_per_second_)
+{
+    scoped_mutex_lock Lock(throttle_mutex);
+    refill(timestamp());
+    bytes_per_second = bytes_per_second_;
+    ops_per_second = ops_per_second_;
+    byte_tokens = std::min(byte_tokens, bytes_per_second * burst_seconds);
+    op_tokens = std::min(op_tokens, ops_per_second * burst_seconds);
+}
+
+double io_throttle::acquire(unsigned_type bytes, double now)
+{
+    scoped_mutex_lock Lock(throttle_mutex);
+    refill(now);
+
+    double wait = 0.0;
+    if (bytes_per_second > 0.0 && byte_tokens < 0.0)
+        wait = -byte_tokens / bytes_per_second;
+    if (ops_per_second > 0.0 && op_tokens < 0.0)
+        wait = std::max(wait, -op_tokens / ops_per_second);
+    if (wait > 0.0)
+    {
+        ++deferred;
+        return now + wait;
+    }
+
+    if (bytes_per_second > 0.0)
+        byte_tokens -= double(bytes);
+    if (ops_per_second > 0.0)
+        op_tokens -= 1.0;
+    return 0.0;
+}
+
+uint64 io_throttle::get_deferred()
+{
+    scoped_mutex_lock Lock(throttle_mutex);
+    return deferred;
+}
+
+io_throttle * io_throttle::get_current()
+{
+    return current_throttle;
+}
+
+scoped_io_throttle::scoped_io_throttle(io_throttle * throttle)
+    : previous(current_throttle)
+{
+    current_throttle = throttle;
+}
+
+scoped_io_throttle::scoped_io_throttle(io_throttle & throttle)
+    : previous(current_throttle)
+{
+    current_throttle = &throttle;
+}
+
+scoped_io_throttle::~scoped_io_throttle()
+{
+    current_throttle = previous;
+}
+
+__STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
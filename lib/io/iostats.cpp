@@ -22,97 +22,290 @@
 
 __STXXL_BEGIN_NAMESPACE
 
+namespace
+{
+    //! microseconds since the first call, the time base of the activity counters
+    inline int64 to_usec(double t)
+    {
+        static const double origin = timestamp();
+        return int64((t - origin) * 1e6);
+    }
+}
+
+void stats_activity::change(int diff, double now)
+{
+    const uint64 level_mask = (uint64(1) << level_bits) - 1;
+    const uint64 t = uint64(STXXL_MAX<int64>(to_usec(now), 0));
+#if STXXL_STD_ATOMIC
+    uint64 old_state = state.load(std::memory_order_relaxed), new_state;
+    uint64 last, level, new_level;
+    do {
+        level = old_state & level_mask;
+        last = old_state >> level_bits;
+        new_level = uint64(STXXL_MAX<int64>(int64(level) + diff, 0));
+        // timestamps of different threads may be slightly out of order
+        new_state = (STXXL_MAX(last, t) << level_bits) | new_level;
+    } while (!state.compare_exchange_weak(old_state, new_state, std::memory_order_relaxed));
+#else
+    uint64 last, level, new_level;
+    {
+        scoped_mutex_lock Lock(state_mutex);
+        level = state & level_mask;
+        last = state >> level_bits;
+        new_level = uint64(STXXL_MAX<int64>(int64(level) + diff, 0));
+        state = (STXXL_MAX(last, t) << level_bits) | new_level;
+    }
+#endif
+    if (t > last && level > 0)
+    {
+        busy.add(t - last);
+        weighted.add((t - last) * level);
+    }
+    if (new_level > level)
+        max_level.set_max(new_level);
+}
+
+unsigned stats_activity::get_level() const
+{
+#if STXXL_STD_ATOMIC
+    return unsigned(state.load(std::memory_order_relaxed) & ((uint64(1) << level_bits) - 1));
+#else
+    scoped_mutex_lock Lock(const_cast<mutex &>(state_mutex));
+    return unsigned(state & ((uint64(1) << level_bits) - 1));
+#endif
+}
+
+unsigned latency_histogram::bucket(double seconds)
+{
+    const int64 ns = int64(seconds * 1e9);
+    if (ns < 4)
+        return unsigned(STXXL_MAX<int64>(ns, 0));
+    // four buckets per power of two: the two bits below the leading one
+    const unsigned e = ilog2_floor(uint64(ns));
+    const unsigned b = 4 * (e - 1) + unsigned((ns >> (e - 2)) & 3);
+    return STXXL_MIN(b, num_buckets - 1);
+}
+
+double latency_histogram::bucket_upper(unsigned b)
+{
+    if (b < 4)
+        return double(b + 1) * 1e-9;
+    const unsigned e = b / 4 + 1;
+    return double(uint64(5 + b % 4) << (e - 2)) * 1e-9;
+}
+
+uint64 latency_histogram::count() const
+{
+    uint64 n = 0;
+    for (unsigned b = 0; b < num_buckets; ++b)
+        n += counts[b];
+    return n;
+}
+
+double latency_histogram::percentile(double q) const
+{
+    const uint64 n = count();
+    if (n == 0)
+        return 0.0;
+    const uint64 rank = STXXL_MAX<uint64>(uint64(q * double(n) + 0.999999), 1);
+    uint64 sum = 0;
+    for (unsigned b = 0; b < num_buckets; ++b)
+    {
+        sum += counts[b];
+        if (sum >= rank)
+            return bucket_upper(b);
+    }
+    return bucket_upper(num_buckets - 1);
+}
+
+//! The live statistics of one disk queue.
+class stats::disk_stats : private stxxl::noncopyable
+{
+public:
+    stats_counter reads, writes;
+    stats_counter volume_read, volume_written;
+    stats_counter t_reads, t_writes;            // nanoseconds
+    stats_activity queue;
+    stats_counter read_latency[latency_histogram::num_buckets];
+    stats_counter write_latency[latency_histogram::num_buckets];
+
+    stats_counter next_sample;                  // microseconds
+    mutex sample_mutex;
+    int64 sample_interval;                      // microseconds, 0 until the first sample
+    std::vector<std::pair<double, unsigned> > samples;
+
+    disk_stats() : sample_interval(0) { }
+
+    void reset()
+    {
+        reads.set(0);
+        writes.set(0);
+        volume_read.set(0);
+        volume_written.set(0);
+        t_reads.set(0);
+        t_writes.set(0);
+        queue.reset();
+        for (unsigned b = 0; b < latency_histogram::num_buckets; ++b)
+        {
+            read_latency[b].set(0);
+            write_latency[b].set(0);
+        }
+        scoped_mutex_lock Lock(sample_mutex);
+        samples.clear();
+        sample_interval = 0;
+        next_sample.set(0);
+    }
+};
+
 stats::stats() :
-    reads(0),
-    writes(0),
-    volume_read(0),
-    volume_written(0),
-    c_reads(0),
-    c_writes(0),
-    c_volume_read(0),
-    c_volume_written(0),
-    t_reads(0.0),
-    t_writes(0.0),
-    p_reads(0.0),
-    p_writes(0.0),
-    p_begin_read(0.0),
-    p_begin_write(0.0),
-    p_ios(0.0),
-    p_begin_io(0.0),
-    t_waits(0.0),
-    p_waits(0.0),
-    p_begin_wait(0.0),
-    t_wait_read(0.0),
-    p_wait_read(0.0),
-    p_begin_wait_read(0.0),
-    t_wait_write(0.0),
-    p_wait_write(0.0),
-    p_begin_wait_write(0.0),
-    acc_reads(0), acc_writes(0),
-    acc_ios(0),
-    acc_waits(0),
-    acc_wait_read(0), acc_wait_write(0),
     last_reset(timestamp())
-{ }
+{
+    for (int i = 0; i < max_disks; ++i)
+        disks[i] = NULL;
+}
 
-#ifndef STXXL_IO_STATS_RESET_FORBIDDEN
-void stats::reset()
+stats::~stats()
+{
+    for (int i = 0; i < max_disks; ++i)
+        delete static_cast<disk_stats *>(disks[i]);
+}
+
+stats::disk_stats * stats::get_disk(int queue_id)
 {
+    const int slot = disk_slot(queue_id);
+#if STXXL_STD_ATOMIC
+    disk_stats * d = disks[slot].load(std::memory_order_acquire);
+    if (d)
+        return d;
+    scoped_mutex_lock Lock(disks_mutex);
+    d = disks[slot].load(std::memory_order_relaxed);
+    if (!d)
     {
-        scoped_mutex_lock ReadLock(read_mutex);
-
-        //assert(acc_reads == 0);
-        if (acc_reads)
-            STXXL_ERRMSG("Warning: " << acc_reads <<
-                         " read(s) not yet finished");
-
-        reads = 0;
-        volume_read = 0;
-        c_reads = 0;
-        c_volume_read = 0;
-        t_reads = 0;
-        p_reads = 0.0;
+        d = new disk_stats;
+        disks[slot].store(d, std::memory_order_release);
     }
+    return d;
+#else
+    scoped_mutex_lock Lock(disks_mutex);
+    if (!disks[slot])
+        disks[slot] = new disk_stats;
+    return disks[slot];
+#endif
+}
+
+std::vector<int> stats::get_disk_ids() const
+{
+    std::vector<int> ids;
+    for (int i = 0; i < max_disks; ++i)
+        if (disks[i])
+            ids.push_back(i - 2);
+    return ids;
+}
+
+disk_stats_data stats::get_disk_stats(int queue_id)
+{
+    disk_stats * d = get_disk(queue_id);
+    disk_stats_data s;
+    s.queue_id = queue_id;
+    s.reads = d->reads.get();
+    s.writes = d->writes.get();
+    s.volume_read = d->volume_read.get();
+    s.volume_written = d->volume_written.get();
+    s.t_reads = double(d->t_reads.get()) * 1e-9;
+    s.t_writes = double(d->t_writes.get()) * 1e-9;
+    s.t_busy = d->queue.get_busy_time();
+    s.t_queue = d->queue.get_weighted_time();
+    s.max_depth = d->queue.get_max_level();
+    s.depth = d->queue.get_level();
+    for (unsigned b = 0; b < latency_histogram::num_buckets; ++b)
     {
-        scoped_mutex_lock WriteLock(write_mutex);
-
-        //assert(acc_writes == 0);
-        if (acc_writes)
-            STXXL_ERRMSG("Warning: " << acc_writes <<
-                         " write(s) not yet finished");
-
-        writes = 0;
-        volume_written = 0;
-        c_writes = 0;
-        c_volume_written = 0;
-        t_writes = 0.0;
-        p_writes = 0.0;
+        s.read_latency.add(b, d->read_latency[b].get());
+        s.write_latency.add(b, d->write_latency[b].get());
     }
     {
-        scoped_mutex_lock IOLock(io_mutex);
+        scoped_mutex_lock Lock(d->sample_mutex);
+        s.samples = d->samples;
+    }
+    s.elapsed = s.time - last_reset;
+    return s;
+}
 
-        //assert(acc_ios == 0);
-        if (acc_ios)
-            STXXL_ERRMSG("Warning: " << acc_ios <<
-                         " io(s) not yet finished");
+void stats::set_queue_depth_sampling(double interval, unsigned_type max_samples)
+{
+    sampling_max_samples.set(STXXL_MAX<unsigned_type>(max_samples, 2));
+    sampling_interval.set(int64(interval * 1e6));
+}
 
-        p_ios = 0.0;
-    }
+void stats::sample_queue_depth(disk_stats * d, double now)
+{
+    const int64 interval = sampling_interval.get();
+    if (interval <= 0)
+        return;
+    const int64 t = to_usec(now);
+    const int64 next = d->next_sample.get();
+    // only the thread that moves next_sample on takes the sample
+    if (t < next || !d->next_sample.compare_and_set(next, t + interval))
+        return;
+
+    scoped_mutex_lock Lock(d->sample_mutex);
+    if (d->sample_interval == 0)
+        d->sample_interval = interval;
+    d->samples.push_back(std::make_pair(now, d->queue.get_level()));
+    if (d->samples.size() >= unsigned_type(sampling_max_samples.get()))
     {
-        scoped_mutex_lock WaitLock(wait_mutex);
-
-        //assert(acc_waits == 0);
-        if (acc_waits)
-            STXXL_ERRMSG("Warning: " << acc_waits <<
-                         " wait(s) not yet finished");
-
-        t_waits = 0.0;
-        p_waits = 0.0;
-        t_wait_read = 0.0;
-        p_wait_read = 0.0;
-        t_wait_write = 0.0;
-        p_wait_write = 0.0;
+        // keep every other sample and halve the rate
+        for (unsigned_type i = 0; 2 * i < d->samples.size(); ++i)
+            d->samples[i] = d->samples[2 * i];
+        d->samples.resize((d->samples.size() + 1) / 2);
+        d->sample_interval *= 2;
     }
+    d->next_sample.set(t + d->sample_interval);
+}
+
+#ifndef STXXL_IO_STATS_RESET_FORBIDDEN
+void stats::reset()
+{
+    //assert(read_activity.get_level() == 0);
+    if (read_activity.get_level())
+        STXXL_ERRMSG("Warning: " << read_activity.get_level() <<
+                     " read(s) not yet finished");
+
+    reads.set(0);
+    volume_read.set(0);
+    c_reads.set(0);
+    c_volume_read.set(0);
+    read_activity.reset();
+
+    //assert(write_activity.get_level() == 0);
+    if (write_activity.get_level())
+        STXXL_ERRMSG("Warning: " << write_activity.get_level() <<
+                     " write(s) not yet finished");
+
+    writes.set(0);
+    volume_written.set(0);
+    c_writes.set(0);
+    c_volume_written.set(0);
+    write_activity.reset();
+
+    //assert(io_activity.get_level() == 0);
+    if (io_activity.get_level())
+        STXXL_ERRMSG("Warning: " << io_activity.get_level() <<
+                     " io(s) not yet finished");
+
+    io_activity.reset();
+
+    //assert(wait_activity.get_level() == 0);
+    if (wait_activity.get_level())
+        STXXL_ERRMSG("Warning: " << wait_activity.get_level() <<
+                     " wait(s) not yet finished");
+
+    wait_activity.reset();
+    wait_read_activity.reset();
+    wait_write_activity.reset();
+
+    for (int i = 0; i < max_disks; ++i)
+        if (disks[i])
+            static_cast<disk_stats *>(disks[i])->reset();
 
     last_reset = timestamp();
 }
@@ -123,124 +316,99 @@ void stats::write_started(unsigned_type size_, double now)
 {
     if (now == 0.0)
         now = timestamp();
-    {
-        scoped_mutex_lock WriteLock(write_mutex);
-
-        ++writes;
-        volume_written += size_;
-        double diff = now - p_begin_write;
-        t_writes += double(acc_writes) * diff;
-        p_begin_write = now;
-        p_writes += (acc_writes++) ? diff : 0.0;
-    }
-    {
-        scoped_mutex_lock IOLock(io_mutex);
-
-        double diff = now - p_begin_io;
-        p_ios += (acc_ios++) ? diff : 0.0;
-        p_begin_io = now;
-    }
+    writes.add(1);
+    volume_written.add(size_);
+    write_activity.change(1, now);
+    io_activity.change(1, now);
 }
 
 void stats::write_canceled(unsigned_type size_)
 {
-    {
-        scoped_mutex_lock WriteLock(write_mutex);
-
-        --writes;
-        volume_written -= size_;
-    }
+    writes.add(-1);
+    volume_written.add(-int64(size_));
     write_finished();
 }
 
 void stats::write_finished()
 {
     double now = timestamp();
-    {
-        scoped_mutex_lock WriteLock(write_mutex);
-
-        double diff = now - p_begin_write;
-        t_writes += double(acc_writes) * diff;
-        p_begin_write = now;
-        p_writes += (acc_writes--) ? diff : 0.0;
-    }
-    {
-        scoped_mutex_lock IOLock(io_mutex);
-
-        double diff = now - p_begin_io;
-        p_ios += (acc_ios--) ? diff : 0.0;
-        p_begin_io = now;
-    }
+    write_activity.change(-1, now);
+    io_activity.change(-1, now);
 }
 
 void stats::write_cached(unsigned_type size_)
 {
-    scoped_mutex_lock WriteLock(write_mutex);
-
-    ++c_writes;
-    c_volume_written += size_;
+    c_writes.add(1);
+    c_volume_written.add(size_);
 }
 
 void stats::read_started(unsigned_type size_, double now)
 {
     if (now == 0.0)
         now = timestamp();
-    {
-        scoped_mutex_lock ReadLock(read_mutex);
-
-        ++reads;
-        volume_read += size_;
-        double diff = now - p_begin_read;
-        t_reads += double(acc_reads) * diff;
-        p_begin_read = now;
-        p_reads += (acc_reads++) ? diff : 0.0;
-    }
-    {
-        scoped_mutex_lock IOLock(io_mutex);
-
-        double diff = now - p_begin_io;
-        p_ios += (acc_ios++) ? diff : 0.0;
-        p_begin_io = now;
-    }
+    reads.add(1);
+    volume_read.add(size_);
+    read_activity.change(1, now);
+    io_activity.change(1, now);
 }
 
 void stats::read_canceled(unsigned_type size_)
 {
-    {
-        scoped_mutex_lock ReadLock(read_mutex);
-
-        --reads;
-        volume_read -= size_;
-    }
+    reads.add(-1);
+    volume_read.add(-int64(size_));
     read_finished();
 }
 
 void stats::read_finished()
 {
     double now = timestamp();
-    {
-        scoped_mutex_lock ReadLock(read_mutex);
+    read_activity.change(-1, now);
+    io_activity.change(-1, now);
+}
 
-        double diff = now - p_begin_read;
-        t_reads += double(acc_reads) * diff;
-        p_begin_read = now;
-        p_reads += (acc_reads--) ? diff : 0.0;
-    }
-    {
-        scoped_mutex_lock IOLock(io_mutex);
+void stats::read_cached(unsigned_type size_)
+{
+    c_reads.add(1);
+    c_volume_read.add(size_);
+}
 
-        double diff = now - p_begin_io;
-        p_ios += (acc_ios--) ? diff : 0.0;
-        p_begin_io = now;
-    }
+void stats::request_queued(int queue_id)
+{
+    disk_stats * d = get_disk(queue_id);
+    const double now = timestamp();
+    d->queue.change(1, now);
+    sample_queue_depth(d, now);
 }
 
-void stats::read_cached(unsigned_type size_)
+void stats::request_canceled(int queue_id)
 {
-    scoped_mutex_lock ReadLock(read_mutex);
+    disk_stats * d = get_disk(queue_id);
+    const double now = timestamp();
+    d->queue.change(-1, now);
+    sample_queue_depth(d, now);
+}
 
-    ++c_reads;
-    c_volume_read += size_;
+void stats::request_served(int queue_id, bool is_write, unsigned_type size_,
+                           double submitted, double begin, double end)
+{
+    disk_stats * d = get_disk(queue_id);
+    const unsigned b = latency_histogram::bucket(end - submitted);
+    if (is_write)
+    {
+        d->writes.add(1);
+        d->volume_written.add(size_);
+        d->t_writes.add(int64((end - begin) * 1e9));
+        d->write_latency[b].add(1);
+    }
+    else
+    {
+        d->reads.add(1);
+        d->volume_read.add(size_);
+        d->t_reads.add(int64((end - begin) * 1e9));
+        d->read_latency[b].add(1);
+    }
+    d->queue.change(-1, end);
+    sample_queue_depth(d, end);
 }
 #endif
 
@@ -248,80 +416,69 @@ void stats::read_cached(unsigned_type size_)
 void stats::wait_started(wait_op_type wait_op)
 {
     double now = timestamp();
-    {
-        scoped_mutex_lock WaitLock(wait_mutex);
-
-        double diff = now - p_begin_wait;
-        t_waits += double(acc_waits) * diff;
-        p_begin_wait = now;
-        p_waits += (acc_waits++) ? diff : 0.0;
-
-        if (wait_op == WAIT_OP_READ) {
-            diff = now - p_begin_wait_read;
-            t_wait_read += double(acc_wait_read) * diff;
-            p_begin_wait_read = now;
-            p_wait_read += (acc_wait_read++) ? diff : 0.0;
-        } else /* if (wait_op == WAIT_OP_WRITE) */ {
-            // wait_any() is only used from write_pool and buffered_writer, so account WAIT_OP_ANY for WAIT_OP_WRITE, too
-            diff = now - p_begin_wait_write;
-            t_wait_write += double(acc_wait_write) * diff;
-            p_begin_wait_write = now;
-            p_wait_write += (acc_wait_write++) ? diff : 0.0;
-        }
-    }
+    wait_activity.change(1, now);
+    // wait_any() is only used from write_pool and buffered_writer, so account WAIT_OP_ANY for WAIT_OP_WRITE, too
+    if (wait_op == WAIT_OP_READ)
+        wait_read_activity.change(1, now);
+    else
+        wait_write_activity.change(1, now);
 }
 
 void stats::wait_finished(wait_op_type wait_op)
 {
     double now = timestamp();
-    {
-        scoped_mutex_lock WaitLock(wait_mutex);
-
-        double diff = now - p_begin_wait;
-        t_waits += double(acc_waits) * diff;
-        p_begin_wait = now;
-        p_waits += (acc_waits--) ? diff : 0.0;
-
-        if (wait_op == WAIT_OP_READ) {
-            double diff = now - p_begin_wait_read;
-            t_wait_read += double(acc_wait_read) * diff;
-            p_begin_wait_read = now;
-            p_wait_read += (acc_wait_read--) ? diff : 0.0;
-        } else /* if (wait_op == WAIT_OP_WRITE) */ {
-            double diff = now - p_begin_wait_write;
-            t_wait_write += double(acc_wait_write) * diff;
-            p_begin_wait_write = now;
-            p_wait_write += (acc_wait_write--) ? diff : 0.0;
-        }
+    wait_activity.change(-1, now);
+    if (wait_op == WAIT_OP_READ)
+        wait_read_activity.change(-1, now);
+    else
+        wait_write_activity.change(-1, now);
 #ifdef STXXL_WAIT_LOG_ENABLED
-        std::ofstream * waitlog = stxxl::logger::get_instance()->waitlog_stream();
-        if (waitlog)
-            *waitlog << (now - last_reset) << "\t"
-                     << ((wait_op == WAIT_OP_READ) ? diff : 0.0) << "\t"
-                     << ((wait_op != WAIT_OP_READ) ? diff : 0.0) << "\t"
-                     << t_wait_read << "\t" << t_wait_write << std::endl << std::flush;
-#endif
+    std::ofstream * waitlog = stxxl::logger::get_instance()->waitlog_stream();
+    if (waitlog)
+    {
+        scoped_mutex_lock LogLock(log_mutex);
+        *waitlog << (now - last_reset) << "\t"
+                 << ((wait_op == WAIT_OP_READ) ? 1 : 0) << "\t"
+                 << ((wait_op != WAIT_OP_READ) ? 1 : 0) << "\t"
+                 << get_wait_read_time() << "\t" << get_wait_write_time() << std::endl << std::flush;
     }
+#endif
 }
 #endif
 
 void stats::_reset_io_wait_time()
 {
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
-    {
-        scoped_mutex_lock WaitLock(wait_mutex);
+    //assert(wait_activity.get_level() == 0);
+    if (wait_activity.get_level())
+        STXXL_ERRMSG("Warning: " << wait_activity.get_level() <<
+                     " wait(s) not yet finished");
 
-        //assert(acc_waits == 0);
-        if (acc_waits)
-            STXXL_ERRMSG("Warning: " << acc_waits <<
-                         " wait(s) not yet finished");
-
-        t_waits = 0.0;
-        p_waits = 0.0;
-    }
+    wait_activity.reset();
 #endif
 }
 
+disk_stats_data disk_stats_data::operator - (const disk_stats_data & a) const
+{
+    disk_stats_data s(*this);
+    s.reads = reads - a.reads;
+    s.writes = writes - a.writes;
+    s.volume_read = volume_read - a.volume_read;
+    s.volume_written = volume_written - a.volume_written;
+    s.t_reads = t_reads - a.t_reads;
+    s.t_writes = t_writes - a.t_writes;
+    s.t_busy = t_busy - a.t_busy;
+    s.t_queue = t_queue - a.t_queue;
+    s.read_latency = read_latency - a.read_latency;
+    s.write_latency = write_latency - a.write_latency;
+    s.samples.clear();
+    for (unsigned_type i = 0; i < samples.size(); ++i)
+        if (samples[i].first >= a.time)
+            s.samples.push_back(samples[i]);
+    s.elapsed = time - a.time;
+    return s;
+}
+
 std::string format_with_SI_IEC_unit_multiplier(uint64 number, const char * unit, int multiplier)
 {
     // may not overflow, std::numeric_limits<uint64>::max() == 16 EB
@@ -399,5 +556,32 @@ std::ostream & operator << (std::ostream & o, const stats_data & s)
 #undef hr
 }
 
+std::ostream & operator << (std::ostream & o, const disk_stats_data & s)
+{
+#define hr add_IEC_binary_multiplier
+    o << "STXXL I/O statistics of disk queue " << s.get_queue_id() << std::endl;
+    o << " number of reads                            : " << hr(s.get_reads()) << std::endl;
+    o << " number of bytes read                       : " << hr(s.get_read_volume(), "B") << std::endl;
+    o << " time spent in serving reads                : " << s.get_read_time() << " s" << std::endl;
+    if (s.get_reads())
+        o << " read latency p50 / p99 / p99.9             : "
+          << s.get_read_latency().percentile(0.5) * 1e3 << " / "
+          << s.get_read_latency().percentile(0.99) * 1e3 << " / "
+          << s.get_read_latency().percentile(0.999) * 1e3 << " ms" << std::endl;
+    o << " number of writes                           : " << hr(s.get_writes()) << std::endl;
+    o << " number of bytes written                    : " << hr(s.get_written_volume(), "B") << std::endl;
+    o << " time spent in serving writes               : " << s.get_write_time() << " s" << std::endl;
+    if (s.get_writes())
+        o << " write latency p50 / p99 / p99.9            : "
+          << s.get_write_latency().percentile(0.5) * 1e3 << " / "
+          << s.get_write_latency().percentile(0.99) * 1e3 << " / "
+          << s.get_write_latency().percentile(0.999) * 1e3 << " ms" << std::endl;
+    o << " utilization                                : " << s.get_utilization() * 100.0 << " %" << std::endl;
+    o << " queue depth mean / max                     : " << s.get_mean_queue_depth()
+      << " / " << s.get_max_queue_depth() << std::endl;
+    return o;
+#undef hr
+}
+
 __STXXL_END_NAMESPACE
 // vim: et:ts=4:sw=4
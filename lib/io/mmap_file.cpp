@@ -17,11 +17,104 @@
 
 #include <stxxl/bits/io/iostats.h>
 #include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/utils.h>
 
 
 __STXXL_BEGIN_NAMESPACE
 
 
+mmap_file::~mmap_file()
+{
+    if (mapping.base)
+        munmap(mapping.base, mapping.length);
+    for (unsigned i = 0; i < retired_mappings.size(); ++i)
+        munmap(retired_mappings[i].base, retired_mappings[i].length);
+}
+
+char * mmap_file::_get_mapping(offset_type end, offset_type file_size)
+{
+    // the mapping may extend past the end of file, which must not be touched
+    if (end > file_size)
+        return NULL;
+
+    if (end <= mapping.length)
+        return mapping.base;
+
+    if (mode_ & WRONLY)
+        return NULL;
+
+    // at least double the mapping, so a file growing in small steps is
+    // remapped only logarithmically often
+    const offset_type length = STXXL_MAX(file_size, 2 * mapping.length);
+    void * mem = mmap(NULL, length, PROT_READ, MAP_SHARED, file_des, 0);
+    if (mem == MAP_FAILED || mem == 0)
+    {
+        STXXL_VERBOSE1("mmap_file: persistent mapping of " << filename << " failed");
+        return NULL;
+    }
+
+    // an outgrown mapping is kept until all its regions are released
+    if (mapping.base)
+    {
+        if (mapping.borrowers == 0)
+            munmap(mapping.base, mapping.length);
+        else
+            retired_mappings.push_back(mapping);
+    }
+    mapping = mapping_type(static_cast<char *>(mem), length);
+
+    return mapping.base;
+}
+
+const void * mmap_file::map_readonly(offset_type offset, size_type bytes, access_hint hint)
+{
+    offset_type file_size = size();
+
+    scoped_mutex_lock map_lock(map_mutex);
+    char * base = _get_mapping(offset + bytes, file_size);
+    if (!base)
+        return NULL;
+
+    if (hint != NORMAL_ACCESS)
+    {
+        // madvise requires a page aligned address
+        offset_type page_size = sysconf(_SC_PAGESIZE);
+        offset_type aligned = offset - offset % page_size;
+        int advice = (hint == SEQUENTIAL_ACCESS) ? MADV_SEQUENTIAL : MADV_WILLNEED;
+        madvise(base + aligned, bytes + (offset - aligned), advice);
+    }
+
+    ++mapping.borrowers;
+    return base + offset;
+}
+
+void mmap_file::release_readonly(const void * region)
+{
+    const char * p = static_cast<const char *>(region);
+
+    scoped_mutex_lock map_lock(map_mutex);
+    if (mapping.contains(p))
+    {
+        assert(mapping.borrowers > 0);
+        --mapping.borrowers;
+        return;
+    }
+    for (unsigned i = 0; i < retired_mappings.size(); ++i)
+    {
+        if (retired_mappings[i].contains(p))
+        {
+            assert(retired_mappings[i].borrowers > 0);
+            if (--retired_mappings[i].borrowers == 0)
+            {
+                munmap(retired_mappings[i].base, retired_mappings[i].length);
+                retired_mappings.erase(retired_mappings.begin() + i);
+            }
+            return;
+        }
+    }
+    assert(!"mmap_file::release_readonly() of a region that was not borrowed");
+}
+
 void mmap_file::serve(const request * req) throw (io_error)
 {
     scoped_mutex_lock fd_lock(fd_mutex);
@@ -35,6 +128,19 @@ void mmap_file::serve(const request * req) throw (io_error)
 
     stats::scoped_read_write_timer read_write_timer(bytes, type == request::WRITE);
 
+    if (type == request::READ)
+    {
+        // serve reads from the persistent mapping if it already covers the
+        // region, it is only ever enlarged by map_readonly()
+        offset_type file_size = _size();
+        scoped_mutex_lock map_lock(map_mutex);
+        if (mapping.base && offset + bytes <= STXXL_MIN(mapping.length, file_size))
+        {
+            memcpy(buffer, mapping.base + offset, bytes);
+            return;
+        }
+    }
+
     int prot = (type == request::READ) ? PROT_READ : PROT_WRITE;
     void * mem = mmap(NULL, bytes, prot, MAP_SHARED, file_des, offset);
     // void *mem = mmap (buffer, bytes, prot , MAP_SHARED|MAP_FIXED , file_des, offset);
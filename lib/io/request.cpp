@@ -24,13 +24,16 @@ request::request(const completion_handler & on_compl,
                  void * buffer_,
                  offset_type offset_,
                  size_type bytes_,
-                 request_type type_) :
+                 request_type type_,
+                 request_priority priority_) :
     on_complete(on_compl),
     file_(file__),
     buffer(buffer_),
     offset(offset_),
     bytes(bytes_),
-    type(type_)
+    type(type_),
+    priority(priority_),
+    throttle(NULL)
 {
     STXXL_VERBOSE3("[" << static_cast<void *>(this) << "] request::(...), ref_cnt=" << get_reference_count());
     file_->add_request_ref();
@@ -87,6 +90,7 @@ std::ostream & request::print(std::ostream & out) const
     out << " File offset: " << get_offset();
     out << " Transfer size: " << get_size() << " bytes";
     out << " Type of transfer: " << ((get_type() == READ) ? "READ" : "WRITE");
+    out << " Priority: " << get_priority();
     return out;
 }
 
@@ -12,11 +12,10 @@
  *  http://www.boost.org/LICENSE_1_0.txt)
  **************************************************************************/
 
-#include <algorithm>
-
 #include <stxxl/bits/io/request_queue_impl_qwqr.h>
 #include <stxxl/bits/io/request_with_state.h>
-#include <stxxl/bits/parallel.h>
+#include <stxxl/bits/io/io_throttle.h>
+#include <stxxl/bits/common/timer.h>
 
 
 #ifndef STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
@@ -25,17 +24,21 @@
 
 __STXXL_BEGIN_NAMESPACE
 
-struct file_offset_match : public std::binary_function<request_ptr, request_ptr, bool>
+namespace
 {
-    bool operator () (
-        const request_ptr & a,
-        const request_ptr & b) const
-    {
-        // matching file and offset are enough to cause problems
-        return (a->get_offset() == b->get_offset()) &&
-               (a->get_file() == b->get_file());
-    }
-};
+    //! slack of each priority class, a few transfers of large blocks
+    double slack_table[request::NUM_PRIORITIES] = { 0.0, 0.025, 0.1, 1.0 };
+}
+
+double request_queue_impl_qwqr::deadline_slack(request::request_priority prio)
+{
+    return slack_table[prio];
+}
+
+void request_queue_impl_qwqr::set_deadline_slack(request::request_priority prio, double seconds)
+{
+    slack_table[prio] = seconds;
+}
 
 request_queue_impl_qwqr::request_queue_impl_qwqr(int n) : _thread_state(NOT_RUNNING), sem(0)
 {
@@ -43,6 +46,47 @@ request_queue_impl_qwqr::request_queue_impl_qwqr(int n) : _thread_state(NOT_RUNN
     start_thread(worker, static_cast<void *>(this), thread, _thread_state);
 }
 
+request_queue_impl_qwqr::location *
+request_queue_impl_qwqr::find_conflict(const request_ptr & req, request::request_type type)
+{
+    // matching file and offset are enough to cause problems
+    block_index::iterator it = pending_blocks[type].find(block_type(req->get_file(), req->get_offset()));
+    if (it == pending_blocks[type].end())
+        return NULL;
+    return &locations[it->second];
+}
+
+void request_queue_impl_qwqr::insert(queue_type & queue, double key, const queued_request & entry)
+{
+    location & loc = locations[entry.req.get()];
+    loc.queue = &queue;
+    loc.pos = queue.insert(std::make_pair(key, entry));
+}
+
+void request_queue_impl_qwqr::insert_by_deadline(const queued_request & entry)
+{
+    const request::request_priority prio = entry.req->get_priority();
+    insert(queues[prio], entry.submitted + deadline_slack(prio), entry);
+}
+
+void request_queue_impl_qwqr::remove(location_map::iterator loc)
+{
+    request * req = loc->first;
+    block_index & index = pending_blocks[req->get_type()];
+    std::pair<block_index::iterator, block_index::iterator> range =
+        index.equal_range(block_type(req->get_file(), req->get_offset()));
+    for (block_index::iterator it = range.first; it != range.second; ++it)
+    {
+        if (it->second == req)
+        {
+            index.erase(it);
+            break;
+        }
+    }
+    loc->second.queue->erase(loc->second.pos);
+    locations.erase(loc);
+}
+
 void request_queue_impl_qwqr::add_request(request_ptr & req)
 {
     if (req.empty())
@@ -50,37 +94,27 @@ void request_queue_impl_qwqr::add_request(request_ptr & req)
     if (_thread_state() != RUNNING)
         STXXL_THROW_INVALID_ARGUMENT("Request submitted to not running queue.");
 
-    if (req.get()->get_type() == request::READ)
+    queued_request entry;
+    entry.req = req;
+    entry.submitted = timestamp();
+
     {
+        scoped_mutex_lock Lock(queue_mutex);
 #if STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
+        if (req->get_type() == request::READ)
         {
-            scoped_mutex_lock Lock(write_mutex);
-            if (std::find_if(write_queue.begin(), write_queue.end(),
-                             bind2nd(file_offset_match(), req) _STXXL_FORCE_SEQUENTIAL)
-                != write_queue.end())
-            {
+            if (find_conflict(req, request::WRITE))
                 STXXL_ERRMSG("READ request submitted for a BID with a pending WRITE request");
-            }
         }
-#endif
-        scoped_mutex_lock Lock(read_mutex);
-        read_queue.push_back(req);
-    }
-    else
-    {
-#if STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
+        else
         {
-            scoped_mutex_lock Lock(read_mutex);
-            if (std::find_if(read_queue.begin(), read_queue.end(),
-                             bind2nd(file_offset_match(), req) _STXXL_FORCE_SEQUENTIAL)
-                != read_queue.end())
-            {
+            if (find_conflict(req, request::READ))
                 STXXL_ERRMSG("WRITE request submitted for a BID with a pending READ request");
-            }
         }
 #endif
-        scoped_mutex_lock Lock(write_mutex);
-        write_queue.push_back(req);
+        pending_blocks[req->get_type()].insert(
+            std::make_pair(block_type(req->get_file(), req->get_offset()), req.get()));
+        insert_by_deadline(entry);
     }
 
     sem++;
@@ -93,31 +127,102 @@ bool request_queue_impl_qwqr::cancel_request(request_ptr & req)
     if (_thread_state() != RUNNING)
         STXXL_THROW_INVALID_ARGUMENT("Request canceled to not running queue.");
 
-    bool was_still_in_queue = false;
-    if (req.get()->get_type() == request::READ)
+    scoped_mutex_lock Lock(queue_mutex);
+    location_map::iterator loc = locations.find(req.get());
+    if (loc == locations.end())
+        return false;
+
+    // deferred requests hold no count in sem, the worker may hold the
+    // count of a queued one already
+    if (loc->second.queue != &throttled)
+        sem.decrement();
+    remove(loc);
+    return true;
+}
+
+void request_queue_impl_qwqr::promote_request(request_ptr & req, request::request_priority prio)
+{
+    // the dispatcher reads the priority under the same lock
+    scoped_mutex_lock Lock(queue_mutex);
+    if (!req->raise_priority(prio))
+        return;
+
+    // deferred requests get their new deadline when they are ready
+    location_map::iterator loc = locations.find(req.get());
+    if (loc == locations.end() || loc->second.queue == &throttled)
+        return;
+
+    queued_request entry = loc->second.pos->second;
+    loc->second.queue->erase(loc->second.pos);
+    insert_by_deadline(entry);
+}
+
+request_ptr request_queue_impl_qwqr::next_request(double now, bool & token, double & wakeup)
+{
+    // deferred requests their throttle grants by now compete again
+    while (!throttled.empty() && throttled.begin()->first <= now)
     {
-        scoped_mutex_lock Lock(read_mutex);
-        queue_type::iterator pos;
-        if ((pos = std::find(read_queue.begin(), read_queue.end(), req _STXXL_FORCE_SEQUENTIAL)) != read_queue.end())
-        {
-            read_queue.erase(pos);
-            was_still_in_queue = true;
-            sem--;
-        }
+        const queued_request entry = throttled.begin()->second;
+        throttled.erase(throttled.begin());
+        insert_by_deadline(entry);
+        sem++;
     }
-    else
+
+    request_ptr req;
+    for ( ; ; )
     {
-        scoped_mutex_lock Lock(write_mutex);
-        queue_type::iterator pos;
-        if ((pos = std::find(write_queue.begin(), write_queue.end(), req _STXXL_FORCE_SEQUENTIAL)) != write_queue.end())
+        // the heads of the queues have the earliest deadlines of their class
+        queue_type * queue = NULL;
+        for (int p = 0; p < request::NUM_PRIORITIES; ++p)
         {
-            write_queue.erase(pos);
-            was_still_in_queue = true;
-            sem--;
+            if (!queues[p].empty() &&
+                (queue == NULL || queues[p].begin()->first < queue->begin()->first))
+                queue = &queues[p];
         }
+        if (queue == NULL)
+            break;
+
+        queue_type::iterator pos = queue->begin();
+        double ready = 0.0;
+        if (pos->second.req->get_type() == request::READ)
+        {
+            // write the block before it is read back
+            location * write = find_conflict(pos->second.req, request::WRITE);
+            if (write)
+            {
+                if (write->queue == &throttled)
+                    ready = write->pos->first;
+                else
+                {
+                    queue = write->queue;
+                    pos = write->pos;
+                }
+            }
+        }
+        if (ready == 0.0 && pos->second.req->get_throttle())
+            ready = pos->second.req->get_throttle()->acquire(pos->second.req->get_size(), now);
+
+        // the request leaves the queues, and its count in sem with it
+        if (token)
+            token = false;
+        else
+            sem.decrement();
+
+        if (ready != 0.0)
+        {
+            const queued_request entry = pos->second;
+            queue->erase(pos);
+            insert(throttled, ready, entry);
+            continue;
+        }
+
+        req = pos->second.req;
+        remove(locations.find(req.get()));
+        break;
     }
 
-    return was_still_in_queue;
+    wakeup = throttled.empty() ? 0.0 : throttled.begin()->first;
+    return req;
 }
 
 request_queue_impl_qwqr::~request_queue_impl_qwqr()
@@ -130,48 +235,22 @@ void * request_queue_impl_qwqr::worker(void * arg)
     self * pthis = static_cast<self *>(arg);
     request_ptr req;
 
-    bool write_phase = true;
+    // when the next deferred request becomes ready, 0 if there is none
+    double wakeup = 0.0;
     for ( ; ; )
     {
-        pthis->sem--;
-
-        if (write_phase)
-        {
-            scoped_mutex_lock WriteLock(pthis->write_mutex);
-            if (!pthis->write_queue.empty())
-            {
-                req = pthis->write_queue.front();
-                pthis->write_queue.pop_front();
-
-                WriteLock.unlock();
-
-                //assert(req->nref() > 1);
-                req->serve();
-            }
-            else
-            {
-                WriteLock.unlock();
-
-                pthis->sem++;
-
-                if (pthis->_priority_op == WRITE)
-                    write_phase = false;
-            }
-
-            if (pthis->_priority_op == NONE
-                || pthis->_priority_op == READ)
-                write_phase = false;
-        }
+        bool token = true;
+        if (wakeup == 0.0)
+            pthis->sem--;
         else
-        {
-            scoped_mutex_lock ReadLock(pthis->read_mutex);
+            token = pthis->sem.timed_decrement(wakeup - timestamp());
 
-            if (!pthis->read_queue.empty())
+        {
+            scoped_mutex_lock Lock(pthis->queue_mutex);
+            req = pthis->next_request(timestamp(), token, wakeup);
+            if (req.valid())
             {
-                req = pthis->read_queue.front();
-                pthis->read_queue.pop_front();
-
-                ReadLock.unlock();
+                Lock.unlock();
 
                 STXXL_VERBOSE2("queue: before serve request has " << req->nref() << " references ");
                 //assert(req->nref() > 1);
@@ -180,21 +259,15 @@ void * request_queue_impl_qwqr::worker(void * arg)
             }
             else
             {
-                ReadLock.unlock();
+                Lock.unlock();
 
-                pthis->sem++;
-
-                if (pthis->_priority_op == READ)
-                    write_phase = true;
+                if (token)
+                    pthis->sem++;
             }
-
-            if (pthis->_priority_op == NONE
-                || pthis->_priority_op == WRITE)
-                write_phase = true;
         }
 
         // terminate if it has been requested and queues are empty
-        if (pthis->_thread_state() == TERMINATE) {
+        if (pthis->_thread_state() == TERMINATE && wakeup == 0.0) {
             if ((pthis->sem--) == 0)
                 break;
             else
@@ -15,6 +15,7 @@
 #include <stxxl/bits/io/request_with_state.h>
 #include <stxxl/bits/io/file.h>
 #include <stxxl/bits/io/disk_queues.h>
+#include <stxxl/bits/common/trace.h>
 
 __STXXL_BEGIN_NAMESPACE
 
@@ -38,7 +39,19 @@ void request_with_state::wait(bool measure_time)
 
     stats::scoped_wait_timer wait_timer(get_type() == READ ? stats::WAIT_OP_READ : stats::WAIT_OP_WRITE, measure_time);
 
-    _state.wait_for(READY2DIE);
+    // whoever waits for a read needs the data now, while the deadline of a
+    // write already bounds the wait and buffers are often recycled in bulk
+    if (get_type() == READ && _state() == OP)
+        promote(DEMAND);
+
+    if (tracer::enabled() && _state() != READY2DIE)
+    {
+        // only waits that block are worth a trace event
+        scoped_trace trace("io", get_type() == READ ? "wait read" : "wait write");
+        _state.wait_for(READY2DIE);
+    }
+    else
+        _state.wait_for(READY2DIE);
 
     check_errors();
 }
@@ -52,6 +65,7 @@ bool request_with_state::cancel()
         request_ptr rp(this);
         if (disk_queues::get_instance()->cancel_request(rp, file_->get_queue_id()))
         {
+            stats::get_instance()->request_canceled(file_->get_queue_id());
             _state.set_to(DONE);
             notify_waiters();
             file_->delete_request_ref();
@@ -63,6 +77,19 @@ bool request_with_state::cancel()
     return false;
 }
 
+void request_with_state::promote(request_priority prio)
+{
+    STXXL_VERBOSE3("[" << static_cast<void *>(this) << "] request_with_state::promote() " << prio);
+
+    // only queued requests change their priority, under the queue's lock
+    file * f = file_;
+    if (f && _state() == OP)
+    {
+        request_ptr rp(this);
+        disk_queues::get_instance()->promote_request(rp, f->get_queue_id(), prio);
+    }
+}
+
 bool request_with_state::poll()
 {
     const request_state s = _state();
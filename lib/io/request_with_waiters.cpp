@@ -26,12 +26,24 @@ bool request_with_waiters::add_waiter(onoff_switch * sw)
     // never being notified
     scoped_mutex_lock lock(waiters_mutex);
 
+#if STXXL_STD_ATOMIC
+    // announce the waiter before poll(): a completion that notify_waiters()
+    // does not see as having waiters must be visible to poll()
+    ++num_waiters;
+#endif
+
     if (poll())                     // request already finished
     {
+#if STXXL_STD_ATOMIC
+        --num_waiters;
+#endif
         return true;
     }
 
-    waiters.insert(sw);
+    if (!first_waiter)
+        first_waiter = sw;
+    else
+        more_waiters.push_back(sw);
 
     return false;
 }
@@ -39,25 +51,43 @@ bool request_with_waiters::add_waiter(onoff_switch * sw)
 void request_with_waiters::delete_waiter(onoff_switch * sw)
 {
     scoped_mutex_lock lock(waiters_mutex);
-    waiters.erase(sw);
+    if (first_waiter == sw)
+    {
+        first_waiter = NULL;
+        if (!more_waiters.empty())
+        {
+            first_waiter = more_waiters.back();
+            more_waiters.pop_back();
+        }
+    }
+    else
+    {
+        std::vector<onoff_switch *>::iterator it = std::find(more_waiters.begin(), more_waiters.end(), sw);
+        if (it == more_waiters.end())
+            return;
+        *it = more_waiters.back();
+        more_waiters.pop_back();
+    }
+#if STXXL_STD_ATOMIC
+    --num_waiters;
+#endif
 }
 
 void request_with_waiters::notify_waiters()
 {
+#if STXXL_STD_ATOMIC
+    // nobody waits in wait_any(), as for most requests
+    if (num_waiters.load() == 0)
+        return;
+#endif
     scoped_mutex_lock lock(waiters_mutex);
-    std::for_each(waiters.begin(),
-                  waiters.end(),
+    if (first_waiter)
+        first_waiter->on();
+    std::for_each(more_waiters.begin(),
+                  more_waiters.end(),
                   std::mem_fun(&onoff_switch::on)
                   _STXXL_FORCE_SEQUENTIAL);
 }
 
-/*
-int request_with_waiters::nwaiters()
-{
-    scoped_mutex_lock lock(waiters_mutex);
-    return waiters.size();
-}
-*/
-
 __STXXL_END_NAMESPACE
 // vim: et:ts=4:sw=4
@@ -14,6 +14,9 @@
 #include <iomanip>
 #include <stxxl/bits/io/serving_request.h>
 #include <stxxl/bits/io/file.h>
+#include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/io/io_throttle.h>
+#include <stxxl/bits/common/trace.h>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -25,8 +28,11 @@ serving_request::serving_request(
     void * buf,
     offset_type off,
     size_type b,
-    request_type t) :
-    request_with_state(on_cmpl, f, buf, off, b, t)
+    request_type t,
+    bool queued,
+    request_priority p) :
+    request_with_state(on_cmpl, f, buf, off, b, t, p),
+    time_submitted(0.0)
 {
 #ifdef STXXL_CHECK_BLOCK_ALIGNING
     // Direct I/O requires file system block size alignment for file offsets,
@@ -34,6 +40,12 @@ serving_request::serving_request(
     // of the file system block size
     check_alignment();
 #endif
+    if (queued)
+    {
+        time_submitted = timestamp();
+        throttle = io_throttle::get_current();
+        stats::get_instance()->request_queued(f->get_queue_id());
+    }
 }
 
 void serving_request::serve()
@@ -47,14 +59,22 @@ void serving_request::serve()
         offset << "/0x" << bytes <<
         ((type == request::READ) ? " READ" : " WRITE"));
 
+    const double begin = (time_submitted != 0.0) ? timestamp() : 0.0;
     try
     {
+        // one event per request served by a disk queue
+        scoped_trace trace("io", (type == request::READ) ? "serve read" : "serve write",
+                           "queue", (time_submitted != 0.0) ? file_->get_queue_id() : -1);
+        trace.set_arg("bytes", bytes);
         file_->serve(this);
     }
     catch (const io_error & ex)
     {
         error_occured(ex.what());
     }
+    if (time_submitted != 0.0)
+        stats::get_instance()->request_served(file_->get_queue_id(), type == request::WRITE, bytes,
+                                              time_submitted, begin, timestamp());
 
     check_nref(true);
 
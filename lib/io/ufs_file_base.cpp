@@ -25,6 +25,7 @@
  #include <fcntl.h>
 #endif
 #include <cstdio>
+#include <cstring>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -37,7 +38,7 @@ const char * ufs_file_base::io_type() const
 
 ufs_file_base::ufs_file_base(
     const std::string & filename,
-    int mode) : file_des(-1), mode_(mode), filename(filename)
+    int mode) : file_des(-1), mode_(mode), punch_holes(true), filename(filename)
 {
     int flags = 0;
 
@@ -209,6 +210,44 @@ void ufs_file_base::_set_size(offset_type newsize)
 #endif
 }
 
+bool ufs_file_base::can_shrink() const
+{
+    return true;
+}
+
+void ufs_file_base::discard(offset_type offset, offset_type size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+    scoped_mutex_lock fd_lock(fd_mutex);
+    if (!punch_holes || (mode_ & RDONLY))
+        return;
+
+    // deallocate the file system blocks of the region, which allows the file
+    // system to issue TRIM commands on SSDs. Holes read back as zeroes.
+    if (::fallocate(file_des, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size) != 0)
+    {
+        if (errno == EOPNOTSUPP || errno == ENOSYS)
+        {
+            STXXL_VERBOSE1("ufs_file_base::discard(): file system of " << filename <<
+                           " does not support hole punching, disabling it");
+            punch_holes = false;
+        }
+        else
+        {
+            // discarding is best effort and runs when blocks are freed, often
+            // from destructors, so report the error instead of throwing
+            STXXL_ERRMSG("::fallocate(PUNCH_HOLE) path=" << filename << " fd=" << file_des <<
+                         " offset=" << offset << " size=" << size << " : " << strerror(errno) <<
+                         ", disabling hole punching");
+            punch_holes = false;
+        }
+    }
+#else
+    STXXL_UNUSED(offset);
+    STXXL_UNUSED(size);
+#endif
+}
+
 void ufs_file_base::close_remove()
 {
     close();
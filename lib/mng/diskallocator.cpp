@@ -17,6 +17,46 @@
 
 __STXXL_BEGIN_NAMESPACE
 
+DiskAllocator::~DiskAllocator()
+{
+    scoped_mutex_lock lock(mutex);
+    try
+    {
+        shrink_file(1);
+    }
+    catch (io_error & e)
+    {
+        STXXL_ERRMSG("io_error thrown in ~DiskAllocator(): " << e.what());
+    }
+}
+
+void DiskAllocator::shrink_file(stxxl::int64 min_bytes)
+{
+    if (free_space.empty() || disk_bytes <= configured_bytes || !storage->can_shrink())
+        return;
+
+    sortseq::iterator last = free_space.end();
+    --last;
+    if (last->first + last->second != disk_bytes)
+        return;     // end of file is in use
+
+    stxxl::int64 new_size = std::max(last->first, configured_bytes);
+    stxxl::int64 cut_bytes = disk_bytes - new_size;
+    if (cut_bytes < min_bytes)
+        return;
+
+    STXXL_VERBOSE1("DiskAllocator::shrink_file() from " << disk_bytes << " to " << new_size << " bytes");
+
+    if (new_size == last->first)
+        free_space.erase(last);
+    else
+        last->second -= cut_bytes;
+
+    free_bytes -= cut_bytes;
+    disk_bytes = new_size;
+    storage->set_size(disk_bytes);
+}
+
 void DiskAllocator::dump() const
 {
     int64 total = 0;
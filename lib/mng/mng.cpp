@@ -12,6 +12,8 @@
  **************************************************************************/
 
 #include <stxxl/bits/mng/mng.h>
+#include <stxxl/bits/mng/stats_sampler.h>
+#include <stxxl/bits/common/trace.h>
 
 
 __STXXL_BEGIN_NAMESPACE
@@ -39,11 +41,18 @@ block_manager::block_manager()
     m_total_allocation = 0;
     m_maximum_allocation = 0;
 #endif // STXXL_MNG_COUNT_ALLOCATION
+
+    // create stats first, so it outlives the sampler
+    stats::get_instance();
+    sampler = stats_sampler::from_environment(this);
+    // starts tracing if STXXLTRACEFILE is set
+    tracer::get_instance();
 }
 
 block_manager::~block_manager()
 {
     STXXL_VERBOSE1("Block manager destructor");
+    delete sampler;
     for (size_t i = ndisks; i > 0; )
     {
         --i;
@@ -0,0 +1,436 @@
+/***************************************************************************
+ *  mng/stats_sampler.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <stxxl/bits/mng/stats_sampler.h>
+#include <stxxl/bits/mng/mng.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/verbose.h>
+
+#ifndef STXXL_WINDOWS
+ #include <cerrno>
+ #include <unistd.h>
+ #include <sys/socket.h>
+ #include <sys/un.h>
+#endif
+
+
+__STXXL_BEGIN_NAMESPACE
+
+namespace
+{
+    void sleep_seconds(double seconds)
+    {
+#if STXXL_STD_THREADS
+        std::this_thread::sleep_for(std::chrono::microseconds(int64(seconds * 1e6)));
+#elif STXXL_BOOST_THREADS
+        boost::this_thread::sleep(boost::posix_time::microseconds(int64(seconds * 1e6)));
+#else
+        usleep((useconds_t)(seconds * 1e6));
+#endif
+    }
+
+    //! per second over an interval, 0 for empty intervals
+    double rate(double value, double seconds)
+    {
+        return (seconds > 0.0) ? value / seconds : 0.0;
+    }
+
+    const char * unix_prefix = "unix:";
+
+    bool is_socket_target(const std::string & target)
+    {
+        return target.compare(0, strlen(unix_prefix), unix_prefix) == 0;
+    }
+
+    void prometheus_header(std::ostream & o, const char * name, const char * type, const char * help)
+    {
+        o << "# HELP " << name << " " << help << "\n"
+          << "# TYPE " << name << " " << type << "\n";
+    }
+}
+
+stats_sampler::stats_sampler(const std::string & target_, double interval_,
+                             format_type format_, const block_manager * bm_) :
+    target(target_),
+    interval(interval_),
+    format(format_),
+    bm(bm_ ? bm_ : block_manager::get_instance()),
+    stop_requested(false),
+    last(*stats::get_instance()),
+    samples_written(0),
+    socket_fd(-1),
+    socket_error_reported(false),
+    file_error_reported(false)
+{
+    stats * s = stats::get_instance();
+    std::vector<int> ids = s->get_disk_ids();
+    for (unsigned_type i = 0; i < ids.size(); ++i)
+        last_disks[ids[i]] = s->get_disk_stats(ids[i]);
+
+#if STXXL_STD_THREADS
+    worker = new std::thread(worker_main, this);
+#elif STXXL_BOOST_THREADS
+    worker = new boost::thread(boost::bind(worker_main, this));
+#else
+    check_pthread_call(pthread_create(&worker, NULL, worker_main, this));
+#endif
+}
+
+stats_sampler::~stats_sampler()
+{
+    {
+        scoped_mutex_lock Lock(stop_mutex);
+        stop_requested = true;
+    }
+#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+    worker->join();
+    delete worker;
+#else
+    check_pthread_call(pthread_join(worker, NULL));
+#endif
+    sample();
+#ifndef STXXL_WINDOWS
+    if (socket_fd >= 0)
+        ::close(socket_fd);
+#endif
+}
+
+void * stats_sampler::worker_main(void * arg)
+{
+    static_cast<stats_sampler *>(arg)->run();
+    return NULL;
+}
+
+bool stats_sampler::stopping()
+{
+    scoped_mutex_lock Lock(stop_mutex);
+    return stop_requested;
+}
+
+void stats_sampler::run()
+{
+    double next = timestamp() + interval;
+    for ( ; ; )
+    {
+        // sleep in short slices to notice the destructor soon
+        for ( ; ; )
+        {
+            if (stopping())
+                return;
+            const double left = next - timestamp();
+            if (left <= 0.0)
+                break;
+            sleep_seconds(STXXL_MIN(left, 0.05));
+        }
+        sample();
+        next += interval;
+        if (next < timestamp())
+            next = timestamp() + interval;
+    }
+}
+
+unsigned_type stats_sampler::get_samples_written() const
+{
+    scoped_mutex_lock Lock(sample_mutex);
+    return samples_written;
+}
+
+void stats_sampler::sample()
+{
+    scoped_mutex_lock Lock(sample_mutex);
+
+    stats * s = stats::get_instance();
+    const stats_data total(*s);
+    std::map<int, disk_stats_data> disks;
+    std::vector<int> ids = s->get_disk_ids();
+    for (unsigned_type i = 0; i < ids.size(); ++i)
+        disks[ids[i]] = s->get_disk_stats(ids[i]);
+
+    std::ostringstream o;
+    o << std::fixed << std::setprecision(6);
+    if (format == PROMETHEUS)
+        write_prometheus(o, total, total - last, disks);
+    else
+        write_json(o, total, total - last, disks);
+    output(o.str());
+
+    last = total;
+    last_disks = disks;
+    ++samples_written;
+}
+
+void stats_sampler::write_json(std::ostream & o, const stats_data & total, const stats_data & diff,
+                               const std::map<int, disk_stats_data> & disks)
+{
+    const double t = diff.get_elapsed_time();
+    o << "{\"time\":" << timestamp()
+      << ",\"elapsed\":" << total.get_elapsed_time()
+      << ",\"interval\":" << t
+      << ",\"reads\":" << total.get_reads()
+      << ",\"writes\":" << total.get_writes()
+      << ",\"read_bytes\":" << total.get_read_volume()
+      << ",\"written_bytes\":" << total.get_written_volume()
+      << ",\"read_time\":" << total.get_read_time()
+      << ",\"write_time\":" << total.get_write_time()
+      << ",\"io_time\":" << total.get_pio_time()
+      << ",\"wait_time\":" << total.get_io_wait_time()
+      << ",\"wait_read_time\":" << total.get_wait_read_time()
+      << ",\"wait_write_time\":" << total.get_wait_write_time()
+      << ",\"read_bandwidth\":" << rate(double(diff.get_read_volume()), t)
+      << ",\"write_bandwidth\":" << rate(double(diff.get_written_volume()), t)
+      << ",\"read_iops\":" << rate(double(diff.get_reads()), t)
+      << ",\"write_iops\":" << rate(double(diff.get_writes()), t)
+      << ",\"wait_fraction\":" << rate(diff.get_io_wait_time(), t);
+#if STXXL_MNG_COUNT_ALLOCATION
+    o << ",\"allocation\":{\"total\":" << bm->get_total_allocation()
+      << ",\"current\":" << bm->get_current_allocation()
+      << ",\"maximum\":" << bm->get_maximum_allocation() << "}";
+#endif
+    o << ",\"disks\":[";
+    for (std::map<int, disk_stats_data>::const_iterator it = disks.begin(); it != disks.end(); ++it)
+    {
+        const disk_stats_data & d = it->second;
+        std::map<int, disk_stats_data>::const_iterator prev = last_disks.find(it->first);
+        const disk_stats_data dd = (prev != last_disks.end()) ? d - prev->second : d;
+        const double dt = dd.get_elapsed_time();
+        if (it != disks.begin())
+            o << ",";
+        o << "{\"queue\":" << it->first
+          << ",\"reads\":" << d.get_reads()
+          << ",\"writes\":" << d.get_writes()
+          << ",\"read_bytes\":" << d.get_read_volume()
+          << ",\"written_bytes\":" << d.get_written_volume()
+          << ",\"read_bandwidth\":" << rate(double(dd.get_read_volume()), dt)
+          << ",\"write_bandwidth\":" << rate(double(dd.get_written_volume()), dt)
+          << ",\"read_iops\":" << rate(double(dd.get_reads()), dt)
+          << ",\"write_iops\":" << rate(double(dd.get_writes()), dt)
+          << ",\"utilization\":" << dd.get_utilization()
+          << ",\"queue_depth\":" << d.get_queue_depth()
+          << ",\"mean_queue_depth\":" << dd.get_mean_queue_depth()
+          << ",\"max_queue_depth\":" << d.get_max_queue_depth()
+          << ",\"read_latency\":{\"p50\":" << dd.get_read_latency().percentile(0.5)
+          << ",\"p99\":" << dd.get_read_latency().percentile(0.99)
+          << ",\"p999\":" << dd.get_read_latency().percentile(0.999) << "}"
+          << ",\"write_latency\":{\"p50\":" << dd.get_write_latency().percentile(0.5)
+          << ",\"p99\":" << dd.get_write_latency().percentile(0.99)
+          << ",\"p999\":" << dd.get_write_latency().percentile(0.999) << "}}";
+    }
+    o << "]}\n";
+}
+
+void stats_sampler::write_prometheus(std::ostream & o, const stats_data & total, const stats_data & diff,
+                                     const std::map<int, disk_stats_data> & disks)
+{
+    const double t = diff.get_elapsed_time();
+#define STXXL_PROM(name, type, help, value) \
+    prometheus_header(o, name, type, help); \
+    o << name << " " << (value) << "\n"
+
+    STXXL_PROM("stxxl_reads_total", "counter", "Number of read operations.", total.get_reads());
+    STXXL_PROM("stxxl_writes_total", "counter", "Number of write operations.", total.get_writes());
+    STXXL_PROM("stxxl_read_bytes_total", "counter", "Bytes read from disks.", total.get_read_volume());
+    STXXL_PROM("stxxl_written_bytes_total", "counter", "Bytes written to disks.", total.get_written_volume());
+    STXXL_PROM("stxxl_read_seconds_total", "counter", "Time spent in reads, summed over parallel reads.", total.get_read_time());
+    STXXL_PROM("stxxl_write_seconds_total", "counter", "Time spent in writes, summed over parallel writes.", total.get_write_time());
+    STXXL_PROM("stxxl_io_seconds_total", "counter", "Time with at least one read or write in progress.", total.get_pio_time());
+    STXXL_PROM("stxxl_wait_seconds_total", "counter", "Time spent waiting for I/O completion.", total.get_io_wait_time());
+    STXXL_PROM("stxxl_read_bytes_per_second", "gauge", "Read bandwidth over the last interval.", rate(double(diff.get_read_volume()), t));
+    STXXL_PROM("stxxl_write_bytes_per_second", "gauge", "Write bandwidth over the last interval.", rate(double(diff.get_written_volume()), t));
+    STXXL_PROM("stxxl_read_iops", "gauge", "Reads per second over the last interval.", rate(double(diff.get_reads()), t));
+    STXXL_PROM("stxxl_write_iops", "gauge", "Writes per second over the last interval.", rate(double(diff.get_writes()), t));
+    STXXL_PROM("stxxl_wait_fraction", "gauge", "Fraction of the last interval spent waiting for I/O.", rate(diff.get_io_wait_time(), t));
+#if STXXL_MNG_COUNT_ALLOCATION
+    STXXL_PROM("stxxl_allocation_bytes_total", "counter", "Bytes of external memory allocated so far.", bm->get_total_allocation());
+    STXXL_PROM("stxxl_allocated_bytes", "gauge", "Bytes of external memory currently allocated.", bm->get_current_allocation());
+    STXXL_PROM("stxxl_allocated_bytes_max", "gauge", "Maximum of allocated external memory.", bm->get_maximum_allocation());
+#endif
+#undef STXXL_PROM
+
+    // per-queue metrics, over the last interval where they are rates
+    std::map<int, disk_stats_data> interval_disks;
+    for (std::map<int, disk_stats_data>::const_iterator it = disks.begin(); it != disks.end(); ++it)
+    {
+        std::map<int, disk_stats_data>::const_iterator prev = last_disks.find(it->first);
+        interval_disks[it->first] = (prev != last_disks.end()) ? it->second - prev->second : it->second;
+    }
+    typedef std::map<int, disk_stats_data>::const_iterator iter;
+
+#define STXXL_PROM_DISK(name, type, help, source, expr)                   \
+    prometheus_header(o, name, type, help);                               \
+    for (iter it = source.begin(); it != source.end(); ++it) {            \
+        const disk_stats_data & d = it->second;                           \
+        o << name << "{queue=\"" << it->first << "\"} " << (expr) << "\n"; \
+    }
+
+    STXXL_PROM_DISK("stxxl_disk_reads_total", "counter", "Reads served by the disk queue.", disks, d.get_reads());
+    STXXL_PROM_DISK("stxxl_disk_writes_total", "counter", "Writes served by the disk queue.", disks, d.get_writes());
+    STXXL_PROM_DISK("stxxl_disk_read_bytes_total", "counter", "Bytes read through the disk queue.", disks, d.get_read_volume());
+    STXXL_PROM_DISK("stxxl_disk_written_bytes_total", "counter", "Bytes written through the disk queue.", disks, d.get_written_volume());
+    STXXL_PROM_DISK("stxxl_disk_queue_depth", "gauge", "Requests queued or in service.", disks, d.get_queue_depth());
+    STXXL_PROM_DISK("stxxl_disk_utilization", "gauge", "Fraction of the last interval with requests queued or in service.",
+                    interval_disks, d.get_utilization());
+    STXXL_PROM_DISK("stxxl_disk_mean_queue_depth", "gauge", "Average queue depth over the last interval.",
+                    interval_disks, d.get_mean_queue_depth());
+    STXXL_PROM_DISK("stxxl_disk_read_bytes_per_second", "gauge", "Read bandwidth over the last interval.",
+                    interval_disks, rate(double(d.get_read_volume()), d.get_elapsed_time()));
+    STXXL_PROM_DISK("stxxl_disk_write_bytes_per_second", "gauge", "Write bandwidth over the last interval.",
+                    interval_disks, rate(double(d.get_written_volume()), d.get_elapsed_time()));
+#undef STXXL_PROM_DISK
+
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+    static const char * quantile_names[] = { "0.5", "0.99", "0.999" };
+    for (int w = 0; w < 2; ++w)
+    {
+        const char * name = w ? "stxxl_disk_write_latency_seconds" : "stxxl_disk_read_latency_seconds";
+        prometheus_header(o, name, "summary", w ? "Write latency percentiles over the last interval, sum and count since start."
+                          : "Read latency percentiles over the last interval, sum and count since start.");
+        for (iter it = interval_disks.begin(); it != interval_disks.end(); ++it)
+        {
+            const latency_histogram & h = w ? it->second.get_write_latency() : it->second.get_read_latency();
+            for (int q = 0; q < 3; ++q)
+                o << name << "{queue=\"" << it->first << "\",quantile=\"" << quantile_names[q] << "\"} "
+                  << h.percentile(quantiles[q]) << "\n";
+        }
+        // _sum and _count must be monotonic counters, so they are cumulative
+        for (iter it = disks.begin(); it != disks.end(); ++it)
+        {
+            const latency_histogram & h = w ? it->second.get_write_latency() : it->second.get_read_latency();
+            // the histogram keeps no exact sum, use the upper bucket bounds
+            double sum = 0.0;
+            for (unsigned b = 0; b < latency_histogram::num_buckets; ++b)
+                sum += double(h.get(b)) * latency_histogram::bucket_upper(b);
+            o << name << "_sum{queue=\"" << it->first << "\"} " << sum << "\n"
+              << name << "_count{queue=\"" << it->first << "\"} " << h.count() << "\n";
+        }
+    }
+}
+
+void stats_sampler::output(const std::string & text)
+{
+    if (is_socket_target(target))
+    {
+#ifdef STXXL_WINDOWS
+        if (!socket_error_reported)
+            STXXL_ERRMSG("stats_sampler: Unix domain sockets are not supported on this platform");
+        socket_error_reported = true;
+#else
+        if (socket_fd < 0)
+        {
+            const std::string path = target.substr(strlen(unix_prefix));
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            socket_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (socket_fd >= 0 && ::connect(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            {
+                ::close(socket_fd);
+                socket_fd = -1;
+            }
+            if (socket_fd < 0)
+            {
+                // try again with the next sample, but complain only once
+                if (!socket_error_reported)
+                    STXXL_ERRMSG("stats_sampler: cannot connect to " << path << ": " << strerror(errno));
+                socket_error_reported = true;
+                return;
+            }
+            socket_error_reported = false;
+        }
+        std::string message = text;
+        if (format == PROMETHEUS)
+            message += "\n";
+        const char * p = message.data();
+        size_t left = message.size();
+        while (left > 0)
+        {
+#ifdef MSG_NOSIGNAL
+            ssize_t rc = ::send(socket_fd, p, left, MSG_NOSIGNAL);
+#else
+            ssize_t rc = ::send(socket_fd, p, left, 0);
+#endif
+            if (rc < 0 && errno == EINTR)
+                continue;
+            if (rc <= 0)
+            {
+                // the listener went away, reconnect with the next sample
+                ::close(socket_fd);
+                socket_fd = -1;
+                return;
+            }
+            p += rc;
+            left -= rc;
+        }
+#endif
+    }
+    else if (format == PROMETHEUS)
+    {
+        // replace the file atomically, readers never see a partial snapshot
+        const std::string tmp = target + ".tmp";
+        {
+            std::ofstream f(tmp.c_str(), std::ios::out | std::ios::trunc);
+            f << text;
+        }
+        if (std::rename(tmp.c_str(), target.c_str()) != 0)
+        {
+            if (!file_error_reported)
+                STXXL_ERRMSG("stats_sampler: cannot write " << target);
+            file_error_reported = true;
+        }
+        else
+            file_error_reported = false;
+    }
+    else
+    {
+        std::ofstream f(target.c_str(), std::ios::out | std::ios::app);
+        f << text;
+        if (!f)
+        {
+            if (!file_error_reported)
+                STXXL_ERRMSG("stats_sampler: cannot write " << target);
+            file_error_reported = true;
+        }
+        else
+            file_error_reported = false;
+    }
+}
+
+stats_sampler * stats_sampler::from_environment(const block_manager * bm_)
+{
+    const char * file = getenv("STXXLSTATSFILE");
+    if (!file || !*file)
+        return NULL;
+
+    double interval = 1.0;
+    const char * interval_str = getenv("STXXLSTATSINTERVAL");
+    if (interval_str && atof(interval_str) > 0.0)
+        interval = atof(interval_str);
+
+    const std::string target(file);
+    format_type format = JSON_LINES;
+    const char * format_str = getenv("STXXLSTATSFORMAT");
+    if (format_str && *format_str)
+        format = (strcmp(format_str, "prometheus") == 0) ? PROMETHEUS : JSON_LINES;
+    else if (target.size() > 5 && target.compare(target.size() - 5, 5, ".prom") == 0)
+        format = PROMETHEUS;
+
+    STXXL_MSG("Writing I/O statistics to " << target << " every " << interval << " s");
+    return new stats_sampler(target, interval, format, bm_);
+}
+
+__STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *  tests/algo/test_parallel_random_shuffle.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example algo/test_parallel_random_shuffle.cpp
+//! Test \c stxxl::parallel_random_shuffle() and \c stxxl::stream::shuffle
+
+#include <algorithm>
+#include <vector>
+#include <stxxl/vector>
+#include <stxxl/random_shuffle>
+#include <stxxl/stream>
+
+typedef stxxl::uint64 value_type;
+typedef stxxl::VECTOR_GENERATOR<value_type>::result vector_type;
+
+// checks that [first, last) is a permutation of first_value, first_value + 1, ...
+template <typename Iterator>
+void check_permutation(Iterator first, Iterator last, value_type first_value)
+{
+    std::vector<value_type> v(first, last);
+    std::sort(v.begin(), v.end());
+    for (stxxl::uint64 i = 0; i < v.size(); ++i)
+        STXXL_CHECK(v[i] == first_value + i);
+}
+
+void test_vector(stxxl::uint64 n, stxxl::unsigned_type memory)
+{
+    STXXL_MSG("parallel_random_shuffle of " << n << " elements with " << memory << " bytes");
+    vector_type v(n), w(n);
+    for (stxxl::uint64 i = 0; i < n; ++i)
+        v[i] = i;
+
+    // only the range is shuffled
+    const stxxl::uint64 seed = stxxl::parallel_random_shuffle(v.begin() + 100, v.end() - 100, memory);
+    for (stxxl::uint64 i = 0; i < 100; ++i)
+    {
+        STXXL_CHECK(v[i] == i);
+        STXXL_CHECK(v[n - 1 - i] == n - 1 - i);
+    }
+    check_permutation(v.begin() + 100, v.end() - 100, 100);
+    stxxl::uint64 fixed = 0;
+    for (stxxl::uint64 i = 100; i < n - 100; ++i)
+        fixed += (v[i] == i);
+    STXXL_CHECK(fixed < 10);
+
+    // the same seed gives the same permutation, with any number of threads
+    for (stxxl::uint64 i = 0; i < n; ++i)
+        w[i] = i;
+    stxxl::parallel_random_shuffle(w.begin() + 100, w.end() - 100, memory, seed, 1);
+    for (stxxl::uint64 i = 0; i < n; ++i)
+        STXXL_CHECK(v[i] == w[i]);
+}
+
+void test_stream()
+{
+    // large stream without a size estimate
+    {
+        const stxxl::uint64 n = 3000000;
+        std::vector<value_type> out;
+        {
+            vector_type v(n);
+            for (stxxl::uint64 i = 0; i < n; ++i)
+                v[i] = i;
+            typedef stxxl::stream::streamify_traits<vector_type::iterator>::stream_type input_type;
+            input_type input = stxxl::stream::streamify(v.begin(), v.end());
+            stxxl::stream::shuffle<input_type> s(input, 8 * 1024 * 1024, 42);
+            STXXL_CHECK(s.get_partitionings() > 0);
+            STXXL_CHECK(s.get_elements_read() == n);
+            for ( ; !s.empty(); ++s)
+                out.push_back(*s);
+        }
+        STXXL_CHECK(out.size() == n);
+        check_permutation(out.begin(), out.end(), 0);
+    }
+
+    // small inputs are shuffled in memory; element 0 ends up everywhere equally often
+    {
+        const unsigned n = 4, rounds = 4000;
+        std::vector<unsigned> hits(n, 0);
+        for (unsigned r = 1; r <= rounds; ++r)
+        {
+            std::vector<value_type> v(n);
+            for (unsigned i = 0; i < n; ++i)
+                v[i] = i;
+            typedef stxxl::stream::streamify_traits<std::vector<value_type>::iterator>::stream_type input_type;
+            input_type input = stxxl::stream::streamify(v.begin(), v.end());
+            stxxl::stream::shuffle<input_type> s(input, 1024 * 1024, r);
+            STXXL_CHECK(s.get_partitionings() == 0);
+            for (unsigned i = 0; !s.empty(); ++s, ++i)
+                if (*s == 0)
+                    ++hits[i];
+        }
+        for (unsigned i = 0; i < n; ++i)
+        {
+            STXXL_MSG("element 0 at position " << i << ": " << hits[i] << " times");
+            STXXL_CHECK(hits[i] > rounds / n * 8 / 10 && hits[i] < rounds / n * 12 / 10);
+        }
+    }
+}
+
+int main()
+{
+    test_vector(100000, 16 * 1024 * 1024);     // in memory
+    test_vector(4000000, 16 * 1024 * 1024);    // one partitioning pass
+    test_vector(4000000, 4 * 1024 * 1024);     // repartitioning
+    test_stream();
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
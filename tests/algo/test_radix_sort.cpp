@@ -0,0 +1,72 @@
+/***************************************************************************
+ *  tests/algo/test_radix_sort.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example algo/test_radix_sort.cpp
+//! Test the radix sort kernel used for run formation in \c stxxl::ksort()
+//! and \c stxxl::stable_ksort()
+
+#include <vector>
+#include <stxxl/bits/algo/intksort.h>
+#include <stxxl/bits/common/rand.h>
+#include <stxxl/bits/verbose.h>
+
+template <typename KeyType>
+struct ref_type
+{
+    typedef KeyType key_type;
+    key_type key;
+    stxxl::uint64 index;        // position in the input, to check stability
+};
+
+template <typename KeyType>
+void test(const char * name, stxxl::uint64 n, KeyType (* make_key)(stxxl::random_number64 &))
+{
+    STXXL_MSG("radix_sort of " << n << " keys: " << name);
+    typedef ref_type<KeyType> ref;
+    stxxl::random_number64 rnd(n);
+    std::vector<ref> a(n + 1), b(n + 1);
+    for (stxxl::uint64 i = 0; i < n; ++i)
+    {
+        a[i].key = make_key(rnd);
+        a[i].index = i;
+    }
+    std::vector<ref> sorted(a.begin(), a.begin() + n);
+    std::stable_sort(sorted.begin(), sorted.end(), stxxl::radix_sort_local::key_less<ref>());
+
+    stxxl::radix_sort(&a[0], &a[0] + n, &b[0]);
+    for (stxxl::uint64 i = 0; i < n; ++i)
+        STXXL_CHECK(a[i].key == sorted[i].key && a[i].index == sorted[i].index);
+}
+
+stxxl::uint32 uniform32(stxxl::random_number64 & rnd) { return stxxl::uint32(rnd()); }
+stxxl::uint64 uniform64(stxxl::random_number64 & rnd) { return rnd(); }
+stxxl::uint64 exponential64(stxxl::random_number64 & rnd) { return rnd() >> (rnd() % 64); }
+stxxl::uint64 few_keys64(stxxl::random_number64 & rnd) { return rnd() % 5; }
+stxxl::uint64 heavy_key64(stxxl::random_number64 & rnd) { return (rnd() % 10) ? (stxxl::uint64(1) << 50) : rnd(); }
+stxxl::int32 signed32(stxxl::random_number64 & rnd) { return stxxl::int32(rnd()); }
+stxxl::int64 signed64(stxxl::random_number64 & rnd) { return stxxl::int64(rnd()) >> (rnd() % 64); }
+
+int main()
+{
+    const stxxl::uint64 sizes[] = { 0, 1, 2, 100, 255, 256, 1000, 100000, 1000000 };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        test("uniform 32 bit", sizes[i], uniform32);
+        test("uniform 64 bit", sizes[i], uniform64);
+        test("exponential 64 bit", sizes[i], exponential64);
+        test("few keys", sizes[i], few_keys64);
+        test("one heavy key", sizes[i], heavy_key64);
+        test("signed 32 bit", sizes[i], signed32);
+        test("signed 64 bit", sizes[i], signed64);
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -12,6 +12,7 @@
 
 //! \example algo/test_scan.cpp
 //! This is an example of how to use \c stxxl::for_each() and \c stxxl::find() algorithms
+//! and their parallel variants
 
 #include <iostream>
 #include <algorithm>
@@ -57,6 +58,36 @@ struct fill_value
     }
 };
 
+template <typename type>
+struct identity
+{
+    type operator () (type i) const
+    {
+        return i;
+    }
+};
+
+template <typename type>
+struct plus
+{
+    type operator () (type a, type b) const
+    {
+        return a + b;
+    }
+};
+
+template <typename type>
+struct check_less
+{
+    type bound;
+    check_less(type b) : bound(b) { }
+
+    void operator () (const type & arg) const
+    {
+        STXXL_CHECK(arg < bound);
+    }
+};
+
 int main()
 {
     stxxl::vector<int64>::size_type i;
@@ -104,5 +135,52 @@ int main()
         STXXL_CHECK2(v[i] == 555, "Error at position " << i);
     }
 
+    STXXL_MSG("parallel_generate ...");
+    b = timestamp();
+    stxxl::parallel_generate(v.begin() + 3, v.end() - 5, identity<int64>(), 8);
+    e = timestamp();
+    STXXL_MSG("parallel_generate time: " << (e - b));
+
+    STXXL_MSG("check");
+    STXXL_CHECK(v[0] == 0 && v[2] == 555 && v[v.size() - 5] == 555);
+    for (i = 3; i < v.size() - 5; ++i)
+    {
+        STXXL_CHECK2(v[i] == int64(i - 3), "Error at position " << i);
+    }
+
+    STXXL_MSG("transform_reduce ...");
+    const int64 n = v.size() - 8;
+    int64 sum = stxxl::transform_reduce(v.begin() + 3, v.end() - 5, int64(0), plus<int64>(), identity<int64>(), 8);
+    STXXL_CHECK(sum == n * (n - 1) / 2);
+    sum = stxxl::transform_reduce(v.begin() + 3, v.begin() + 4, int64(7), plus<int64>(), identity<int64>(), 8);
+    STXXL_CHECK(sum == 7);
+    sum = stxxl::transform_reduce(v.begin() + 3, v.begin() + 3, int64(7), plus<int64>(), identity<int64>(), 8);
+    STXXL_CHECK(sum == 7);
+
+    STXXL_MSG("parallel_for_each ...");
+    stxxl::parallel_for_each(v.begin() + 3, v.end() - 5, check_less<int64>(n), 8);
+
+    STXXL_MSG("parallel_for_each_m ...");
+    b = timestamp();
+    stxxl::parallel_for_each_m(v.begin() + 3, v.end() - 5, square<int64>(), 8);
+    e = timestamp();
+    STXXL_MSG("parallel_for_each_m time: " << (e - b));
+
+    STXXL_MSG("check");
+    STXXL_CHECK(v[2] == 555 && v[v.size() - 5] == 555);
+    for (i = 3; i < v.size() - 5; ++i)
+    {
+        STXXL_CHECK2(v[i] == int64((i - 3) * (i - 3)), "Error at position " << i);
+    }
+
+    STXXL_MSG("parallel_find ...");
+    for (int64 k = 0; k < 4; ++k)
+    {
+        const int64 pos[] = { 0, 1023, 1024 * 1024, n - 1 };
+        STXXL_CHECK(stxxl::parallel_find(v.begin() + 3, v.end() - 5, pos[k] * pos[k], 8) - v.begin() == pos[k] + 3);
+    }
+    STXXL_CHECK(stxxl::parallel_find(v.begin() + 3, v.end() - 5, 555, 8) == v.end() - 5);
+    STXXL_CHECK(stxxl::parallel_find(v.begin(), v.end(), 555, 8) - v.begin() == 1);
+
     return 0;
 }
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *  tests/algo/test_stable_ksort_skewed.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example algo/test_stable_ksort_skewed.cpp
+//! Test \c stxxl::stable_ksort() with skewed keys, duplicates and recursion
+
+#include <limits>
+#include <vector>
+#include <stxxl/stable_ksort>
+#include <stxxl/vector>
+
+struct my_type
+{
+    typedef stxxl::uint64 key_type;
+
+    key_type _key;
+    stxxl::uint64 index;        // position in the input, to check stability
+
+    key_type key() const
+    {
+        return _key;
+    }
+
+    my_type() { }
+    my_type(key_type __key, stxxl::uint64 __index) : _key(__key), index(__index) { }
+};
+
+typedef stxxl::VECTOR_GENERATOR<my_type, 2, 2, 128 * 1024>::result vector_type;
+
+enum distribution { UNIFORM, EXPONENTIAL, FEW_KEYS, ONE_HEAVY_KEY, EQUAL, DESCENDING };
+
+stxxl::uint64 make_key(distribution d, stxxl::uint64 i, stxxl::uint64 n, stxxl::random_number64 & rnd)
+{
+    switch (d)
+    {
+    case UNIFORM:
+        return rnd();
+    case EXPONENTIAL:
+        return rnd() >> (rnd() % 64);
+    case FEW_KEYS:
+        return rnd() % 5;
+    case ONE_HEAVY_KEY:
+        return (rnd() % 10) ? 1000000 : rnd() % 2000000;
+    case EQUAL:
+        return 42;
+    case DESCENDING:
+    default:
+        return n - i;
+    }
+}
+
+void test(distribution d, stxxl::uint64 n, stxxl::uint64 front, stxxl::uint64 back, stxxl::unsigned_type memory)
+{
+    STXXL_MSG("distribution " << d << ": sorting " << n << " records, leaving " << front << " + " << back << " untouched");
+    stxxl::random_number64 rnd(42 + d);
+    vector_type v(front + n + back);
+    for (stxxl::uint64 i = 0; i < v.size(); ++i)
+        v[i] = my_type(make_key(d, i, n, rnd), i);
+
+    stxxl::stable_ksort(v.begin() + front, v.end() - back, memory);
+
+    vector_type::const_iterator it = v.cbegin();
+    std::vector<bool> seen(n, false);
+    for (stxxl::uint64 i = 0; i < v.size(); ++i, ++it)
+    {
+        const my_type & r = *it;
+        if (i < front || i >= front + n)
+        {
+            STXXL_CHECK(r.index == i);
+            continue;
+        }
+        STXXL_CHECK(r.index >= front && r.index < front + n);
+        STXXL_CHECK(!seen[r.index - front]);
+        seen[r.index - front] = true;
+        if (i > front)
+        {
+            const my_type & p = *(it - 1);
+            STXXL_CHECK(p.key() <= r.key());
+            // stable: equal keys keep their input order
+            STXXL_CHECK(p.key() < r.key() || p.index < r.index);
+        }
+    }
+}
+
+int main()
+{
+    const stxxl::unsigned_type memory = 4 * 1024 * 1024;
+    const stxxl::uint64 n = 2 * 1024 * 1024;
+
+    test(UNIFORM, 100000, 0, 0, memory);                // in memory
+    test(UNIFORM, n, 1000, 777, memory);
+    test(EXPONENTIAL, n, 0, 0, memory);
+    test(FEW_KEYS, n, 5, 0, memory);
+    test(ONE_HEAVY_KEY, n, 0, 3, memory);
+    test(EQUAL, n, 0, 0, memory);
+    test(DESCENDING, n, 0, 0, memory);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
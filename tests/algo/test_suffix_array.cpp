@@ -0,0 +1,138 @@
+/***************************************************************************
+ *  tests/algo/test_suffix_array.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Compares stxxl::suffix_array and stxxl::lcp_array with naive internal
+//! constructions on random, repetitive and tiny texts, checks the in-memory
+//! and the fully external LCP computation, and checks that
+//! stxxl::suffix_array_check rejects a wrong suffix array.
+
+#include <algorithm>
+#include <vector>
+#include <stxxl/suffix_array>
+#include <stxxl/bits/common/rand.h>
+
+typedef stxxl::VECTOR_GENERATOR<unsigned char>::result text_type;
+typedef stxxl::VECTOR_GENERATOR<stxxl::uint32>::result sa_type;
+
+const stxxl::uint64 memory = 64 * 1024 * 1024;
+
+struct suffix_less
+{
+    const std::vector<unsigned char> & t;
+
+    suffix_less(const std::vector<unsigned char> & t_) : t(t_) { }
+
+    bool operator () (stxxl::uint32 a, stxxl::uint32 b) const
+    {
+        return std::lexicographical_compare(t.begin() + a, t.end(), t.begin() + b, t.end());
+    }
+};
+
+void check(const std::vector<unsigned char> & itext, bool naive)
+{
+    const stxxl::uint32 n = stxxl::uint32(itext.size());
+    text_type text(itext.size());
+    std::copy(itext.begin(), itext.end(), text.begin());
+
+    sa_type sa, lcp;
+    stxxl::suffix_array(text, sa, memory);
+    STXXL_CHECK(sa.size() == n);
+    STXXL_CHECK(stxxl::suffix_array_check(text, sa, memory));
+
+    std::vector<stxxl::uint32> isa(n);
+    std::copy(sa.begin(), sa.end(), isa.begin());
+    if (naive)
+    {
+        std::vector<stxxl::uint32> expected(n);
+        for (stxxl::uint32 i = 0; i < n; ++i)
+            expected[i] = i;
+        std::sort(expected.begin(), expected.end(), suffix_less(itext));
+        STXXL_CHECK(std::equal(expected.begin(), expected.end(), isa.begin()));
+    }
+
+    // Kasai et al. in internal memory
+    std::vector<stxxl::uint32> rank(n), expected_lcp(n, 0);
+    for (stxxl::uint32 i = 0; i < n; ++i)
+        rank[isa[i]] = i;
+    for (stxxl::uint32 j = 0, l = 0; j < n; ++j)
+    {
+        if (rank[j] == 0)
+        {
+            l = 0;
+            continue;
+        }
+        const stxxl::uint32 k = isa[rank[j] - 1];
+        while (j + l < n && k + l < n && itext[j + l] == itext[k + l])
+            ++l;
+        expected_lcp[rank[j]] = l;
+        if (l > 0)
+            --l;
+    }
+    stxxl::lcp_array(text, sa, lcp, memory);
+    STXXL_CHECK(lcp.size() == n);
+    for (stxxl::uint32 i = 0; i < n; ++i)
+        STXXL_CHECK(lcp[i] == expected_lcp[i]);
+
+    // the fully external variant for texts larger than the memory budget
+    sa_type lcp_ext;
+    stxxl::suffix_array_local::lcp_doubling(text, sa, lcp_ext, memory);
+    STXXL_CHECK(lcp_ext.size() == n);
+    for (stxxl::uint32 i = 0; i < n; ++i)
+        STXXL_CHECK2(lcp_ext[i] == expected_lcp[i], "Error at position " << i);
+}
+
+int main()
+{
+    stxxl::random_number32 rnd;
+
+    // tiny texts of all sizes
+    for (unsigned n = 1; n < 40; ++n)
+    {
+        std::vector<unsigned char> t(n);
+        for (unsigned i = 0; i < n; ++i)
+            t[i] = 'a' + rnd() % 3;
+        check(t, true);
+    }
+    {
+        // DNA-like
+        std::vector<unsigned char> t(20000);
+        for (unsigned i = 0; i < t.size(); ++i)
+            t[i] = "ACGT"[rnd() % 4];
+        check(t, true);
+    }
+    {
+        // highly repetitive, needs many recursion levels
+        std::vector<unsigned char> t(30000, 'a');
+        check(t, true);
+        for (unsigned i = 0; i < t.size(); ++i)
+            t[i] = "abcab"[i % 5];
+        check(t, true);
+    }
+    {
+        // larger than the sort memory
+        std::vector<unsigned char> t(1000000);
+        for (unsigned i = 0; i < t.size(); ++i)
+            t[i] = (unsigned char)(rnd() % 256);
+        check(t, false);
+    }
+    {
+        // a wrong suffix array is detected
+        text_type text(1000);
+        for (unsigned i = 0; i < text.size(); ++i)
+            text[i] = "ACGT"[rnd() % 4];
+        sa_type sa;
+        stxxl::suffix_array(text, sa, memory);
+        std::swap(sa[10], sa[11]);
+        STXXL_CHECK(!stxxl::suffix_array_check(text, sa, memory));
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *  tests/common/test_trace.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example common/test_trace.cpp
+//! This tests the trace events recorded by \c stxxl::tracer and their Chrome
+//! trace output.
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <stxxl/bits/common/trace.h>
+#include <stxxl/sort>
+#include <stxxl/vector>
+#include <stxxl/random>
+
+using stxxl::tracer;
+using stxxl::scoped_trace;
+
+struct cmp_less_int : public std::less<int>
+{
+    int min_value() const
+    {
+        return std::numeric_limits<int>::min();
+    }
+
+    int max_value() const
+    {
+        return std::numeric_limits<int>::max();
+    }
+};
+
+unsigned count(const std::string & s, const std::string & what)
+{
+    unsigned n = 0;
+    for (std::string::size_type pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1))
+        ++n;
+    return n;
+}
+
+std::string dump()
+{
+    std::ostringstream o;
+    tracer::get_instance()->dump(o);
+    return o.str();
+}
+
+int main()
+{
+    tracer * t = tracer::get_instance();
+
+    // disabled: nothing is recorded
+    {
+        scoped_trace trace("test", "disabled");
+    }
+    STXXL_CHECK(t->size() == 0);
+
+    // the ring buffer keeps the most recent events
+    t->enable("", 16);
+    for (int i = 0; i < 20; ++i)
+    {
+        scoped_trace trace("test", "event", "i", i);
+        trace.set_arg("square", i * i);
+    }
+    STXXL_CHECK(t->size() == 16);
+    STXXL_CHECK(t->get_dropped() == 4);
+    std::string s = dump();
+    STXXL_CHECK(s.compare(0, 16, "{\"traceEvents\":[") == 0);
+    STXXL_CHECK(count(s, "\"name\":\"event\"") == 16);
+    STXXL_CHECK(count(s, "\"args\":{\"i\":3,") == 0);
+    STXXL_CHECK(count(s, "\"args\":{\"i\":4,\"square\":16}") == 1);
+    STXXL_CHECK(count(s, "\"args\":{\"i\":19,\"square\":361}") == 1);
+    STXXL_CHECK(count(s, "4 older events dropped") == 1);
+    // oldest event first
+    STXXL_CHECK(s.find("\"i\":4,") < s.find("\"i\":19,"));
+
+    t->clear();
+    STXXL_CHECK(t->size() == 0);
+
+    // an external sort records its phases, the disk queue threads the requests
+    {
+        typedef stxxl::VECTOR_GENERATOR<int, 4, 4, 64 * 1024>::result vector_type;
+        vector_type v(4 * 1024 * 1024);
+        stxxl::random_number32 rnd;
+        for (vector_type::size_type i = 0; i < v.size(); ++i)
+            v[i] = rnd();
+        t->enable("", 1024 * 1024);
+        stxxl::sort(v.begin(), v.end(), cmp_less_int(), 4 * 1024 * 1024);
+        t->disable();
+    }
+    s = dump();
+    STXXL_MSG("recorded " << t->size() << " events");
+    STXXL_CHECK(count(s, "\"name\":\"run formation\"") == 1);
+    STXXL_CHECK(count(s, "\"name\":\"sort run\"") >= 2);
+    STXXL_CHECK(count(s, "\"name\":\"merge\"") >= 1);
+    STXXL_CHECK(count(s, "\"name\":\"serve read\"") >= 1);
+    STXXL_CHECK(count(s, "\"name\":\"serve write\"") >= 1);
+    STXXL_CHECK(count(s, "older events dropped") == 0);
+    // the disk queue threads record into buffers of their own
+    STXXL_CHECK(count(s, "\"tid\":2") >= 1);
+
+    // recording stops when disabled
+    const stxxl::unsigned_type recorded = t->size();
+    {
+        scoped_trace trace("test", "disabled");
+    }
+    STXXL_CHECK(t->size() == recorded);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *  tests/containers/test_vector_concurrent_read.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks several threads reading one vector at the same time, with
+//! vector_reader lookups and vector_bufreader scans.
+
+#include <vector>
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread/thread.hpp>
+ #include <boost/bind.hpp>
+#else
+ #include <pthread.h>
+#endif
+
+#include <stxxl/vector>
+
+typedef stxxl::VECTOR_GENERATOR<stxxl::uint64, 2, 2, 4096>::result vector_type;
+
+const stxxl::unsigned_type num_threads = 4;
+const stxxl::uint64 num_lookups = 20000;
+
+stxxl::uint64 value_at(stxxl::uint64 i)
+{
+    return i * 7 + 3;
+}
+
+struct worker_args
+{
+    const vector_type * v;
+    stxxl::unsigned_type id;
+    stxxl::uint64 errors;
+};
+
+//! Random lookups all over the vector, then a scan of the thread's part.
+void * worker_main(void * arg)
+{
+    worker_args & args = *static_cast<worker_args *>(arg);
+    const vector_type & v = *args.v;
+
+    {
+        vector_type::reader_type reader(v, 3);
+        stxxl::uint64 state = args.id + 1;
+        for (stxxl::uint64 k = 0; k < num_lookups; ++k)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            const stxxl::uint64 i = (state >> 17) % v.size();
+            if (reader[i] != value_at(i))
+                ++args.errors;
+        }
+    }
+
+    const stxxl::uint64 part = v.size() / num_threads;
+    const stxxl::uint64 first = args.id * part;
+    const stxxl::uint64 last = (args.id + 1 == num_threads) ? v.size() : first + part;
+    vector_type::bufreader_type bufreader(v.cbegin() + first, v.cbegin() + last);
+    for (stxxl::uint64 i = first; !bufreader.empty(); ++bufreader, ++i)
+    {
+        if (*bufreader != value_at(i))
+            ++args.errors;
+    }
+    return NULL;
+}
+
+int main()
+{
+    vector_type v(1024 * 1024 + 123);
+    {
+        vector_type::bufwriter_type writer(v.begin());
+        for (stxxl::uint64 i = 0; i < v.size(); ++i)
+            writer << value_at(i);
+    }
+
+    // a single reader sees the elements written through the vector's cache
+    v[5] = 0;
+    {
+        vector_type::reader_type reader(v);
+        STXXL_CHECK(reader.size() == v.size());
+        STXXL_CHECK(reader[5] == 0);
+        STXXL_CHECK(reader[v.size() - 1] == value_at(v.size() - 1));
+    }
+    v[5] = value_at(5);
+
+    std::vector<worker_args> args(num_threads);
+#if STXXL_STD_THREADS
+    std::vector<std::thread *> threads(num_threads);
+#elif STXXL_BOOST_THREADS
+    std::vector<boost::thread *> threads(num_threads);
+#else
+    std::vector<pthread_t> threads(num_threads);
+#endif
+    for (stxxl::unsigned_type t = 0; t < num_threads; ++t)
+    {
+        args[t].v = &v;
+        args[t].id = t;
+        args[t].errors = 0;
+#if STXXL_STD_THREADS
+        threads[t] = new std::thread(worker_main, &args[t]);
+#elif STXXL_BOOST_THREADS
+        threads[t] = new boost::thread(boost::bind(worker_main, &args[t]));
+#else
+        STXXL_CHECK(pthread_create(&threads[t], NULL, worker_main, &args[t]) == 0);
+#endif
+    }
+    for (stxxl::unsigned_type t = 0; t < num_threads; ++t)
+    {
+#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+        threads[t]->join();
+        delete threads[t];
+#else
+        STXXL_CHECK(pthread_join(threads[t], NULL) == 0);
+#endif
+        STXXL_CHECK2(args[t].errors == 0, "thread " << t << " read " << args[t].errors << " wrong elements");
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
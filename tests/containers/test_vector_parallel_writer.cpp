@@ -0,0 +1,120 @@
+/***************************************************************************
+ *  tests/containers/test_vector_parallel_writer.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks several threads filling one vector with vector_parallel_writer.
+
+#include <vector>
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread/thread.hpp>
+ #include <boost/bind.hpp>
+#else
+ #include <pthread.h>
+#endif
+
+#include <stxxl/vector>
+
+typedef stxxl::VECTOR_GENERATOR<stxxl::uint64, 2, 2, 4096>::result vector_type;
+typedef vector_type::parallel_writer_type parallel_writer_type;
+
+stxxl::uint64 value_at(stxxl::uint64 i)
+{
+    return i * 5 + 1;
+}
+
+//! Writes the whole range of one writer.
+void * worker_main(void * arg)
+{
+    parallel_writer_type::range_writer & writer = *static_cast<parallel_writer_type::range_writer *>(arg);
+    for (stxxl::uint64 i = writer.range_begin(); i < writer.range_end(); ++i)
+        writer << value_at(i);
+    writer.finish();
+    return NULL;
+}
+
+//! Fills a vector of n elements with k threads and checks it.
+void test(vector_type & v, stxxl::uint64 n, stxxl::unsigned_type k)
+{
+    {
+        parallel_writer_type writers(v, n, k);
+        STXXL_CHECK(writers.num_writers() == k);
+        STXXL_CHECK(writers[0].range_begin() == 0);
+        STXXL_CHECK(writers[k - 1].range_end() == n);
+
+#if STXXL_STD_THREADS
+        std::vector<std::thread *> threads(k);
+#elif STXXL_BOOST_THREADS
+        std::vector<boost::thread *> threads(k);
+#else
+        std::vector<pthread_t> threads(k);
+#endif
+        for (stxxl::unsigned_type t = 0; t < k; ++t)
+        {
+            if (t > 0)
+                STXXL_CHECK(writers[t].range_begin() == writers[t - 1].range_end());
+            STXXL_CHECK(writers[t].size() == 0 || writers[t].range_begin() % vector_type::block_type::size == 0);
+#if STXXL_STD_THREADS
+            threads[t] = new std::thread(worker_main, &writers[t]);
+#elif STXXL_BOOST_THREADS
+            threads[t] = new boost::thread(boost::bind(worker_main, &writers[t]));
+#else
+            STXXL_CHECK(pthread_create(&threads[t], NULL, worker_main, &writers[t]) == 0);
+#endif
+        }
+        for (stxxl::unsigned_type t = 0; t < k; ++t)
+        {
+#if STXXL_STD_THREADS || STXXL_BOOST_THREADS
+            threads[t]->join();
+            delete threads[t];
+#else
+            STXXL_CHECK(pthread_join(threads[t], NULL) == 0);
+#endif
+        }
+        writers.finish();
+    }
+
+    STXXL_CHECK(v.size() == n);
+    for (stxxl::uint64 i = 0; i < n; ++i)
+        STXXL_CHECK2(v[i] == value_at(i), "Error at position " << i);
+
+    vector_type::bufreader_type reader(v);
+    for (stxxl::uint64 i = 0; !reader.empty(); ++reader, ++i)
+        STXXL_CHECK2(*reader == value_at(i), "Error at position " << i);
+}
+
+int main()
+{
+    vector_type v;
+    test(v, 1024 * 1024 + 123, 4);
+
+    // overwrites the old contents, also in the vector's cache
+    v[7] = 0;
+    test(v, 3 * 512 + 5, 3);
+
+    // more writers than blocks, some get empty ranges
+    test(v, 1000, 7);
+
+    // nothing written in one range: the vector stays usable
+    {
+        parallel_writer_type writers(v, 4096, 2);
+        for (stxxl::uint64 i = 0; i < writers[0].range_end(); ++i)
+            writers[0] << value_at(i);
+    }
+    STXXL_CHECK(v.size() == 4096);
+    STXXL_CHECK(v[1] == value_at(1));
+    v[4000] = 42;
+    STXXL_CHECK(v[4000] == 42);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *  tests/containers/test_vector_shared_cache.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks vectors of different types paging through one shared_page_cache.
+
+#include <iostream>
+#include <stxxl/vector>
+
+typedef stxxl::VECTOR_GENERATOR<stxxl::uint64, 2, 2, 4096>::result vector64_type;
+typedef stxxl::VECTOR_GENERATOR<stxxl::uint32, 2, 2, 4096>::result vector32_type;
+
+template <typename vector_type>
+void fill(vector_type & v, stxxl::uint64 seed)
+{
+    for (stxxl::uint64 i = 0; i < v.size(); ++i)
+        v[i] = typename vector_type::value_type(i * seed + 1);
+}
+
+template <typename vector_type>
+void check(const vector_type & v, stxxl::uint64 seed)
+{
+    for (stxxl::uint64 i = 0; i < v.size(); ++i)
+        STXXL_CHECK(v[i] == typename vector_type::value_type(i * seed + 1));
+}
+
+int main()
+{
+    const stxxl::unsigned_type slots = 6;
+    stxxl::shared_page_cache cache(slots, 8192);
+
+    {
+        vector64_type a(10000), b(20000);
+        vector32_type c(30000);
+        a.attach_cache(cache);
+        b.attach_cache(cache);
+        c.attach_cache(cache);
+
+        fill(a, 3);
+        fill(b, 5);
+        fill(c, 7);
+        STXXL_CHECK(cache.size_free() == 0);
+        check(a, 3);
+        check(c, 7);
+        check(b, 5);
+
+        // a hot vector takes over the whole cache
+        cache.reset_stats();
+        for (int round = 0; round < 4; ++round)
+            for (stxxl::uint64 i = 0; i < 4 * 1024; ++i)
+                STXXL_CHECK(a[i] == i * 3 + 1);
+        STXXL_CHECK(a.shared_cache_pages() == 4);      // 4 pages of 2 blocks
+        STXXL_CHECK(cache.get_misses() <= 4 + 2);
+        STXXL_CHECK(cache.get_hits() > 0);
+
+        // ... unless limited by a quota
+        a.set_cache_quota(2);
+        STXXL_CHECK(a.shared_cache_pages() <= 2);
+        check(a, 3);
+        STXXL_CHECK(a.shared_cache_pages() <= 2);
+
+        // two references from different vectors are valid at the same time
+        std::swap(a[100], b[100]);
+        STXXL_CHECK(a[100] == 100 * 5 + 1 && b[100] == 100 * 3 + 1);
+        std::swap(a[100], b[100]);
+
+        // swap content while pages are cached
+        vector64_type d(5000);
+        fill(d, 11);
+        a.swap(d);
+        check(a, 11);
+        check(d, 3);
+        d.attach_cache(cache);
+        a.detach_cache();
+        check(d, 3);
+        check(a, 11);
+        STXXL_CHECK(a.shared_cache_pages() == 0);
+
+        // shrink and clear while pages are cached
+        check(b, 5);
+        b.resize(3000, true);
+        check(b, 5);
+        c.clear();
+        STXXL_CHECK(c.shared_cache_pages() == 0);
+        c.resize(1000);
+        fill(c, 13);
+        check(c, 13);
+
+        STXXL_MSG("shared cache: hits " << cache.get_hits() << " misses " << cache.get_misses() << " evictions " << cache.get_evictions());
+    }
+    STXXL_CHECK(cache.size_free() == slots);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *  tests/io/test_completion_queue.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example io/test_completion_queue.cpp
+//! This tests \c stxxl::completion_queue with reads, writes, chained
+//! completion handlers and canceled requests.
+
+#include <algorithm>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/request>
+#include <stxxl/aligned_alloc>
+
+using stxxl::file;
+using stxxl::request;
+using stxxl::request_ptr;
+using stxxl::completion_queue;
+using stxxl::unsigned_type;
+
+struct count_handler
+{
+    unsigned_type * count;
+
+    count_handler(unsigned_type * count_) : count(count_) { }
+
+    void operator () (request *)
+    {
+        ++*count;
+    }
+};
+
+int main()
+{
+    const unsigned_type block = 4096, num_blocks = 512;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(block * num_blocks);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        std::fill(buffer + i * block, buffer + (i + 1) * block, char(i));
+
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR));
+    f->set_size(block * num_blocks);
+
+    completion_queue cq;
+    STXXL_CHECK(cq.empty());
+    STXXL_CHECK(!cq.wait_next().valid());       // nothing tagged: returns at once
+    STXXL_CHECK(!cq.try_next().valid());
+
+    // writes, every completion is returned exactly once
+    unsigned_type handled = 0;
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        f->awrite(buffer + i * block, i * block, block, cq.tag(count_handler(&handled)));
+    STXXL_CHECK(cq.size() == num_blocks);
+    std::vector<bool> seen(num_blocks, false);
+    unsigned_type returned = 0;
+    while (request_ptr req = cq.wait_next())
+    {
+        STXXL_CHECK(req->poll());
+        STXXL_CHECK(req->get_type() == request::WRITE);
+        const unsigned_type i = (unsigned_type)req->get_offset() / block;
+        STXXL_CHECK(!seen[i]);
+        seen[i] = true;
+        ++returned;
+    }
+    STXXL_CHECK(returned == num_blocks);
+    STXXL_CHECK(handled == num_blocks);         // chained handlers ran
+    STXXL_CHECK(cq.empty());
+
+    // reads into a cleared buffer, polled with try_next()
+    std::fill(buffer, buffer + block * num_blocks, 0);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        f->aread(buffer + i * block, i * block, block, cq.tag());
+    returned = 0;
+    while (!cq.empty())
+    {
+        request_ptr req = cq.try_next();
+        if (!req.valid())
+            continue;
+        const unsigned_type i = (unsigned_type)req->get_offset() / block;
+        STXXL_CHECK(std::count((char *)req->get_buffer(), (char *)req->get_buffer() + block, char(i)) == int(block));
+        ++returned;
+    }
+    STXXL_CHECK(returned == num_blocks);
+
+    // canceled requests are not waited for
+    std::vector<request_ptr> reqs(num_blocks);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        reqs[i] = f->aread(buffer + i * block, i * block, block, cq.tag());
+    unsigned_type canceled = 0;
+    for (unsigned_type i = num_blocks; i > 0; --i)
+        if (cq.cancel(reqs[i - 1]))
+            ++canceled;
+    returned = 0;
+    while (cq.wait_next().valid())
+        ++returned;
+    STXXL_MSG("canceled " << canceled << " of " << num_blocks << " requests");
+    STXXL_CHECK(returned + canceled == num_blocks);
+    stxxl::wait_all(reqs.begin(), reqs.end());
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
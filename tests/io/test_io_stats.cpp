@@ -0,0 +1,123 @@
+/***************************************************************************
+ *  tests/io/test_io_stats.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example io/test_io_stats.cpp
+//! This tests the per-queue I/O statistics, latency histograms and queue
+//! depth sampling.
+
+#include <algorithm>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+
+using stxxl::file;
+using stxxl::stats;
+using stxxl::latency_histogram;
+using stxxl::unsigned_type;
+
+void test_histogram()
+{
+    for (unsigned b = 0; b < latency_histogram::num_buckets - 1; ++b)
+    {
+        const double upper = latency_histogram::bucket_upper(b);
+        STXXL_CHECK(upper < latency_histogram::bucket_upper(b + 1));
+        STXXL_CHECK(latency_histogram::bucket(upper * 0.999) == b);
+        STXXL_CHECK(latency_histogram::bucket(upper * 1.001) == b + 1);
+    }
+    STXXL_CHECK(latency_histogram::bucket(1e6) == latency_histogram::num_buckets - 1);
+
+    // 900 fast operations of 1 ms, 99 of 10 ms and one of 1 s
+    latency_histogram h;
+    h.add(latency_histogram::bucket(1e-3), 900);
+    h.add(latency_histogram::bucket(1e-2), 99);
+    h.add(latency_histogram::bucket(1.0));
+    STXXL_CHECK(h.count() == 1000);
+    STXXL_CHECK(h.percentile(0.5) >= 1e-3 && h.percentile(0.5) < 1.25e-3);
+    STXXL_CHECK(h.percentile(0.99) >= 1e-2 && h.percentile(0.99) < 1.25e-2);
+    STXXL_CHECK(h.percentile(0.9999) >= 1.0 && h.percentile(0.9999) < 1.25);
+    STXXL_CHECK((h - h).count() == 0);
+}
+
+int main()
+{
+    test_histogram();
+
+    const unsigned_type block = 64 * 1024, num_blocks = 128;
+    const int queue = 5, other_queue = 7;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(block);
+    std::fill(buffer, buffer + block, 0);
+
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR, queue));
+    stxxl::compat_unique_ptr<file>::result g(stxxl::create_file("memory", "", file::RDWR, other_queue));
+    f->set_size(num_blocks * block);
+    g->set_size(block);
+    stxxl::request_ptr req[num_blocks];
+
+    stats * s = stats::get_instance();
+    s->set_queue_depth_sampling(1e-6, 16);
+    stxxl::stats_data global_begin(*s);
+    stxxl::disk_stats_data begin = s->get_disk_stats(queue);
+
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        req[i] = f->awrite(buffer, i * block, block, stxxl::default_completion_handler());
+    wait_all(req, num_blocks);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        req[i] = f->aread(buffer, i * block, block, stxxl::default_completion_handler());
+    wait_all(req, num_blocks);
+    g->awrite(buffer, 0, block, stxxl::default_completion_handler())->wait();
+
+    stxxl::disk_stats_data d = s->get_disk_stats(queue) - begin;
+    std::cout << d;
+    STXXL_CHECK(d.get_queue_id() == queue);
+    STXXL_CHECK(d.get_reads() == num_blocks && d.get_writes() == num_blocks);
+    STXXL_CHECK(d.get_read_volume() == stxxl::int64(num_blocks * block));
+    STXXL_CHECK(d.get_written_volume() == stxxl::int64(num_blocks * block));
+    STXXL_CHECK(d.get_read_latency().count() == num_blocks);
+    STXXL_CHECK(d.get_write_latency().count() == num_blocks);
+    STXXL_CHECK(d.get_read_latency().percentile(0.5) <= d.get_read_latency().percentile(0.999));
+    STXXL_CHECK(d.get_queue_depth() == 0);
+    STXXL_CHECK(d.get_max_queue_depth() >= 1);
+    STXXL_CHECK(d.get_utilization() >= 0.0 && d.get_utilization() <= 1.0);
+
+    // samples are thinned out to stay below the limit and are ordered by time
+    const std::vector<std::pair<double, unsigned> > & samples = d.get_queue_depth_samples();
+    STXXL_CHECK(!samples.empty() && samples.size() < 16);
+    for (unsigned_type i = 1; i < samples.size(); ++i)
+        STXXL_CHECK(samples[i - 1].first <= samples[i].first);
+
+    // the other queue is accounted separately
+    STXXL_CHECK(s->get_disk_stats(other_queue).get_writes() == 1);
+    STXXL_CHECK(s->get_disk_stats(other_queue).get_reads() == 0);
+    std::vector<int> ids = s->get_disk_ids();
+    STXXL_CHECK(std::find(ids.begin(), ids.end(), queue) != ids.end());
+    STXXL_CHECK(std::find(ids.begin(), ids.end(), other_queue) != ids.end());
+
+    // the process-wide totals include both queues
+    stxxl::stats_data global = stxxl::stats_data(*s) - global_begin;
+    STXXL_CHECK(global.get_reads() == num_blocks);
+    STXXL_CHECK(global.get_writes() == num_blocks + 1);
+    STXXL_CHECK(global.get_pio_time() <= global.get_read_time() + global.get_write_time() + 1e-3);
+
+    // canceled requests leave the queue, too
+    s->set_queue_depth_sampling(0);
+    begin = s->get_disk_stats(queue);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        req[i] = f->awrite(buffer, i * block, block, stxxl::default_completion_handler());
+    const unsigned_type canceled = cancel_all(req, req + num_blocks);
+    wait_all(req, num_blocks);
+    d = s->get_disk_stats(queue) - begin;
+    STXXL_MSG("canceled " << canceled << " of " << num_blocks << " requests");
+    STXXL_CHECK(d.get_writes() + canceled == num_blocks);
+    STXXL_CHECK(d.get_queue_depth() == 0);
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *  tests/io/test_io_throttle.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example io/test_io_throttle.cpp
+//! This tests the token buckets of \c stxxl::io_throttle and that the disk
+//! queues defer throttled requests while serving others.
+
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/timer>
+
+using stxxl::file;
+using stxxl::request_ptr;
+using stxxl::io_throttle;
+using stxxl::scoped_io_throttle;
+using stxxl::unsigned_type;
+
+int main()
+{
+    // bandwidth: the burst is granted, then one request may overdraw
+    {
+        io_throttle t(1024 * 1024, 0, 0.1);
+        const double now = stxxl::timestamp();
+        STXXL_CHECK(t.acquire(64 * 1024, now) == 0.0);
+        STXXL_CHECK(t.acquire(64 * 1024, now) == 0.0);
+        const double ready = t.acquire(64 * 1024, now);
+        STXXL_CHECK(ready > now);
+        STXXL_CHECK(ready - now < 0.03);
+        STXXL_CHECK(t.acquire(64 * 1024, ready) == 0.0);
+        STXXL_CHECK(t.get_deferred() == 1);
+    }
+
+    // requests per second
+    {
+        io_throttle t(0, 100, 0.1);
+        const double now = stxxl::timestamp();
+        for (int i = 0; i < 11; ++i)
+            STXXL_CHECK(t.acquire(1, now) == 0.0);
+        STXXL_CHECK(t.acquire(1, now) > now);
+        t.set_limits(0, 0);
+        STXXL_CHECK(t.acquire(1, now) == 0.0);
+    }
+
+    // the queue serves unthrottled requests while throttled ones wait
+    const unsigned_type block = 64 * 1024, num_blocks = 64;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(2 * block * num_blocks);
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR));
+    f->set_size(2 * block * num_blocks);
+
+    io_throttle limit(4 * 1024 * 1024);
+    stxxl::timer timer;
+    timer.start();
+    std::vector<request_ptr> throttled;
+    {
+        scoped_io_throttle context(limit);
+        for (unsigned_type i = 0; i < num_blocks; ++i)
+            throttled.push_back(f->awrite(buffer + i * block, i * block, block, stxxl::default_completion_handler()));
+    }
+    std::vector<request_ptr> others;
+    for (unsigned_type i = num_blocks; i < 2 * num_blocks; ++i)
+        others.push_back(f->aread(buffer + i * block, i * block, block, stxxl::default_completion_handler()));
+    stxxl::wait_all(others.begin(), others.end());
+    const double others_done = timer.seconds();
+
+    unsigned_type finished = 0;
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        finished += throttled[i]->poll();
+    STXXL_CHECK(finished < num_blocks);
+    // a deferred request can be canceled
+    STXXL_CHECK(throttled.back()->cancel());
+
+    stxxl::wait_all(throttled.begin(), throttled.end());
+    const double throttled_done = timer.seconds();
+    STXXL_MSG("unthrottled reads done after " << others_done << " s, throttled writes after " << throttled_done << " s");
+    // 4 MiB at 4 MiB/s, less the burst and the canceled request
+    STXXL_CHECK(throttled_done > 0.8);
+    STXXL_CHECK(others_done < throttled_done / 2);
+    STXXL_CHECK(limit.get_deferred() > 0);
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -11,6 +11,8 @@
  *  http://www.boost.org/LICENSE_1_0.txt)
  **************************************************************************/
 
+#include <fstream>
+#include <string>
 #include <stxxl.h>
 
 struct my_handler
@@ -49,6 +51,103 @@ void testIO()
     unlink(paths[1]);
 }
 
+void testMapReadonly()
+{
+#ifndef STXXL_WINDOWS
+    const char * path = "/var/tmp/data_mapped";
+    typedef stxxl::VECTOR_GENERATOR<stxxl::uint64, 2, 2, 64 * 1024>::result vector_type;
+    const stxxl::uint64 size = 10 * vector_type::block_type::size + 42;
+
+    {
+        stxxl::mmap_file file(path, stxxl::file::CREAT | stxxl::file::RDWR | stxxl::file::TRUNC);
+        vector_type vec(&file, size);
+        for (stxxl::uint64 i = 0; i < size; ++i)
+            vec[i] = i;
+        vec.flush();
+
+        // borrow the first block directly from the mapping
+        const stxxl::uint64 * data = static_cast<const stxxl::uint64 *>(
+            file.map_readonly(0, vector_type::block_type::raw_size, stxxl::file::SEQUENTIAL_ACCESS));
+        STXXL_CHECK(data != NULL);
+        for (unsigned i = 0; i < vector_type::block_type::size; ++i)
+            STXXL_CHECK(data[i] == i);
+        file.release_readonly(data);
+
+        // regions beyond the end of file are not available
+        STXXL_CHECK(file.map_readonly(file.size(), BLOCK_ALIGN) == NULL);
+
+        // buffered readers borrow blocks from the mapping
+        stxxl::uint64 i = 0;
+        for (vector_type::bufreader_type reader(vec); !reader.empty(); ++reader, ++i)
+            STXXL_CHECK(*reader == i);
+        STXXL_CHECK(i == size);
+
+        // vector_iterator2stream on a subrange
+        i = 17;
+        for (stxxl::stream::vector_iterator2stream<vector_type::iterator> in(vec.begin() + 17, vec.end());
+             !in.empty(); ++in, ++i)
+            STXXL_CHECK(*in == i);
+        STXXL_CHECK(i == size);
+    }
+
+    unlink(path);
+#endif
+}
+
+//! Counts the memory mappings of the process, 0 if unknown.
+unsigned count_mappings()
+{
+    std::ifstream maps("/proc/self/maps");
+    unsigned lines = 0;
+    for (std::string line; std::getline(maps, line); )
+        ++lines;
+    return lines;
+}
+
+void testMappingGrowth()
+{
+#ifndef STXXL_WINDOWS
+    const char * path = "/var/tmp/data_mapped";
+    const unsigned block_size = 64 * 1024;
+    const unsigned steps = 500;
+    char * buffer = static_cast<char *>(stxxl::aligned_alloc<BLOCK_ALIGN>(block_size));
+
+    {
+        stxxl::mmap_file file(path, stxxl::file::CREAT | stxxl::file::RDWR | stxxl::file::TRUNC);
+        const unsigned mappings_before = count_mappings();
+        const void * borrowed = NULL;
+        for (unsigned i = 0; i < steps; ++i)
+        {
+            // grow by one block, write it and read it back
+            file.set_size((i + 1) * stxxl::uint64(block_size));
+            memset(buffer, i % 256, block_size);
+            file.awrite(buffer, i * stxxl::uint64(block_size), block_size, stxxl::default_completion_handler())->wait();
+            memset(buffer, 0, block_size);
+            file.aread(buffer, i * stxxl::uint64(block_size), block_size, stxxl::default_completion_handler())->wait();
+            STXXL_CHECK(buffer[0] == char(i % 256) && buffer[block_size - 1] == char(i % 256));
+
+            const char * data = static_cast<const char *>(
+                file.map_readonly(i * stxxl::uint64(block_size), block_size));
+            STXXL_CHECK(data != NULL && data[0] == char(i % 256));
+            // keep the first region borrowed across all remappings
+            if (i == 0)
+                borrowed = data;
+            else
+                file.release_readonly(data);
+        }
+        STXXL_CHECK(static_cast<const char *>(borrowed)[block_size - 1] == 0);
+        file.release_readonly(borrowed);
+
+        // the mapping grows geometrically and outgrown ones are unmapped
+        STXXL_CHECK2(count_mappings() <= mappings_before + 4,
+                     "mappings grew from " << mappings_before << " to " << count_mappings());
+    }
+
+    stxxl::aligned_dealloc<BLOCK_ALIGN>(buffer);
+    unlink(path);
+#endif
+}
+
 void testIOException()
 {
     unlink("TestFile");
@@ -60,5 +159,7 @@ void testIOException()
 int main()
 {
     testIO();
+    testMapReadonly();
+    testMappingGrowth();
     testIOException();
 }
@@ -0,0 +1,154 @@
+/***************************************************************************
+ *  tests/io/test_request_priority.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example io/test_request_priority.cpp
+//! This tests the order in which a disk queue serves requests of different
+//! priority classes, promotion of queued requests and that a read is not
+//! served before a queued write of the same block.
+
+#include <algorithm>
+#include <vector>
+#include <unistd.h>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/bits/common/switch.h>
+
+using stxxl::file;
+using stxxl::request;
+using stxxl::request_ptr;
+using stxxl::unsigned_type;
+
+const unsigned_type block = 4096;
+
+//! Records the order of completion, runs on the disk queue thread.
+struct record_handler
+{
+    std::vector<unsigned_type> * order;
+
+    record_handler(std::vector<unsigned_type> * order_) : order(order_) { }
+
+    void operator () (request * req)
+    {
+        order->push_back((unsigned_type)req->get_offset() / block);
+    }
+};
+
+//! Keeps the disk queue thread busy until released.
+struct block_handler
+{
+    stxxl::onoff_switch * release;
+
+    block_handler(stxxl::onoff_switch * release_) : release(release_) { }
+
+    void operator () (request *)
+    {
+        release->wait_for_on();
+    }
+};
+
+int main()
+{
+    const unsigned_type num_blocks = 64;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(block * (num_blocks + 1));
+    std::fill(buffer, buffer + block * (num_blocks + 1), 0);
+
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR));
+    f->set_size(block * (num_blocks + 1));
+
+    // block 0 occupies the queue thread while the others are submitted
+    const unsigned_type n = num_blocks / 4;
+    {
+        // slacks far above the submission time, so the classes are served
+        // strictly one after another however slow the submission is
+        typedef stxxl::request_queue_impl_qwqr queue_type;
+        double default_slack[request::NUM_PRIORITIES];
+        for (int p = 0; p < request::NUM_PRIORITIES; ++p)
+        {
+            default_slack[p] = queue_type::deadline_slack(request::request_priority(p));
+            queue_type::set_deadline_slack(request::request_priority(p), 1000.0 * p);
+        }
+
+        std::vector<unsigned_type> order;
+        stxxl::onoff_switch release;
+        std::vector<request_ptr> reqs;
+        reqs.push_back(f->aread(buffer, 0, block, block_handler(&release)));
+        for (unsigned_type i = 1; i <= n; ++i)
+            reqs.push_back(f->aread(buffer + i * block, i * block, block, record_handler(&order), request::BACKGROUND));
+        for (unsigned_type i = n + 1; i <= 2 * n; ++i)
+            reqs.push_back(f->awrite(buffer + i * block, i * block, block, record_handler(&order)));
+        for (unsigned_type i = 2 * n + 1; i <= 3 * n; ++i)
+            reqs.push_back(f->aread(buffer + i * block, i * block, block, record_handler(&order), request::PREFETCH));
+        for (unsigned_type i = 3 * n + 1; i <= 4 * n; ++i)
+            reqs.push_back(f->aread(buffer + i * block, i * block, block, record_handler(&order)));
+        // a prefetch the consumer needs now
+        reqs[2 * n + 1]->promote(request::DEMAND);
+
+        // the promoted prefetch is older than all demand reads, then demand,
+        // prefetch, writeback and background, in submission order within
+        std::vector<unsigned_type> expected;
+        expected.push_back(2 * n + 1);
+        for (unsigned_type i = 3 * n + 1; i <= 4 * n; ++i)
+            expected.push_back(i);
+        for (unsigned_type i = 2 * n + 2; i <= 3 * n; ++i)
+            expected.push_back(i);
+        for (unsigned_type i = n + 1; i <= 2 * n; ++i)
+            expected.push_back(i);
+        for (unsigned_type i = 1; i <= n; ++i)
+            expected.push_back(i);
+
+        release.on();
+        // waiting promotes, so wait in the expected order
+        reqs[0]->wait();
+        for (unsigned_type i = 0; i < expected.size(); ++i)
+            reqs[expected[i]]->wait();
+        STXXL_CHECK(order == expected);
+
+        for (int p = 0; p < request::NUM_PRIORITIES; ++p)
+            queue_type::set_deadline_slack(request::request_priority(p), default_slack[p]);
+    }
+
+    // requests of low priority are not starved
+    {
+        std::vector<unsigned_type> order;
+        stxxl::onoff_switch release;
+        std::vector<request_ptr> reqs;
+        reqs.push_back(f->aread(buffer, 0, block, block_handler(&release)));
+        reqs.push_back(f->aread(buffer + block, block, block, record_handler(&order), request::BACKGROUND));
+        usleep(useconds_t(1.5e6 * stxxl::request_queue_impl_qwqr::deadline_slack(request::BACKGROUND)));
+        reqs.push_back(f->aread(buffer + 2 * block, 2 * block, block, record_handler(&order)));
+        release.on();
+        stxxl::wait_all(reqs.begin(), reqs.end());
+        STXXL_CHECK(order.size() == 2);
+        STXXL_CHECK(order[0] == 1);
+        STXXL_CHECK(order[1] == 2);
+    }
+
+    // a demand read waits for the background write of the same block
+    {
+        std::vector<unsigned_type> order;
+        stxxl::onoff_switch release;
+        char * data = (char *)stxxl::aligned_alloc<4096>(block);
+        std::fill(data, data + block, 42);
+        std::vector<request_ptr> reqs;
+        reqs.push_back(f->aread(buffer, 0, block, block_handler(&release)));
+        reqs.push_back(f->awrite(data, block, block, record_handler(&order), request::BACKGROUND));
+        reqs.push_back(f->aread(buffer + block, block, block, record_handler(&order)));
+        release.on();
+        stxxl::wait_all(reqs.begin(), reqs.end());
+        STXXL_CHECK(order.size() == 2);
+        STXXL_CHECK(std::count(buffer + block, buffer + 2 * block, 42) == int(block));
+        stxxl::aligned_dealloc<4096>(data);
+    }
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *  tests/io/test_wait_any.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example io/test_wait_any.cpp
+//! This tests completion notification with \c stxxl::wait_any(),
+//! \c stxxl::poll_any() and \c stxxl::wait_all() on many small requests.
+
+#include <algorithm>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+
+using stxxl::file;
+using stxxl::request_ptr;
+using stxxl::unsigned_type;
+
+int main()
+{
+    const unsigned_type block = 4096, num_blocks = 1024, rounds = 16;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(block * num_blocks);
+    std::fill(buffer, buffer + block * num_blocks, 1);
+
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR));
+    f->set_size(block * num_blocks);
+
+    for (unsigned_type r = 0; r < rounds; ++r)
+    {
+        std::vector<request_ptr> reqs(num_blocks);
+        for (unsigned_type i = 0; i < num_blocks; ++i)
+            reqs[i] = f->awrite(buffer + i * block, i * block, block, stxxl::default_completion_handler());
+
+        // retire the requests in completion order
+        unsigned_type done = 0;
+        while (!reqs.empty())
+        {
+            std::vector<request_ptr>::iterator it;
+            if (r % 2 == 0)
+                it = stxxl::wait_any(reqs.begin(), reqs.end());
+            else
+            {
+                it = stxxl::poll_any(reqs.begin(), reqs.end());
+                if (it == reqs.end())
+                    continue;
+            }
+            STXXL_CHECK(it != reqs.end());
+            STXXL_CHECK((*it)->poll());
+            // waiting for a completed request returns at once
+            (*it)->wait();
+            *it = reqs.back();
+            reqs.pop_back();
+            ++done;
+        }
+        STXXL_CHECK(done == num_blocks);
+
+        // the same requests waited for by wait_any() and wait_all()
+        std::vector<request_ptr> reads(num_blocks);
+        for (unsigned_type i = 0; i < num_blocks; ++i)
+            reads[i] = f->aread(buffer + i * block, i * block, block, stxxl::default_completion_handler());
+        std::vector<request_ptr>::iterator first = stxxl::wait_any(reads.begin(), reads.end());
+        STXXL_CHECK((*first)->poll());
+        stxxl::wait_all(reads.begin(), reads.end());
+        for (unsigned_type i = 0; i < num_blocks; ++i)
+            STXXL_CHECK(reads[i]->poll());
+    }
+
+    STXXL_CHECK(std::count(buffer, buffer + block * num_blocks, 1) == int(block * num_blocks));
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
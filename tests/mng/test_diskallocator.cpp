@@ -0,0 +1,141 @@
+/***************************************************************************
+ *  tests/mng/test_diskallocator.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stxxl/io>
+#include <stxxl/mng>
+#include <stxxl/aligned_alloc>
+
+//! Checks that files grown by the DiskAllocator shrink back to their
+//! configured size once their end is freed, and that discarded regions of
+//! a file on disk release their storage where the file system has holes.
+
+typedef stxxl::BID<2 * 1024 * 1024> bid_type;
+
+//! Size of the file on disk, or as the file object reports it.
+stxxl::int64 file_size(stxxl::file & file, const std::string & path)
+{
+    if (path.empty())
+        return file.size();
+    struct stat st;
+    STXXL_CHECK(::stat(path.c_str(), &st) == 0);
+    return st.st_size;
+}
+
+void test_shrink(stxxl::file & file, const std::string & path, stxxl::int64 configured_size)
+{
+    stxxl::DiskAllocator * alloc = new stxxl::DiskAllocator(&file, configured_size);
+
+    STXXL_CHECK(alloc->get_total_bytes() == configured_size);
+    STXXL_CHECK(file_size(file, path) == configured_size);
+
+    const unsigned nblocks = 64;
+    const stxxl::int64 grown_size = std::max<stxxl::int64>(configured_size, nblocks * (stxxl::int64)bid_type::size);
+    std::vector<bid_type> bids(nblocks);
+    for (unsigned i = 0; i < nblocks; ++i) {
+        bids[i].storage = &file;
+        alloc->new_blocks(&bids[i], &bids[i] + 1);
+    }
+
+    STXXL_CHECK(alloc->get_used_bytes() == nblocks * (stxxl::int64)bid_type::size);
+    STXXL_CHECK(file_size(file, path) >= grown_size);
+
+    // freeing the lower half keeps the end of the file in use
+    for (unsigned i = 0; i < nblocks / 2; ++i)
+        alloc->delete_block(bids[i]);
+    STXXL_CHECK(file_size(file, path) >= grown_size);
+
+    for (unsigned i = nblocks / 2; i < nblocks; ++i)
+        alloc->delete_block(bids[i]);
+
+    STXXL_CHECK(alloc->get_used_bytes() == 0);
+    STXXL_CHECK(alloc->get_total_bytes() == configured_size);
+    STXXL_CHECK(file_size(file, path) == configured_size);
+
+    // a small growth is not worth shrinking in between, but on destruction
+    std::vector<bid_type> more(configured_size / bid_type::size + 1);
+    for (unsigned i = 0; i < more.size(); ++i) {
+        more[i].storage = &file;
+        alloc->new_blocks(&more[i], &more[i] + 1);
+    }
+    for (unsigned i = 0; i < more.size(); ++i)
+        alloc->delete_block(more[i]);
+    STXXL_CHECK(alloc->get_total_bytes() == configured_size + (stxxl::int64)bid_type::size);
+    STXXL_CHECK(file_size(file, path) == configured_size + (stxxl::int64)bid_type::size);
+
+    delete alloc;
+    STXXL_CHECK(file_size(file, path) == configured_size);
+}
+
+//! Writes a region, discards part of it and checks the allocated blocks.
+void test_discard(const std::string & path)
+{
+    const stxxl::int64 mib = 1024 * 1024;
+    stxxl::syscall_file file(path, stxxl::file::RDWR | stxxl::file::CREAT | stxxl::file::TRUNC);
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(4 * mib);
+    std::fill(buffer, buffer + 4 * mib, 1);
+    file.set_size(4 * mib);
+    file.awrite(buffer, 0, 4 * mib, stxxl::default_completion_handler())->wait();
+
+    struct stat before, after;
+    STXXL_CHECK(::stat(path.c_str(), &before) == 0);
+    file.discard(mib, 2 * mib);
+    STXXL_CHECK(::stat(path.c_str(), &after) == 0);
+    STXXL_CHECK(after.st_size == before.st_size);
+
+    if (after.st_blocks == before.st_blocks)
+    {
+        STXXL_MSG("file system of " << path << " does not punch holes, skipping");
+    }
+    else
+    {
+        // st_blocks counts 512 byte units
+        STXXL_CHECK(after.st_blocks <= before.st_blocks - 2 * mib / 512);
+        file.aread(buffer, 0, 4 * mib, stxxl::default_completion_handler())->wait();
+        STXXL_CHECK(std::count(buffer, buffer + mib, 1) == mib);
+        STXXL_CHECK(std::count(buffer + mib, buffer + 3 * mib, 0) == 2 * mib);
+        STXXL_CHECK(std::count(buffer + 3 * mib, buffer + 4 * mib, 1) == mib);
+    }
+
+    stxxl::aligned_dealloc<4096>(buffer);
+    file.close_remove();
+}
+
+int main(int argc, char ** argv)
+{
+    {
+        stxxl::mem_file file;
+        test_shrink(file, "", 0);
+    }
+    {
+        stxxl::mem_file file;
+        test_shrink(file, "", 16 * 1024 * 1024);
+    }
+
+    if (argc > 1)
+    {
+        const std::string path = std::string(argv[1]) + "/test_diskallocator.dat";
+        {
+            stxxl::syscall_file file(path, stxxl::file::RDWR | stxxl::file::CREAT | stxxl::file::TRUNC);
+            file.set_size(16 * 1024 * 1024);
+            test_shrink(file, path, 16 * 1024 * 1024);
+            file.close_remove();
+        }
+        test_discard(path);
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
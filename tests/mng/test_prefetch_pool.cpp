@@ -47,5 +47,40 @@ int main()
     pool.read(blk, bids[0])->wait();
     pool.read(blk, bids[1])->wait();
 
+    stxxl::block_manager::get_instance()->delete_blocks(bids + 0, bids + 2);
+
+    // automatic read-ahead along a sequential and a strided stream
+    {
+        const unsigned nblocks = 32;
+        block_type::bid_type seq[nblocks];
+        stxxl::block_manager::get_instance()->new_blocks(stxxl::single_disk(), seq, seq + nblocks);
+        for (unsigned i = 0; i < nblocks; ++i) {
+            (*blk)[0].integer = i;
+            blk->write(seq[i])->wait();
+        }
+
+        pool.set_readahead(4);
+        for (unsigned i = 0; i < nblocks; ++i) {
+            pool.read(blk, seq[i])->wait();
+            STXXL_CHECK((*blk)[0].integer == int(i));
+        }
+        for (unsigned i = 0; i < nblocks; i += 3) {
+            pool.read(blk, seq[i])->wait();
+            STXXL_CHECK((*blk)[0].integer == int(i));
+        }
+        STXXL_MSG(pool.get_stats());
+        STXXL_CHECK(pool.get_stats().readahead > 0);
+        STXXL_CHECK(pool.get_stats().hits + pool.get_stats().late_hits > 0);
+
+        // explicit hints take blocks back from the read-ahead
+        pool.hint(seq[0]);
+        pool.set_readahead(0);
+        STXXL_CHECK(pool.size() == 5);
+        pool.read(blk, seq[0])->wait();
+        STXXL_CHECK((*blk)[0].integer == 0);
+
+        stxxl::block_manager::get_instance()->delete_blocks(seq + 0, seq + nblocks);
+    }
+
     delete blk;
 }
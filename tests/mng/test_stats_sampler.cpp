@@ -0,0 +1,140 @@
+/***************************************************************************
+ *  tests/mng/test_stats_sampler.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example mng/test_stats_sampler.cpp
+//! This tests the JSON Lines and Prometheus output of \c stxxl::stats_sampler.
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/mng>
+#include <stxxl/stats>
+#include <stxxl/aligned_alloc>
+
+using stxxl::file;
+using stxxl::stats_sampler;
+using stxxl::unsigned_type;
+
+static const int queue = 9;
+
+void do_io(file * f, char * buffer, unsigned_type block, unsigned_type num_blocks)
+{
+    std::vector<stxxl::request_ptr> req(num_blocks);
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        req[i] = f->awrite(buffer, i * block, block, stxxl::default_completion_handler());
+    stxxl::wait_all(req.begin(), req.end());
+    for (unsigned_type i = 0; i < num_blocks; ++i)
+        req[i] = f->aread(buffer, i * block, block, stxxl::default_completion_handler());
+    stxxl::wait_all(req.begin(), req.end());
+}
+
+std::vector<std::string> read_lines(const std::string & filename)
+{
+    std::vector<std::string> lines;
+    std::ifstream in(filename.c_str());
+    std::string line;
+    while (std::getline(in, line))
+        lines.push_back(line);
+    return lines;
+}
+
+std::string to_str(unsigned_type x)
+{
+    std::ostringstream o;
+    o << x;
+    return o.str();
+}
+
+bool contains(const std::string & s, const std::string & what)
+{
+    return s.find(what) != std::string::npos;
+}
+
+int main()
+{
+    const unsigned_type block = 64 * 1024, num_blocks = 64;
+    char * buffer = (char *)stxxl::aligned_alloc<4096>(block);
+    std::fill(buffer, buffer + block, 0);
+
+    stxxl::compat_unique_ptr<file>::result f(stxxl::create_file("memory", "", file::RDWR, queue));
+    f->set_size(num_blocks * block);
+
+    const std::string json_file = "./test_stats_sampler.json";
+    const std::string prom_file = "./test_stats_sampler.prom";
+    std::remove(json_file.c_str());
+    std::remove(prom_file.c_str());
+
+    {
+        stats_sampler json(json_file, 0.05, stats_sampler::JSON_LINES);
+        stats_sampler prom(prom_file, 0.05, stats_sampler::PROMETHEUS);
+        do_io(f.get(), buffer, block, num_blocks);
+        json.sample();
+        // wait for some periodic snapshots
+        while (json.get_samples_written() < 4 || prom.get_samples_written() < 2)
+            usleep(10000);
+    }
+
+    std::vector<std::string> lines = read_lines(json_file);
+    STXXL_MSG("JSON snapshots: " << lines.size());
+    STXXL_CHECK(lines.size() >= 5);    // explicit, periodic and final snapshots
+    for (unsigned_type i = 0; i < lines.size(); ++i)
+    {
+        const std::string & l = lines[i];
+        STXXL_CHECK(l[0] == '{' && l[l.size() - 1] == '}');
+        STXXL_CHECK(contains(l, "\"reads\":"));
+        STXXL_CHECK(contains(l, "\"read_bandwidth\":"));
+        STXXL_CHECK(contains(l, "\"wait_time\":"));
+        STXXL_CHECK(contains(l, "\"disks\":["));
+        STXXL_CHECK(contains(l, "{\"queue\":9,"));
+        STXXL_CHECK(contains(l, "\"read_latency\":{\"p50\":"));
+        STXXL_CHECK(!contains(l, "nan") && !contains(l, "inf"));
+    }
+    // the explicit snapshot was taken after the I/O, periodic ones may
+    // precede it
+    bool found_counters = false;
+    for (unsigned_type i = 0; i < lines.size(); ++i)
+        found_counters = found_counters || contains(lines[i], "\"reads\":" + to_str(num_blocks) + ",");
+    STXXL_CHECK(found_counters);
+
+    std::vector<std::string> prom = read_lines(prom_file);
+    STXXL_CHECK(!prom.empty());
+    bool found_reads = false, found_latency = false, found_summary = false, found_count = false;
+    for (unsigned_type i = 0; i < prom.size(); ++i)
+    {
+        const std::string & l = prom[i];
+        STXXL_CHECK(!l.empty());
+        if (l[0] == '#')
+            STXXL_CHECK(contains(l, "# HELP stxxl_") || contains(l, "# TYPE stxxl_"));
+        if (l == "stxxl_disk_reads_total{queue=\"9\"} " + to_str(num_blocks))
+            found_reads = true;
+        if (contains(l, "stxxl_disk_read_latency_seconds{queue=\"9\",quantile=\"0.99\"} "))
+            found_latency = true;
+        if (contains(l, "# TYPE stxxl_disk_read_latency_seconds "))
+            found_summary = (l == "# TYPE stxxl_disk_read_latency_seconds summary");
+        // cumulative since start, not over the last interval
+        if (l == "stxxl_disk_read_latency_seconds_count{queue=\"9\"} " + to_str(num_blocks))
+            found_count = true;
+    }
+    STXXL_CHECK(found_reads);
+    STXXL_CHECK(found_latency);
+    STXXL_CHECK(found_summary);
+    STXXL_CHECK(found_count);
+
+    std::remove(json_file.c_str());
+    std::remove(prom_file.c_str());
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -40,5 +40,51 @@ int main()
     block_type::bid_type bid;
     stxxl::block_manager::get_instance()->new_block(stxxl::single_disk(), bid);
     pool.write(blk, bid)->wait();
+    stxxl::block_manager::get_instance()->delete_block(bid);
+
+    // deferred writing, submitted in offset order
+    {
+        const unsigned nblocks = 8;
+        block_type::bid_type bids[nblocks];
+        stxxl::block_manager::get_instance()->new_blocks(stxxl::single_disk(), bids + 0, bids + nblocks);
+
+        pool.resize(nblocks + 2);
+        pool.set_write_combining(nblocks);
+
+        for (unsigned i = 0; i < nblocks - 1; ++i) {
+            unsigned j = (i * 5) % nblocks;     // scattered
+            blk = pool.steal();
+            (*blk)[0].integer = j;
+            STXXL_CHECK(!pool.write(blk, bids[j]).valid());
+        }
+        STXXL_CHECK(pool.size_pending() == nblocks - 1);
+        STXXL_CHECK(pool.has_request(bids[5]));
+
+        // overwriting a pending block replaces it
+        blk = pool.steal();
+        (*blk)[0].integer = 42;
+        pool.write(blk, bids[5]);
+        STXXL_CHECK(pool.size_pending() == nblocks - 1);
+
+        // stealing a pending block submits its write
+        std::pair<block_type *, stxxl::request_ptr> stolen = pool.steal_request(bids[5]);
+        STXXL_CHECK(stolen.first != NULL && stolen.second.valid());
+        stolen.second->wait();
+        STXXL_CHECK((*stolen.first)[0].integer == 42);
+        pool.add(stolen.first);
+
+        pool.flush();
+        STXXL_CHECK(pool.size_pending() == 0);
+        pool.resize(0);
+
+        blk = new block_type;
+        for (unsigned i = 0; i < nblocks - 1; ++i) {
+            unsigned j = (i * 5) % nblocks;
+            blk->read(bids[j])->wait();
+            STXXL_CHECK((*blk)[0].integer == int(j == 5 ? 42 : j));
+        }
+
+        stxxl::block_manager::get_instance()->delete_blocks(bids + 0, bids + nblocks);
+    }
     delete blk;
 }
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *  tests/stream/test_aggregate.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Sums values per key with stream::aggregate, in memory and with spilled
+//! runs, and compares against a reference computed with std::map.
+
+#include <limits>
+#include <map>
+#include <vector>
+#include <stxxl/stream>
+#include <stxxl/bits/common/rand.h>
+
+typedef std::pair<unsigned, stxxl::uint64> record_type;     // (key, sum)
+
+struct key_of
+{
+    typedef unsigned key_type;
+
+    key_type operator () (const record_type & r) const { return r.first; }
+};
+
+struct add
+{
+    record_type operator () (const record_type & a, const record_type & b) const
+    {
+        return record_type(a.first, a.second + b.second);
+    }
+};
+
+struct cmp_key
+{
+    bool operator () (const record_type & a, const record_type & b) const { return a.first < b.first; }
+    record_type min_value() const { return record_type(std::numeric_limits<unsigned>::min(), 0); }
+    record_type max_value() const { return record_type(std::numeric_limits<unsigned>::max(), 0); }
+};
+
+typedef std::vector<record_type> input_type;
+typedef stxxl::stream::iterator2stream<input_type::const_iterator> stream_type;
+typedef stxxl::stream::aggregate<stream_type, key_of, add, cmp_key, 4096> aggregate_type;
+
+void check(aggregate_type & agg, const std::map<unsigned, stxxl::uint64> & expected)
+{
+    std::map<unsigned, stxxl::uint64>::const_iterator it = expected.begin();
+    for ( ; !agg.empty(); ++agg, ++it)
+    {
+        STXXL_CHECK(it != expected.end());
+        STXXL_CHECK(agg->first == it->first);
+        STXXL_CHECK(agg->second == it->second);
+    }
+    STXXL_CHECK(it == expected.end());
+}
+
+int main()
+{
+    const unsigned n = 2000000, keys = 100000;
+    stxxl::random_number32 rnd;
+    input_type input(n);
+    std::map<unsigned, stxxl::uint64> expected;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        input[i] = record_type(rnd() % keys, i);
+        expected[input[i].first] += i;
+    }
+
+    {
+        stream_type in(input.begin(), input.end());
+        aggregate_type agg(in, key_of(), add(), cmp_key(), 64 * 1024 * 1024);
+        STXXL_CHECK(agg.get_spills() == 0);
+        check(agg, expected);
+        STXXL_CHECK(agg.get_elements_read() == n);
+    }
+    {
+        // the table holds only a fraction of the keys
+        stream_type in(input.begin(), input.end());
+        aggregate_type agg(in, key_of(), add(), cmp_key(), 2 * 1024 * 1024);
+        STXXL_MSG("spilled " << agg.get_elements_spilled() << " partial aggregates in " << agg.get_spills() << " spills");
+        STXXL_CHECK(agg.get_spills() > 1);
+        STXXL_CHECK(agg.get_elements_spilled() < n);
+        check(agg, expected);
+    }
+    {
+        input_type empty;
+        stream_type in(empty.begin(), empty.end());
+        aggregate_type agg(in, key_of(), add(), cmp_key(), 2 * 1024 * 1024);
+        STXXL_CHECK(agg.empty());
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *  tests/stream/test_async_pipeline.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks stream::async_pipeline: element order, sorting of its output,
+//! early destruction and propagation of exceptions from the upstream.
+
+#include <functional>
+#include <limits>
+#include <stxxl/stream>
+#include <stxxl/vector>
+
+struct counter
+{
+    typedef stxxl::uint64 value_type;
+
+    value_type value, end, fail_at;
+
+    counter(value_type end_, value_type fail_at_ = std::numeric_limits<value_type>::max())
+        : value(0), end(end_), fail_at(fail_at_) { }
+
+    const value_type & operator * () const { return value; }
+
+    counter & operator ++ ()
+    {
+        if (++value == fail_at)
+            throw std::runtime_error("counter failed");
+        return *this;
+    }
+
+    bool empty() const { return value >= end; }
+};
+
+struct scramble
+{
+    typedef stxxl::uint64 value_type;
+
+    value_type operator () (value_type v) const
+    {
+        // some CPU work per element
+        for (int i = 0; i < 8; ++i)
+            v = v * 6364136223846793005ull + 1442695040888963407ull;
+        return v;
+    }
+};
+
+struct cmp_less : public std::less<stxxl::uint64>
+{
+    stxxl::uint64 min_value() const { return std::numeric_limits<stxxl::uint64>::min(); }
+    stxxl::uint64 max_value() const { return std::numeric_limits<stxxl::uint64>::max(); }
+};
+
+int main()
+{
+    const stxxl::uint64 n = 1000 * 1000;
+
+    {
+        // order is preserved, small batches to exercise the ring
+        counter input(n);
+        stxxl::stream::async_pipeline<counter> async(input, 3, 1000);
+        for (stxxl::uint64 i = 0; i < n; ++i, ++async)
+        {
+            STXXL_CHECK(!async.empty());
+            STXXL_CHECK(*async == i);
+        }
+        STXXL_CHECK(async.empty());
+    }
+    {
+        // an empty input
+        counter input(0);
+        stxxl::stream::async_pipeline<counter> async(input);
+        STXXL_CHECK(async.empty());
+    }
+    {
+        // transform runs in the worker while the sorter creates runs
+        counter input(n);
+        scramble op;
+        typedef stxxl::stream::transform<scramble, counter> transform_type;
+        transform_type transformed(op, input);
+        typedef stxxl::stream::async_pipeline<transform_type> async_type;
+        async_type async(transformed);
+        stxxl::stream::sort<async_type, cmp_less> sorted(async, cmp_less(), 16 * 1024 * 1024);
+
+        stxxl::uint64 count = 0, last = 0;
+        for ( ; !sorted.empty(); ++sorted, ++count)
+        {
+            STXXL_CHECK(last <= *sorted);
+            last = *sorted;
+        }
+        STXXL_CHECK(count == n);
+    }
+    {
+        // destroyed before the input is consumed
+        counter input(n);
+        stxxl::stream::async_pipeline<counter> async(input, 2, 100);
+        for (int i = 0; i < 150; ++i)
+            ++async;
+        STXXL_CHECK(*async == 150);
+    }
+    {
+        // exceptions are rethrown by the consumer
+        counter input(n, 5000);
+        bool caught = false;
+        try
+        {
+            stxxl::stream::async_pipeline<counter> async(input, 2, 1000);
+            while (!async.empty())
+                ++async;
+        }
+        catch (std::runtime_error &)
+        {
+            caught = true;
+        }
+        STXXL_CHECK(caught);
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
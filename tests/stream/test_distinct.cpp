@@ -0,0 +1,122 @@
+/***************************************************************************
+ *  tests/stream/test_distinct.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks stream::hash_distinct and stream::hash_count in memory, with one
+//! and with repeated partitioning, with a hash too weak for partitioning,
+//! against a reference computed with std::map, and the accuracy of the
+//! HyperLogLog estimate.
+
+#include <cmath>
+#include <map>
+#include <vector>
+#include <stxxl/stream>
+#include <stxxl/bits/common/rand.h>
+
+typedef stxxl::uint64 value_type;
+typedef std::vector<value_type> input_type;
+typedef stxxl::stream::iterator2stream<input_type::const_iterator> stream_type;
+typedef std::map<value_type, stxxl::uint64> reference_type;
+
+template <class Count>
+void check_count(Count & count, const reference_type & expected)
+{
+    reference_type seen;
+    for ( ; !count.empty(); ++count)
+    {
+        STXXL_CHECK(seen.find(count->first) == seen.end());
+        seen[count->first] = count->second;
+    }
+    STXXL_CHECK(seen == expected);
+}
+
+//! Maps thousands of values to the same hash value.
+struct weak_hash
+{
+    size_t operator () (value_type v) const
+    {
+        return size_t(v / 5000);
+    }
+};
+
+int main()
+{
+    const unsigned n = 1000000, range = 400000;
+    stxxl::random_number32 rnd;
+    input_type input(n);
+    reference_type expected;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        input[i] = value_type(rnd() % range) * 0x10001;
+        ++expected[input[i]];
+    }
+    STXXL_MSG(expected.size() << " distinct values");
+
+    stxxl::uint64 estimate;
+    {
+        stream_type in(input.begin(), input.end());
+        estimate = stxxl::stream::estimate_distinct(in);
+        STXXL_MSG("estimated " << estimate << " distinct values");
+        STXXL_CHECK(std::fabs(double(estimate) - double(expected.size())) < 0.05 * double(expected.size()));
+    }
+    {
+        stream_type in(input.begin(), input.end());
+        stxxl::stream::hash_count<stream_type> count(in, 256 * 1024 * 1024);
+        STXXL_CHECK(count.get_partitionings() == 0);
+        check_count(count, expected);
+    }
+    {
+        // the partitions of the first pass are too large and are partitioned again
+        stream_type in(input.begin(), input.end());
+        stxxl::stream::hash_count<stream_type, stxxl::compat_hash<value_type>::result, 4096>
+        count(in, 256 * 1024);
+        STXXL_MSG(count.get_partitionings() << " partitionings, " << count.get_blocks_written() << " blocks written");
+        STXXL_CHECK(count.get_partitionings() > 1);
+        check_count(count, expected);
+    }
+    {
+        // sized by the estimate, one partitioning pass
+        stream_type in(input.begin(), input.end());
+        stxxl::stream::hash_distinct<stream_type, stxxl::compat_hash<value_type>::result, 4096>
+        distinct(in, 8 * 1024 * 1024, estimate);
+        STXXL_CHECK(distinct.get_partitionings() == 1);
+        reference_type seen;
+        for ( ; !distinct.empty(); ++distinct)
+        {
+            STXXL_CHECK(expected.find(*distinct) != expected.end());
+            STXXL_CHECK(++seen[*distinct] == 1);
+        }
+        STXXL_CHECK(seen.size() == expected.size());
+        STXXL_CHECK(distinct.get_elements_read() == n);
+    }
+    {
+        // partitions of equal hashes do not shrink and are filtered instead
+        input_type weak;
+        reference_type weak_expected;
+        for (unsigned i = 0; i < 30000; ++i)
+        {
+            weak.push_back(value_type(rnd() % 10000));
+            ++weak_expected[weak.back()];
+        }
+        stream_type in(weak.begin(), weak.end());
+        stxxl::stream::hash_count<stream_type, weak_hash, 4096> count(in, 64 * 1024);
+        check_count(count, weak_expected);
+        STXXL_MSG(count.get_partitionings() << " partitionings with a weak hash");
+        STXXL_CHECK(count.get_partitionings() > 2);
+    }
+    {
+        input_type empty;
+        stream_type in(empty.begin(), empty.end());
+        stxxl::stream::hash_distinct<stream_type> distinct(in, 1024 * 1024);
+        STXXL_CHECK(distinct.empty());
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *  tests/stream/test_join.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Compares stream::merge_join and stream::hash_join (in memory and
+//! partitioned) against a reference computed with std::map.
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <stxxl/stream>
+#include <stxxl/bits/common/rand.h>
+
+typedef std::pair<unsigned, unsigned> record_type;     // (key, payload)
+
+struct key_of
+{
+    typedef unsigned key_type;
+
+    key_type operator () (const record_type & r) const { return r.first; }
+};
+
+typedef std::vector<record_type> input_type;
+typedef stxxl::stream::iterator2stream<input_type::const_iterator> stream_type;
+
+void generate(input_type & v, unsigned n, unsigned keys, unsigned salt)
+{
+    stxxl::random_number32 rnd;
+    v.resize(n);
+    for (unsigned i = 0; i < n; ++i)
+        v[i] = record_type(rnd() % keys, i * salt);
+}
+
+// number of matches and sum of payload products
+std::pair<stxxl::uint64, stxxl::uint64> reference(const input_type & a, const input_type & b)
+{
+    std::map<unsigned, std::pair<stxxl::uint64, stxxl::uint64> > sa;  // key -> (count, payload sum)
+    for (unsigned i = 0; i < a.size(); ++i)
+    {
+        ++sa[a[i].first].first;
+        sa[a[i].first].second += a[i].second;
+    }
+    std::pair<stxxl::uint64, stxxl::uint64> res(0, 0);
+    for (unsigned i = 0; i < b.size(); ++i)
+    {
+        std::map<unsigned, std::pair<stxxl::uint64, stxxl::uint64> >::const_iterator it = sa.find(b[i].first);
+        if (it == sa.end())
+            continue;
+        res.first += it->second.first;
+        res.second += it->second.second * b[i].second;
+    }
+    return res;
+}
+
+template <class Join>
+std::pair<stxxl::uint64, stxxl::uint64> consume(Join & join, bool sorted)
+{
+    std::pair<stxxl::uint64, stxxl::uint64> res(0, 0);
+    unsigned last_key = 0;
+    for ( ; !join.empty(); ++join)
+    {
+        STXXL_CHECK(join->first.first == join->second.first);
+        if (sorted)
+        {
+            STXXL_CHECK(last_key <= join->first.first);
+            last_key = join->first.first;
+        }
+        ++res.first;
+        res.second += stxxl::uint64(join->first.second) * join->second.second;
+    }
+    return res;
+}
+
+int main()
+{
+    input_type a, b;
+    generate(a, 200000, 50000, 3);
+    generate(b, 300000, 70000, 7);
+    // a few heavy keys
+    for (unsigned i = 0; i < 2000; ++i)
+    {
+        a.push_back(record_type(42, i));
+        b.push_back(record_type(42, i + 1));
+    }
+    const std::pair<stxxl::uint64, stxxl::uint64> expected = reference(a, b);
+    STXXL_MSG("expecting " << expected.first << " matches");
+
+    {
+        input_type sa(a), sb(b);
+        std::stable_sort(sa.begin(), sa.end());
+        std::stable_sort(sb.begin(), sb.end());
+        stream_type in1(sa.begin(), sa.end()), in2(sb.begin(), sb.end());
+        // a tiny group buffer forces the heavy key to be spilled
+        stxxl::stream::merge_join<stream_type, stream_type, key_of, key_of>
+        join(in1, in2, key_of(), key_of(), 1000 * sizeof(record_type));
+        STXXL_CHECK(consume(join, true) == expected);
+        STXXL_MSG(join.get_stats());
+        STXXL_CHECK(join.get_stats().blocks_written > 0);
+    }
+    {
+        stream_type in1(a.begin(), a.end()), in2(b.begin(), b.end());
+        stxxl::stream::hash_join<stream_type, stream_type, key_of, key_of, 4096>
+        join(in1, in2, key_of(), key_of(), 64 * 1024 * 1024);
+        STXXL_CHECK(consume(join, false) == expected);
+        STXXL_MSG(join.get_stats());
+        STXXL_CHECK(join.get_stats().partitions == 0);
+    }
+    {
+        stream_type in1(a.begin(), a.end()), in2(b.begin(), b.end());
+        stxxl::stream::hash_join<stream_type, stream_type, key_of, key_of, 4096>
+        join(in1, in2, key_of(), key_of(), 512 * 1024);
+        STXXL_CHECK(consume(join, false) == expected);
+        STXXL_MSG(join.get_stats());
+        STXXL_CHECK(join.get_stats().partitions > 1);
+        STXXL_CHECK(join.get_stats().blocks_read == join.get_stats().blocks_written);
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
@@ -149,4 +149,25 @@ int main()
         stxxl::stream::materialize(_42mill.reset(), v.begin(), v.end(), 42);
         check_42_fill(v, _42mill.len());
     }
+    {
+        typedef stxxl::VECTOR_GENERATOR<int>::result vector_type;
+        typedef stxxl::stream::streamify_traits<vector_type::const_iterator>::stream_type input_type;
+        STXXL_CHECK(stxxl::stream::is_batch_stream<input_type>::value);
+        STXXL_CHECK(!stxxl::stream::is_batch_stream<forty_two>::value);
+
+        forty_two _3mill (3 * 1000000);
+        vector_type src(_3mill.len()), v(10 * 1000000);
+        stxxl::stream::materialize(_3mill.reset(), src.begin());
+
+        // copy batches between unaligned ranges crossing block boundaries
+        const unsigned skip = 7, cut = 5, shift = 3;
+        const vector_type & csrc = src;
+        input_type in = stxxl::stream::streamify(csrc.begin() + skip, csrc.end() - cut);
+        vector_type::iterator end = stxxl::stream::materialize(in, v.begin() + shift, v.end());
+        STXXL_CHECK(end - v.begin() == int(shift + _3mill.len() - skip - cut));
+
+        vector_type::const_iterator ci = v.begin() + shift;
+        for (unsigned i = skip; i < _3mill.len() - cut; ++i, ++ci)
+            STXXL_CHECK(*ci == (int)i);
+    }
 }
@@ -0,0 +1,133 @@
+/***************************************************************************
+ *  tests/stream/test_tee.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! Checks stream::tee with outputs consumed at different speeds (with and
+//! without spooling to disk) and the push-style tee_into and partition_into.
+
+#include <functional>
+#include <limits>
+#include <vector>
+#include <stxxl/stream>
+
+struct counter
+{
+    typedef stxxl::uint64 value_type;
+
+    value_type value, end;
+
+    counter(value_type end_) : value(0), end(end_) { }
+
+    const value_type & operator * () const { return value; }
+
+    counter & operator ++ ()
+    {
+        ++value;
+        return *this;
+    }
+
+    bool empty() const { return value >= end; }
+};
+
+struct cmp_less : public std::less<stxxl::uint64>
+{
+    stxxl::uint64 min_value() const { return std::numeric_limits<stxxl::uint64>::min(); }
+    stxxl::uint64 max_value() const { return std::numeric_limits<stxxl::uint64>::max(); }
+};
+
+struct cmp_greater : public std::greater<stxxl::uint64>
+{
+    stxxl::uint64 min_value() const { return std::numeric_limits<stxxl::uint64>::max(); }
+    stxxl::uint64 max_value() const { return std::numeric_limits<stxxl::uint64>::min(); }
+};
+
+struct collector
+{
+    std::vector<stxxl::uint64> values;
+
+    void push(stxxl::uint64 v) { values.push_back(v); }
+};
+
+struct parity
+{
+    unsigned operator () (stxxl::uint64 v) const { return unsigned(v % 2); }
+};
+
+typedef stxxl::stream::tee<counter, 4096> tee_type;
+
+void test_tee(stxxl::uint64 n, stxxl::unsigned_type memory, bool expect_spool)
+{
+    counter input(n);
+    tee_type tee(input, 3, memory);
+    tee_type::output & a = tee[0], & b = tee[1], & c = tee[2];
+
+    // a runs far ahead, b follows at half its speed, c starts at the end
+    stxxl::uint64 ia = 0, ib = 0, ic = 0;
+    for ( ; !a.empty(); ++a, ++ia)
+    {
+        STXXL_CHECK(*a == ia);
+        if (ia % 2 == 0)
+        {
+            STXXL_CHECK(*b == ib);
+            ++b;
+            ++ib;
+        }
+    }
+    STXXL_CHECK(ia == n);
+    for ( ; !b.empty(); ++b, ++ib)
+        STXXL_CHECK(*b == ib);
+    for ( ; !c.empty(); ++c, ++ic)
+        STXXL_CHECK(*c == ic);
+    STXXL_CHECK(ib == n && ic == n);
+
+    STXXL_MSG("tee: " << tee.get_blocks_written() << " blocks written, " << tee.get_blocks_read() << " blocks read");
+    STXXL_CHECK((tee.get_blocks_written() > 0) == expect_spool);
+}
+
+int main()
+{
+    const stxxl::uint64 n = 1000 * 1000;
+
+    test_tee(n, 64 * 1024 * 1024, false);
+    test_tee(n, 64 * 1024, true);
+    test_tee(0, 64 * 1024, false);
+
+    {
+        // one pass over the input creates runs for two different orders
+        counter input(n);
+        typedef stxxl::stream::runs_creator<stxxl::stream::use_push<stxxl::uint64>, cmp_less> up_creator_type;
+        typedef stxxl::stream::runs_creator<stxxl::stream::use_push<stxxl::uint64>, cmp_greater> down_creator_type;
+        up_creator_type up(cmp_less(), 16 * 1024 * 1024);
+        down_creator_type down(cmp_greater(), 16 * 1024 * 1024);
+        STXXL_CHECK(stxxl::stream::tee_into(input, up, down) == n);
+
+        up_creator_type::sorted_runs_type up_runs = up.result();
+        down_creator_type::sorted_runs_type down_runs = down.result();
+        stxxl::stream::runs_merger<up_creator_type::sorted_runs_type> up_merger(up_runs, cmp_less(), 16 * 1024 * 1024);
+        stxxl::stream::runs_merger<down_creator_type::sorted_runs_type> down_merger(down_runs, cmp_greater(), 16 * 1024 * 1024);
+        for (stxxl::uint64 i = 0; i < n; ++i, ++up_merger, ++down_merger)
+        {
+            STXXL_CHECK(*up_merger == i);
+            STXXL_CHECK(*down_merger == n - 1 - i);
+        }
+        STXXL_CHECK(up_merger.empty() && down_merger.empty());
+    }
+    {
+        counter input(1001);
+        collector even, odd;
+        collector * sinks[] = { &even, &odd };
+        STXXL_CHECK(stxxl::stream::partition_into(input, parity(), sinks) == 1001);
+        STXXL_CHECK(even.values.size() == 501 && odd.values.size() == 500);
+        for (unsigned i = 0; i < 500; ++i)
+            STXXL_CHECK(even.values[i] == 2 * i && odd.values[i] == 2 * i + 1);
+    }
+
+    STXXL_MSG("Test passed.");
+    return 0;
+}
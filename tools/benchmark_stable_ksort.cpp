@@ -0,0 +1,114 @@
+/***************************************************************************
+ *  tools/benchmark_stable_ksort.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+/*
+ * This program benchmarks stxxl::stable_ksort on uniformly distributed and on
+ * skewed keys, to show that sampling keeps the throughput independent of
+ * the key distribution.
+ */
+
+#include <stxxl/cmdline>
+#include <stxxl/vector>
+#include <stxxl/stats>
+#include <stxxl/stable_ksort>
+
+using stxxl::timestamp;
+using stxxl::uint64;
+
+#define MB (1024 * 1024)
+
+// 16 byte record with a 64-bit key
+struct record_type
+{
+    typedef uint64 key_type;
+
+    key_type m_key;
+    uint64 payload;
+
+    key_type key() const
+    {
+        return m_key;
+    }
+};
+
+typedef stxxl::VECTOR_GENERATOR<record_type>::result vector_type;
+
+static const char * distributions[] = {
+    "uniform", "exponential", "16 distinct keys", "one heavy key", NULL
+};
+
+static uint64 make_key(unsigned d, stxxl::random_number64 & rnd)
+{
+    switch (d)
+    {
+    case 0:
+        return rnd();
+    case 1:
+        // magnitudes uniformly distributed, most keys are small
+        return rnd() >> (rnd() % 64);
+    case 2:
+        return rnd() % 16;
+    default:
+        // 90% of the records have the same key
+        return (rnd() % 10) ? 1000000 : rnd();
+    }
+}
+
+int benchmark_stable_ksort(int argc, char * argv[])
+{
+    stxxl::cmdline_parser cp;
+
+    cp.set_description("Benchmark stxxl::stable_ksort on 16 byte records with uniform "
+                       "and skewed key distributions.");
+
+    uint64 length = 1024 * MB;
+    cp.add_bytes('s', "size", "", "Amount of data to sort, default: 1 GiB", length);
+
+    uint64 memsize = 256 * MB;
+    cp.add_bytes('M', "ram", "", "Amount of RAM to use when sorting, default: 256 MiB", memsize);
+
+    if (!cp.process(argc,argv))
+        return -1;
+
+    const uint64 n = stxxl::div_ceil(length, sizeof(record_type));
+    stxxl::stats * Stats = stxxl::stats::get_instance();
+
+    for (unsigned d = 0; distributions[d]; ++d)
+    {
+        vector_type v(n);
+        {
+            stxxl::random_number64 rnd(42);
+            vector_type::bufwriter_type writer(v.begin());
+            for (uint64 i = 0; i < n; ++i)
+            {
+                record_type r;
+                r.m_key = make_key(d, rnd);
+                r.payload = i;
+                writer << r;
+            }
+            writer.finish();
+        }
+
+        std::cout << "# stable_ksort of " << n << " records, key distribution: " << distributions[d] << std::endl;
+        stxxl::stats_data stats_begin(*Stats);
+        double ts1 = timestamp();
+
+        stxxl::stable_ksort(v.begin(), v.end(), memsize);
+
+        double elapsed = timestamp() - ts1;
+        stxxl::stats_data io = stxxl::stats_data(*Stats) - stats_begin;
+        std::cout << "finished in " << elapsed << " seconds @ "
+                  << (double(n) * sizeof(record_type) / MB / elapsed) << " MiB/s, "
+                  << "I/O volume " << (double(io.get_read_volume() + io.get_written_volume()) / MB) << " MiB"
+                  << std::endl;
+    }
+
+    return 0;
+}
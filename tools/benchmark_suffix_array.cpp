@@ -0,0 +1,140 @@
+/***************************************************************************
+ *  tools/benchmark_suffix_array.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+/*
+ * This program benchmarks the suffix array (DC3) and LCP array construction
+ * of STXXL on random DNA, on a highly repetitive text, or on a file.
+ */
+
+#include <fstream>
+#include <limits>
+#include <vector>
+#include <stxxl/cmdline>
+#include <stxxl/vector>
+#include <stxxl/stats>
+#include <stxxl/suffix_array>
+
+using stxxl::timestamp;
+using stxxl::uint32;
+using stxxl::uint64;
+
+#define MB (1024 * 1024)
+
+typedef unsigned char alphabet_type;
+typedef stxxl::VECTOR_GENERATOR<alphabet_type>::result text_vector_type;
+
+static void output_result(const char* what, double elapsed, uint64 size)
+{
+    std::cout << what << " finished in " << elapsed << " seconds @ "
+              << (double(size) / MB / elapsed) << " MiB/s" << std::endl;
+}
+
+template <typename offset_type>
+static void benchmark(const text_vector_type& text, uint64 memsize,
+                      unsigned num_threads, bool lcp_flag)
+{
+    typedef typename stxxl::VECTOR_GENERATOR<offset_type>::result offset_vector_type;
+
+    stxxl::stats * Stats = stxxl::stats::get_instance();
+    offset_vector_type sa;
+    {
+        stxxl::stats_data stats_begin(*Stats);
+        double ts1 = timestamp();
+
+        stxxl::suffix_array(text, sa, memsize, num_threads);
+
+        output_result("# suffix_array", timestamp() - ts1, text.size());
+        std::cout << (stxxl::stats_data(*Stats) - stats_begin);
+    }
+    if (lcp_flag)
+    {
+        offset_vector_type lcp;
+        stxxl::stats_data stats_begin(*Stats);
+        double ts1 = timestamp();
+
+        stxxl::lcp_array(text, sa, lcp, memsize, num_threads);
+
+        output_result("# lcp_array", timestamp() - ts1, text.size());
+        std::cout << (stxxl::stats_data(*Stats) - stats_begin);
+    }
+}
+
+int benchmark_suffix_array(int argc, char * argv[])
+{
+    // parse command line
+    stxxl::cmdline_parser cp;
+
+    cp.set_description("Benchmark suffix array construction with the DC3 algorithm "
+                       "and, optionally, LCP array construction. The text is random DNA, "
+                       "a highly repetitive text or read from a file.");
+
+    uint64 length = 64 * MB;
+    cp.add_bytes('s', "size", "", "Length of the text, or maximum amount read from the input file, default: 64 MiB", length);
+
+    uint64 memsize = 1024 * MB;
+    cp.add_bytes('M', "ram", "", "Amount of RAM to use for sorting, default: 1 GiB", memsize);
+
+    unsigned num_threads = 0;
+    cp.add_uint('t', "threads", "", "Number of threads for parallel sorting, default: all", num_threads);
+
+    std::string input_filename;
+    cp.add_string('i', "input", "", "Read the text from this file instead of generating it", input_filename);
+
+    bool repetitive = false;
+    cp.add_flag('r', "repetitive", "", "Generate a highly repetitive text instead of random DNA", repetitive);
+
+    bool lcp_flag = false;
+    cp.add_flag('l', "lcp", "", "Also construct the LCP array", lcp_flag);
+
+    if (!cp.process(argc,argv))
+        return -1;
+
+    text_vector_type text;
+    if (input_filename.size())
+    {
+        std::ifstream in(input_filename.c_str(), std::ios::binary);
+        if (!in.good()) {
+            std::cout << "error: could not open " << input_filename << std::endl;
+            return -1;
+        }
+        text_vector_type::bufwriter_type writer(text);
+        char c;
+        for (uint64 i = 0; i < length && in.get(c); ++i)
+            writer << alphabet_type(c);
+        writer.finish();
+    }
+    else
+    {
+        text.resize(length);
+        text_vector_type::bufwriter_type writer(text);
+        stxxl::random_number32 rng;
+        // repetitive: a random DNA block of 1000 characters, repeated with rare mutations
+        std::vector<alphabet_type> period(1000);
+        for (unsigned i = 0; i < period.size(); ++i)
+            period[i] = "ACGT"[rng() % 4];
+        for (uint64 i = 0; i < length; ++i)
+        {
+            if (repetitive)
+                writer << ((rng() % 1000 == 0) ? alphabet_type('N') : period[i % period.size()]);
+            else
+                writer << alphabet_type("ACGT"[rng() % 4]);
+        }
+        writer.finish();
+    }
+
+    std::cout << "# text of size " << text.size() << std::endl;
+
+    if (text.size() + 3 < std::numeric_limits<uint32>::max())
+        benchmark<uint32>(text, memsize, num_threads, lcp_flag);
+    else
+        benchmark<uint64>(text, memsize, num_threads, lcp_flag);
+
+    return 0;
+}
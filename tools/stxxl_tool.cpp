@@ -58,6 +58,8 @@ extern int benchmark_files(int argc, char * argv[]);
 extern int benchmark_sort(int argc, char * argv[]);
 extern int benchmark_disks_random(int argc, char * argv[]);
 extern int benchmark_pqueue(int argc, char * argv[]);
+extern int benchmark_suffix_array(int argc, char * argv[]);
+extern int benchmark_stable_ksort(int argc, char * argv[]);
 extern int do_mlock(int argc, char * argv[]);
 extern int do_mallinfo(int argc, char * argv[]);
 
@@ -86,6 +88,10 @@ struct SubTool subtools[] = {
       "Benchmark random block access time to .stxxl configured disks." },
     { "benchmark_pqueue", &benchmark_pqueue, false,
       "Benchmark priority queue implementation using sequence of operations." },
+    { "benchmark_suffix_array", &benchmark_suffix_array, false,
+      "Benchmark suffix array and LCP array construction on random, repetitive or real text." },
+    { "benchmark_stable_ksort", &benchmark_stable_ksort, false,
+      "Benchmark stable_ksort with uniform and skewed key distributions." },
     { "mlock", &do_mlock, true,
       "Lock physical memory." },
     { "mallinfo", &do_mallinfo, true,